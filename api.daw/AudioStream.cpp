@@ -0,0 +1,126 @@
+#include"AudioStream.h"
+#include"EngineThreads.h"
+#include"RealtimeSafety.h"
+#include"Trace.h"
+#include"Log.h"
+
+#include<chrono>
+#include<climits>
+#include<cstdio>
+
+static void ConvertEngineBlock(AudioStream* stream, int frameCount)
+{
+    const int channelCount = stream->engine->channelCount;
+    for (int n = 0; n < frameCount; n++)
+    {
+        for (int c = 0; c < channelCount; c++)
+        {
+            float sample = stream->channels[c][n];
+            sample = sample > 1.0f ? 1.0f : (sample < -1.0f ? -1.0f : sample);
+            stream->samples[n * channelCount + c] = (short)(sample * SHRT_MAX);
+        }
+    }
+}
+
+static void FillAudioStreamBuffer(AudioStream* stream, ALuint buffer)
+{
+    TraceScope trace("Audio buffer");
+    Engine* engine = stream->engine;
+
+    /* the graph runs under the real-time checks; handing the block to OpenAL does not */
+    const bool realtime = SetRealtimeThread(true);
+    ProcessEngineBlock(engine, stream->channels, engine->blockSize);
+    SetRealtimeThread(realtime);
+    ConvertEngineBlock(stream, engine->blockSize);
+
+    alBufferData(
+        buffer, engine->channelCount == 2 ? AL_FORMAT_STEREO16 : AL_FORMAT_MONO16,
+        stream->samples, (ALsizei)(sizeof(short) * engine->blockSize * engine->channelCount), engine->sampleRate
+    );
+    alSourceQueueBuffers(stream->source, 1, &buffer);
+}
+
+static void RunAudioStream(AudioStream* stream)
+{
+    SetTraceThreadName("Audio");
+    while (stream->running.load(std::memory_order_acquire))
+    {
+        ALint processed = 0;
+        alGetSourcei(stream->source, AL_BUFFERS_PROCESSED, &processed);
+
+        while (processed-- > 0)
+        {
+            ALuint buffer = 0;
+            alSourceUnqueueBuffers(stream->source, 1, &buffer);
+            FillAudioStreamBuffer(stream, buffer);
+        }
+
+        /* the source stops by itself once every queued buffer has played */
+        ALint state = AL_PLAYING;
+        alGetSourcei(stream->source, AL_SOURCE_STATE, &state);
+        if (state != AL_PLAYING)
+        {
+
+            const unsigned underruns = stream->underruns.fetch_add(1, std::memory_order_relaxed) + 1;
+            LogMessage(LOG_WARNING, "The audio stream underran (%u so far).", underruns);
+            MarkTraceXrun();
+            alSourcePlay(stream->source);
+        }
+
+        std::this_thread::sleep_for(std::chrono::microseconds(AUDIO_STREAM_POLL_MICROSECONDS));
+    }
+}
+
+bool StartAudioStream(AudioStream* stream, Engine* engine)
+{
+    if (engine == NULL)
+        return false;
+
+    stream->engine = engine;
+    stream->samples = new short[(size_t)engine->blockSize * engine->channelCount];
+    for (int c = 0; c < engine->channelCount; c++)
+        stream->channels[c] = new float[engine->blockSize];
+    stream->underruns.store(0);
+
+    alGenSources(1, &stream->source);
+    alGenBuffers(AUDIO_STREAM_BUFFER_COUNT, stream->buffers);
+
+    /* the first blocks render here on the caller's thread, so they get the engine threads' floating point state */
+    const EngineFloatState floatState = EnableEngineDenormalFlush();
+    for (int b = 0; b < AUDIO_STREAM_BUFFER_COUNT; b++)
+        FillAudioStreamBuffer(stream, stream->buffers[b]);
+    SetEngineFloatState(floatState);
+
+    if (alGetError() != AL_NO_ERROR)
+    {
+
+        LogMessage(LOG_ERROR, "The audio stream could not be queued.");
+        return false;
+    }
+
+    alSourcePlay(stream->source);
+
+    stream->running.store(true);
+    stream->thread = CreateEngineThread(RunAudioStream, stream);
+
+    return true;
+}
+
+bool StopAudioStream(AudioStream* stream)
+{
+    if (!stream->running.exchange(false))
+        return false;
+
+    stream->thread.join();
+
+    alSourceStop(stream->source);
+    alSourcei(stream->source, AL_BUFFER, 0);
+    alDeleteSources(1, &stream->source);
+    alDeleteBuffers(AUDIO_STREAM_BUFFER_COUNT, stream->buffers);
+
+    delete[] stream->samples;
+    for (int c = 0; c < stream->engine->channelCount; c++)
+        delete[] stream->channels[c];
+
+    return true;
+}
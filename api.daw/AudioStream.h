@@ -0,0 +1,28 @@
+#pragma once
+
+#include<atomic>
+#include<thread>
+
+#include"AL/al.h"
+
+#include"Engine.h"
+
+/*api.daw audio stream*/
+#define AUDIO_STREAM_BUFFER_COUNT 4
+#define AUDIO_STREAM_POLL_MICROSECONDS 500
+
+struct AudioStream {
+    Engine* engine;
+    ALuint source;
+    ALuint buffers[AUDIO_STREAM_BUFFER_COUNT];
+
+    std::thread thread;
+    std::atomic<bool> running;
+    std::atomic<unsigned> underruns;
+
+    short* samples;
+    float* channels[ENGINE_MAX_CHANNELS];
+};
+
+bool StartAudioStream(AudioStream* stream, Engine* engine);
+bool StopAudioStream(AudioStream* stream);
@@ -0,0 +1,194 @@
+#include"Autosave.h"
+#include"Log.h"
+
+#include<cstdio>
+#include<cstring>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include<windows.h>
+#else
+#include<sys/resource.h>
+#include<sys/syscall.h>
+#include<unistd.h>
+#endif
+
+using namespace std;
+
+#define AUTOSAVE_NICE 19
+
+static void LowerAutosaveThreadPriority()
+{
+#if defined(_WIN32)
+    /* background mode lowers I/O and memory priority along with the CPU priority */
+    SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+#elif defined(__APPLE__)
+    setpriority(PRIO_DARWIN_THREAD, 0, PRIO_DARWIN_BG);
+#else
+    /* Linux keeps a nice value per thread */
+    setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), AUTOSAVE_NICE);
+#endif
+}
+
+bool GetAutosavePath(const char* path, int slot, char* result, int capacity)
+{
+    const int length = snprintf(result, capacity, "%s.autosave%d", path, slot);
+    return length >= 0 && length < capacity;
+}
+
+static void RunAutosave(Autosave* autosave)
+{
+    LowerAutosaveThreadPriority();
+
+    unique_lock<mutex> lock(autosave->mutex);
+    while (true)
+    {
+        autosave->wake.wait(lock, [autosave]() { return autosave->queued || !autosave->running; });
+        if (!autosave->queued)
+            break;
+
+        ProjectVersion version = autosave->job;
+        autosave->job = ProjectVersion();
+        char path[PROJECT_PATH_LENGTH];
+        memcpy(path, autosave->jobPath, sizeof(path));
+        const int slot = autosave->jobSlot;
+        const int retention = autosave->jobRetention;
+        const double snapshotMicroseconds = autosave->jobSnapshotMicroseconds;
+        lock.unlock();
+
+        const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        Project project;
+        BuildProjectFromVersion(version, &project);
+        const double buildMilliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+        char slotPath[AUTOSAVE_PATH_LENGTH];
+        ProjectSaveReport saveReport;
+        memset(&saveReport, 0, sizeof(saveReport));
+        const bool saved = GetAutosavePath(path, slot, slotPath, sizeof(slotPath)) && SaveProjectCopy(slotPath, &project, &saveReport);
+
+        /* slots left over from a larger retention go away */
+        for (int stale = retention; stale < AUTOSAVE_MAX_RETENTION; stale++)
+        {
+            if (GetAutosavePath(path, stale, slotPath, sizeof(slotPath)))
+                remove(slotPath);
+        }
+
+        AutosaveReport report;
+        report.serial = version.serial;
+        report.slot = slot;
+        report.snapshotMicroseconds = snapshotMicroseconds;
+        report.buildMilliseconds = buildMilliseconds;
+        report.writeMilliseconds = saveReport.milliseconds;
+        report.writtenBytes = saveReport.writtenBytes;
+        report.saved = saved;
+
+        /* the snapshot's nodes are released here, off the UI thread */
+        version = ProjectVersion();
+        project = Project();
+
+        /* a failed write leaves the serial alone, so the next request tries the same document again */
+        lock.lock();
+        if (saved)
+            autosave->savedSerial = report.serial;
+        autosave->report = report;
+        autosave->queued = false;
+        autosave->completed.fetch_add(1, memory_order_release);
+    }
+}
+
+bool StartAutosave(Autosave* autosave, int intervalSeconds, int retention)
+{
+    autosave->running = true;
+    autosave->queued = false;
+    autosave->completed.store(0);
+    memset(&autosave->report, 0, sizeof(AutosaveReport));
+
+    autosave->intervalSeconds = intervalSeconds;
+    autosave->retention = retention;
+    autosave->savedSerial = 0;
+    autosave->sequence = 0;
+    autosave->lastRequest = chrono::steady_clock::now();
+
+    autosave->thread = thread(RunAutosave, autosave);
+    return true;
+}
+
+bool StopAutosave(Autosave* autosave)
+{
+    if (!autosave->thread.joinable())
+        return false;
+
+    /* a queued autosave is still written before the thread ends */
+    {
+        lock_guard<mutex> lock(autosave->mutex);
+        autosave->running = false;
+    }
+    autosave->wake.notify_one();
+    autosave->thread.join();
+    return true;
+}
+
+bool RequestAutosave(Autosave* autosave, const ProjectHistory* history, const char* path)
+{
+    unique_lock<mutex> lock(autosave->mutex, try_to_lock);
+    if (!lock.owns_lock() || autosave->queued)
+        return false;
+
+    const ProjectVersion& current = history->versions[history->current];
+    if (current.serial == autosave->savedSerial)
+        return false;
+
+    /* a path that does not fit is refused rather than autosaved under a cut-off name; the next try waits an interval */
+    if (strlen(path) >= sizeof(autosave->jobPath))
+    {
+
+        LogMessage(LOG_ERROR, "The project path %s is too long to autosave.", path);
+        autosave->lastRequest = chrono::steady_clock::now();
+        return false;
+    }
+
+    const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    autosave->job = GetProjectSnapshot(history);
+    autosave->jobSnapshotMicroseconds = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+
+    const int retention = autosave->retention < 1 ? 1 : (autosave->retention > AUTOSAVE_MAX_RETENTION ? AUTOSAVE_MAX_RETENTION : autosave->retention);
+    memcpy(autosave->jobPath, path, strlen(path) + 1);
+    autosave->jobSlot = (int)(autosave->sequence % retention);
+    autosave->jobRetention = retention;
+    autosave->queued = true;
+    lock.unlock();
+    autosave->wake.notify_one();
+
+    autosave->sequence++;
+    autosave->lastRequest = chrono::steady_clock::now();
+    return true;
+}
+
+bool IsAutosaveDue(const Autosave* autosave)
+{
+    if (autosave->intervalSeconds <= 0)
+        return false;
+
+    return chrono::steady_clock::now() - autosave->lastRequest >= chrono::seconds(autosave->intervalSeconds);
+}
+
+bool PollAutosave(Autosave* autosave, const ProjectHistory* history, const char* path)
+{
+    if (!IsAutosaveDue(autosave))
+        return false;
+
+    return RequestAutosave(autosave, history, path);
+}
+
+bool GetAutosaveReport(Autosave* autosave, AutosaveReport* report)
+{
+    if (autosave->completed.load(memory_order_acquire) == 0)
+        return false;
+
+    unique_lock<mutex> lock(autosave->mutex, try_to_lock);
+    if (!lock.owns_lock())
+        return false;
+
+    *report = autosave->report;
+    return true;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include<atomic>
+#include<chrono>
+#include<condition_variable>
+#include<mutex>
+#include<thread>
+
+#include"ProjectFile.h"
+#include"ProjectHistory.h"
+
+/*api.daw autosave*/
+#define AUTOSAVE_DEFAULT_INTERVAL_SECONDS 120
+#define AUTOSAVE_DEFAULT_RETENTION 5
+#define AUTOSAVE_MAX_RETENTION 32
+#define AUTOSAVE_PATH_LENGTH (PROJECT_PATH_LENGTH + 24)
+
+struct AutosaveReport {
+    unsigned long long serial;
+    int slot;
+    double snapshotMicroseconds;
+    double buildMilliseconds;
+    double writeMilliseconds;
+    unsigned long long writtenBytes;
+    bool saved;
+};
+
+/*
+    The UI thread only copies the current ProjectVersion, which is O(1) because every node is
+    shared, and hands it over with a try_lock so a busy writer never stalls a frame. A background
+    thread at the lowest priority rebuilds the project from the snapshot and writes it through
+    SaveProjectCopy (temporary file, sync, rename). Autosaves rotate through retention slots named
+    path.autosave<slot>, overwriting the oldest one of the session.
+*/
+struct Autosave {
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool running;
+
+    /* the queued job, the last report and the serial last written, guarded by mutex */
+    bool queued;
+    ProjectVersion job;
+    char jobPath[PROJECT_PATH_LENGTH];
+    int jobSlot;
+    int jobRetention;
+    double jobSnapshotMicroseconds;
+    AutosaveReport report;
+    unsigned long long savedSerial;
+    std::atomic<unsigned> completed;
+
+    /* owned by the UI thread */
+    int intervalSeconds;
+    int retention;
+    unsigned long long sequence;
+    std::chrono::steady_clock::time_point lastRequest;
+};
+
+bool StartAutosave(Autosave* autosave, int intervalSeconds = AUTOSAVE_DEFAULT_INTERVAL_SECONDS, int retention = AUTOSAVE_DEFAULT_RETENTION);
+bool StopAutosave(Autosave* autosave);
+
+/* true once the interval has passed since the last request */
+bool IsAutosaveDue(const Autosave* autosave);
+
+/* call once per frame; requests an autosave when the interval has passed and the document changed */
+bool PollAutosave(Autosave* autosave, const ProjectHistory* history, const char* path);
+
+/* queues the current version right away; false when the writer is still busy or nothing changed */
+bool RequestAutosave(Autosave* autosave, const ProjectHistory* history, const char* path);
+
+/* the last finished autosave; false until there is one or while the writer holds the report */
+bool GetAutosaveReport(Autosave* autosave, AutosaveReport* report);
+/* false when the result does not fit; a project path shorter than PROJECT_PATH_LENGTH always fits AUTOSAVE_PATH_LENGTH */
+bool GetAutosavePath(const char* path, int slot, char* result, int capacity);
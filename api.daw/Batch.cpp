@@ -0,0 +1,665 @@
+#include"Batch.h"
+#include"Mixer.h"
+#include"ProjectFile.h"
+#include"EngineThreads.h"
+#include"Trace.h"
+#include"Log.h"
+#include"Resample.h"
+#include"sndfile.h"
+
+#include<algorithm>
+#include<atomic>
+#include<cmath>
+#include<cstdio>
+#include<cstdlib>
+#include<cstring>
+#include<thread>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include<windows.h>
+#include<psapi.h>
+#else
+#include<sys/resource.h>
+#endif
+
+using namespace std;
+
+struct BatchFormat {
+    const char* name;
+    int format;
+};
+
+static const BatchFormat BatchFormats[] = {
+    {"wav", SF_FORMAT_WAV | SF_FORMAT_FLOAT},
+    {"wav16", SF_FORMAT_WAV | SF_FORMAT_PCM_16},
+    {"wav24", SF_FORMAT_WAV | SF_FORMAT_PCM_24},
+    {"w64", SF_FORMAT_W64 | SF_FORMAT_FLOAT},
+    {"aiff", SF_FORMAT_AIFF | SF_FORMAT_PCM_24},
+    {"flac", SF_FORMAT_FLAC | SF_FORMAT_PCM_24},
+    {"ogg", SF_FORMAT_OGG | SF_FORMAT_VORBIS},
+};
+
+static const BatchFormat* FindBatchFormat(const char* name)
+{
+    for (const BatchFormat& format : BatchFormats)
+    {
+        if (strcmp(format.name, name) == 0)
+            return &format;
+    }
+
+    return NULL;
+}
+
+static unsigned long long GetCachedSampleBytes(const CachedSample* sample)
+{
+    unsigned long long bytes = 0;
+    for (int c = 0; c < sample->channelCount; c++)
+        bytes += sample->channels[c].size() * sizeof(float);
+    return bytes;
+}
+
+/* reads the whole file and resamples it to the sample's rate */
+static bool DecodeCachedSample(CachedSample* sample)
+{
+    SF_INFO info;
+    memset(&info, 0, sizeof(info));
+    SNDFILE* file = sf_open(sample->path, SFM_READ, &info);
+    if (file == NULL)
+    {
+
+        LogMessage(LOG_ERROR, "The asset %s could not be opened: %s", sample->path, sf_strerror(NULL));
+        return false;
+    }
+
+    vector<float> interleaved((size_t)info.frames * info.channels);
+    const long long read = info.frames > 0 ? sf_readf_float(file, interleaved.data(), info.frames) : 0;
+    sf_close(file);
+    if (read <= 0 || info.samplerate <= 0)
+    {
+
+        LogMessage(LOG_ERROR, "The asset %s holds no audio.", sample->path);
+        return false;
+    }
+
+    sample->channelCount = min(info.channels, ENGINE_MAX_CHANNELS);
+    sample->frameCount = GetResampledFrames(read, info.samplerate, sample->sampleRate);
+    for (int c = 0; c < sample->channelCount; c++)
+    {
+        sample->channels[c].resize((size_t)sample->frameCount);
+        ResampleChannel(interleaved.data() + c, read, info.channels, info.samplerate, sample->channels[c].data(), sample->frameCount, sample->sampleRate);
+    }
+
+    return true;
+}
+
+/* called with the cache locked; samples being decoded or held by a job stay */
+static void EvictCachedSamples(SampleCache* cache)
+{
+    while (cache->bytes > cache->capacity)
+    {
+        int oldest = -1;
+        for (int s = 0; s < (int)cache->samples.size(); s++)
+        {
+            const CachedSample* sample = cache->samples[s];
+            if (sample->users == 0 && !sample->loading && (oldest < 0 || sample->lastUse < cache->samples[oldest]->lastUse))
+                oldest = s;
+        }
+        if (oldest < 0)
+            return;
+
+        CachedSample* sample = cache->samples[oldest];
+        cache->bytes -= GetCachedSampleBytes(sample);
+        cache->samples.erase(cache->samples.begin() + oldest);
+        delete sample;
+    }
+}
+
+/* called with the cache locked; the last job waiting on a failed decode takes the entry out, so a later acquire tries the file again */
+static void DropFailedSample(SampleCache* cache, CachedSample* sample)
+{
+    sample->users--;
+    if (sample->users > 0)
+        return;
+
+    cache->samples.erase(find(cache->samples.begin(), cache->samples.end(), sample));
+    delete sample;
+}
+
+bool InitializeSampleCache(SampleCache* cache, unsigned long long capacity)
+{
+    ClearSampleCache(cache);
+    cache->capacity = capacity;
+    cache->hits = 0;
+    cache->misses = 0;
+    cache->peakBytes = 0;
+    return true;
+}
+
+void ClearSampleCache(SampleCache* cache)
+{
+    lock_guard<mutex> lock(cache->mutex);
+    for (CachedSample* sample : cache->samples)
+        delete sample;
+    cache->samples.clear();
+    cache->bytes = 0;
+    cache->clock = 0;
+}
+
+const CachedSample* AcquireCachedSample(SampleCache* cache, const char* path, int sampleRate)
+{
+    unique_lock<mutex> lock(cache->mutex);
+    for (CachedSample* sample : cache->samples)
+    {
+        if (sample->sampleRate != sampleRate || strcmp(sample->path, path) != 0)
+            continue;
+
+        cache->hits++;
+        sample->users++;
+        cache->loaded.wait(lock, [sample]() { return !sample->loading; });
+        sample->lastUse = ++cache->clock;
+        if (!sample->failed)
+            return sample;
+
+        DropFailedSample(cache, sample);
+        return NULL;
+    }
+
+    cache->misses++;
+    CachedSample* sample = new CachedSample();
+    snprintf(sample->path, BATCH_PATH_LENGTH, "%s", path);
+    sample->sampleRate = sampleRate;
+    sample->channelCount = 0;
+    sample->frameCount = 0;
+    sample->users = 1;
+    sample->lastUse = ++cache->clock;
+    sample->loading = true;
+    sample->failed = false;
+    cache->samples.push_back(sample);
+
+    /* other jobs keep using the cache while this file decodes */
+    lock.unlock();
+    const bool decoded = DecodeCachedSample(sample);
+    lock.lock();
+
+    sample->loading = false;
+    sample->failed = !decoded;
+    cache->loaded.notify_all();
+    if (!decoded)
+    {
+
+        DropFailedSample(cache, sample);
+        return NULL;
+    }
+
+    cache->bytes += GetCachedSampleBytes(sample);
+    cache->peakBytes = max(cache->peakBytes, cache->bytes);
+    EvictCachedSamples(cache);
+    return sample;
+}
+
+void ReleaseCachedSample(SampleCache* cache, const CachedSample* sample)
+{
+    if (sample == NULL)
+        return;
+
+    lock_guard<mutex> lock(cache->mutex);
+    CachedSample* cached = (CachedSample*)sample;
+    cached->users--;
+    cached->lastUse = ++cache->clock;
+    EvictCachedSamples(cache);
+}
+
+/* splits a line into whitespace separated fields in place; quotes keep spaces, # outside them ends the line */
+static int SplitBatchLine(char* line, char** fields, int capacity)
+{
+    int count = 0;
+    char* cursor = line;
+    while (*cursor != '\0')
+    {
+        while (*cursor == ' ' || *cursor == '\t' || *cursor == '\r' || *cursor == '\n')
+            cursor++;
+        if (*cursor == '\0' || *cursor == '#')
+            break;
+
+        const bool quoted = *cursor == '"';
+        if (quoted)
+            cursor++;
+        if (count == capacity)
+            return capacity + 1;
+        fields[count++] = cursor;
+
+        while (*cursor != '\0' && (quoted ? *cursor != '"' : *cursor != ' ' && *cursor != '\t' && *cursor != '\r' && *cursor != '\n'))
+            cursor++;
+        if (*cursor != '\0')
+            *cursor++ = '\0';
+    }
+
+    return count;
+}
+
+static bool ParseBatchSeconds(const char* text, double* seconds)
+{
+    char* end = NULL;
+    *seconds = strtod(text, &end);
+    return end != text && *end == '\0' && *seconds >= 0.0;
+}
+
+bool ReadBatchJobs(const char* path, vector<BatchJob>* jobs)
+{
+    FILE* file = fopen(path, "r");
+    if (file == NULL)
+    {
+
+        LogMessage(LOG_ERROR, "The job list %s could not be opened.", path);
+        return false;
+    }
+
+    jobs->clear();
+    bool valid = true;
+    char line[BATCH_LINE_LENGTH];
+    for (int number = 1; fgets(line, sizeof(line), file) != NULL; number++)
+    {
+        char* fields[5];
+        const int count = SplitBatchLine(line, fields, 5);
+        if (count == 0)
+            continue;
+
+        BatchJob job;
+        memset(&job, 0, sizeof(job));
+        const bool whole = count == 5 && strcmp(fields[2], "end") == 0;
+        if (count != 5 || !ParseBatchSeconds(fields[1], &job.startSeconds) || (!whole && !ParseBatchSeconds(fields[2], &job.endSeconds)))
+        {
+
+            LogMessage(LOG_ERROR, "Line %d of the job list %s is not <project> <start> <end> <format> <output>.", number, path);
+            valid = false;
+            continue;
+        }
+        if (FindBatchFormat(fields[3]) == NULL)
+        {
+
+            LogMessage(LOG_ERROR, "Line %d of the job list %s asks for the unknown format %s.", number, path, fields[3]);
+            valid = false;
+            continue;
+        }
+
+        if (whole)
+            job.endSeconds = BATCH_END_OF_PROJECT;
+        snprintf(job.projectPath, BATCH_PATH_LENGTH, "%s", fields[0]);
+        snprintf(job.format, BATCH_FORMAT_LENGTH, "%s", fields[3]);
+        snprintf(job.outputPath, BATCH_PATH_LENGTH, "%s", fields[4]);
+        jobs->push_back(job);
+    }
+    fclose(file);
+
+    return valid;
+}
+
+/* Plays the clips of one timeline track from the cached samples, with the clip and track gains. */
+struct BatchTrackPlayer {
+    const Timeline* timeline;
+    unsigned track;
+    const vector<const CachedSample*>* samples;
+    vector<unsigned> clips;
+    long long position;
+};
+
+static bool ProcessBatchTrackPlayer(void* state, EngineNodeContext* context)
+{
+    BatchTrackPlayer* player = (BatchTrackPlayer*)state;
+    for (int c = 0; c < context->channelCount; c++)
+        memset(context->channels[c], 0, sizeof(float) * context->frameCount);
+
+    const long long start = player->position;
+    const long long end = start + context->frameCount;
+    player->position = end;
+
+    const TimelineTrack& track = player->timeline->tracks[player->track];
+    if (track.mute)
+        return true;
+
+    const int count = min(QueryTimelineClips(player->timeline, start, end, player->clips.data(), (int)player->clips.size()), (int)player->clips.size());
+    for (int i = 0; i < count; i++)
+    {
+        const TimelineClip& clip = player->timeline->clips[player->clips[i]];
+        if (clip.track != player->track || clip.asset >= player->samples->size() || (*player->samples)[clip.asset] == NULL)
+            continue;
+
+        const CachedSample* sample = (*player->samples)[clip.asset];
+        const long long first = max(start, clip.start);
+        const long long last = min(end, clip.start + clip.length);
+        const float gain = clip.gain * track.gain;
+        for (int c = 0; c < context->channelCount; c++)
+        {
+            const float* source = sample->channels[min(c, sample->channelCount - 1)].data();
+            float* channel = context->channels[c];
+            for (long long n = first; n < last; n++)
+            {
+                const long long index = clip.sourceOffset + n - clip.start;
+                if (index >= 0 && index < sample->frameCount)
+                    channel[n - start] += source[index] * gain;
+            }
+        }
+    }
+
+    return true;
+}
+
+/* Everything one job renders with; players and samples are indexed by timeline track and project asset. */
+struct BatchSession {
+    Project project;
+    Engine* engine;
+    Mixer* mixer;
+    vector<BatchTrackPlayer> players;
+    vector<const CachedSample*> samples;
+    long long first;
+    long long last;
+};
+
+/* relative asset paths are taken from the project's folder; false when the result does not fit */
+static bool ResolveBatchAssetPath(const char* projectPath, const char* assetPath, char* path, size_t capacity)
+{
+    const bool absolute = assetPath[0] == '/' || assetPath[0] == '\\' || (assetPath[0] != '\0' && assetPath[1] == ':');
+    const char* slash = max(strrchr(projectPath, '/'), strrchr(projectPath, '\\'));
+    int length;
+    if (absolute || slash == NULL)
+        length = snprintf(path, capacity, "%s", assetPath);
+    else
+        length = snprintf(path, capacity, "%.*s%s", (int)(slash - projectPath + 1), projectPath, assetPath);
+    return length >= 0 && (size_t)length < capacity;
+}
+
+static bool BuildBatchSession(const BatchJob* job, SampleCache* cache, BatchSession* session)
+{
+    Project* project = &session->project;
+    if (!LoadProject(job->projectPath, project))
+    {
+
+        LogMessage(LOG_ERROR, "The project %s could not be loaded for a batch render.", job->projectPath);
+        return false;
+    }
+
+    const int sampleRate = (int)lround(project->tempoMap.sampleRate);
+    session->first = llround(job->startSeconds * sampleRate);
+    session->last = job->endSeconds < 0.0 ? GetTimelineLength(&project->timeline) : llround(job->endSeconds * sampleRate);
+    if (sampleRate <= 0 || session->last <= session->first)
+    {
+
+        LogMessage(LOG_ERROR, "The project %s has nothing to render between %.3f s and the end of the job.", job->projectPath, job->startSeconds);
+        return false;
+    }
+
+    const int trackCount = (int)project->timeline.tracks.size();
+    if (trackCount > MIXER_MAX_TRACKS || trackCount >= ENGINE_MAX_NODES)
+    {
+
+        LogMessage(LOG_ERROR, "The project %s has more tracks than the mixer takes.", job->projectPath);
+        return false;
+    }
+
+    /* only the assets the range plays are decoded */
+    vector<unsigned> clips(max((size_t)1, project->timeline.clips.size()));
+    const int clipCount = min(QueryTimelineClips(&project->timeline, session->first, session->last, clips.data(), (int)clips.size()), (int)clips.size());
+    session->samples.assign(project->assets.size(), NULL);
+    vector<bool> requested(project->assets.size(), false);
+    for (int i = 0; i < clipCount; i++)
+    {
+        const unsigned asset = project->timeline.clips[clips[i]].asset;
+        if (asset >= project->assets.size() || requested[asset])
+            continue;
+
+        requested[asset] = true;
+        char path[BATCH_PATH_LENGTH];
+        if (!ResolveBatchAssetPath(job->projectPath, project->assets[asset].path, path, sizeof(path)))
+        {
+
+            LogMessage(LOG_ERROR, "The asset path %s of the project %s is too long.", project->assets[asset].path, job->projectPath);
+            return false;
+        }
+        session->samples[asset] = AcquireCachedSample(cache, path, sampleRate);
+        if (session->samples[asset] == NULL)
+        {
+
+            LogMessage(LOG_ERROR, "The asset %s of the project %s could not be read.", path, job->projectPath);
+            return false;
+        }
+    }
+
+    session->engine = CreateEngine(sampleRate, BATCH_BLOCK_SIZE, ENGINE_MAX_CHANNELS);
+    session->mixer = session->engine != NULL ? CreateMixer(session->engine) : NULL;
+    if (session->mixer == NULL)
+        return false;
+
+    session->players.resize(trackCount);
+    for (int t = 0; t < trackCount; t++)
+    {
+        BatchTrackPlayer* player = &session->players[t];
+        player->timeline = &project->timeline;
+        player->track = (unsigned)t;
+        player->samples = &session->samples;
+        player->clips.resize(clips.size());
+        player->position = session->first;
+
+        const char* name = project->timeline.tracks[t].name;
+        const int node = AddEngineNode(session->engine, name, player, ProcessBatchTrackPlayer);
+        if (node == ENGINE_NO_NODE || AddMixerTrack(session->mixer, name, node) < 0)
+            return false;
+    }
+    for (const ProjectStrip& strip : project->strips)
+    {
+        if (strip.kind == PROJECT_STRIP_BUS && AddMixerBus(session->mixer, strip.name) < 0)
+            return false;
+    }
+
+    ApplyProjectMixer(project, session->mixer);
+    return SetEngineOutputNode(session->engine, session->mixer->node) && CompileEngineGraph(session->engine);
+}
+
+static void ReleaseBatchSession(BatchSession* session, SampleCache* cache)
+{
+    if (session->mixer != NULL)
+        DestroyMixer(session->mixer);
+    if (session->engine != NULL)
+        DestroyEngine(session->engine);
+    for (const CachedSample* sample : session->samples)
+        ReleaseCachedSample(cache, sample);
+    delete session;
+}
+
+static bool WriteBatchSession(const BatchJob* job, BatchSession* session)
+{
+    const BatchFormat* format = FindBatchFormat(job->format);
+    SF_INFO info;
+    memset(&info, 0, sizeof(info));
+    info.samplerate = session->engine->sampleRate;
+    info.channels = session->engine->channelCount;
+    info.format = format != NULL ? format->format : 0;
+    SNDFILE* file = format != NULL ? sf_open(job->outputPath, SFM_WRITE, &info) : NULL;
+    if (file == NULL)
+    {
+
+        LogMessage(LOG_ERROR, "The render of %s could not be written to %s: %s", job->projectPath, job->outputPath, sf_strerror(NULL));
+        return false;
+    }
+
+    /* integer formats clip overs instead of wrapping them */
+    if ((info.format & SF_FORMAT_SUBMASK) != SF_FORMAT_FLOAT)
+        sf_command(file, SFC_SET_CLIPPING, NULL, SF_TRUE);
+
+    const int channelCount = session->engine->channelCount;
+    float storage[ENGINE_MAX_CHANNELS][BATCH_BLOCK_SIZE];
+    float* channels[ENGINE_MAX_CHANNELS];
+    for (int c = 0; c < channelCount; c++)
+        channels[c] = storage[c];
+    vector<float> interleaved((size_t)BATCH_BLOCK_SIZE * channelCount);
+
+    bool succeeded = true;
+    for (long long position = session->first; position < session->last && succeeded; position += BATCH_BLOCK_SIZE)
+    {
+        const int frameCount = (int)min((long long)BATCH_BLOCK_SIZE, session->last - position);
+        succeeded = ProcessEngineBlock(session->engine, channels, frameCount);
+        for (int n = 0; n < frameCount; n++)
+        {
+            for (int c = 0; c < channelCount; c++)
+                interleaved[(size_t)n * channelCount + c] = channels[c][n];
+        }
+        succeeded = succeeded && sf_writef_float(file, interleaved.data(), frameCount) == frameCount;
+    }
+    sf_close(file);
+
+    if (!succeeded)
+        LogMessage(LOG_ERROR, "The render of %s could not be written to %s.", job->projectPath, job->outputPath);
+    return succeeded;
+}
+
+bool RenderBatchJob(BatchJob* job, SampleCache* cache)
+{
+    const unsigned long long start = ReadEngineTicks();
+    job->succeeded = false;
+    job->seconds = 0.0;
+    job->megabytes = 0.0;
+
+    BatchSession* session = new BatchSession();
+    session->engine = NULL;
+    session->mixer = NULL;
+    if (BuildBatchSession(job, cache, session) && WriteBatchSession(job, session))
+    {
+
+        job->succeeded = true;
+        job->seconds = (double)(session->last - session->first) / session->engine->sampleRate;
+
+        unsigned long long bytes = sizeof(Engine) + sizeof(Mixer) + session->project.timeline.clips.size() * sizeof(TimelineClip);
+        for (const BatchTrackPlayer& player : session->players)
+            bytes += player.clips.size() * sizeof(unsigned);
+        for (const CachedSample* sample : session->samples)
+            bytes += sample != NULL ? GetCachedSampleBytes(sample) : 0;
+        job->megabytes = bytes / (1024.0 * 1024.0);
+    }
+    ReleaseBatchSession(session, cache);
+
+    job->milliseconds = (ReadEngineTicks() - start) * GetEngineTickSeconds() * 1000.0;
+    job->realtimeFactor = job->milliseconds > 0.0 ? job->seconds * 1000.0 / job->milliseconds : 0.0;
+    job->processPeakMegabytes = GetProcessPeakMegabytes();
+    return job->succeeded;
+}
+
+struct BatchRender {
+    vector<BatchJob>* jobs;
+    SampleCache* cache;
+    atomic<int> next;
+};
+
+static void RunBatchWorker(BatchRender* render)
+{
+    SetTraceThreadName("Batch");
+    vector<BatchJob>& jobs = *render->jobs;
+    for (int j = render->next.fetch_add(1); j < (int)jobs.size(); j = render->next.fetch_add(1))
+    {
+        TraceScope trace("Batch job", j);
+        if (RenderBatchJob(&jobs[j], render->cache))
+            LogMessage(
+                LOG_INFO, "Rendered %s to %s: %.1f s in %.1f ms (%.1fx realtime), %.1f MB", jobs[j].projectPath, jobs[j].outputPath, jobs[j].seconds,
+                jobs[j].milliseconds, jobs[j].realtimeFactor, jobs[j].megabytes
+            );
+    }
+}
+
+bool RunBatchJobs(vector<BatchJob>* jobs, int threadCount, unsigned long long cacheCapacity, BatchReport* report)
+{
+    memset(report, 0, sizeof(*report));
+    if (threadCount <= 0)
+        threadCount = max(1, (int)thread::hardware_concurrency());
+    threadCount = max(1, min(threadCount, (int)jobs->size()));
+
+    SampleCache* cache = new SampleCache();
+    InitializeSampleCache(cache, cacheCapacity);
+    BatchRender render;
+    render.jobs = jobs;
+    render.cache = cache;
+    render.next.store(0);
+
+    const unsigned long long start = ReadEngineTicks();
+    vector<thread> workers;
+    for (int t = 0; t < threadCount; t++)
+        workers.push_back(CreateEngineThread(RunBatchWorker, &render));
+    for (thread& worker : workers)
+        worker.join();
+
+    report->jobs = (int)jobs->size();
+    report->threads = threadCount;
+    report->milliseconds = (ReadEngineTicks() - start) * GetEngineTickSeconds() * 1000.0;
+    for (const BatchJob& job : *jobs)
+    {
+        report->failed += job.succeeded ? 0 : 1;
+        report->audioSeconds += job.seconds;
+    }
+    report->jobsPerHour = report->milliseconds > 0.0 ? (report->jobs - report->failed) * 3600000.0 / report->milliseconds : 0.0;
+    report->realtimeFactor = report->milliseconds > 0.0 ? report->audioSeconds * 1000.0 / report->milliseconds : 0.0;
+    report->processPeakMegabytes = GetProcessPeakMegabytes();
+    report->cachePeakMegabytes = cache->peakBytes / (1024.0 * 1024.0);
+    report->cacheHits = cache->hits;
+    report->cacheMisses = cache->misses;
+
+    ClearSampleCache(cache);
+    delete cache;
+    return report->failed == 0;
+}
+
+double GetProcessPeakMegabytes()
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return 0.0;
+    return counters.PeakWorkingSetSize / (1024.0 * 1024.0);
+#else
+    /* kilobytes on Linux */
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0.0;
+    return usage.ru_maxrss / 1024.0;
+#endif
+}
+
+bool IsBatchRenderCommandLine(int argc, char** argv)
+{
+    return argc >= 3 && strcmp(argv[1], BATCH_RENDER_ARGUMENT) == 0;
+}
+
+int RunBatchRender(int argc, char** argv)
+{
+    if (!IsBatchRenderCommandLine(argc, argv))
+        return -1;
+
+    SetTraceThreadName("Batch");
+    vector<BatchJob> jobs;
+    if (!ReadBatchJobs(argv[2], &jobs))
+        return 1;
+
+    const int threadCount = argc >= 4 ? atoi(argv[3]) : 0;
+    FILE* output = stdout;
+    if (argc >= 5 && (output = fopen(argv[4], "w")) == NULL)
+    {
+
+        LogMessage(LOG_ERROR, "The batch report %s could not be created.", argv[4]);
+        output = stdout;
+    }
+
+    BatchReport report;
+    RunBatchJobs(&jobs, threadCount, (unsigned long long)BATCH_CACHE_MEGABYTES << 20, &report);
+
+    for (const BatchJob& job : jobs)
+        fprintf(
+            output, "%s %s %s: %s, %.1f s in %.1f ms (%.1fx realtime), %.1f MB, process peak %.1f MB\n", job.projectPath, job.format, job.outputPath,
+            job.succeeded ? "rendered" : "failed", job.seconds, job.milliseconds, job.realtimeFactor, job.megabytes, job.processPeakMegabytes
+        );
+    fprintf(
+        output, "Batch: %d jobs, %d failed, %d threads, %.1f s of audio in %.1f ms (%.1fx realtime, %.0f jobs/hour), process peak %.1f MB, cache peak %.1f MB, %llu hits, %llu misses\n",
+        report.jobs, report.failed, report.threads, report.audioSeconds, report.milliseconds, report.realtimeFactor, report.jobsPerHour,
+        report.processPeakMegabytes, report.cachePeakMegabytes, report.cacheHits, report.cacheMisses
+    );
+    if (output != stdout)
+        fclose(output);
+
+    return report.failed == 0 ? 0 : 1;
+}
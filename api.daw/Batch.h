@@ -0,0 +1,115 @@
+#pragma once
+
+#include<condition_variable>
+#include<mutex>
+#include<vector>
+
+#include"Engine.h"
+
+/*api.daw batch render*/
+#define BATCH_RENDER_ARGUMENT "--batch"
+#define BATCH_PATH_LENGTH 260
+#define BATCH_FORMAT_LENGTH 16
+#define BATCH_LINE_LENGTH 2048
+#define BATCH_BLOCK_SIZE 512
+#define BATCH_END_OF_PROJECT -1.0
+#define BATCH_CACHE_MEGABYTES 4096
+
+/* A decoded asset, resampled to the rate of the projects that play it and kept planar. */
+struct CachedSample {
+    char path[BATCH_PATH_LENGTH];
+    int sampleRate;
+    int channelCount;
+    long long frameCount;
+    std::vector<float> channels[ENGINE_MAX_CHANNELS];
+
+    /* guarded by the cache's mutex */
+    int users;
+    unsigned long long lastUse;
+    bool loading;
+    bool failed;
+};
+
+/*
+    Assets shared by every job of a batch, so a file used by many sessions is decoded once.
+    The first job to ask for a file decodes it outside the lock while later ones wait for it;
+    samples no job holds are evicted oldest first once the cache passes its capacity.
+*/
+struct SampleCache {
+    std::mutex mutex;
+    std::condition_variable loaded;
+    std::vector<CachedSample*> samples;
+    unsigned long long capacity;
+    unsigned long long bytes;
+    unsigned long long peakBytes;
+    unsigned long long clock;
+    unsigned long long hits;
+    unsigned long long misses;
+};
+
+bool InitializeSampleCache(SampleCache* cache, unsigned long long capacity);
+void ClearSampleCache(SampleCache* cache);
+
+/* NULL when the file cannot be decoded; every sample acquired is released once */
+const CachedSample* AcquireCachedSample(SampleCache* cache, const char* path, int sampleRate);
+void ReleaseCachedSample(SampleCache* cache, const CachedSample* sample);
+
+/* One line of a job list: a range of a project rendered through its mixer into a file. */
+struct BatchJob {
+    char projectPath[BATCH_PATH_LENGTH];
+    char outputPath[BATCH_PATH_LENGTH];
+    char format[BATCH_FORMAT_LENGTH];
+    double startSeconds;
+    double endSeconds;
+
+    /* filled by the render; megabytes counts the job's engine, mixer and the cached samples it played */
+    bool succeeded;
+    double seconds;
+    double milliseconds;
+    double realtimeFactor;
+    double megabytes;
+    double processPeakMegabytes;
+};
+
+/*
+    Reads a job list, one job per line:
+        <project> <start seconds> <end seconds | end> <format> <output>
+    Paths holding spaces are quoted and # starts a comment. The formats are wav (32-bit
+    float), wav16, wav24, w64, aiff, flac and ogg.
+*/
+bool ReadBatchJobs(const char* path, std::vector<BatchJob>* jobs);
+
+/* renders one job on the calling thread; asset paths relative to the project are read from its folder */
+bool RenderBatchJob(BatchJob* job, SampleCache* cache);
+
+struct BatchReport {
+    int jobs;
+    int failed;
+    int threads;
+    double audioSeconds;
+    double milliseconds;
+    double jobsPerHour;
+    double realtimeFactor;
+    double processPeakMegabytes;
+    double cachePeakMegabytes;
+    unsigned long long cacheHits;
+    unsigned long long cacheMisses;
+};
+
+/*
+    Renders every job on up to threadCount threads of one pool, each job in an engine of its
+    own and all of them sharing one sample cache. Jobs are independent, so throughput grows
+    with the threads until the cores or the disk run out.
+*/
+bool RunBatchJobs(std::vector<BatchJob>* jobs, int threadCount, unsigned long long cacheCapacity, BatchReport* report);
+
+/* the largest working set of the process so far */
+double GetProcessPeakMegabytes();
+
+/*
+    Headless entry point, run before any audio device or window is opened:
+        api.daw --batch <job list> [threads] [report path]
+    writes a line per job and a summary to the report, or to the standard output.
+*/
+bool IsBatchRenderCommandLine(int argc, char** argv);
+int RunBatchRender(int argc, char** argv);
@@ -0,0 +1,733 @@
+#include"Convolution.h"
+#include"EngineThreads.h"
+#include"Simd.h"
+#include"Trace.h"
+#include"Log.h"
+#include"Resample.h"
+
+#include"sndfile.h"
+
+#include<algorithm>
+#include<chrono>
+#include<cmath>
+#include<cstdio>
+#include<cstring>
+
+using namespace std;
+
+typedef float (*ConvolutionDotKernel)(const float* a, const float* b, int count);
+
+static float ConvolutionDotScalar(const float* a, const float* b, int count)
+{
+    float sum = 0.0f;
+    for (int n = 0; n < count; n++)
+        sum += a[n] * b[n];
+    return sum;
+}
+
+DAW_TARGET_AVX2
+static float ConvolutionDotAVX2(const float* a, const float* b, int count)
+{
+    __m256 sum = _mm256_setzero_ps();
+    int n = 0;
+    for (; n + 8 <= count; n += 8)
+        sum = _mm256_fmadd_ps(_mm256_loadu_ps(a + n), _mm256_loadu_ps(b + n), sum);
+
+    __m128 folded = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+    folded = _mm_add_ps(folded, _mm_movehl_ps(folded, folded));
+    folded = _mm_add_ss(folded, _mm_shuffle_ps(folded, folded, 1));
+    float total = _mm_cvtss_f32(folded);
+    for (; n < count; n++)
+        total += a[n] * b[n];
+    return total;
+}
+
+static unsigned GetConvolutionRingSize(long long frames)
+{
+    unsigned size = 1;
+    while (size < frames)
+        size *= 2;
+    return size;
+}
+
+static void InitializeConvolutionLevel(ConvolutionLevel* level, const float* impulse, long long impulseFrames, int partitionFrames, int partitionCount, long long offset)
+{
+    level->partitionFrames = partitionFrames;
+    level->partitionCount = partitionCount;
+    level->bins = partitionFrames + 1;
+    level->offset = offset;
+    InitializeFft(&level->fft, 2 * partitionFrames);
+
+    const size_t spectra = (size_t)partitionCount * level->bins;
+    level->impulseReal.assign(spectra, 0.0f);
+    level->impulseImaginary.assign(spectra, 0.0f);
+    level->inputReal.assign(spectra, 0.0f);
+    level->inputImaginary.assign(spectra, 0.0f);
+    level->accumulatorReal.assign(level->bins, 0.0f);
+    level->accumulatorImaginary.assign(level->bins, 0.0f);
+    level->time.assign(2 * partitionFrames, 0.0f);
+    level->result.assign(2 * partitionFrames, 0.0f);
+
+    /* each partition is zero padded to twice its length, so overlap-save keeps the second half */
+    for (int p = 0; p < partitionCount; p++)
+    {
+        const long long start = offset + (long long)p * partitionFrames;
+        const int frames = (int)max(0LL, min((long long)partitionFrames, impulseFrames - start));
+        fill(level->time.begin(), level->time.end(), 0.0f);
+        if (frames > 0)
+            memcpy(level->time.data(), impulse + start, sizeof(float) * frames);
+        ForwardFft(&level->fft, level->time.data(), level->impulseReal.data() + (size_t)p * level->bins, level->impulseImaginary.data() + (size_t)p * level->bins);
+    }
+    fill(level->time.begin(), level->time.end(), 0.0f);
+
+    const unsigned outputSize = GetConvolutionRingSize(offset + 2 * partitionFrames + CONVOLUTION_HEAD_FRAMES);
+    level->output.assign(outputSize, 0.0f);
+    level->outputMask = outputSize - 1;
+
+    level->requested.store(0);
+    level->completed.store(0);
+    level->busy.store(false);
+}
+
+static size_t GetConvolutionLevelBytes(const ConvolutionLevel* level)
+{
+    const size_t floats = level->impulseReal.size() * 4 + level->accumulatorReal.size() * 2 + level->time.size() * 2 + level->output.size();
+    return floats * sizeof(float);
+}
+
+Convolution* CreateConvolution(const float* const* impulse, int impulseChannels, long long frameCount, int channelCount)
+{
+    if (impulseChannels < 1 || frameCount < 1 || channelCount < 1 || channelCount > ENGINE_MAX_CHANNELS)
+        return NULL;
+
+    /*
+        Partitions grow by CONVOLUTION_LEVEL_GROWTH from level to level. A level keeps
+        CONVOLUTION_LEVEL_PARTITIONS, or more when the next level would otherwise start
+        before twice its own partition size; the last level takes the rest of the impulse.
+    */
+    int partitionFrames[CONVOLUTION_MAX_LEVELS];
+    int partitionCounts[CONVOLUTION_MAX_LEVELS];
+    long long offsets[CONVOLUTION_MAX_LEVELS];
+    int levelCount = 0;
+    long long offset = CONVOLUTION_HEAD_FRAMES;
+    int partition = CONVOLUTION_HEAD_FRAMES;
+    while (offset < frameCount && levelCount < CONVOLUTION_MAX_LEVELS)
+    {
+        const int next = min(partition * CONVOLUTION_LEVEL_GROWTH, CONVOLUTION_MAX_PARTITION);
+        const long long remaining = (frameCount - offset + partition - 1) / partition;
+        long long count = CONVOLUTION_LEVEL_PARTITIONS;
+        while (offset + count * partition < 2LL * next)
+            count++;
+        if (count >= remaining || next == partition || levelCount == CONVOLUTION_MAX_LEVELS - 1)
+            count = remaining;
+
+        partitionFrames[levelCount] = partition;
+        partitionCounts[levelCount] = (int)count;
+        offsets[levelCount] = offset;
+        offset += count * partition;
+        partition = next;
+        levelCount++;
+    }
+
+    int largest = CONVOLUTION_HEAD_FRAMES;
+    for (int l = 0; l < levelCount; l++)
+        largest = max(largest, partitionFrames[l]);
+    const unsigned inputSize = GetConvolutionRingSize((long long)CONVOLUTION_INPUT_PARTITIONS * largest);
+
+    Convolution* convolution = new Convolution();
+    convolution->path[0] = '\0';
+    convolution->channelCount = channelCount;
+    convolution->impulseFrames = frameCount;
+    convolution->avx2 = HasAVX2();
+    convolution->frame = 0;
+    convolution->bytes = 0;
+
+    for (int c = 0; c < channelCount; c++)
+    {
+        const float* samples = impulse[min(c, impulseChannels - 1)];
+        ConvolutionChannel& channel = convolution->channels[c];
+
+        /* reversed, so each output frame is one dot product with the most recent input */
+        channel.head.assign(CONVOLUTION_HEAD_FRAMES, 0.0f);
+        for (int n = 0; n < CONVOLUTION_HEAD_FRAMES && n < frameCount; n++)
+            channel.head[CONVOLUTION_HEAD_FRAMES - 1 - n] = samples[n];
+        channel.history.assign(2 * CONVOLUTION_HEAD_FRAMES, 0.0f);
+        channel.historyPosition = 0;
+
+        channel.input.assign(inputSize, 0.0f);
+        channel.inputMask = inputSize - 1;
+
+        channel.levelCount = levelCount;
+        for (int l = 0; l < levelCount; l++)
+        {
+            ConvolutionLevel* level = &channel.levels[l];
+            InitializeConvolutionLevel(level, samples, frameCount, partitionFrames[l], partitionCounts[l], offsets[l]);
+
+            /* the first level runs on the audio thread as soon as its partition is complete */
+            level->background = l > 0;
+            level->deadline = min(level->offset, (long long)inputSize);
+            convolution->bytes += GetConvolutionLevelBytes(level);
+        }
+        convolution->bytes += (channel.head.size() + channel.history.size() + channel.input.size()) * sizeof(float);
+    }
+
+    return convolution;
+}
+
+Convolution* LoadConvolution(const char* path, int sampleRate, int channelCount)
+{
+    SF_INFO info;
+    memset(&info, 0, sizeof(info));
+    SNDFILE* file = sf_open(path, SFM_READ, &info);
+    if (file == NULL)
+    {
+
+        LogMessage(LOG_ERROR, "The impulse response %s could not be opened: %s", path, sf_strerror(NULL));
+        return NULL;
+    }
+
+    const long long frames = min((long long)info.frames, (long long)CONVOLUTION_MAX_SECONDS * info.samplerate);
+    vector<float> interleaved((size_t)frames * info.channels);
+    const long long read = frames > 0 ? sf_readf_float(file, interleaved.data(), frames) : 0;
+    sf_close(file);
+    if (read <= 0 || info.samplerate <= 0)
+    {
+
+        LogMessage(LOG_ERROR, "The impulse response %s holds no audio.", path);
+        return NULL;
+    }
+    if (info.frames > frames)
+        LogMessage(LOG_WARNING, "The impulse response %s is cut to %d seconds.", path, CONVOLUTION_MAX_SECONDS);
+
+    const int impulseChannels = min(info.channels, ENGINE_MAX_CHANNELS);
+    const long long frameCount = GetResampledFrames(read, info.samplerate, sampleRate);
+    vector<float> channels[ENGINE_MAX_CHANNELS];
+    const float* impulse[ENGINE_MAX_CHANNELS];
+    for (int c = 0; c < impulseChannels; c++)
+    {
+        channels[c].resize((size_t)frameCount);
+        ResampleChannel(interleaved.data() + c, read, info.channels, info.samplerate, channels[c].data(), frameCount, sampleRate);
+        impulse[c] = channels[c].data();
+    }
+
+    Convolution* convolution = CreateConvolution(impulse, impulseChannels, frameCount, channelCount);
+    if (convolution != NULL)
+        snprintf(convolution->path, CONVOLUTION_PATH_LENGTH, "%s", path);
+    return convolution;
+}
+
+Convolution* CopyConvolution(const Convolution* source)
+{
+    Convolution* convolution = new Convolution();
+    snprintf(convolution->path, CONVOLUTION_PATH_LENGTH, "%s", source->path);
+    convolution->channelCount = source->channelCount;
+    convolution->impulseFrames = source->impulseFrames;
+    convolution->bytes = source->bytes;
+    convolution->avx2 = source->avx2;
+    convolution->frame = 0;
+
+    /* only the impulse and its spectra are read from source, and the audio thread never writes those */
+    for (int c = 0; c < source->channelCount; c++)
+    {
+        const ConvolutionChannel& original = source->channels[c];
+        ConvolutionChannel& channel = convolution->channels[c];
+        channel.head = original.head;
+        channel.history.assign(original.history.size(), 0.0f);
+        channel.historyPosition = 0;
+        channel.input.assign(original.input.size(), 0.0f);
+        channel.inputMask = original.inputMask;
+
+        channel.levelCount = original.levelCount;
+        for (int l = 0; l < original.levelCount; l++)
+        {
+            const ConvolutionLevel& from = original.levels[l];
+            ConvolutionLevel* level = &channel.levels[l];
+            level->partitionFrames = from.partitionFrames;
+            level->partitionCount = from.partitionCount;
+            level->bins = from.bins;
+            level->offset = from.offset;
+            level->deadline = from.deadline;
+            level->background = from.background;
+            InitializeFft(&level->fft, 2 * from.partitionFrames);
+
+            level->impulseReal = from.impulseReal;
+            level->impulseImaginary = from.impulseImaginary;
+            level->inputReal.assign(from.inputReal.size(), 0.0f);
+            level->inputImaginary.assign(from.inputImaginary.size(), 0.0f);
+            level->accumulatorReal.assign(from.accumulatorReal.size(), 0.0f);
+            level->accumulatorImaginary.assign(from.accumulatorImaginary.size(), 0.0f);
+            level->time.assign(from.time.size(), 0.0f);
+            level->result.assign(from.result.size(), 0.0f);
+            level->output.assign(from.output.size(), 0.0f);
+            level->outputMask = from.outputMask;
+
+            level->requested.store(0);
+            level->completed.store(0);
+            level->busy.store(false);
+        }
+    }
+
+    return convolution;
+}
+
+void DestroyConvolution(Convolution* convolution)
+{
+    delete convolution;
+}
+
+/* by whoever holds busy: transforms the next input partition and sums it against the impulse */
+static void ProcessConvolutionJob(Convolution* convolution, ConvolutionChannel* channel, ConvolutionLevel* level)
+{
+    const unsigned long long start = ReadEngineTicks();
+    const int frames = level->partitionFrames;
+    const int bins = level->bins;
+    const long long job = level->completed.load(memory_order_relaxed);
+
+    float* time = level->time.data();
+    memmove(time, time + frames, sizeof(float) * frames);
+    memcpy(time + frames, channel->input.data() + (size_t)((unsigned long long)(job * frames) & channel->inputMask), sizeof(float) * frames);
+
+    const int slot = (int)(job % level->partitionCount);
+    ForwardFft(&level->fft, time, level->inputReal.data() + (size_t)slot * bins, level->inputImaginary.data() + (size_t)slot * bins);
+
+    float* accumulatorReal = level->accumulatorReal.data();
+    float* accumulatorImaginary = level->accumulatorImaginary.data();
+    memset(accumulatorReal, 0, sizeof(float) * bins);
+    memset(accumulatorImaginary, 0, sizeof(float) * bins);
+    for (int p = 0; p < level->partitionCount; p++)
+    {
+        const size_t input = (size_t)((slot - p + level->partitionCount) % level->partitionCount) * bins;
+        const size_t impulse = (size_t)p * bins;
+        SpectrumMultiplyAccumulate(
+            &level->fft, level->inputReal.data() + input, level->inputImaginary.data() + input, level->impulseReal.data() + impulse, level->impulseImaginary.data() + impulse,
+            accumulatorReal, accumulatorImaginary, bins
+        );
+    }
+    InverseFft(&level->fft, accumulatorReal, accumulatorImaginary, level->result.data());
+
+    const long long destination = job * frames + level->offset;
+    const float* result = level->result.data() + frames;
+    for (int n = 0; n < frames; n++)
+        level->output[(size_t)((unsigned long long)(destination + n) & level->outputMask)] = result[n];
+
+    level->completed.store(job + 1, memory_order_release);
+    if (level->background)
+    {
+
+        const unsigned long long ticks = ReadEngineTicks() - start;
+        convolution->backgroundTicks.fetch_add(ticks, memory_order_relaxed);
+        WriteTraceEvent("Convolution partition", start, ticks, frames);
+    }
+}
+
+/* audio thread: a level the pool has not caught up with is finished here, or waited for while a worker holds it */
+static void WaitConvolutionLevel(Convolution* convolution, ConvolutionChannel* channel, ConvolutionLevel* level, long long required)
+{
+    if (level->completed.load(memory_order_acquire) >= required)
+        return;
+
+    convolution->lateJobs.fetch_add(1, memory_order_relaxed);
+    while (level->completed.load(memory_order_acquire) < required)
+    {
+        if (!level->busy.load(memory_order_relaxed) && !level->busy.exchange(true, memory_order_acquire))
+        {
+
+            while (level->completed.load(memory_order_relaxed) < required)
+                ProcessConvolutionJob(convolution, channel, level);
+            level->busy.store(false, memory_order_release);
+        }
+        else
+            _mm_pause();
+    }
+}
+
+bool ProcessConvolution(Convolution* convolution, float** channels, int channelCount, int frameCount)
+{
+    const ConvolutionDotKernel dot = convolution->avx2 ? ConvolutionDotAVX2 : ConvolutionDotScalar;
+    channelCount = min(channelCount, convolution->channelCount);
+
+    /* chunks end on head partition boundaries, where the first level runs */
+    int done = 0;
+    while (done < frameCount)
+    {
+        const long long start = convolution->frame;
+        const int chunk = min(frameCount - done, CONVOLUTION_HEAD_FRAMES - (int)(start % CONVOLUTION_HEAD_FRAMES));
+        const long long end = start + chunk;
+
+        for (int c = 0; c < channelCount; c++)
+        {
+            ConvolutionChannel* channel = &convolution->channels[c];
+            float* samples = channels[c] + done;
+
+            /* everything this chunk reads from a level, and every input it is about to overwrite, must be done */
+            for (int l = 0; l < channel->levelCount; l++)
+            {
+                ConvolutionLevel* level = &channel->levels[l];
+                if (level->background && end > level->deadline)
+                    WaitConvolutionLevel(convolution, channel, level, (end - level->deadline + level->partitionFrames - 1) / level->partitionFrames);
+            }
+
+            float* history = channel->history.data();
+            int position = channel->historyPosition;
+            for (int n = 0; n < chunk; n++)
+            {
+                const float sample = samples[n];
+                channel->input[(size_t)((unsigned long long)(start + n) & channel->inputMask)] = sample;
+                history[position] = sample;
+                history[position + CONVOLUTION_HEAD_FRAMES] = sample;
+                samples[n] = dot(channel->head.data(), history + position + 1, CONVOLUTION_HEAD_FRAMES);
+                position = (position + 1) % CONVOLUTION_HEAD_FRAMES;
+            }
+            channel->historyPosition = position;
+
+            for (int l = 0; l < channel->levelCount; l++)
+            {
+                const ConvolutionLevel* level = &channel->levels[l];
+                const float* output = level->output.data();
+                for (int n = 0; n < chunk; n++)
+                    samples[n] += output[(size_t)((unsigned long long)(start + n) & level->outputMask)];
+            }
+
+            if (end % CONVOLUTION_HEAD_FRAMES != 0)
+                continue;
+
+            for (int l = 0; l < channel->levelCount; l++)
+            {
+                ConvolutionLevel* level = &channel->levels[l];
+                if (end % level->partitionFrames != 0)
+                    continue;
+
+                level->requested.store(end / level->partitionFrames, memory_order_release);
+                if (!level->background)
+                    ProcessConvolutionJob(convolution, channel, level);
+            }
+        }
+
+        convolution->frame = end;
+        done += chunk;
+    }
+
+    return true;
+}
+
+static void RunConvolutionPool(ConvolutionPool* pool)
+{
+    SetTraceThreadName("Convolution");
+    while (pool->running.load(memory_order_acquire))
+    {
+        Convolution* convolution = NULL;
+        ConvolutionChannel* channel = NULL;
+        ConvolutionLevel* level = NULL;
+
+        /* the smallest partitions have the closest deadlines */
+        {
+            lock_guard<mutex> lock(pool->mutex);
+            for (Convolution* candidate : pool->convolutions)
+            {
+                for (int c = 0; c < candidate->channelCount; c++)
+                {
+                    ConvolutionChannel* candidateChannel = &candidate->channels[c];
+                    for (int l = 0; l < candidateChannel->levelCount; l++)
+                    {
+                        ConvolutionLevel* candidateLevel = &candidateChannel->levels[l];
+                        if (!candidateLevel->background || candidateLevel->busy.load(memory_order_relaxed))
+                            continue;
+                        if (candidateLevel->completed.load(memory_order_relaxed) >= candidateLevel->requested.load(memory_order_acquire))
+                            continue;
+                        if (level == NULL || candidateLevel->partitionFrames < level->partitionFrames)
+                        {
+
+                            convolution = candidate;
+                            channel = candidateChannel;
+                            level = candidateLevel;
+                        }
+                    }
+                }
+            }
+
+            if (level != NULL && !level->busy.exchange(true, memory_order_acquire))
+                convolution->workers.fetch_add(1, memory_order_relaxed);
+            else
+                level = NULL;
+        }
+
+        if (level == NULL)
+        {
+
+            this_thread::sleep_for(chrono::microseconds(CONVOLUTION_POOL_POLL_MICROSECONDS));
+            continue;
+        }
+
+        while (level->completed.load(memory_order_relaxed) < level->requested.load(memory_order_acquire))
+            ProcessConvolutionJob(convolution, channel, level);
+        level->busy.store(false, memory_order_release);
+        convolution->workers.fetch_sub(1, memory_order_release);
+    }
+}
+
+bool StartConvolutionPool(ConvolutionPool* pool, int threadCount)
+{
+    if (!pool->threads.empty())
+        return false;
+
+    /* one core is left to the audio and UI threads */
+    if (threadCount <= 0)
+        threadCount = max(1, (int)thread::hardware_concurrency() - 1);
+
+    pool->running.store(true);
+    for (int t = 0; t < threadCount; t++)
+        pool->threads.push_back(CreateEngineThread(RunConvolutionPool, pool));
+    return true;
+}
+
+bool StopConvolutionPool(ConvolutionPool* pool)
+{
+    if (pool->threads.empty())
+        return false;
+
+    pool->running.store(false);
+    for (thread& worker : pool->threads)
+        worker.join();
+    pool->threads.clear();
+    return true;
+}
+
+bool AddPooledConvolution(ConvolutionPool* pool, Convolution* convolution)
+{
+    lock_guard<mutex> lock(pool->mutex);
+    pool->convolutions.push_back(convolution);
+    return true;
+}
+
+bool RemovePooledConvolution(ConvolutionPool* pool, Convolution* convolution)
+{
+    {
+        lock_guard<mutex> lock(pool->mutex);
+        vector<Convolution*>::iterator found = find(pool->convolutions.begin(), pool->convolutions.end(), convolution);
+        if (found == pool->convolutions.end())
+            return false;
+        pool->convolutions.erase(found);
+    }
+
+    while (convolution->workers.load(memory_order_acquire) > 0)
+        this_thread::yield();
+    return true;
+}
+
+static void AcquireConvolution(ConvolutionReverb* reverb)
+{
+    /* wait until the UI thread has freed the last retired impulse before swapping again */
+    if (reverb->retired.load(memory_order_acquire) != NULL)
+        return;
+
+    Convolution* convolution = reverb->pending.exchange(NULL, memory_order_acq_rel);
+    if (convolution == NULL)
+        return;
+
+    reverb->retired.store(reverb->active, memory_order_release);
+    reverb->active = convolution;
+}
+
+static bool ProcessConvolutionReverbNode(void* state, EngineNodeContext* context)
+{
+    ConvolutionReverb* reverb = (ConvolutionReverb*)state;
+    AcquireConvolution(reverb);
+    Convolution* convolution = reverb->active;
+    if (convolution == NULL)
+        return true;
+
+    const int channelCount = min(context->channelCount, convolution->channelCount);
+    for (int c = 0; c < channelCount; c++)
+        memcpy(reverb->dryChannels[c], context->channels[c], sizeof(float) * context->frameCount);
+    ProcessConvolution(convolution, context->channels, channelCount, context->frameCount);
+
+    const float dry = reverb->dry.load(memory_order_relaxed);
+    const float wet = reverb->wet.load(memory_order_relaxed);
+    for (int c = 0; c < channelCount; c++)
+    {
+        float* samples = context->channels[c];
+        const float* drySamples = reverb->dryChannels[c];
+        for (int n = 0; n < context->frameCount; n++)
+            samples[n] = drySamples[n] * dry + samples[n] * wet;
+    }
+
+    return true;
+}
+
+/* the copy has no pool, so every level runs inline and the result does not depend on timing */
+static void* CloneConvolutionReverbNode(void* state, Engine* destination)
+{
+    ConvolutionReverb* reverb = (ConvolutionReverb*)state;
+    ConvolutionReverb* clone = new ConvolutionReverb();
+    clone->engine = destination;
+    clone->pool = NULL;
+    clone->node = ENGINE_NO_NODE;
+    clone->dry.store(reverb->dry.load());
+    clone->wet.store(reverb->wet.load());
+    clone->pending.store(NULL);
+    clone->retired.store(NULL);
+    clone->active = reverb->impulse != NULL ? CopyConvolution(reverb->impulse) : NULL;
+    clone->impulse = clone->active;
+    for (int c = 0; c < ENGINE_MAX_CHANNELS; c++)
+        clone->dryChannels[c] = new float[ENGINE_MAX_BLOCK_SIZE]();
+    return clone;
+}
+
+static void ReleaseConvolutionReverbNode(void* state)
+{
+    ConvolutionReverb* reverb = (ConvolutionReverb*)state;
+    ReleaseConvolutionReverb(reverb);
+    delete reverb;
+}
+
+static long long GetConvolutionReverbTail(void* state)
+{
+    ConvolutionReverb* reverb = (ConvolutionReverb*)state;
+    return reverb->impulse != NULL ? reverb->impulse->impulseFrames : 0;
+}
+
+int AddConvolutionReverbNode(Engine* engine, ConvolutionReverb* reverb, ConvolutionPool* pool)
+{
+    reverb->engine = engine;
+    reverb->pool = pool;
+    reverb->dry.store(1.0f);
+    reverb->wet.store(0.3f);
+    reverb->pending.store(NULL);
+    reverb->retired.store(NULL);
+    reverb->active = NULL;
+    reverb->impulse = NULL;
+    for (int c = 0; c < ENGINE_MAX_CHANNELS; c++)
+        reverb->dryChannels[c] = new float[ENGINE_MAX_BLOCK_SIZE]();
+
+    reverb->node = AddEngineNode(engine, "Convolution reverb", reverb, ProcessConvolutionReverbNode);
+    SetEngineNodeClone(engine, reverb->node, CloneConvolutionReverbNode, ReleaseConvolutionReverbNode);
+    SetEngineNodeTail(engine, reverb->node, GetConvolutionReverbTail);
+    return reverb->node;
+}
+
+static void ReleaseConvolution(ConvolutionReverb* reverb, Convolution* convolution)
+{
+    if (convolution == NULL)
+        return;
+
+    if (reverb->pool != NULL)
+        RemovePooledConvolution(reverb->pool, convolution);
+    DestroyConvolution(convolution);
+}
+
+bool SetConvolutionReverbImpulse(ConvolutionReverb* reverb, Convolution* convolution)
+{
+    if (convolution == NULL)
+        return false;
+
+    if (reverb->pool != NULL)
+        AddPooledConvolution(reverb->pool, convolution);
+
+    /* an impulse the audio thread never picked up is freed right away */
+    ReleaseConvolution(reverb, reverb->pending.exchange(convolution, memory_order_acq_rel));
+    reverb->impulse = convolution;
+    return true;
+}
+
+bool CollectConvolutionGarbage(ConvolutionReverb* reverb)
+{
+    Convolution* retired = reverb->retired.exchange(NULL, memory_order_acq_rel);
+    if (retired == NULL)
+        return false;
+
+    ReleaseConvolution(reverb, retired);
+    return true;
+}
+
+bool ReleaseConvolutionReverb(ConvolutionReverb* reverb)
+{
+    ReleaseConvolution(reverb, reverb->pending.exchange(NULL));
+    ReleaseConvolution(reverb, reverb->retired.exchange(NULL));
+    ReleaseConvolution(reverb, reverb->active);
+    reverb->active = NULL;
+    reverb->impulse = NULL;
+
+    for (int c = 0; c < ENGINE_MAX_CHANNELS; c++)
+    {
+        delete[] reverb->dryChannels[c];
+        reverb->dryChannels[c] = NULL;
+    }
+    return true;
+}
+
+struct ConvolutionBenchmark {
+    Convolution* convolution;
+    int blockSize;
+    int blocks;
+    unsigned long long ticks;
+};
+
+static void RunConvolutionBenchmark(ConvolutionBenchmark* benchmark)
+{
+    vector<float> left(benchmark->blockSize);
+    vector<float> right(benchmark->blockSize);
+    float* channels[2] = { left.data(), right.data() };
+
+    unsigned seed = 7;
+    for (int b = 0; b < benchmark->blocks; b++)
+    {
+        for (int n = 0; n < benchmark->blockSize; n++)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            left[n] = right[n] = (float)(seed >> 8) / 16777216.0f - 0.5f;
+        }
+
+        const unsigned long long start = ReadEngineTicks();
+        ProcessConvolution(benchmark->convolution, channels, 2, benchmark->blockSize);
+        benchmark->ticks += ReadEngineTicks() - start;
+    }
+}
+
+int BenchmarkConvolution(int sampleRate, int blockSize, const double* impulseSeconds, int count, ConvolutionBenchmarkResult* results)
+{
+    const double tickSeconds = GetEngineTickSeconds();
+    for (int i = 0; i < count; i++)
+    {
+        /* noise decaying by 60 dB over the impulse, like a room */
+        const long long frames = max(1LL, (long long)(impulseSeconds[i] * sampleRate));
+        vector<float> impulse[2];
+        unsigned seed = 1;
+        for (int c = 0; c < 2; c++)
+        {
+            impulse[c].resize((size_t)frames);
+            for (long long n = 0; n < frames; n++)
+            {
+                seed = seed * 1664525u + 1013904223u;
+                impulse[c][(size_t)n] = ((float)(seed >> 8) / 16777216.0f - 0.5f) * (float)exp(-6.9 * n / frames);
+            }
+        }
+
+        const float* channels[2] = { impulse[0].data(), impulse[1].data() };
+        ConvolutionBenchmark benchmark;
+        benchmark.convolution = CreateConvolution(channels, 2, frames, 2);
+        benchmark.blockSize = blockSize;
+        benchmark.blocks = CONVOLUTION_BENCHMARK_SECONDS * sampleRate / blockSize;
+        benchmark.ticks = 0;
+
+        thread render = CreateEngineThread(RunConvolutionBenchmark, &benchmark);
+        render.join();
+
+        const double audioSeconds = (double)benchmark.blocks * blockSize / sampleRate;
+        const double totalSeconds = benchmark.ticks * tickSeconds;
+        const double backgroundSeconds = benchmark.convolution->backgroundTicks.load() * tickSeconds;
+
+        ConvolutionBenchmarkResult& result = results[i];
+        result.impulseSeconds = impulseSeconds[i];
+        result.levelCount = benchmark.convolution->channels[0].levelCount;
+        result.megabytes = benchmark.convolution->bytes / 1048576.0;
+        result.foregroundMicrosecondsPerBlock = (totalSeconds - backgroundSeconds) / benchmark.blocks * 1e6;
+        result.foregroundPercent = (totalSeconds - backgroundSeconds) / audioSeconds * 100.0;
+        result.backgroundPercent = backgroundSeconds / audioSeconds * 100.0;
+        result.totalPercent = totalSeconds / audioSeconds * 100.0;
+        result.avx2 = benchmark.convolution->avx2;
+
+        DestroyConvolution(benchmark.convolution);
+    }
+
+    return count;
+}
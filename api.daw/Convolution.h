@@ -0,0 +1,159 @@
+#pragma once
+
+#include<atomic>
+#include<mutex>
+#include<thread>
+#include<vector>
+
+#include"Engine.h"
+#include"Fft.h"
+
+/*api.daw convolution*/
+#define CONVOLUTION_HEAD_FRAMES 128
+#define CONVOLUTION_LEVEL_GROWTH 4
+#define CONVOLUTION_LEVEL_PARTITIONS 8
+#define CONVOLUTION_MAX_PARTITION 32768
+#define CONVOLUTION_MAX_LEVELS 8
+#define CONVOLUTION_INPUT_PARTITIONS 4
+#define CONVOLUTION_MAX_SECONDS 20
+#define CONVOLUTION_PATH_LENGTH 260
+#define CONVOLUTION_POOL_POLL_MICROSECONDS 1000
+#define CONVOLUTION_BENCHMARK_SECONDS 10
+
+/*
+    One run of uniform partitions. Its input is cut into blocks of partitionFrames, each
+    block is transformed once and multiplied against every partition of the impulse in the
+    frequency domain, and the sum comes back as the output offset frames later. A level
+    whose offset is at least twice its partition size has a whole partition of time to do
+    that, so it runs on the pool; the audio thread only waits when the pool fell behind.
+*/
+struct ConvolutionLevel {
+    int partitionFrames;
+    int partitionCount;
+    int bins;
+    long long offset;
+    long long deadline;
+    bool background;
+
+    Fft fft;
+    std::vector<float> impulseReal;
+    std::vector<float> impulseImaginary;
+    std::vector<float> inputReal;
+    std::vector<float> inputImaginary;
+    std::vector<float> accumulatorReal;
+    std::vector<float> accumulatorImaginary;
+    std::vector<float> time;
+    std::vector<float> result;
+
+    /* written by whoever holds busy, at absolute frames offset from the input that produced them */
+    std::vector<float> output;
+    unsigned outputMask;
+
+    std::atomic<long long> requested;
+    std::atomic<long long> completed;
+    std::atomic<bool> busy;
+};
+
+/* The first CONVOLUTION_HEAD_FRAMES of the impulse are applied directly, so any block size gets its output without latency. */
+struct ConvolutionChannel {
+    std::vector<float> head;
+    std::vector<float> history;
+    int historyPosition;
+
+    std::vector<float> input;
+    unsigned inputMask;
+
+    int levelCount;
+    ConvolutionLevel levels[CONVOLUTION_MAX_LEVELS];
+};
+
+struct Convolution {
+    char path[CONVOLUTION_PATH_LENGTH];
+    int channelCount;
+    long long impulseFrames;
+    size_t bytes;
+
+    /* the head's dot products use AVX2 whenever the processor has it, like the levels' Fft */
+    bool avx2;
+
+    /* audio thread */
+    long long frame;
+    ConvolutionChannel channels[ENGINE_MAX_CHANNELS];
+
+    std::atomic<int> workers;
+    std::atomic<unsigned long long> lateJobs;
+    std::atomic<unsigned long long> backgroundTicks;
+};
+
+/* Worker threads shared by every convolution; they poll, since the audio thread never signals. */
+struct ConvolutionPool {
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::vector<Convolution*> convolutions;
+    std::atomic<bool> running;
+};
+
+bool StartConvolutionPool(ConvolutionPool* pool, int threadCount = 0);
+bool StopConvolutionPool(ConvolutionPool* pool);
+
+/* impulse holds impulseChannels channels of frameCount frames; output channel c uses impulse channel c, or the last one */
+Convolution* CreateConvolution(const float* const* impulse, int impulseChannels, long long frameCount, int channelCount);
+
+/* reads the impulse with libsndfile and resamples it to sampleRate with the shared windowed sinc resampler */
+Convolution* LoadConvolution(const char* path, int sampleRate, int channelCount);
+
+/* a fresh convolution with the impulse of source, sharing none of its state; source may be running meanwhile */
+Convolution* CopyConvolution(const Convolution* source);
+
+/* must be out of any pool and off the audio thread */
+void DestroyConvolution(Convolution* convolution);
+
+bool AddPooledConvolution(ConvolutionPool* pool, Convolution* convolution);
+
+/* returns once no worker is inside the convolution */
+bool RemovePooledConvolution(ConvolutionPool* pool, Convolution* convolution);
+
+/* replaces channels with the wet signal; levels the pool has not finished are run here */
+bool ProcessConvolution(Convolution* convolution, float** channels, int channelCount, int frameCount);
+
+/* The impulse is swapped like the engine schedule: picked up by the audio thread at the start of a block, the old one retired to the UI. */
+struct ConvolutionReverb {
+    Engine* engine;
+    ConvolutionPool* pool;
+    int node;
+    std::atomic<float> dry;
+    std::atomic<float> wet;
+
+    std::atomic<Convolution*> pending;
+    std::atomic<Convolution*> retired;
+    Convolution* active;
+    float* dryChannels[ENGINE_MAX_CHANNELS];
+
+    /* UI side: the impulse set last */
+    Convolution* impulse;
+};
+
+int AddConvolutionReverbNode(Engine* engine, ConvolutionReverb* reverb, ConvolutionPool* pool);
+
+/* takes ownership; the reverb passes its input through until the first impulse arrives */
+bool SetConvolutionReverbImpulse(ConvolutionReverb* reverb, Convolution* convolution);
+
+/* UI thread, once per frame */
+bool CollectConvolutionGarbage(ConvolutionReverb* reverb);
+
+/* the node must be out of the schedule */
+bool ReleaseConvolutionReverb(ConvolutionReverb* reverb);
+
+struct ConvolutionBenchmarkResult {
+    double impulseSeconds;
+    int levelCount;
+    double megabytes;
+    double foregroundMicrosecondsPerBlock;
+    double foregroundPercent;
+    double backgroundPercent;
+    double totalPercent;
+    bool avx2;
+};
+
+/* runs a stereo reverb over a decaying noise impulse of each length, single threaded so the share the pool would take is timed apart; percentages are of one core in realtime */
+int BenchmarkConvolution(int sampleRate, int blockSize, const double* impulseSeconds, int count, ConvolutionBenchmarkResult* results);
@@ -0,0 +1,579 @@
+#include"DelayLine.h"
+#include"EngineThreads.h"
+#include"Simd.h"
+
+#include<algorithm>
+#include<cmath>
+#include<cstring>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+using namespace std;
+
+/* row q weighs the taps from 3 frames newer to 4 frames older than the read point for a fraction of q / DELAY_SINC_PHASES: a Hann windowed sinc, normalized to unity gain */
+static float DelaySincTable[(DELAY_SINC_PHASES + 1) * DELAY_SINC_TAPS];
+
+static bool ComputeDelaySincTable()
+{
+    const double halfWidth = DELAY_SINC_TAPS / 2 + 0.5;
+    for (int q = 0; q <= DELAY_SINC_PHASES; q++)
+    {
+        const double fraction = (double)q / DELAY_SINC_PHASES;
+        double taps[DELAY_SINC_TAPS];
+        double sum = 0.0;
+        for (int k = 0; k < DELAY_SINC_TAPS; k++)
+        {
+            const double t = fraction - (k - (DELAY_SINC_TAPS / 2 - 1));
+            const double sinc = t == 0.0 ? 1.0 : sin(M_PI * t) / (M_PI * t);
+            taps[k] = sinc * 0.5 * (1.0 + cos(M_PI * t / halfWidth));
+            sum += taps[k];
+        }
+        for (int k = 0; k < DELAY_SINC_TAPS; k++)
+            DelaySincTable[q * DELAY_SINC_TAPS + k] = (float)(taps[k] / sum);
+    }
+
+    return true;
+}
+
+static const bool DelaySincTableComputed = ComputeDelaySincTable();
+
+bool InitializeDelayLine(DelayLine* line, int maxFrames)
+{
+    if (maxFrames <= 0)
+        return false;
+
+    unsigned capacity = 1;
+    while (capacity < (unsigned)maxFrames + DELAY_SINC_TAPS)
+        capacity *= 2;
+
+    line->buffer.assign(capacity, 0.0f);
+    line->mask = capacity - 1;
+    line->position = 0;
+    return true;
+}
+
+void ClearDelayLine(DelayLine* line)
+{
+    fill(line->buffer.begin(), line->buffer.end(), 0.0f);
+}
+
+float GetDelayLineMinimum(int interpolation)
+{
+    switch (interpolation)
+    {
+    case DELAY_INTERPOLATION_CUBIC:
+        return 2.0f;
+    case DELAY_INTERPOLATION_ALLPASS:
+        return 1.5f;
+    case DELAY_INTERPOLATION_SINC:
+        return (float)(DELAY_SINC_TAPS / 2);
+    }
+
+    return 1.0f;
+}
+
+static inline float ReadDelaySample(const float* buffer, unsigned mask, unsigned position, float delay, int interpolation, float* state)
+{
+    /* the allpass keeps its fraction between 0.5 and 1.5, where its coefficient stays well away from -1 */
+    const int whole = interpolation == DELAY_INTERPOLATION_ALLPASS ? (int)(delay - 0.5f) : (int)delay;
+    const float fraction = delay - whole;
+    const unsigned index = position - whole;
+    const float newer = buffer[index & mask];
+    const float older = buffer[(index - 1) & mask];
+
+    switch (interpolation)
+    {
+    case DELAY_INTERPOLATION_CUBIC:
+    {
+
+        const float p0 = buffer[(index + 1) & mask];
+        const float p3 = buffer[(index - 2) & mask];
+        return newer + 0.5f * fraction * (older - p0 + fraction * (2.0f * p0 - 5.0f * newer + 4.0f * older - p3 + fraction * (3.0f * (newer - older) + p3 - p0)));
+    }
+    case DELAY_INTERPOLATION_ALLPASS:
+    {
+
+        const float eta = (1.0f - fraction) / (1.0f + fraction);
+        const float output = eta * newer + older - eta * *state;
+        *state = output;
+        return output;
+    }
+    case DELAY_INTERPOLATION_SINC:
+    {
+
+        const float* taps = DelaySincTable + (int)(fraction * DELAY_SINC_PHASES + 0.5f) * DELAY_SINC_TAPS;
+        float sum = 0.0f;
+        for (int k = 0; k < DELAY_SINC_TAPS; k++)
+            sum += taps[k] * buffer[(index - (k - (DELAY_SINC_TAPS / 2 - 1))) & mask];
+        return sum;
+    }
+    }
+
+    return newer + fraction * (older - newer);
+}
+
+float ReadDelayLine(const DelayLine* line, float delay, int interpolation, float* state)
+{
+    float ignored = 0.0f;
+    delay = min(max(delay, GetDelayLineMinimum(interpolation)), (float)(line->mask + 1 - DELAY_SINC_TAPS));
+    return ReadDelaySample(line->buffer.data(), line->mask, line->position, delay, interpolation, state != NULL ? state : &ignored);
+}
+
+/* what a block of voices needs besides the line and the voices' own state */
+struct DelayVoiceBlock {
+    int voiceCount;
+    int interpolation;
+    float minimum;
+    float base;
+    float baseStep;
+    float depth;
+    float rotationCosine;
+    float rotationSine;
+    float gain;
+    float feedback;
+    float damping;
+};
+
+/* reads every voice, writes input plus the damped feedback, then turns each voice's oscillator by one frame */
+typedef void (*DelayVoicesKernel)(DelayLine* line, DelayVoices* voices, const DelayVoiceBlock* block, const float* input, float* wet, int frameCount);
+
+static void DelayVoicesScalar(DelayLine* line, DelayVoices* voices, const DelayVoiceBlock* block, const float* input, float* wet, int frameCount)
+{
+    float* buffer = line->buffer.data();
+    const unsigned mask = line->mask;
+    float base = block->base;
+    float damped = voices->damped;
+    for (int n = 0; n < frameCount; n++)
+    {
+        float sum = 0.0f;
+        for (int v = 0; v < block->voiceCount; v++)
+        {
+            const float delay = max(block->minimum, base + block->depth * voices->sines[v]);
+            sum += ReadDelaySample(buffer, mask, line->position, delay, block->interpolation, &voices->states[v]);
+
+            const float cosine = voices->cosines[v];
+            voices->cosines[v] = cosine * block->rotationCosine - voices->sines[v] * block->rotationSine;
+            voices->sines[v] = voices->sines[v] * block->rotationCosine + cosine * block->rotationSine;
+        }
+
+        const float sample = sum * block->gain;
+        damped = sample + block->damping * (damped - sample);
+        buffer[line->position & mask] = input[n] + block->feedback * damped;
+        line->position++;
+        wet[n] = sample;
+        base += block->baseStep;
+    }
+    voices->damped = damped;
+}
+
+DAW_TARGET_AVX2
+static inline __m256 GatherDelay(const float* buffer, __m256i index, int offset, __m256i mask)
+{
+    return _mm256_i32gather_ps(buffer, _mm256_and_si256(_mm256_sub_epi32(index, _mm256_set1_epi32(offset)), mask), 4);
+}
+
+/* eight voices per vector, every tap fetched with a gather; lanes past voiceCount run on silent oscillators and weigh nothing */
+DAW_TARGET_AVX2
+static void DelayVoicesAVX2(DelayLine* line, DelayVoices* voices, const DelayVoiceBlock* block, const float* input, float* wet, int frameCount)
+{
+    float* buffer = line->buffer.data();
+    const __m256i mask = _mm256_set1_epi32((int)line->mask);
+    const __m256 minimum = _mm256_set1_ps(block->minimum);
+    const __m256 depth = _mm256_set1_ps(block->depth);
+    const __m256 rotationCosine = _mm256_set1_ps(block->rotationCosine);
+    const __m256 rotationSine = _mm256_set1_ps(block->rotationSine);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const int vectors = (block->voiceCount + 7) / 8;
+    const int interpolation = block->interpolation;
+
+    __m256 weights[DELAY_MAX_VOICES / 8];
+    for (int w = 0; w < vectors; w++)
+    {
+        float lanes[8];
+        for (int l = 0; l < 8; l++)
+            lanes[l] = w * 8 + l < block->voiceCount ? block->gain : 0.0f;
+        weights[w] = _mm256_loadu_ps(lanes);
+    }
+
+    float base = block->base;
+    float damped = voices->damped;
+    for (int n = 0; n < frameCount; n++)
+    {
+        const __m256i position = _mm256_set1_epi32((int)line->position);
+        __m256 sum = _mm256_setzero_ps();
+        for (int w = 0; w < vectors; w++)
+        {
+            __m256 sines = _mm256_loadu_ps(voices->sines + 8 * w);
+            __m256 cosines = _mm256_loadu_ps(voices->cosines + 8 * w);
+            __m256 delay = _mm256_max_ps(minimum, _mm256_fmadd_ps(depth, sines, _mm256_set1_ps(base)));
+            if (interpolation == DELAY_INTERPOLATION_ALLPASS)
+                delay = _mm256_sub_ps(delay, half);
+
+            const __m256i whole = _mm256_cvttps_epi32(delay);
+            __m256 fraction = _mm256_sub_ps(delay, _mm256_cvtepi32_ps(whole));
+            const __m256i index = _mm256_sub_epi32(position, whole);
+            const __m256 newer = GatherDelay(buffer, index, 0, mask);
+            const __m256 older = GatherDelay(buffer, index, 1, mask);
+
+            __m256 output;
+            if (interpolation == DELAY_INTERPOLATION_CUBIC)
+            {
+
+                const __m256 p0 = GatherDelay(buffer, index, -1, mask);
+                const __m256 p3 = GatherDelay(buffer, index, 2, mask);
+                __m256 polynomial = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(3.0f), _mm256_sub_ps(newer, older)), _mm256_sub_ps(p3, p0));
+                polynomial = _mm256_fmadd_ps(
+                    fraction, polynomial,
+                    _mm256_sub_ps(_mm256_fmadd_ps(_mm256_set1_ps(4.0f), older, _mm256_fmsub_ps(_mm256_set1_ps(2.0f), p0, _mm256_mul_ps(_mm256_set1_ps(5.0f), newer))), p3)
+                );
+                polynomial = _mm256_fmadd_ps(fraction, polynomial, _mm256_sub_ps(older, p0));
+                output = _mm256_fmadd_ps(_mm256_mul_ps(half, fraction), polynomial, newer);
+            } else if (interpolation == DELAY_INTERPOLATION_ALLPASS) {
+                fraction = _mm256_add_ps(fraction, half);
+                const __m256 eta = _mm256_div_ps(_mm256_sub_ps(one, fraction), _mm256_add_ps(one, fraction));
+                const __m256 state = _mm256_loadu_ps(voices->states + 8 * w);
+                output = _mm256_fmadd_ps(eta, _mm256_sub_ps(newer, state), older);
+                _mm256_storeu_ps(voices->states + 8 * w, output);
+            } else if (interpolation == DELAY_INTERPOLATION_SINC) {
+                const __m256i phase = _mm256_cvttps_epi32(_mm256_fmadd_ps(fraction, _mm256_set1_ps((float)DELAY_SINC_PHASES), half));
+                const __m256i row = _mm256_mullo_epi32(phase, _mm256_set1_epi32(DELAY_SINC_TAPS));
+                output = _mm256_setzero_ps();
+                for (int k = 0; k < DELAY_SINC_TAPS; k++)
+                {
+                    const __m256 tap = _mm256_i32gather_ps(DelaySincTable, _mm256_add_epi32(row, _mm256_set1_epi32(k)), 4);
+                    output = _mm256_fmadd_ps(tap, GatherDelay(buffer, index, k - (DELAY_SINC_TAPS / 2 - 1), mask), output);
+                }
+            } else
+                output = _mm256_fmadd_ps(fraction, _mm256_sub_ps(older, newer), newer);
+
+            sum = _mm256_fmadd_ps(output, weights[w], sum);
+
+            const __m256 turned = _mm256_fmsub_ps(cosines, rotationCosine, _mm256_mul_ps(sines, rotationSine));
+            sines = _mm256_fmadd_ps(sines, rotationCosine, _mm256_mul_ps(cosines, rotationSine));
+            _mm256_storeu_ps(voices->cosines + 8 * w, turned);
+            _mm256_storeu_ps(voices->sines + 8 * w, sines);
+        }
+
+        __m128 folded = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+        folded = _mm_add_ps(folded, _mm_movehl_ps(folded, folded));
+        folded = _mm_add_ss(folded, _mm_shuffle_ps(folded, folded, 1));
+        const float sample = _mm_cvtss_f32(folded);
+
+        damped = sample + block->damping * (damped - sample);
+        buffer[line->position & line->mask] = input[n] + block->feedback * damped;
+        line->position++;
+        wet[n] = sample;
+        base += block->baseStep;
+    }
+    voices->damped = damped;
+}
+
+bool IsDelayKernelAVX2()
+{
+    return HasAVX2();
+}
+
+bool SetDelayEffectKernels(DelayEffect* effect, bool allowAVX2)
+{
+    effect->avx2 = allowAVX2 && HasAVX2();
+    return effect->avx2;
+}
+
+/* offset turns every oscillator on from where it starts */
+static void ResetDelayVoices(DelayEffect* effect, int voiceCount, double offset = 0.0)
+{
+    for (int c = 0; c < effect->channelCount; c++)
+    {
+        DelayVoices& voices = effect->channelVoices[c];
+        for (int v = 0; v < DELAY_MAX_VOICES; v++)
+        {
+            const double phase = 2.0 * M_PI * v / voiceCount + 0.5 * M_PI * c + offset;
+            voices.cosines[v] = v < voiceCount ? (float)cos(phase) : 0.0f;
+            voices.sines[v] = v < voiceCount ? (float)sin(phase) : 0.0f;
+            voices.states[v] = 0.0f;
+        }
+        voices.damped = 0.0f;
+    }
+    effect->appliedVoices = voiceCount;
+}
+
+bool InitializeDelayEffect(DelayEffect* effect, int sampleRate, int channelCount, int maxFrames)
+{
+    if (sampleRate <= 0 || channelCount <= 0 || channelCount > ENGINE_MAX_CHANNELS || maxFrames <= 0)
+        return false;
+
+    effect->engine = NULL;
+    effect->node = ENGINE_NO_NODE;
+    effect->sampleRate = sampleRate;
+    effect->channelCount = channelCount;
+    effect->avx2 = HasAVX2();
+    effect->bypassed.store(true);
+    effect->interpolation.store(DELAY_INTERPOLATION_CUBIC);
+    SetDelayEffectType(effect, DELAY_EFFECT_CHORUS);
+
+    const int lineFrames = (int)ceil((DELAY_MAX_MILLISECONDS + DELAY_MAX_DEPTH_MILLISECONDS) * sampleRate / 1000.0f);
+    for (int c = 0; c < channelCount; c++)
+        InitializeDelayLine(&effect->lines[c], lineFrames);
+    effect->wet.assign(maxFrames, 0.0f);
+    effect->appliedTime = -1.0f;
+    ResetDelayVoices(effect, effect->voices.load());
+
+    return true;
+}
+
+bool SetDelayEffectType(DelayEffect* effect, int type)
+{
+    switch (type)
+    {
+    case DELAY_EFFECT_ECHO:
+        effect->voices.store(1);
+        effect->time.store(350.0f);
+        effect->depth.store(0.0f);
+        effect->rate.store(0.0f);
+        effect->feedback.store(0.45f);
+        effect->damping.store(0.3f);
+        effect->mix.store(0.3f);
+        break;
+    case DELAY_EFFECT_CHORUS:
+        effect->voices.store(8);
+        effect->time.store(20.0f);
+        effect->depth.store(4.0f);
+        effect->rate.store(0.4f);
+        effect->feedback.store(0.0f);
+        effect->damping.store(0.0f);
+        effect->mix.store(0.5f);
+        break;
+    case DELAY_EFFECT_FLANGER:
+        effect->voices.store(1);
+        effect->time.store(3.0f);
+        effect->depth.store(2.0f);
+        effect->rate.store(0.25f);
+        effect->feedback.store(0.6f);
+        effect->damping.store(0.0f);
+        effect->mix.store(0.5f);
+        break;
+    default:
+        return false;
+    }
+
+    effect->type.store(type);
+    return true;
+}
+
+bool ProcessDelayEffect(DelayEffect* effect, float** channels, int channelCount, int frameCount)
+{
+    if (frameCount <= 0 || frameCount > (int)effect->wet.size())
+        return false;
+    if (effect->bypassed.load(memory_order_relaxed))
+        return true;
+
+    const int voiceCount = min(max(effect->voices.load(memory_order_relaxed), 1), DELAY_MAX_VOICES);
+    if (voiceCount != effect->appliedVoices)
+        ResetDelayVoices(effect, voiceCount);
+
+    DelayVoiceBlock block;
+    block.voiceCount = voiceCount;
+    block.interpolation = min(max(effect->interpolation.load(memory_order_relaxed), 0), DELAY_INTERPOLATION_COUNT - 1);
+    block.minimum = GetDelayLineMinimum(block.interpolation);
+
+    /* a new time glides in over the block instead of jumping */
+    const float framesPerMillisecond = effect->sampleRate / 1000.0f;
+    const float time = min(max(effect->time.load(memory_order_relaxed), 0.0f), DELAY_MAX_MILLISECONDS) * framesPerMillisecond;
+    if (effect->appliedTime < 0.0f)
+        effect->appliedTime = time;
+    block.base = effect->appliedTime;
+    block.baseStep = (time - effect->appliedTime) / frameCount;
+    effect->appliedTime = time;
+
+    const double rotation = 2.0 * M_PI * max(effect->rate.load(memory_order_relaxed), 0.0f) / effect->sampleRate;
+    block.depth = min(max(effect->depth.load(memory_order_relaxed), 0.0f), DELAY_MAX_DEPTH_MILLISECONDS) * framesPerMillisecond;
+    block.rotationCosine = (float)cos(rotation);
+    block.rotationSine = (float)sin(rotation);
+    block.gain = 1.0f / sqrtf((float)voiceCount);
+    block.feedback = min(max(effect->feedback.load(memory_order_relaxed), -0.98f), 0.98f);
+    block.damping = min(max(effect->damping.load(memory_order_relaxed), 0.0f), 0.99f);
+
+    const float mix = min(max(effect->mix.load(memory_order_relaxed), 0.0f), 1.0f);
+    float* wet = effect->wet.data();
+    const DelayVoicesKernel kernel = effect->avx2 ? DelayVoicesAVX2 : DelayVoicesScalar;
+    channelCount = min(channelCount, effect->channelCount);
+    for (int c = 0; c < channelCount; c++)
+    {
+        DelayVoices& voices = effect->channelVoices[c];
+        kernel(&effect->lines[c], &voices, &block, channels[c], wet, frameCount);
+
+        float* samples = channels[c];
+        for (int n = 0; n < frameCount; n++)
+            samples[n] += mix * (wet[n] - samples[n]);
+
+        /* the rotation drifts in float, so each oscillator is pulled back onto the unit circle */
+        for (int v = 0; v < voiceCount; v++)
+        {
+            const float scale = 1.0f / sqrtf(voices.cosines[v] * voices.cosines[v] + voices.sines[v] * voices.sines[v]);
+            voices.cosines[v] *= scale;
+            voices.sines[v] *= scale;
+        }
+    }
+
+    return true;
+}
+
+static bool ProcessDelayEffectNode(void* state, EngineNodeContext* context)
+{
+    return ProcessDelayEffect((DelayEffect*)state, context->channels, context->channelCount, context->frameCount);
+}
+
+static unsigned long long HashDelayEffectNode(void* state, unsigned long long hash)
+{
+    DelayEffect* effect = (DelayEffect*)state;
+    const int switches[4] = {
+        effect->bypassed.load(memory_order_relaxed), effect->type.load(memory_order_relaxed), effect->voices.load(memory_order_relaxed),
+        effect->interpolation.load(memory_order_relaxed)
+    };
+    const float settings[6] = {
+        effect->time.load(memory_order_relaxed), effect->depth.load(memory_order_relaxed), effect->rate.load(memory_order_relaxed),
+        effect->feedback.load(memory_order_relaxed), effect->damping.load(memory_order_relaxed), effect->mix.load(memory_order_relaxed)
+    };
+    hash = HashEngineBytes(hash, switches, sizeof(switches));
+    return HashEngineBytes(hash, settings, sizeof(settings));
+}
+
+static void* CloneDelayEffectNode(void* state, Engine* destination)
+{
+    DelayEffect* effect = (DelayEffect*)state;
+    DelayEffect* clone = new DelayEffect();
+    InitializeDelayEffect(clone, effect->sampleRate, effect->channelCount, destination->blockSize);
+    clone->bypassed.store(effect->bypassed.load());
+    clone->type.store(effect->type.load());
+    clone->voices.store(effect->voices.load());
+    clone->interpolation.store(effect->interpolation.load());
+    clone->time.store(effect->time.load());
+    clone->depth.store(effect->depth.load());
+    clone->rate.store(effect->rate.load());
+    clone->feedback.store(effect->feedback.load());
+    clone->damping.store(effect->damping.load());
+    clone->mix.store(effect->mix.load());
+    return clone;
+}
+
+static void ReleaseDelayEffectNode(void* state)
+{
+    delete (DelayEffect*)state;
+}
+
+/* the lines start empty; only the sweep follows the timeline */
+static bool SeekDelayEffectNode(void* state, long long frame)
+{
+    DelayEffect* effect = (DelayEffect*)state;
+    const double cycles = (double)max(effect->rate.load(), 0.0f) * frame / effect->sampleRate;
+    ResetDelayVoices(effect, min(max(effect->voices.load(), 1), DELAY_MAX_VOICES), 2.0 * M_PI * (cycles - floor(cycles)));
+    return true;
+}
+
+/* every pass around the feedback loop takes the longest delay, until the echoes fall 100 dB */
+static long long GetDelayEffectTail(void* state)
+{
+    DelayEffect* effect = (DelayEffect*)state;
+    if (effect->bypassed.load())
+        return 0;
+
+    const float milliseconds = min(max(effect->time.load(), 0.0f), DELAY_MAX_MILLISECONDS) + min(max(effect->depth.load(), 0.0f), DELAY_MAX_DEPTH_MILLISECONDS);
+    const long long frames = (long long)ceil(milliseconds * effect->sampleRate / 1000.0f) + DELAY_SINC_TAPS;
+    const double feedback = min(fabs((double)effect->feedback.load()), 0.98);
+    const long long passes = feedback < 1e-5 ? 1 : 1 + (long long)ceil(log(1e-5) / log(feedback));
+    return frames * passes;
+}
+
+int AddDelayEffectNode(Engine* engine, DelayEffect* effect, const char* name)
+{
+    effect->engine = engine;
+    effect->node = AddEngineNode(engine, name, effect, ProcessDelayEffectNode);
+    SetEngineNodeHash(engine, effect->node, HashDelayEffectNode);
+    SetEngineNodeClone(engine, effect->node, CloneDelayEffectNode, ReleaseDelayEffectNode);
+    SetEngineNodeSeek(engine, effect->node, SeekDelayEffectNode);
+    SetEngineNodeTail(engine, effect->node, GetDelayEffectTail);
+    return effect->node;
+}
+
+struct DelayBenchmark {
+    DelayEffect* effect;
+    int blockSize;
+    int blocks;
+    unsigned long long ticks;
+};
+
+static void RunDelayBenchmark(DelayBenchmark* benchmark)
+{
+    vector<float> samples(benchmark->blockSize);
+    float* channels[1] = { samples.data() };
+
+    unsigned seed = 3;
+    for (int b = 0; b < benchmark->blocks; b++)
+    {
+        for (int n = 0; n < benchmark->blockSize; n++)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            samples[n] = (float)(seed >> 8) / 16777216.0f - 0.5f;
+        }
+
+        const unsigned long long start = ReadEngineTicks();
+        ProcessDelayEffect(benchmark->effect, channels, 1, benchmark->blockSize);
+        benchmark->ticks += ReadEngineTicks() - start;
+    }
+}
+
+/* the kernel is set on the benchmark's own effect, so the effects the engine runs keep the selected one */
+static double MeasureDelayEffect(int sampleRate, int blockSize, int voices, int interpolation, bool avx2)
+{
+    DelayEffect* effect = new DelayEffect();
+    InitializeDelayEffect(effect, sampleRate, 1, blockSize);
+    SetDelayEffectKernels(effect, avx2);
+    effect->bypassed.store(false);
+    effect->voices.store(voices);
+    effect->interpolation.store(interpolation);
+
+    DelayBenchmark benchmark;
+    benchmark.effect = effect;
+    benchmark.blockSize = blockSize;
+    benchmark.blocks = DELAY_BENCHMARK_SECONDS * sampleRate / blockSize;
+    benchmark.ticks = 0;
+
+    thread render = CreateEngineThread(RunDelayBenchmark, &benchmark);
+    render.join();
+    delete effect;
+
+    return benchmark.ticks * GetEngineTickSeconds() / ((double)benchmark.blocks * blockSize) * 1e9;
+}
+
+int BenchmarkDelay(int sampleRate, int blockSize, const int* voiceCounts, int count, DelayBenchmarkResult* results)
+{
+    double single[DELAY_INTERPOLATION_COUNT];
+    for (int i = 0; i < DELAY_INTERPOLATION_COUNT; i++)
+        single[i] = MeasureDelayEffect(sampleRate, blockSize, 1, i, false);
+
+    int written = 0;
+    for (int pass = 0; pass < 2; pass++)
+    {
+        const bool avx2 = pass == 1;
+        if (avx2 && !HasAVX2())
+            break;
+
+        for (int i = 0; i < DELAY_INTERPOLATION_COUNT; i++)
+        {
+            for (int v = 0; v < count; v++)
+            {
+                DelayBenchmarkResult& result = results[written++];
+                result.voices = min(max(voiceCounts[v], 1), DELAY_MAX_VOICES);
+                result.interpolation = i;
+                result.avx2 = avx2;
+                result.nanosecondsPerFrame = MeasureDelayEffect(sampleRate, blockSize, result.voices, i, avx2);
+                result.singleVoiceRatio = result.nanosecondsPerFrame / single[i];
+            }
+        }
+    }
+
+    return written;
+}
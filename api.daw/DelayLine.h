@@ -0,0 +1,118 @@
+#pragma once
+
+#include<atomic>
+#include<vector>
+
+#include"Engine.h"
+
+/*api.daw delay line*/
+#define DELAY_MAX_MILLISECONDS 2000.0f
+#define DELAY_MAX_DEPTH_MILLISECONDS 50.0f
+#define DELAY_MAX_VOICES 16
+#define DELAY_SINC_TAPS 8
+#define DELAY_SINC_PHASES 256
+#define DELAY_BENCHMARK_SECONDS 5
+
+#define DELAY_INTERPOLATION_LINEAR 0
+#define DELAY_INTERPOLATION_CUBIC 1
+#define DELAY_INTERPOLATION_ALLPASS 2
+#define DELAY_INTERPOLATION_SINC 3
+#define DELAY_INTERPOLATION_COUNT 4
+
+#define DELAY_EFFECT_ECHO 0
+#define DELAY_EFFECT_CHORUS 1
+#define DELAY_EFFECT_FLANGER 2
+
+/*
+    A circular buffer of a power-of-two size, so positions wrap with a mask and never
+    branch. Samples are written at position, which only grows; the sample written d
+    frames ago sits at position - d. Every interpolation needs a few samples on each
+    side of the read point, so delays shorter than GetDelayLineMinimum are raised to it.
+*/
+struct DelayLine {
+    std::vector<float> buffer;
+    unsigned mask;
+    unsigned position;
+};
+
+bool InitializeDelayLine(DelayLine* line, int maxFrames);
+void ClearDelayLine(DelayLine* line);
+float GetDelayLineMinimum(int interpolation);
+
+inline void WriteDelayLine(DelayLine* line, float sample)
+{
+    line->buffer[line->position & line->mask] = sample;
+    line->position++;
+}
+
+/* allpass keeps the previous output of the tap in state and suits delays that move slowly; the other interpolations ignore state */
+float ReadDelayLine(const DelayLine* line, float delay, int interpolation, float* state);
+
+/* One channel's voices: a quadrature oscillator per voice and the allpass state of its tap. */
+struct DelayVoices {
+    float cosines[DELAY_MAX_VOICES];
+    float sines[DELAY_MAX_VOICES];
+    float states[DELAY_MAX_VOICES];
+    float damped;
+};
+
+/*
+    Echo, chorus and flanger are one effect: voiceCount taps swept around a base delay by
+    their own oscillators, summed, fed back through a damping lowpass and mixed with the
+    input. Voices of a channel are spread evenly in phase and channels a quarter turn
+    apart. The SIMD kernel gathers eight voices per instruction.
+*/
+struct DelayEffect {
+    Engine* engine;
+    int node;
+    int sampleRate;
+    int channelCount;
+
+    /* settings, written by the UI thread */
+    std::atomic<bool> bypassed;
+    std::atomic<int> type;
+    std::atomic<int> voices;
+    std::atomic<int> interpolation;
+    std::atomic<float> time;
+    std::atomic<float> depth;
+    std::atomic<float> rate;
+    std::atomic<float> feedback;
+    std::atomic<float> damping;
+    std::atomic<float> mix;
+
+    /* the voices kernel: AVX2 when the processor has it, unless SetDelayEffectKernels turns it off */
+    bool avx2;
+
+    /* audio thread */
+    int appliedVoices;
+    float appliedTime;
+    DelayLine lines[ENGINE_MAX_CHANNELS];
+    DelayVoices channelVoices[ENGINE_MAX_CHANNELS];
+    std::vector<float> wet;
+};
+
+/* a bypassed chorus; maxFrames bounds the block size */
+bool InitializeDelayEffect(DelayEffect* effect, int sampleRate, int channelCount, int maxFrames);
+
+/* echo, chorus and flanger presets for time, voices, depth, rate and feedback */
+bool SetDelayEffectType(DelayEffect* effect, int type);
+
+bool ProcessDelayEffect(DelayEffect* effect, float** channels, int channelCount, int frameCount);
+int AddDelayEffectNode(Engine* engine, DelayEffect* effect, const char* name);
+
+/* new effects take the AVX2 kernel whenever the processor has it; SetDelayEffectKernels changes one that is not processing yet */
+bool IsDelayKernelAVX2();
+bool SetDelayEffectKernels(DelayEffect* effect, bool allowAVX2);
+
+struct DelayBenchmarkResult {
+    int voices;
+    int interpolation;
+    bool avx2;
+    double nanosecondsPerFrame;
+
+    /* against a single scalar voice with the same interpolation */
+    double singleVoiceRatio;
+};
+
+/* a mono chorus of each voice count with each interpolation; results receive the scalar pass and, when supported, the AVX2 pass: up to 2 * DELAY_INTERPOLATION_COUNT * count entries */
+int BenchmarkDelay(int sampleRate, int blockSize, const int* voiceCounts, int count, DelayBenchmarkResult* results);
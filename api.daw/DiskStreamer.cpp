@@ -0,0 +1,224 @@
+#include"DiskStreamer.h"
+#include"EngineThreads.h"
+#include"Trace.h"
+#include"Log.h"
+
+#include<algorithm>
+#include<chrono>
+#include<cstdio>
+#include<cstring>
+
+using namespace std;
+
+/* reads count frames at frame into the ring, padding with silence past the end of the file */
+static void ReadDiskStreamFrames(DiskStream* stream, unsigned long long frame, int count)
+{
+    TraceScope trace("Disk read", count);
+    float* destination = stream->ring + (size_t)(frame & (DISK_STREAM_RING_FRAMES - 1)) * stream->channelCount;
+
+    long long read = 0;
+    if ((long long)frame < stream->frameCount)
+    {
+
+        if (stream->fileFrame != (long long)frame && sf_seek(stream->file, (sf_count_t)frame, SEEK_SET) < 0)
+            stream->fileFrame = -1;
+        else {
+            read = sf_readf_float(stream->file, destination, min((long long)count, stream->frameCount - (long long)frame));
+            stream->fileFrame = (long long)frame + read;
+        }
+    }
+
+    if (read < count)
+        memset(destination + read * stream->channelCount, 0, sizeof(float) * (size_t)(count - read) * stream->channelCount);
+}
+
+static void FillDiskStream(DiskStream* stream)
+{
+    const unsigned epoch = stream->epoch.load(memory_order_acquire);
+    const unsigned long long read = stream->readFrame.load(memory_order_acquire);
+    unsigned long long write = stream->writeFrame.load(memory_order_relaxed);
+
+    /* after a seek or a starved block the ring restarts at the play position */
+    bool restart = epoch != stream->filledEpoch.load(memory_order_relaxed) || write < read;
+    if (restart)
+        write = read;
+
+    while (write - read + DISK_STREAM_READ_FRAMES <= DISK_STREAM_RING_FRAMES)
+    {
+        /* a read never wraps around the end of the ring */
+        const int contiguous = DISK_STREAM_RING_FRAMES - (int)(write & (DISK_STREAM_RING_FRAMES - 1));
+        const int count = min(DISK_STREAM_READ_FRAMES, contiguous);
+        ReadDiskStreamFrames(stream, write, count);
+        write += count;
+
+        /* the first read after a restart is published right away, the rest of the ring fills behind it */
+        stream->writeFrame.store(write, memory_order_release);
+        if (restart)
+        {
+
+            stream->filledEpoch.store(epoch, memory_order_release);
+            restart = false;
+        }
+
+        if (stream->epoch.load(memory_order_acquire) != epoch)
+            return;
+    }
+}
+
+static void RunDiskStreamer(DiskStreamer* streamer)
+{
+    SetTraceThreadName("Disk streamer");
+    unique_lock<mutex> lock(streamer->mutex);
+    while (streamer->running)
+    {
+        for (DiskStream* stream : streamer->streams)
+            FillDiskStream(stream);
+
+        /* the audio thread never signals, so the streamer polls */
+        streamer->wake.wait_for(lock, chrono::milliseconds(DISK_STREAMER_POLL_MILLISECONDS));
+    }
+}
+
+bool StartDiskStreamer(DiskStreamer* streamer)
+{
+    streamer->running = true;
+    streamer->thread = CreateEngineThread(RunDiskStreamer, streamer);
+    return true;
+}
+
+bool StopDiskStreamer(DiskStreamer* streamer)
+{
+    if (!streamer->thread.joinable())
+        return false;
+
+    {
+        lock_guard<mutex> lock(streamer->mutex);
+        streamer->running = false;
+    }
+    streamer->wake.notify_one();
+    streamer->thread.join();
+    return true;
+}
+
+DiskStream* OpenDiskStream(DiskStreamer* streamer, const char* path)
+{
+    SF_INFO info;
+    memset(&info, 0, sizeof(info));
+    SNDFILE* file = sf_open(path, SFM_READ, &info);
+    if (file == NULL)
+    {
+
+        LogMessage(LOG_ERROR, "The stream %s could not be opened: %s", path, sf_strerror(NULL));
+        return NULL;
+    }
+
+    DiskStream* stream = new DiskStream();
+    stream->file = file;
+    stream->channelCount = info.channels;
+    stream->frameCount = info.frames;
+    stream->ring = new float[(size_t)DISK_STREAM_RING_FRAMES * info.channels]();
+    stream->readFrame.store(0);
+    stream->epoch.store(1);
+    stream->writeFrame.store(0);
+    stream->filledEpoch.store(0);
+    stream->fileFrame = -1;
+    stream->playing.store(false);
+    stream->seekRequest.store(DISK_STREAM_NO_SEEK);
+    stream->starvedBlocks.store(0);
+
+    {
+        lock_guard<mutex> lock(streamer->mutex);
+        streamer->streams.push_back(stream);
+    }
+    streamer->wake.notify_one();
+    return stream;
+}
+
+bool CloseDiskStream(DiskStreamer* streamer, DiskStream* stream)
+{
+    if (stream == NULL)
+        return false;
+
+    {
+        lock_guard<mutex> lock(streamer->mutex);
+        streamer->streams.erase(remove(streamer->streams.begin(), streamer->streams.end(), stream), streamer->streams.end());
+    }
+
+    sf_close(stream->file);
+    delete[] stream->ring;
+    delete stream;
+    return true;
+}
+
+bool SetDiskStreamPlaying(DiskStream* stream, bool playing)
+{
+    stream->playing.store(playing, memory_order_release);
+    return true;
+}
+
+bool SeekDiskStream(DiskStream* stream, long long frame)
+{
+    if (frame < 0)
+        return false;
+
+    stream->seekRequest.store(frame, memory_order_release);
+    return true;
+}
+
+static void SilenceDiskStreamOutput(float** channels, int channelCount, int frameCount)
+{
+    for (int c = 0; c < channelCount; c++)
+        memset(channels[c], 0, sizeof(float) * frameCount);
+}
+
+bool ReadDiskStream(DiskStream* stream, float** channels, int channelCount, int frameCount)
+{
+    const unsigned epoch = stream->epoch.load(memory_order_relaxed);
+    const long long seek = stream->seekRequest.exchange(DISK_STREAM_NO_SEEK, memory_order_acq_rel);
+    if (seek != DISK_STREAM_NO_SEEK)
+    {
+
+        stream->readFrame.store((unsigned long long)seek, memory_order_release);
+        stream->epoch.store(epoch + 1, memory_order_release);
+        SilenceDiskStreamOutput(channels, channelCount, frameCount);
+        return false;
+    }
+
+    if (!stream->playing.load(memory_order_acquire))
+    {
+
+        SilenceDiskStreamOutput(channels, channelCount, frameCount);
+        return false;
+    }
+
+    /* the position keeps moving while the streamer refills, so playback stays on time */
+    const unsigned long long read = stream->readFrame.load(memory_order_relaxed);
+    if (stream->filledEpoch.load(memory_order_acquire) != epoch)
+    {
+
+        stream->readFrame.store(read + frameCount, memory_order_release);
+        SilenceDiskStreamOutput(channels, channelCount, frameCount);
+        return false;
+    }
+
+    const unsigned long long write = stream->writeFrame.load(memory_order_acquire);
+    if (write < read + frameCount)
+    {
+
+        stream->starvedBlocks.fetch_add(1, memory_order_relaxed);
+        stream->readFrame.store(read + frameCount, memory_order_release);
+        stream->epoch.store(epoch + 1, memory_order_release);
+        SilenceDiskStreamOutput(channels, channelCount, frameCount);
+        return false;
+    }
+
+    const int fileChannels = stream->channelCount;
+    for (int n = 0; n < frameCount; n++)
+    {
+        const float* frame = stream->ring + (size_t)((read + n) & (DISK_STREAM_RING_FRAMES - 1)) * fileChannels;
+        for (int c = 0; c < channelCount; c++)
+            channels[c][n] = frame[c < fileChannels ? c : fileChannels - 1];
+    }
+    stream->readFrame.store(read + frameCount, memory_order_release);
+    return true;
+}
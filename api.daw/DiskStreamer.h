@@ -0,0 +1,67 @@
+#pragma once
+
+#include<atomic>
+#include<condition_variable>
+#include<mutex>
+#include<thread>
+#include<vector>
+
+#include"sndfile.h"
+
+/*api.daw disk streamer*/
+#define DISK_STREAM_RING_FRAMES (1 << 16)
+#define DISK_STREAM_READ_FRAMES 4096
+#define DISK_STREAMER_POLL_MILLISECONDS 2
+#define DISK_STREAM_NO_SEEK -1
+
+/*
+    A ring of decoded frames between the streamer thread, which reads the file ahead of the
+    play position, and the audio thread, which only copies from the ring. Positions are
+    absolute frames. A seek or a starved block makes the audio thread bump epoch; the
+    streamer then refills from readFrame and publishes the epoch it filled for, and the
+    audio thread plays silence until the two match.
+*/
+struct DiskStream {
+    SNDFILE* file;
+    int channelCount;
+    long long frameCount;
+    float* ring;
+
+    /* written by the audio thread */
+    std::atomic<unsigned long long> readFrame;
+    std::atomic<unsigned> epoch;
+
+    /* written by the streamer thread */
+    std::atomic<unsigned long long> writeFrame;
+    std::atomic<unsigned> filledEpoch;
+    long long fileFrame;
+
+    /* written by the UI thread */
+    std::atomic<bool> playing;
+    std::atomic<long long> seekRequest;
+
+    std::atomic<unsigned> starvedBlocks;
+};
+
+struct DiskStreamer {
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool running;
+    std::vector<DiskStream*> streams;
+};
+
+bool StartDiskStreamer(DiskStreamer* streamer);
+bool StopDiskStreamer(DiskStreamer* streamer);
+
+/* the stream starts stopped at frame 0 */
+DiskStream* OpenDiskStream(DiskStreamer* streamer, const char* path);
+
+/* the audio thread must no longer read the stream */
+bool CloseDiskStream(DiskStreamer* streamer, DiskStream* stream);
+
+bool SetDiskStreamPlaying(DiskStream* stream, bool playing);
+bool SeekDiskStream(DiskStream* stream, long long frame);
+
+/* audio thread: fills frameCount frames of every channel, with silence past the end or while starved */
+bool ReadDiskStream(DiskStream* stream, float** channels, int channelCount, int frameCount);
@@ -0,0 +1,588 @@
+#include"Dynamics.h"
+#include"EngineThreads.h"
+#include"Simd.h"
+
+#include<algorithm>
+#include<cmath>
+#include<cstring>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+using namespace std;
+
+/* phase p interpolates the signal at DYNAMICS_TRUE_PEAK_DELAY - p / PHASES frames back: a Hann windowed sinc, normalized to unity gain */
+static float TruePeakPhases[DYNAMICS_TRUE_PEAK_PHASES][DYNAMICS_TRUE_PEAK_TAPS];
+
+static bool ComputeTruePeakPhases()
+{
+    const double halfWidth = DYNAMICS_TRUE_PEAK_DELAY + 0.5;
+    for (int p = 0; p < DYNAMICS_TRUE_PEAK_PHASES; p++)
+    {
+        double sum = 0.0;
+        double taps[DYNAMICS_TRUE_PEAK_TAPS];
+        for (int k = 0; k < DYNAMICS_TRUE_PEAK_TAPS; k++)
+        {
+            const double t = k - DYNAMICS_TRUE_PEAK_DELAY + (double)p / DYNAMICS_TRUE_PEAK_PHASES;
+            const double sinc = t == 0.0 ? 1.0 : sin(M_PI * t) / (M_PI * t);
+            taps[k] = sinc * 0.5 * (1.0 + cos(M_PI * t / halfWidth));
+            sum += taps[k];
+        }
+        for (int k = 0; k < DYNAMICS_TRUE_PEAK_TAPS; k++)
+            TruePeakPhases[p][k] = (float)(taps[k] / sum);
+    }
+
+    return true;
+}
+
+static const bool TruePeakPhasesComputed = ComputeTruePeakPhases();
+
+/*
+    Detection over a block, linked across channels. histories hold DYNAMICS_TRUE_PEAK_TAPS - 1
+    frames of the previous block ahead of this one. With truePeak, detection[n] is the peak
+    of the oversampled signal from DYNAMICS_TRUE_PEAK_DELAY frames back up to just before
+    the frame after it.
+*/
+typedef void (*DynamicsPeakKernel)(const float* const* histories, int channelCount, int frameCount, bool truePeak, float* detection);
+typedef void (*DynamicsMeanSquareKernel)(const float* const* histories, int channelCount, int frameCount, float* detection);
+
+static float DetectDynamicsPeak(const float* const* histories, int channelCount, int n, bool truePeak)
+{
+    float peak = 0.0f;
+    for (int c = 0; c < channelCount; c++)
+    {
+        const float* x = histories[c] + DYNAMICS_TRUE_PEAK_TAPS - 1 + n;
+        if (!truePeak)
+        {
+
+            peak = max(peak, fabsf(*x));
+            continue;
+        }
+
+        peak = max(peak, fabsf(x[-DYNAMICS_TRUE_PEAK_DELAY]));
+        for (int p = 1; p < DYNAMICS_TRUE_PEAK_PHASES; p++)
+        {
+            float sum = 0.0f;
+            for (int k = 0; k < DYNAMICS_TRUE_PEAK_TAPS; k++)
+                sum += TruePeakPhases[p][k] * x[-k];
+            peak = max(peak, fabsf(sum));
+        }
+    }
+
+    return peak;
+}
+
+static void DynamicsPeakScalar(const float* const* histories, int channelCount, int frameCount, bool truePeak, float* detection)
+{
+    for (int n = 0; n < frameCount; n++)
+        detection[n] = DetectDynamicsPeak(histories, channelCount, n, truePeak);
+}
+
+static void DynamicsMeanSquareScalar(const float* const* histories, int channelCount, int frameCount, float* detection)
+{
+    const float scale = 1.0f / channelCount;
+    for (int n = 0; n < frameCount; n++)
+    {
+        float sum = 0.0f;
+        for (int c = 0; c < channelCount; c++)
+        {
+            const float x = histories[c][DYNAMICS_TRUE_PEAK_TAPS - 1 + n];
+            sum += x * x;
+        }
+        detection[n] = sum * scale;
+    }
+}
+
+/* eight frames per vector; the taps are broadcast, so every phase is a run of fused multiply-adds over shifted loads */
+DAW_TARGET_AVX2
+static void DynamicsPeakAVX2(const float* const* histories, int channelCount, int frameCount, bool truePeak, float* detection)
+{
+    const __m256 magnitude = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    int n = 0;
+    for (; n + 8 <= frameCount; n += 8)
+    {
+        __m256 peak = _mm256_setzero_ps();
+        for (int c = 0; c < channelCount; c++)
+        {
+            const float* x = histories[c] + DYNAMICS_TRUE_PEAK_TAPS - 1 + n;
+            if (!truePeak)
+            {
+
+                peak = _mm256_max_ps(peak, _mm256_and_ps(_mm256_loadu_ps(x), magnitude));
+                continue;
+            }
+
+            peak = _mm256_max_ps(peak, _mm256_and_ps(_mm256_loadu_ps(x - DYNAMICS_TRUE_PEAK_DELAY), magnitude));
+            for (int p = 1; p < DYNAMICS_TRUE_PEAK_PHASES; p++)
+            {
+                __m256 sum = _mm256_setzero_ps();
+                for (int k = 0; k < DYNAMICS_TRUE_PEAK_TAPS; k++)
+                    sum = _mm256_fmadd_ps(_mm256_set1_ps(TruePeakPhases[p][k]), _mm256_loadu_ps(x - k), sum);
+                peak = _mm256_max_ps(peak, _mm256_and_ps(sum, magnitude));
+            }
+        }
+        _mm256_storeu_ps(detection + n, peak);
+    }
+
+    for (; n < frameCount; n++)
+        detection[n] = DetectDynamicsPeak(histories, channelCount, n, truePeak);
+}
+
+DAW_TARGET_AVX2
+static void DynamicsMeanSquareAVX2(const float* const* histories, int channelCount, int frameCount, float* detection)
+{
+    const float scale = 1.0f / channelCount;
+    int n = 0;
+    for (; n + 8 <= frameCount; n += 8)
+    {
+        __m256 sum = _mm256_setzero_ps();
+        for (int c = 0; c < channelCount; c++)
+        {
+            const __m256 x = _mm256_loadu_ps(histories[c] + DYNAMICS_TRUE_PEAK_TAPS - 1 + n);
+            sum = _mm256_fmadd_ps(x, x, sum);
+        }
+        _mm256_storeu_ps(detection + n, _mm256_mul_ps(sum, _mm256_set1_ps(scale)));
+    }
+
+    for (; n < frameCount; n++)
+    {
+        float sum = 0.0f;
+        for (int c = 0; c < channelCount; c++)
+        {
+            const float x = histories[c][DYNAMICS_TRUE_PEAK_TAPS - 1 + n];
+            sum += x * x;
+        }
+        detection[n] = sum * scale;
+    }
+}
+
+bool SetDynamicsKernels(Dynamics* dynamics, bool allowAVX2)
+{
+    dynamics->avx2 = allowAVX2 && HasAVX2();
+    return dynamics->avx2;
+}
+
+static unsigned GetDynamicsCapacity(int frames)
+{
+    unsigned capacity = 1;
+    while (capacity < (unsigned)frames)
+        capacity *= 2;
+    return capacity;
+}
+
+static int GetDynamicsMaxLookahead(const Dynamics* dynamics)
+{
+    return (int)ceil(DYNAMICS_MAX_LOOKAHEAD_MILLISECONDS * dynamics->sampleRate / 1000.0f);
+}
+
+/* a value pushes out every newer-or-equal value that is not smaller, so the front is always the minimum */
+static void PushDynamicsWindow(DynamicsWindow* window, long long position, float value, int length)
+{
+    while (window->tail != window->head && window->values[(window->tail - 1) & window->mask] >= value)
+        window->tail--;
+
+    window->positions[window->tail & window->mask] = position;
+    window->values[window->tail & window->mask] = value;
+    window->tail++;
+
+    while (window->positions[window->head & window->mask] <= position - length)
+        window->head++;
+}
+
+static void ResetDynamicsDetector(Dynamics* dynamics, int lookahead, int latency, bool bypassed)
+{
+    dynamics->appliedBypassed = bypassed;
+    dynamics->appliedLookahead = lookahead;
+    dynamics->appliedLatency = latency;
+    dynamics->gain = 1.0f;
+    dynamics->window.head = 0;
+    dynamics->window.tail = 0;
+
+    /* the moving average starts full of unity gain, so it does not fade in */
+    fill(dynamics->average.begin(), dynamics->average.end(), 1.0f);
+    dynamics->averageSum = lookahead + 1;
+    fill(dynamics->squares.begin(), dynamics->squares.end(), 0.0f);
+    dynamics->squareSum = 0.0;
+    dynamics->squarePosition = 0;
+}
+
+static int ComputeDynamicsLatency(const Dynamics* dynamics)
+{
+    const bool truePeak = dynamics->mode.load(memory_order_relaxed) == DYNAMICS_LIMITER && dynamics->truePeak.load(memory_order_relaxed);
+    return dynamics->lookahead.load(memory_order_relaxed) + (truePeak ? DYNAMICS_TRUE_PEAK_DELAY : 0);
+}
+
+static bool UpdateDynamicsLatency(Dynamics* dynamics)
+{
+    const int latency = ComputeDynamicsLatency(dynamics);
+    dynamics->latency.store(latency, memory_order_relaxed);
+    if (dynamics->engine == NULL || dynamics->node == ENGINE_NO_NODE)
+        return true;
+
+    return SetEngineNodeLatency(dynamics->engine, dynamics->node, latency);
+}
+
+bool InitializeDynamics(Dynamics* dynamics, int sampleRate, int channelCount, int maxFrames)
+{
+    if (sampleRate <= 0 || channelCount <= 0 || channelCount > ENGINE_MAX_CHANNELS || maxFrames <= 0)
+        return false;
+
+    dynamics->engine = NULL;
+    dynamics->node = ENGINE_NO_NODE;
+    dynamics->sampleRate = sampleRate;
+    dynamics->channelCount = channelCount;
+    dynamics->maxFrames = maxFrames;
+    dynamics->avx2 = HasAVX2();
+
+    dynamics->bypassed.store(true);
+    dynamics->mode.store(DYNAMICS_LIMITER);
+    dynamics->detector.store(DYNAMICS_DETECT_PEAK);
+    dynamics->truePeak.store(true);
+    dynamics->threshold.store(-1.0f);
+    dynamics->ratio.store(4.0f);
+    dynamics->knee.store(6.0f);
+    dynamics->attack.store(5.0f);
+    dynamics->release.store(100.0f);
+    dynamics->makeup.store(0.0f);
+    dynamics->lookahead.store((int)lround(5.0 * sampleRate / 1000.0));
+    dynamics->reduction.store(0.0f);
+    dynamics->latency.store(ComputeDynamicsLatency(dynamics));
+
+    const int maxLookahead = GetDynamicsMaxLookahead(dynamics);
+    const unsigned windowCapacity = GetDynamicsCapacity(maxLookahead + 2);
+    dynamics->window.positions.assign(windowCapacity, 0);
+    dynamics->window.values.assign(windowCapacity, 1.0f);
+    dynamics->window.mask = windowCapacity - 1;
+    dynamics->average.assign(windowCapacity, 1.0f);
+
+    dynamics->squareLength = max(1, (int)(DYNAMICS_RMS_MILLISECONDS * sampleRate / 1000.0f));
+    dynamics->squares.assign(dynamics->squareLength, 0.0f);
+
+    const unsigned delayCapacity = GetDynamicsCapacity(maxLookahead + DYNAMICS_TRUE_PEAK_DELAY + 1);
+    dynamics->delayMask = delayCapacity - 1;
+    dynamics->delayPosition = 0;
+    for (int c = 0; c < channelCount; c++)
+    {
+        dynamics->delay[c].assign(delayCapacity, 0.0f);
+        dynamics->history[c].assign(DYNAMICS_TRUE_PEAK_TAPS - 1 + maxFrames, 0.0f);
+    }
+    dynamics->detection.assign(maxFrames, 0.0f);
+    dynamics->gains.assign(maxFrames, 1.0f);
+
+    dynamics->frame = 0;
+    ResetDynamicsDetector(dynamics, dynamics->lookahead.load(), dynamics->latency.load(), true);
+    return true;
+}
+
+bool CopyDynamicsSettings(Dynamics* destination, const Dynamics* source)
+{
+    if (destination->sampleRate != source->sampleRate)
+        return false;
+
+    destination->bypassed.store(source->bypassed.load());
+    destination->mode.store(source->mode.load());
+    destination->detector.store(source->detector.load());
+    destination->truePeak.store(source->truePeak.load());
+    destination->threshold.store(source->threshold.load());
+    destination->ratio.store(source->ratio.load());
+    destination->knee.store(source->knee.load());
+    destination->attack.store(source->attack.load());
+    destination->release.store(source->release.load());
+    destination->makeup.store(source->makeup.load());
+    destination->lookahead.store(source->lookahead.load());
+    return UpdateDynamicsLatency(destination);
+}
+
+/* the static curve with a soft knee of knee dB around the threshold; below the knee no logarithm is taken */
+static float ComputeCompressorGain(float level, float threshold, float slope, float knee, float kneeStart)
+{
+    if (level <= kneeStart)
+        return 1.0f;
+
+    const float over = 20.0f * log10f(level) - threshold;
+    const float reduction = 2.0f * over < knee ? slope * (over + 0.5f * knee) * (over + 0.5f * knee) / (2.0f * knee) : slope * over;
+    return powf(10.0f, reduction / 20.0f);
+}
+
+static float GetDynamicsCoefficient(float milliseconds, int sampleRate)
+{
+    return milliseconds <= 0.0f ? 1.0f : 1.0f - expf(-1000.0f / (milliseconds * sampleRate));
+}
+
+bool ProcessDynamics(Dynamics* dynamics, float** channels, int channelCount, int frameCount)
+{
+    if (frameCount <= 0 || frameCount > dynamics->maxFrames)
+        return false;
+
+    channelCount = min(channelCount, dynamics->channelCount);
+    const bool bypassed = dynamics->bypassed.load(memory_order_relaxed);
+    const bool limiter = dynamics->mode.load(memory_order_relaxed) == DYNAMICS_LIMITER;
+    const bool truePeak = limiter && dynamics->truePeak.load(memory_order_relaxed);
+    const bool rms = !limiter && dynamics->detector.load(memory_order_relaxed) == DYNAMICS_DETECT_RMS;
+    const int lookahead = min(max(dynamics->lookahead.load(memory_order_relaxed), 0), GetDynamicsMaxLookahead(dynamics));
+    const int latency = lookahead + (truePeak ? DYNAMICS_TRUE_PEAK_DELAY : 0);
+    if (bypassed != dynamics->appliedBypassed || lookahead != dynamics->appliedLookahead || latency != dynamics->appliedLatency)
+        ResetDynamicsDetector(dynamics, lookahead, latency, bypassed);
+
+    float* histories[ENGINE_MAX_CHANNELS];
+    for (int c = 0; c < channelCount; c++)
+    {
+        histories[c] = dynamics->history[c].data();
+        memcpy(histories[c] + DYNAMICS_TRUE_PEAK_TAPS - 1, channels[c], sizeof(float) * frameCount);
+    }
+
+    float* gains = dynamics->gains.data();
+    float deepest = 1.0f;
+    if (bypassed)
+        fill(gains, gains + frameCount, 1.0f);
+    else {
+        float* detection = dynamics->detection.data();
+        if (rms)
+        {
+
+            const DynamicsMeanSquareKernel meanSquare = dynamics->avx2 ? DynamicsMeanSquareAVX2 : DynamicsMeanSquareScalar;
+            meanSquare(histories, channelCount, frameCount, detection);
+        } else {
+
+            const DynamicsPeakKernel peak = dynamics->avx2 ? DynamicsPeakAVX2 : DynamicsPeakScalar;
+            peak(histories, channelCount, frameCount, truePeak, detection);
+        }
+
+        const float threshold = dynamics->threshold.load(memory_order_relaxed);
+        const float ratio = max(dynamics->ratio.load(memory_order_relaxed), 1.0f);
+        const float knee = max(dynamics->knee.load(memory_order_relaxed), 0.0f);
+        const float ceiling = powf(10.0f, threshold / 20.0f);
+        const float kneeStart = powf(10.0f, (threshold - 0.5f * knee) / 20.0f);
+        const float makeup = limiter ? 1.0f : powf(10.0f, dynamics->makeup.load(memory_order_relaxed) / 20.0f);
+        const float attack = GetDynamicsCoefficient(dynamics->attack.load(memory_order_relaxed), dynamics->sampleRate);
+        const float release = GetDynamicsCoefficient(dynamics->release.load(memory_order_relaxed), dynamics->sampleRate);
+
+        /* the limiter holds each minimum one frame longer, for the inter-sample peak that follows the frame */
+        const int windowLength = lookahead + 1 + (limiter ? 1 : 0);
+        const int averageLength = lookahead + 1;
+        const unsigned averageMask = (unsigned)dynamics->average.size() - 1;
+        float gain = dynamics->gain;
+        for (int n = 0; n < frameCount; n++)
+        {
+            const long long frame = dynamics->frame + n;
+            float level = detection[n];
+            if (rms)
+            {
+
+                float& oldest = dynamics->squares[dynamics->squarePosition];
+                dynamics->squareSum += level - oldest;
+                oldest = level;
+                dynamics->squarePosition = dynamics->squarePosition + 1 == dynamics->squareLength ? 0 : dynamics->squarePosition + 1;
+                level = sqrtf((float)max(0.0, dynamics->squareSum / dynamics->squareLength));
+            }
+
+            float required;
+            if (limiter)
+                required = level > ceiling ? ceiling / level : 1.0f;
+            else
+                required = ComputeCompressorGain(level, threshold, 1.0f / ratio - 1.0f, knee, kneeStart);
+
+            PushDynamicsWindow(&dynamics->window, frame, required, windowLength);
+            const float minimum = dynamics->window.values[dynamics->window.head & dynamics->window.mask];
+
+            if (limiter)
+            {
+
+                /* every minimum averaged here covers the peak by the time it comes out, so the average does too */
+                float& oldest = dynamics->average[(unsigned)(frame - averageLength) & averageMask];
+                dynamics->averageSum -= oldest;
+                dynamics->average[(unsigned)frame & averageMask] = minimum;
+                dynamics->averageSum += minimum;
+                const float target = (float)(dynamics->averageSum / averageLength);
+                gain = target < gain ? target : gain + (target - gain) * release;
+            }
+            else
+                gain += (minimum - gain) * (minimum < gain ? attack : release);
+
+            deepest = min(deepest, gain);
+            gains[n] = gain * makeup;
+        }
+        dynamics->gain = gain;
+    }
+    dynamics->frame += frameCount;
+    dynamics->reduction.store(20.0f * log10f(max(deepest, 1e-6f)), memory_order_relaxed);
+
+    const unsigned mask = dynamics->delayMask;
+    const unsigned position = dynamics->delayPosition;
+    for (int c = 0; c < channelCount; c++)
+    {
+        float* samples = channels[c];
+        float* delay = dynamics->delay[c].data();
+        for (int n = 0; n < frameCount; n++)
+        {
+            delay[(position + n) & mask] = samples[n];
+            samples[n] = delay[(position + n - latency) & mask] * gains[n];
+        }
+
+        memmove(histories[c], histories[c] + frameCount, sizeof(float) * (DYNAMICS_TRUE_PEAK_TAPS - 1));
+    }
+    dynamics->delayPosition = position + frameCount;
+
+    return true;
+}
+
+bool SetDynamicsMode(Dynamics* dynamics, int mode)
+{
+    if (mode != DYNAMICS_COMPRESSOR && mode != DYNAMICS_LIMITER)
+        return false;
+
+    dynamics->mode.store(mode, memory_order_relaxed);
+    return UpdateDynamicsLatency(dynamics);
+}
+
+bool SetDynamicsTruePeak(Dynamics* dynamics, bool truePeak)
+{
+    dynamics->truePeak.store(truePeak, memory_order_relaxed);
+    return UpdateDynamicsLatency(dynamics);
+}
+
+bool SetDynamicsLookahead(Dynamics* dynamics, float milliseconds)
+{
+    milliseconds = min(max(milliseconds, 0.0f), DYNAMICS_MAX_LOOKAHEAD_MILLISECONDS);
+    dynamics->lookahead.store(min((int)lround(milliseconds * dynamics->sampleRate / 1000.0), GetDynamicsMaxLookahead(dynamics)), memory_order_relaxed);
+    return UpdateDynamicsLatency(dynamics);
+}
+
+float GetDynamicsLookahead(const Dynamics* dynamics)
+{
+    return dynamics->lookahead.load(memory_order_relaxed) * 1000.0f / dynamics->sampleRate;
+}
+
+static bool ProcessDynamicsNode(void* state, EngineNodeContext* context)
+{
+    return ProcessDynamics((Dynamics*)state, context->channels, context->channelCount, context->frameCount);
+}
+
+static unsigned long long HashDynamicsNode(void* state, unsigned long long hash)
+{
+    Dynamics* dynamics = (Dynamics*)state;
+    const int switches[4] = {
+        dynamics->bypassed.load(memory_order_relaxed), dynamics->mode.load(memory_order_relaxed), dynamics->detector.load(memory_order_relaxed),
+        dynamics->truePeak.load(memory_order_relaxed)
+    };
+    const float settings[6] = {
+        dynamics->threshold.load(memory_order_relaxed), dynamics->ratio.load(memory_order_relaxed), dynamics->knee.load(memory_order_relaxed),
+        dynamics->attack.load(memory_order_relaxed), dynamics->release.load(memory_order_relaxed), dynamics->makeup.load(memory_order_relaxed)
+    };
+    const int lookahead = dynamics->lookahead.load(memory_order_relaxed);
+    hash = HashEngineBytes(hash, switches, sizeof(switches));
+    hash = HashEngineBytes(hash, settings, sizeof(settings));
+    return HashEngineBytes(hash, &lookahead, sizeof(lookahead));
+}
+
+static void* CloneDynamicsNode(void* state, Engine* destination)
+{
+    Dynamics* dynamics = (Dynamics*)state;
+    Dynamics* clone = new Dynamics();
+    InitializeDynamics(clone, dynamics->sampleRate, dynamics->channelCount, destination->blockSize);
+    CopyDynamicsSettings(clone, dynamics);
+    return clone;
+}
+
+static void ReleaseDynamicsNode(void* state)
+{
+    delete (Dynamics*)state;
+}
+
+/* the delay line, then the envelope settling from wherever a fresh instance starts */
+static long long GetDynamicsTail(void* state)
+{
+    Dynamics* dynamics = (Dynamics*)state;
+    const long long latency = dynamics->latency.load();
+    if (dynamics->bypassed.load())
+        return latency;
+
+    const float milliseconds = DYNAMICS_TAIL_TIME_CONSTANTS * (max(dynamics->attack.load(), 0.0f) + max(dynamics->release.load(), 0.0f)) + DYNAMICS_RMS_MILLISECONDS;
+    return latency + (long long)ceil(milliseconds * dynamics->sampleRate / 1000.0f);
+}
+
+int AddDynamicsNode(Engine* engine, Dynamics* dynamics, const char* name)
+{
+    dynamics->engine = engine;
+    dynamics->node = AddEngineNode(engine, name, dynamics, ProcessDynamicsNode);
+    SetEngineNodeHash(engine, dynamics->node, HashDynamicsNode);
+    SetEngineNodeClone(engine, dynamics->node, CloneDynamicsNode, ReleaseDynamicsNode);
+    SetEngineNodeTail(engine, dynamics->node, GetDynamicsTail);
+    UpdateDynamicsLatency(dynamics);
+    return dynamics->node;
+}
+
+struct DynamicsBenchmark {
+    Dynamics* dynamics;
+    int blockSize;
+    int blocks;
+    unsigned long long ticks;
+};
+
+static void RunDynamicsBenchmark(DynamicsBenchmark* benchmark)
+{
+    vector<float> left(benchmark->blockSize);
+    vector<float> right(benchmark->blockSize);
+    float* channels[2] = { left.data(), right.data() };
+
+    /* noise in bursts a few blocks long, so the limiter keeps attacking and releasing */
+    unsigned seed = 7;
+    for (int b = 0; b < benchmark->blocks; b++)
+    {
+        const float level = (b / 4) % 2 == 0 ? 2.0f : 0.25f;
+        for (int n = 0; n < benchmark->blockSize; n++)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            left[n] = right[n] = level * ((float)(seed >> 8) / 16777216.0f - 0.5f);
+        }
+
+        const unsigned long long start = ReadEngineTicks();
+        ProcessDynamics(benchmark->dynamics, channels, 2, benchmark->blockSize);
+        benchmark->ticks += ReadEngineTicks() - start;
+    }
+}
+
+int BenchmarkDynamics(int sampleRate, int blockSize, const float* lookaheadMilliseconds, int count, DynamicsBenchmarkResult* results)
+{
+    const double tickSeconds = GetEngineTickSeconds();
+    int written = 0;
+
+    for (int pass = 0; pass < 2; pass++)
+    {
+        const bool avx2 = pass == 1;
+        if (avx2 && !HasAVX2())
+            break;
+
+        for (int i = 0; i < count; i++)
+        {
+            Dynamics* dynamics = new Dynamics();
+            InitializeDynamics(dynamics, sampleRate, 2, blockSize);
+
+            /* the kernel is set on this instance only, so the master limiter keeps the selected one */
+            SetDynamicsKernels(dynamics, avx2);
+            dynamics->bypassed.store(false);
+            dynamics->threshold.store(-6.0f);
+            SetDynamicsLookahead(dynamics, lookaheadMilliseconds[i]);
+
+            DynamicsBenchmark benchmark;
+            benchmark.dynamics = dynamics;
+            benchmark.blockSize = blockSize;
+            benchmark.blocks = DYNAMICS_BENCHMARK_SECONDS * sampleRate / blockSize;
+            benchmark.ticks = 0;
+
+            thread render = CreateEngineThread(RunDynamicsBenchmark, &benchmark);
+            render.join();
+
+            const double seconds = benchmark.ticks * tickSeconds;
+            DynamicsBenchmarkResult& result = results[written++];
+            result.lookaheadMilliseconds = GetDynamicsLookahead(dynamics);
+            result.avx2 = avx2;
+            result.nanosecondsPerFrame = seconds / ((double)benchmark.blocks * blockSize) * 1e9;
+            result.corePercent = seconds / ((double)benchmark.blocks * blockSize / sampleRate) * 100.0;
+            delete dynamics;
+        }
+    }
+
+    return written;
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include<atomic>
+#include<vector>
+
+#include"Engine.h"
+
+/*api.daw dynamics*/
+#define DYNAMICS_MAX_LOOKAHEAD_MILLISECONDS 20.0f
+#define DYNAMICS_RMS_MILLISECONDS 10.0f
+#define DYNAMICS_TRUE_PEAK_PHASES 4
+#define DYNAMICS_TRUE_PEAK_TAPS 8
+#define DYNAMICS_TRUE_PEAK_DELAY (DYNAMICS_TRUE_PEAK_TAPS / 2)
+#define DYNAMICS_BENCHMARK_SECONDS 10
+#define DYNAMICS_TAIL_TIME_CONSTANTS 10
+
+#define DYNAMICS_COMPRESSOR 0
+#define DYNAMICS_LIMITER 1
+
+#define DYNAMICS_DETECT_PEAK 0
+#define DYNAMICS_DETECT_RMS 1
+
+/* Minimum of the last length values pushed; each value enters and leaves the deque once, so the cost does not grow with the length. */
+struct DynamicsWindow {
+    std::vector<long long> positions;
+    std::vector<float> values;
+    unsigned mask;
+    unsigned head;
+    unsigned tail;
+};
+
+/*
+    A feed-forward compressor or brickwall limiter with the side chain linked across
+    channels. The audio is delayed by the lookahead, and the gain each frame needs is
+    taken as the minimum over the lookahead window, so reduction starts before the
+    transient arrives. The limiter estimates inter-sample peaks by oversampling the
+    detector four times, and shapes its attack as a moving average over the window,
+    which reaches full reduction exactly when the peak comes out. latency is what delay
+    compensation is told: the lookahead plus the true-peak filter's delay.
+*/
+struct Dynamics {
+    Engine* engine;
+    int node;
+    int sampleRate;
+    int channelCount;
+    int maxFrames;
+
+    /* settings, written by the UI thread */
+    std::atomic<bool> bypassed;
+    std::atomic<int> mode;
+    std::atomic<int> detector;
+    std::atomic<bool> truePeak;
+    std::atomic<float> threshold;
+    std::atomic<float> ratio;
+    std::atomic<float> knee;
+    std::atomic<float> attack;
+    std::atomic<float> release;
+    std::atomic<float> makeup;
+    std::atomic<int> lookahead;
+    std::atomic<int> latency;
+
+    /* deepest gain reduction of the last block in dB, for meters */
+    std::atomic<float> reduction;
+
+    /* detection kernels: AVX2 when the processor has it, unless SetDynamicsKernels turns it off */
+    bool avx2;
+
+    /* audio thread */
+    bool appliedBypassed;
+    int appliedLookahead;
+    int appliedLatency;
+    long long frame;
+    float gain;
+    DynamicsWindow window;
+    std::vector<float> average;
+    double averageSum;
+    std::vector<float> squares;
+    double squareSum;
+    int squareLength;
+    int squarePosition;
+    std::vector<float> delay[ENGINE_MAX_CHANNELS];
+    unsigned delayMask;
+    unsigned delayPosition;
+    std::vector<float> history[ENGINE_MAX_CHANNELS];
+    std::vector<float> detection;
+    std::vector<float> gains;
+};
+
+/* a limiter at -1 dB with 5 ms of lookahead, bypassed; maxFrames bounds the block size */
+bool InitializeDynamics(Dynamics* dynamics, int sampleRate, int channelCount, int maxFrames);
+
+/* for a private instance, such as one on the master of an offline render */
+bool CopyDynamicsSettings(Dynamics* destination, const Dynamics* source);
+
+/* channels are processed in place and come out latency frames late */
+bool ProcessDynamics(Dynamics* dynamics, float** channels, int channelCount, int frameCount);
+
+/* the setters below update the node's latency in the engine; they belong to the UI thread */
+bool SetDynamicsMode(Dynamics* dynamics, int mode);
+bool SetDynamicsTruePeak(Dynamics* dynamics, bool truePeak);
+bool SetDynamicsLookahead(Dynamics* dynamics, float milliseconds);
+float GetDynamicsLookahead(const Dynamics* dynamics);
+
+int AddDynamicsNode(Engine* engine, Dynamics* dynamics, const char* name);
+
+/* for an instance that is not processing yet */
+bool SetDynamicsKernels(Dynamics* dynamics, bool allowAVX2);
+
+struct DynamicsBenchmarkResult {
+    float lookaheadMilliseconds;
+    bool avx2;
+    double nanosecondsPerFrame;
+    double corePercent;
+};
+
+/* a stereo true-peak limiter over loud noise for each lookahead; results receive the scalar pass and, when supported, the AVX2 pass: up to 2 * count entries */
+int BenchmarkDynamics(int sampleRate, int blockSize, const float* lookaheadMilliseconds, int count, DynamicsBenchmarkResult* results);
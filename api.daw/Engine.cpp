@@ -0,0 +1,800 @@
+#include"Engine.h"
+#include"EngineThreads.h"
+#include"Trace.h"
+#include"Log.h"
+
+#include<algorithm>
+#include<cmath>
+#include<cstring>
+#include<cstdio>
+
+#include <corecrt_math_defines.h>
+
+Engine* CreateEngine(int sampleRate, int blockSize, int channelCount)
+{
+    if (blockSize <= 0 || blockSize > ENGINE_MAX_BLOCK_SIZE || channelCount <= 0 || channelCount > ENGINE_MAX_CHANNELS)
+    {
+
+        LogMessage(LOG_ERROR, "The engine configuration is not supported.");
+        return NULL;
+    }
+
+    Engine* engine = new Engine();
+    engine->sampleRate = sampleRate;
+    engine->blockSize = blockSize;
+    engine->channelCount = channelCount;
+    engine->nodeCount = 0;
+    engine->outputNode = ENGINE_NO_NODE;
+    engine->pendingSchedule.store(NULL);
+    engine->retiredSchedule.store(NULL);
+    engine->activeSchedule = NULL;
+    engine->compiledSchedule.outputNode = ENGINE_NO_NODE;
+    engine->compiledSchedule.stepCount = 0;
+    for (int n = 0; n < ENGINE_MAX_NODES; n++)
+        engine->compiledPosition[n] = -1;
+    engine->outputLatency.store(0);
+    engine->renderedFrames.store(0);
+    engine->profile.store(NULL);
+
+    return engine;
+}
+
+void DestroyEngine(Engine* engine)
+{
+    if (engine == NULL)
+        return;
+
+    delete engine->pendingSchedule.exchange(NULL);
+    delete engine->retiredSchedule.exchange(NULL);
+    delete engine->activeSchedule;
+
+    for (int n = 0; n < engine->nodeCount; n++)
+    {
+        delete[] engine->nodes[n].channels[0];
+        for (EngineCompensation* compensation : engine->nodes[n].compensation)
+        {
+            delete[] compensation->storage.load();
+            delete compensation;
+        }
+    }
+
+    delete engine;
+}
+
+int AddEngineNode(Engine* engine, const char* name, void* state, EngineNodeProcess process, bool sumsInputs)
+{
+    if (engine->nodeCount == ENGINE_MAX_NODES)
+        return ENGINE_NO_NODE;
+
+    int index = engine->nodeCount;
+    EngineNode& node = engine->nodes[index];
+    snprintf(node.name, ENGINE_NODE_NAME_LENGTH, "%s", name);
+    node.state = state;
+    node.process = process;
+    node.hash = NULL;
+    node.clone = NULL;
+    node.release = NULL;
+    node.seek = NULL;
+    node.tail = NULL;
+    node.sumsInputs = sumsInputs;
+    node.latency = 0;
+
+    /* one allocation per node, made here so the audio thread never allocates */
+    float* storage = new float[(size_t)engine->blockSize * engine->channelCount]();
+    for (int c = 0; c < engine->channelCount; c++)
+        node.channels[c] = storage + (size_t)c * engine->blockSize;
+
+    engine->nodeCount++;
+    return index;
+}
+
+bool ConnectEngineNodes(Engine* engine, int sourceNode, int destinationNode)
+{
+    if (sourceNode < 0 || sourceNode >= engine->nodeCount || destinationNode < 0 || destinationNode >= engine->nodeCount)
+        return false;
+
+    EngineNode& node = engine->nodes[destinationNode];
+    if (node.inputs.size() == ENGINE_MAX_NODE_INPUTS)
+        return false;
+
+    node.inputs.push_back(sourceNode);
+    if (node.compensation.size() < node.inputs.size())
+    {
+
+        EngineCompensation* compensation = new EngineCompensation();
+        compensation->delay.store(0);
+        compensation->storage.store(NULL);
+        node.compensation.push_back(compensation);
+    }
+    return true;
+}
+
+bool ClearEngineNodeInputs(Engine* engine, int node)
+{
+    if (node < 0 || node >= engine->nodeCount)
+        return false;
+
+    engine->nodes[node].inputs.clear();
+    return true;
+}
+
+bool SetEngineOutputNode(Engine* engine, int node)
+{
+    if (node < 0 || node >= engine->nodeCount)
+        return false;
+
+    engine->outputNode = node;
+    return true;
+}
+
+bool SetEngineNodeHash(Engine* engine, int node, EngineNodeHash hash)
+{
+    if (node < 0 || node >= engine->nodeCount)
+        return false;
+
+    engine->nodes[node].hash = hash;
+    return true;
+}
+
+unsigned long long HashEngineBytes(unsigned long long hash, const void* data, size_t size)
+{
+    /* FNV-1a */
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t b = 0; b < size; b++)
+        hash = (hash ^ bytes[b]) * 1099511628211ull;
+
+    return hash;
+}
+
+static bool HashEngineNode(Engine* engine, int node, unsigned long long* hash, unsigned char* visited)
+{
+    if (visited[node])
+        return true;
+    visited[node] = 1;
+
+    const EngineNode& source = engine->nodes[node];
+    if (source.process != NULL && source.hash == NULL)
+        return false;
+
+    /* inputs first and in order, so the same chain always hashes the same way */
+    for (int input : source.inputs)
+    {
+        if (!HashEngineNode(engine, input, hash, visited))
+            return false;
+    }
+
+    const int inputCount = (int)source.inputs.size();
+    *hash = HashEngineBytes(*hash, source.name, strlen(source.name));
+    *hash = HashEngineBytes(*hash, &inputCount, sizeof(inputCount));
+    *hash = HashEngineBytes(*hash, &source.sumsInputs, sizeof(source.sumsInputs));
+    if (source.hash != NULL)
+        *hash = source.hash(source.state, *hash);
+
+    return true;
+}
+
+bool HashEngineNodes(Engine* engine, int node, unsigned long long* hash)
+{
+    if (node < 0 || node >= engine->nodeCount)
+        return false;
+
+    unsigned char visited[ENGINE_MAX_NODES] = {};
+    *hash = ENGINE_HASH_SEED;
+    return HashEngineNode(engine, node, hash, visited);
+}
+
+static int CopyEngineNode(Engine* source, int node, Engine* destination, int* copies)
+{
+    if (copies[node] != ENGINE_NO_NODE)
+        return copies[node];
+
+    const EngineNode& original = source->nodes[node];
+    const int copy = AddEngineNode(destination, original.name, original.state, original.process, original.sumsInputs);
+    if (copy == ENGINE_NO_NODE)
+        return ENGINE_NO_NODE;
+
+    copies[node] = copy;
+    destination->nodes[copy].hash = original.hash;
+    destination->nodes[copy].latency = original.latency;
+    destination->nodes[copy].seek = original.seek;
+    destination->nodes[copy].tail = original.tail;
+
+    for (int input : original.inputs)
+    {
+        const int inputCopy = CopyEngineNode(source, input, destination, copies);
+        if (inputCopy == ENGINE_NO_NODE || !ConnectEngineNodes(destination, inputCopy, copy))
+            return ENGINE_NO_NODE;
+    }
+
+    return copy;
+}
+
+int CopyEngineNodes(Engine* source, int node, Engine* destination)
+{
+    if (node < 0 || node >= source->nodeCount)
+        return ENGINE_NO_NODE;
+
+    int copies[ENGINE_MAX_NODES];
+    for (int n = 0; n < ENGINE_MAX_NODES; n++)
+        copies[n] = ENGINE_NO_NODE;
+
+    return CopyEngineNode(source, node, destination, copies);
+}
+
+bool SetEngineNodeClone(Engine* engine, int node, EngineNodeClone clone, EngineNodeRelease release)
+{
+    if (node < 0 || node >= engine->nodeCount)
+        return false;
+
+    engine->nodes[node].clone = clone;
+    engine->nodes[node].release = release;
+    return true;
+}
+
+bool SetEngineNodeSeek(Engine* engine, int node, EngineNodeSeek seek)
+{
+    if (node < 0 || node >= engine->nodeCount)
+        return false;
+
+    engine->nodes[node].seek = seek;
+    return true;
+}
+
+bool SetEngineNodeTail(Engine* engine, int node, EngineNodeTail tail)
+{
+    if (node < 0 || node >= engine->nodeCount)
+        return false;
+
+    engine->nodes[node].tail = tail;
+    return true;
+}
+
+static int CloneEngineNode(Engine* source, int node, Engine* destination, int* copies)
+{
+    if (copies[node] != ENGINE_NO_NODE)
+        return copies[node];
+
+    const EngineNode& original = source->nodes[node];
+    void* state = NULL;
+    if (original.state != NULL)
+    {
+
+        if (original.clone == NULL)
+        {
+
+            LogMessage(LOG_ERROR, "The node %s cannot be copied for an offline render.", original.name);
+            return ENGINE_NO_NODE;
+        }
+
+        state = original.clone(original.state, destination);
+        if (state == NULL)
+            return ENGINE_NO_NODE;
+    }
+
+    const int copy = AddEngineNode(destination, original.name, state, original.process, original.sumsInputs);
+    if (copy == ENGINE_NO_NODE)
+    {
+
+        if (state != NULL)
+            original.release(state);
+        return ENGINE_NO_NODE;
+    }
+
+    copies[node] = copy;
+    EngineNode& cloned = destination->nodes[copy];
+    cloned.hash = original.hash;
+    cloned.clone = original.clone;
+    cloned.release = original.release;
+    cloned.seek = original.seek;
+    cloned.tail = original.tail;
+    cloned.latency = original.latency;
+
+    for (int input : original.inputs)
+    {
+        const int inputCopy = CloneEngineNode(source, input, destination, copies);
+        if (inputCopy == ENGINE_NO_NODE || !ConnectEngineNodes(destination, inputCopy, copy))
+            return ENGINE_NO_NODE;
+    }
+
+    return copy;
+}
+
+int CloneEngineNodes(Engine* source, int node, Engine* destination, int* copies)
+{
+    if (node < 0 || node >= source->nodeCount)
+        return ENGINE_NO_NODE;
+
+    return CloneEngineNode(source, node, destination, copies);
+}
+
+void ReleaseEngineClones(Engine* engine)
+{
+    for (int n = 0; n < engine->nodeCount; n++)
+    {
+        EngineNode& node = engine->nodes[n];
+        if (node.state != NULL && node.release != NULL)
+            node.release(node.state);
+        node.state = NULL;
+    }
+}
+
+static long long GetEngineNodeTailPreroll(Engine* engine, int node, long long* prerolls)
+{
+    if (prerolls[node] != ENGINE_UNBOUNDED_TAIL - 1)
+        return prerolls[node];
+
+    const EngineNode& source = engine->nodes[node];
+    long long tail = 0;
+    if (source.process != NULL)
+        tail = source.tail != NULL ? source.tail(source.state) : ENGINE_UNBOUNDED_TAIL;
+
+    long long longest = 0;
+    for (int input : source.inputs)
+    {
+        if (tail == ENGINE_UNBOUNDED_TAIL)
+            break;
+
+        const long long preroll = GetEngineNodeTailPreroll(engine, input, prerolls);
+        if (preroll == ENGINE_UNBOUNDED_TAIL)
+            tail = ENGINE_UNBOUNDED_TAIL;
+        longest = std::max(longest, preroll);
+    }
+
+    prerolls[node] = tail == ENGINE_UNBOUNDED_TAIL ? ENGINE_UNBOUNDED_TAIL : tail + longest;
+    return prerolls[node];
+}
+
+long long GetEngineNodePreroll(Engine* engine, int node)
+{
+    if (node < 0 || node >= engine->nodeCount)
+        return ENGINE_UNBOUNDED_TAIL;
+
+    /* one below ENGINE_UNBOUNDED_TAIL marks a node not visited yet */
+    std::vector<long long> prerolls(engine->nodeCount, ENGINE_UNBOUNDED_TAIL - 1);
+    return GetEngineNodeTailPreroll(engine, node, prerolls.data());
+}
+
+bool SeekEngineNodes(Engine* engine, long long frame)
+{
+    bool succeeded = true;
+    for (int n = 0; n < engine->nodeCount; n++)
+    {
+        const EngineNode& node = engine->nodes[n];
+        if (node.seek != NULL && node.state != NULL)
+            succeeded = node.seek(node.state, frame) && succeeded;
+    }
+
+    return succeeded;
+}
+
+static bool VisitEngineNode(Engine* engine, EngineSchedule* schedule, int node, unsigned char* marks)
+{
+    /* 1 = on the current path, 2 = already scheduled */
+    if (marks[node] == 2)
+        return true;
+    if (marks[node] == 1)
+    {
+
+        LogMessage(LOG_ERROR, "The engine graph contains a cycle at %s.", engine->nodes[node].name);
+        return false;
+    }
+
+    marks[node] = 1;
+    const EngineNode& source = engine->nodes[node];
+    for (int input : source.inputs)
+    {
+        if (!VisitEngineNode(engine, schedule, input, marks))
+            return false;
+    }
+    marks[node] = 2;
+
+    EngineScheduleStep& step = schedule->steps[schedule->stepCount++];
+    step.node = node;
+    step.inputOffset = (int)schedule->inputs.size();
+    step.inputCount = (int)source.inputs.size();
+    schedule->inputs.insert(schedule->inputs.end(), source.inputs.begin(), source.inputs.end());
+    schedule->compensation.insert(schedule->compensation.end(), source.compensation.begin(), source.compensation.begin() + source.inputs.size());
+
+    return true;
+}
+
+static void EnsureEngineCompensation(Engine* engine, EngineCompensation* compensation)
+{
+    if (compensation->storage.load(std::memory_order_relaxed) != NULL)
+        return;
+
+    /* history ring first, then one block of delayed output per channel */
+    const size_t stride = ENGINE_COMPENSATION_CAPACITY + (size_t)engine->blockSize;
+    float* storage = new float[stride * engine->channelCount]();
+    for (int c = 0; c < engine->channelCount; c++)
+    {
+        compensation->history[c] = storage + stride * c;
+        compensation->channels[c] = storage + stride * c + ENGINE_COMPENSATION_CAPACITY;
+    }
+    compensation->writePosition = 0;
+    compensation->storage.store(storage, std::memory_order_release);
+}
+
+/* Aligns every input of the step to the slowest one; returns true when the path latency of the node changed. */
+static bool UpdateEngineStepLatency(Engine* engine, const EngineSchedule& schedule, const EngineScheduleStep& step)
+{
+    EngineNode& node = engine->nodes[step.node];
+    const int* inputs = schedule.inputs.data() + step.inputOffset;
+    EngineCompensation* const* compensation = schedule.compensation.data() + step.inputOffset;
+
+    int inputLatency = 0;
+    for (int i = 0; i < step.inputCount; i++)
+    {
+        if (engine->pathLatency[inputs[i]] > inputLatency)
+            inputLatency = engine->pathLatency[inputs[i]];
+    }
+
+    for (int i = 0; i < step.inputCount; i++)
+    {
+        int delay = inputLatency - engine->pathLatency[inputs[i]];
+        if (delay > ENGINE_COMPENSATION_CAPACITY - engine->blockSize)
+        {
+
+            LogMessage(LOG_ERROR, "The latency into %s exceeds the compensation capacity.", node.name);
+            delay = ENGINE_COMPENSATION_CAPACITY - engine->blockSize;
+        }
+
+        if (delay > 0)
+            EnsureEngineCompensation(engine, compensation[i]);
+        compensation[i]->delay.store(delay, std::memory_order_release);
+    }
+
+    const int pathLatency = inputLatency + node.latency;
+    if (pathLatency == engine->pathLatency[step.node])
+        return false;
+
+    engine->pathLatency[step.node] = pathLatency;
+    return true;
+}
+
+static void UpdateEngineOutputLatency(Engine* engine)
+{
+    const int output = engine->compiledSchedule.outputNode;
+    engine->outputLatency.store(output != ENGINE_NO_NODE ? engine->pathLatency[output] : 0, std::memory_order_release);
+}
+
+bool CompileEngineGraph(Engine* engine)
+{
+    CollectEngineGarbage(engine);
+
+    EngineSchedule* schedule = new EngineSchedule();
+    schedule->outputNode = engine->outputNode;
+    schedule->stepCount = 0;
+
+    /* only nodes that reach the output are scheduled */
+    if (engine->outputNode != ENGINE_NO_NODE)
+    {
+
+        unsigned char marks[ENGINE_MAX_NODES] = {};
+        if (!VisitEngineNode(engine, schedule, engine->outputNode, marks))
+        {
+
+            delete schedule;
+            return false;
+        }
+    }
+
+    /* latencies and compensation are settled before the audio thread can see the schedule */
+    engine->compiledSchedule = *schedule;
+    for (int n = 0; n < engine->nodeCount; n++)
+    {
+        engine->compiledPosition[n] = -1;
+        engine->pathLatency[n] = -1;
+    }
+    for (int s = 0; s < schedule->stepCount; s++)
+    {
+        engine->compiledPosition[schedule->steps[s].node] = s;
+        UpdateEngineStepLatency(engine, *schedule, schedule->steps[s]);
+    }
+    UpdateEngineOutputLatency(engine);
+
+    delete engine->pendingSchedule.exchange(schedule);
+    return true;
+}
+
+bool SetEngineNodeLatency(Engine* engine, int node, int latency)
+{
+    if (node < 0 || node >= engine->nodeCount)
+        return false;
+    if (engine->nodes[node].latency == latency)
+        return true;
+
+    engine->nodes[node].latency = latency;
+
+    const int position = engine->compiledPosition[node];
+    if (position < 0)
+        return true;
+
+    /* only the node and what lies downstream of it is revisited; the schedule itself is kept */
+    bool changed[ENGINE_MAX_NODES] = {};
+    const EngineSchedule& schedule = engine->compiledSchedule;
+    changed[node] = UpdateEngineStepLatency(engine, schedule, schedule.steps[position]);
+
+    for (int s = position + 1; s < schedule.stepCount; s++)
+    {
+        const EngineScheduleStep& step = schedule.steps[s];
+        const int* inputs = schedule.inputs.data() + step.inputOffset;
+
+        bool affected = false;
+        for (int i = 0; i < step.inputCount && !affected; i++)
+            affected = changed[inputs[i]];
+
+        if (affected)
+            changed[step.node] = UpdateEngineStepLatency(engine, schedule, step);
+    }
+
+    UpdateEngineOutputLatency(engine);
+    return true;
+}
+
+int GetEngineOutputLatency(Engine* engine)
+{
+    return engine->outputLatency.load(std::memory_order_acquire);
+}
+
+bool CollectEngineGarbage(Engine* engine)
+{
+    EngineSchedule* retired = engine->retiredSchedule.exchange(NULL);
+    if (retired == NULL)
+        return false;
+
+    delete retired;
+    return true;
+}
+
+static void AcquireEngineSchedule(Engine* engine)
+{
+    /* wait until the UI thread has freed the last retired schedule before swapping again */
+    if (engine->retiredSchedule.load(std::memory_order_acquire) != NULL)
+        return;
+
+    EngineSchedule* schedule = engine->pendingSchedule.exchange(NULL, std::memory_order_acq_rel);
+    if (schedule == NULL)
+        return;
+
+    engine->retiredSchedule.store(engine->activeSchedule, std::memory_order_release);
+    engine->activeSchedule = schedule;
+}
+
+static float** CompensateEngineInput(Engine* engine, EngineCompensation* compensation, float** source, int frameCount)
+{
+    float* storage = compensation->storage.load(std::memory_order_acquire);
+    if (storage == NULL)
+        return source;
+
+    /* the history keeps recording at zero delay so a later latency change has real samples to read */
+    const unsigned mask = ENGINE_COMPENSATION_CAPACITY - 1;
+    const unsigned write = compensation->writePosition;
+    const int delay = compensation->delay.load(std::memory_order_acquire);
+
+    for (int c = 0; c < engine->channelCount; c++)
+    {
+        float* history = compensation->history[c];
+        for (int n = 0; n < frameCount; n++)
+            history[(write + n) & mask] = source[c][n];
+
+        if (delay > 0)
+        {
+
+            float* delayed = compensation->channels[c];
+            const unsigned read = write - (unsigned)delay;
+            for (int n = 0; n < frameCount; n++)
+                delayed[n] = history[(read + n) & mask];
+        }
+    }
+    compensation->writePosition = write + (unsigned)frameCount;
+
+    return delay > 0 ? compensation->channels : source;
+}
+
+float** GetEngineNodeInput(EngineNodeContext* context, int inputIndex)
+{
+    return context->inputs[inputIndex];
+}
+
+bool SetEngineProfile(Engine* engine, EngineProfile* profile)
+{
+    if (profile != NULL)
+    {
+
+        profile->head.store(0);
+        profile->tail.store(0);
+        profile->dropped.store(0);
+        profile->worstTicks.store(0);
+    }
+    engine->profile.store(profile, std::memory_order_release);
+    return true;
+}
+
+bool ProcessEngineBlock(Engine* engine, float** output, int frameCount)
+{
+    AcquireEngineSchedule(engine);
+
+    const EngineSchedule* schedule = engine->activeSchedule;
+    if (schedule == NULL || schedule->outputNode == ENGINE_NO_NODE || frameCount > engine->blockSize)
+    {
+
+        for (int c = 0; c < engine->channelCount; c++)
+            memset(output[c], 0, sizeof(float) * frameCount);
+        return false;
+    }
+
+    EngineNodeContext context;
+    context.engine = engine;
+    context.channelCount = engine->channelCount;
+    context.frameCount = frameCount;
+
+    /* one tick read per step, shared by the profile and the trace: each step ends where the next begins */
+    EngineProfile* profile = engine->profile.load(std::memory_order_acquire);
+    const bool traced = IsTraceEnabled();
+    EngineBlockProfile* blockProfile = NULL;
+    unsigned profileHead = 0;
+    unsigned long long blockStart = 0;
+    unsigned long long stepStart = 0;
+    if (profile != NULL || traced)
+        blockStart = stepStart = ReadEngineTicks();
+    if (profile != NULL)
+    {
+
+        profileHead = profile->head.load(std::memory_order_relaxed);
+        if (profileHead - profile->tail.load(std::memory_order_acquire) < ENGINE_PROFILE_BLOCKS)
+            blockProfile = &profile->blocks[profileHead % ENGINE_PROFILE_BLOCKS];
+        else
+            profile->dropped.store(profile->dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    for (int s = 0; s < schedule->stepCount; s++)
+    {
+        const EngineScheduleStep& step = schedule->steps[s];
+        EngineNode& node = engine->nodes[step.node];
+
+        context.node = step.node;
+        context.step = &step;
+        context.channels = node.channels;
+
+        const int* inputs = schedule->inputs.data() + step.inputOffset;
+        EngineCompensation* const* compensation = schedule->compensation.data() + step.inputOffset;
+        for (int i = 0; i < step.inputCount; i++)
+            context.inputs[i] = CompensateEngineInput(engine, compensation[i], engine->nodes[inputs[i]].channels, frameCount);
+
+        if (node.sumsInputs)
+        {
+
+            for (int c = 0; c < engine->channelCount; c++)
+            {
+                float* destination = node.channels[c];
+                memset(destination, 0, sizeof(float) * frameCount);
+
+                for (int i = 0; i < step.inputCount; i++)
+                {
+                    const float* source = GetEngineNodeInput(&context, i)[c];
+                    for (int n = 0; n < frameCount; n++)
+                        destination[n] += source[n];
+                }
+            }
+        }
+
+        if (node.process != NULL)
+            node.process(node.state, &context);
+
+        if (blockProfile != NULL || traced)
+        {
+
+            const unsigned long long stepEnd = ReadEngineTicks();
+            if (blockProfile != NULL)
+            {
+
+                blockProfile->nodes[s] = step.node;
+                blockProfile->stepTicks[s] = (unsigned)(stepEnd - stepStart);
+            }
+            if (traced)
+                WriteTraceEvent(node.name, stepStart, stepEnd - stepStart, step.node);
+            stepStart = stepEnd;
+        }
+    }
+
+    const EngineNode& outputNode = engine->nodes[schedule->outputNode];
+    for (int c = 0; c < engine->channelCount; c++)
+        memcpy(output[c], outputNode.channels[c], sizeof(float) * frameCount);
+
+    engine->renderedFrames.fetch_add(frameCount, std::memory_order_relaxed);
+
+    const unsigned long long ticks = profile != NULL || traced ? ReadEngineTicks() - blockStart : 0;
+    if (traced)
+        WriteTraceEvent("Engine block", blockStart, ticks, frameCount);
+    if (profile != NULL)
+    {
+
+        if (ticks > profile->worstTicks.load(std::memory_order_relaxed))
+            profile->worstTicks.store(ticks, std::memory_order_relaxed);
+        if (blockProfile != NULL)
+        {
+
+            blockProfile->start = blockStart;
+            blockProfile->ticks = ticks;
+            blockProfile->frameCount = frameCount;
+            blockProfile->stepCount = schedule->stepCount;
+            profile->head.store(profileHead + 1, std::memory_order_release);
+        }
+    }
+    return true;
+}
+
+static bool ProcessOscillatorNode(void* state, EngineNodeContext* context)
+{
+    EngineOscillator* oscillator = (EngineOscillator*)state;
+    const double increment = 2 * M_PI * oscillator->frequency.load(std::memory_order_relaxed) / context->engine->sampleRate;
+    const float amplitude = oscillator->amplitude.load(std::memory_order_relaxed);
+
+    double phase = oscillator->phase;
+    for (int n = 0; n < context->frameCount; n++)
+    {
+        const float sample = amplitude * (float)sin(phase);
+        for (int c = 0; c < context->channelCount; c++)
+            context->channels[c][n] = sample;
+
+        phase += increment;
+        if (phase >= 2 * M_PI)
+            phase -= 2 * M_PI;
+    }
+    oscillator->phase = phase;
+
+    return true;
+}
+
+static unsigned long long HashOscillatorNode(void* state, unsigned long long hash)
+{
+    EngineOscillator* oscillator = (EngineOscillator*)state;
+    const float settings[2] = {oscillator->frequency.load(std::memory_order_relaxed), oscillator->amplitude.load(std::memory_order_relaxed)};
+    return HashEngineBytes(hash, settings, sizeof(settings));
+}
+
+static void* CloneOscillatorNode(void* state, Engine* destination)
+{
+    EngineOscillator* oscillator = (EngineOscillator*)state;
+    EngineOscillator* clone = new EngineOscillator();
+    clone->frequency.store(oscillator->frequency.load());
+    clone->amplitude.store(oscillator->amplitude.load());
+    clone->sampleRate = destination->sampleRate;
+    clone->phase = 0.0;
+    return clone;
+}
+
+static void ReleaseOscillatorNode(void* state)
+{
+    delete (EngineOscillator*)state;
+}
+
+/* the phase a render started at frame 0 reaches at frame */
+static bool SeekOscillatorNode(void* state, long long frame)
+{
+    EngineOscillator* oscillator = (EngineOscillator*)state;
+    const double cycles = (double)oscillator->frequency.load() * frame / oscillator->sampleRate;
+    oscillator->phase = 2 * M_PI * (cycles - floor(cycles));
+    return true;
+}
+
+static long long GetOscillatorTail(void*)
+{
+    return 0;
+}
+
+int AddOscillatorNode(Engine* engine, EngineOscillator* oscillator, float frequency, float amplitude)
+{
+    oscillator->frequency.store(frequency);
+    oscillator->amplitude.store(amplitude);
+    oscillator->sampleRate = engine->sampleRate;
+    oscillator->phase = 0.0;
+
+    const int node = AddEngineNode(engine, "Oscillator", oscillator, ProcessOscillatorNode, false);
+    SetEngineNodeHash(engine, node, HashOscillatorNode);
+    SetEngineNodeClone(engine, node, CloneOscillatorNode, ReleaseOscillatorNode);
+    SetEngineNodeSeek(engine, node, SeekOscillatorNode);
+    SetEngineNodeTail(engine, node, GetOscillatorTail);
+    return node;
+}
@@ -0,0 +1,193 @@
+#pragma once
+
+#include<atomic>
+#include<cstddef>
+#include<vector>
+
+/*api.daw engine*/
+#define ENGINE_MAX_CHANNELS 2
+#define ENGINE_MAX_BLOCK_SIZE 2048
+#define ENGINE_MAX_NODES 512
+#define ENGINE_MAX_NODE_INPUTS 1024
+#define ENGINE_NODE_NAME_LENGTH 64
+#define ENGINE_NO_NODE -1
+#define ENGINE_COMPENSATION_CAPACITY 32768
+#define ENGINE_HASH_SEED 14695981039346656037ull
+#define ENGINE_PROFILE_BLOCKS 64
+#define ENGINE_UNBOUNDED_TAIL -1
+
+struct Engine;
+struct EngineScheduleStep;
+
+struct EngineNodeContext {
+    Engine* engine;
+    int node;
+    const EngineScheduleStep* step;
+    float** inputs[ENGINE_MAX_NODE_INPUTS];
+    float** channels;
+    int channelCount;
+    int frameCount;
+};
+
+/* Called on the audio thread; channels hold the summed inputs and are processed in place. */
+typedef bool (*EngineNodeProcess)(void* state, EngineNodeContext* context);
+
+/* Folds every setting that shapes the node's output into hash; called on the UI thread while the node is out of the schedule. */
+typedef unsigned long long (*EngineNodeHash)(void* state, unsigned long long hash);
+
+/* Makes a private state with the node's current settings for an offline render in destination; called on the UI thread. */
+typedef void* (*EngineNodeClone)(void* state, Engine* destination);
+typedef void (*EngineNodeRelease)(void* state);
+
+/* Moves a private state to a frame of the timeline before it renders its first block. */
+typedef bool (*EngineNodeSeek)(void* state, long long frame);
+
+/* The frames, latency included, the node's output keeps depending on an input that fell silent; ENGINE_UNBOUNDED_TAIL when there is no bound. */
+typedef long long (*EngineNodeTail)(void* state);
+
+/* Delays one input of a node so every input arrives with the same latency. */
+struct EngineCompensation {
+    std::atomic<int> delay;
+    std::atomic<float*> storage;
+    float* history[ENGINE_MAX_CHANNELS];
+    float* channels[ENGINE_MAX_CHANNELS];
+    unsigned writePosition;
+};
+
+struct EngineNode {
+    char name[ENGINE_NODE_NAME_LENGTH];
+    void* state;
+    EngineNodeProcess process;
+    EngineNodeHash hash;
+    EngineNodeClone clone;
+    EngineNodeRelease release;
+    EngineNodeSeek seek;
+    EngineNodeTail tail;
+    bool sumsInputs;
+    int latency;
+    float* channels[ENGINE_MAX_CHANNELS];
+
+    /* UI side; one compensation per input slot, kept when inputs are cleared so slots can be reused */
+    std::vector<int> inputs;
+    std::vector<EngineCompensation*> compensation;
+};
+
+struct EngineScheduleStep {
+    int node;
+    int inputOffset;
+    int inputCount;
+};
+
+struct EngineSchedule {
+    int outputNode;
+    int stepCount;
+    EngineScheduleStep steps[ENGINE_MAX_NODES];
+    std::vector<int> inputs;
+    std::vector<EngineCompensation*> compensation;
+};
+
+/* Timings of one block in engine ticks; the steps are in schedule order and include input compensation and summing. */
+struct EngineBlockProfile {
+    unsigned long long start;
+    unsigned long long ticks;
+    int frameCount;
+    int stepCount;
+    int nodes[ENGINE_MAX_NODES];
+    unsigned stepTicks[ENGINE_MAX_NODES];
+};
+
+/* Filled by the audio thread, drained by the UI; a block that finds the ring full is counted in dropped and still counts towards worstTicks. */
+struct EngineProfile {
+    std::atomic<unsigned> head;
+    std::atomic<unsigned> tail;
+    std::atomic<unsigned long long> dropped;
+    std::atomic<unsigned long long> worstTicks;
+    EngineBlockProfile blocks[ENGINE_PROFILE_BLOCKS];
+};
+
+struct Engine {
+    int sampleRate;
+    int blockSize;
+    int channelCount;
+
+    int nodeCount;
+    EngineNode nodes[ENGINE_MAX_NODES];
+    int outputNode;
+
+    /* Compiled on the UI thread, picked up by the audio thread at the start of a block. */
+    std::atomic<EngineSchedule*> pendingSchedule;
+    std::atomic<EngineSchedule*> retiredSchedule;
+    EngineSchedule* activeSchedule;
+
+    /* UI side copy of the last compiled schedule, used to update latencies without recompiling */
+    EngineSchedule compiledSchedule;
+    int compiledPosition[ENGINE_MAX_NODES];
+    int pathLatency[ENGINE_MAX_NODES];
+    std::atomic<int> outputLatency;
+
+    std::atomic<unsigned long long> renderedFrames;
+    std::atomic<EngineProfile*> profile;
+};
+
+Engine* CreateEngine(int sampleRate, int blockSize, int channelCount);
+void DestroyEngine(Engine* engine);
+
+int AddEngineNode(Engine* engine, const char* name, void* state, EngineNodeProcess process, bool sumsInputs = true);
+bool ConnectEngineNodes(Engine* engine, int sourceNode, int destinationNode);
+bool ClearEngineNodeInputs(Engine* engine, int node);
+bool SetEngineOutputNode(Engine* engine, int node);
+
+bool CompileEngineGraph(Engine* engine);
+bool SetEngineNodeLatency(Engine* engine, int node, int latency);
+int GetEngineOutputLatency(Engine* engine);
+bool CollectEngineGarbage(Engine* engine);
+
+bool SetEngineNodeHash(Engine* engine, int node, EngineNodeHash hash);
+unsigned long long HashEngineBytes(unsigned long long hash, const void* data, size_t size);
+
+/* hashes node and everything upstream of it; false when a processing node there has no hash */
+bool HashEngineNodes(Engine* engine, int node, unsigned long long* hash);
+
+/* copies node and everything upstream of it into destination, sharing node states; returns the copy of node */
+int CopyEngineNodes(Engine* source, int node, Engine* destination);
+
+bool SetEngineNodeClone(Engine* engine, int node, EngineNodeClone clone, EngineNodeRelease release);
+bool SetEngineNodeSeek(Engine* engine, int node, EngineNodeSeek seek);
+bool SetEngineNodeTail(Engine* engine, int node, EngineNodeTail tail);
+
+/*
+    Copies node and everything upstream of it into destination like CopyEngineNodes, but
+    with private states. copies holds ENGINE_MAX_NODES entries mapping source nodes to
+    their copies; entries that are not ENGINE_NO_NODE on entry substitute a node of
+    destination for that part of the graph. Fails when a node there holds a state and has
+    no clone; destination then keeps the states cloned so far for ReleaseEngineClones.
+*/
+int CloneEngineNodes(Engine* source, int node, Engine* destination, int* copies);
+
+/* releases the private states of every node in an engine filled by CloneEngineNodes */
+void ReleaseEngineClones(Engine* engine);
+
+/*
+    The frames a render must start early for node's output to match an uninterrupted
+    render: the longest sum of tails along any path upstream. ENGINE_UNBOUNDED_TAIL when a
+    processing node there has no tail, or one reports no bound.
+*/
+long long GetEngineNodePreroll(Engine* engine, int node);
+
+/* seeks every node of an engine that has a seek */
+bool SeekEngineNodes(Engine* engine, long long frame);
+
+/* profiling is off while profile is NULL; a profile may only be freed once the audio thread has stopped */
+bool SetEngineProfile(Engine* engine, EngineProfile* profile);
+
+float** GetEngineNodeInput(EngineNodeContext* context, int inputIndex);
+bool ProcessEngineBlock(Engine* engine, float** output, int frameCount);
+
+struct EngineOscillator {
+    std::atomic<float> frequency;
+    std::atomic<float> amplitude;
+    int sampleRate;
+    double phase;
+};
+
+int AddOscillatorNode(Engine* engine, EngineOscillator* oscillator, float frequency, float amplitude = 0.5f);
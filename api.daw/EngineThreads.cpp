@@ -0,0 +1,145 @@
+#include"EngineThreads.h"
+#include"Trace.h"
+
+#include<chrono>
+#include<cmath>
+#include<cstring>
+#include<vector>
+
+#include<xmmintrin.h>
+
+#include <corecrt_math_defines.h>
+
+using namespace std;
+
+#define ENGINE_DENORMAL_TEST_RUNS 5
+
+EngineFloatState GetEngineFloatState()
+{
+    return _mm_getcsr();
+}
+
+void SetEngineFloatState(EngineFloatState state)
+{
+    _mm_setcsr(state);
+}
+
+EngineFloatState EnableEngineDenormalFlush()
+{
+    const EngineFloatState previous = GetEngineFloatState();
+    SetEngineFloatState(previous | ENGINE_DENORMAL_FLAGS);
+    return previous;
+}
+
+void ReleaseEngineThread()
+{
+    ReleaseTraceThread();
+    ReleaseLogThread();
+}
+
+static const chrono::steady_clock::time_point EngineTickEpoch = chrono::steady_clock::now();
+static const unsigned long long EngineTickEpochTicks = ReadEngineTicks();
+
+double GetEngineTickSeconds()
+{
+    const double seconds = chrono::duration<double>(chrono::steady_clock::now() - EngineTickEpoch).count();
+    const unsigned long long ticks = ReadEngineTicks() - EngineTickEpochTicks;
+    return ticks > 0 ? seconds / (double)ticks : 0.0;
+}
+
+struct EngineDenormalFilter {
+    float b0, b1, b2, a1, a2;
+    float x1, x2, y1, y2;
+};
+
+static void InitializeEngineDenormalFilter(EngineDenormalFilter* filter, double frequency, double q)
+{
+    /* RBJ lowpass */
+    const double omega = 2.0 * M_PI * frequency;
+    const double alpha = sin(omega) / (2.0 * q);
+    const double a0 = 1.0 + alpha;
+    filter->b0 = (float)((1.0 - cos(omega)) / 2.0 / a0);
+    filter->b1 = (float)((1.0 - cos(omega)) / a0);
+    filter->b2 = filter->b0;
+    filter->a1 = (float)(-2.0 * cos(omega) / a0);
+    filter->a2 = (float)((1.0 - alpha) / a0);
+    filter->x1 = filter->x2 = filter->y1 = filter->y2 = 0.0f;
+}
+
+/* nanoseconds per frame through a cascade of biquads, best of several runs */
+static double TimeEngineDenormalFilters(const vector<float>& input)
+{
+    double best = 0.0;
+    volatile float sink = 0.0f;
+    for (int run = 0; run < ENGINE_DENORMAL_TEST_RUNS; run++)
+    {
+        EngineDenormalFilter filters[ENGINE_DENORMAL_TEST_FILTERS];
+        for (int f = 0; f < ENGINE_DENORMAL_TEST_FILTERS; f++)
+            InitializeEngineDenormalFilter(&filters[f], 0.02 + 0.002 * f, 0.707);
+
+        const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        float last = 0.0f;
+        for (float sample : input)
+        {
+            for (EngineDenormalFilter& filter : filters)
+            {
+                const float output = filter.b0 * sample + filter.b1 * filter.x1 + filter.b2 * filter.x2 - filter.a1 * filter.y1 - filter.a2 * filter.y2;
+                filter.x2 = filter.x1;
+                filter.x1 = sample;
+                filter.y2 = filter.y1;
+                filter.y1 = output;
+                sample = output;
+            }
+            last = sample;
+        }
+        const double elapsed = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / input.size();
+        sink = sink + last;
+
+        if (run == 0 || elapsed < best)
+            best = elapsed;
+    }
+
+    return best;
+}
+
+static void RunEngineDenormalMeasurement(EngineDenormalReport* report)
+{
+    const EngineFloatState state = GetEngineFloatState();
+    vector<float> signal(ENGINE_DENORMAL_TEST_FRAMES);
+    vector<float> tail(ENGINE_DENORMAL_TEST_FRAMES);
+
+    /* the tail is built with flushing off, or it would already be zero */
+    SetEngineFloatState(state & ~ENGINE_DENORMAL_FLAGS);
+    unsigned seed = 1;
+    float amplitude = 1e-38f;
+    for (int n = 0; n < ENGINE_DENORMAL_TEST_FRAMES; n++)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        const float noise = (float)(seed >> 8) / (float)(1 << 24) * 2.0f - 1.0f;
+        signal[n] = 0.5f * noise;
+        tail[n] = amplitude * noise;
+        amplitude *= 0.99995f;
+    }
+    SetEngineFloatState(state);
+
+    report->signalNanoseconds = TimeEngineDenormalFilters(signal);
+    report->tailNanoseconds = TimeEngineDenormalFilters(tail);
+
+    SetEngineFloatState(state & ~ENGINE_DENORMAL_FLAGS);
+    report->unprotectedTailNanoseconds = TimeEngineDenormalFilters(tail);
+    SetEngineFloatState(state);
+
+    report->ratio = report->tailNanoseconds / report->signalNanoseconds;
+    report->unprotectedRatio = report->unprotectedTailNanoseconds / report->signalNanoseconds;
+    report->passed = (state & ENGINE_DENORMAL_FLAGS) == ENGINE_DENORMAL_FLAGS && report->ratio < ENGINE_DENORMAL_TOLERANCE;
+}
+
+bool MeasureEngineDenormals(EngineDenormalReport* report)
+{
+    memset(report, 0, sizeof(EngineDenormalReport));
+
+    /* measured on an engine thread, so this also checks that the threading layer sets the flags */
+    thread measurement = CreateEngineThread(RunEngineDenormalMeasurement, report);
+    measurement.join();
+    return report->passed;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include<thread>
+
+#if defined(_MSC_VER)
+#include<intrin.h>
+#else
+#include<x86intrin.h>
+#endif
+
+#include"Log.h"
+
+/*api.daw engine threads*/
+#define ENGINE_FLUSH_TO_ZERO 0x8000
+#define ENGINE_DENORMALS_ARE_ZERO 0x0040
+#define ENGINE_DENORMAL_FLAGS (ENGINE_FLUSH_TO_ZERO | ENGINE_DENORMALS_ARE_ZERO)
+#define ENGINE_DENORMAL_TOLERANCE 2.0
+#define ENGINE_DENORMAL_TEST_FRAMES 65536
+#define ENGINE_DENORMAL_TEST_FILTERS 8
+
+/* The SSE control/status register of the calling thread: rounding, exception masks, FTZ and DAZ. */
+typedef unsigned EngineFloatState;
+
+EngineFloatState GetEngineFloatState();
+void SetEngineFloatState(EngineFloatState state);
+
+/* sets flush-to-zero and denormals-are-zero on the calling thread; returns the state before */
+EngineFloatState EnableEngineDenormalFlush();
+
+/* after foreign code such as a plugin call: puts state back only if that code changed it */
+inline void RestoreEngineFloatState(EngineFloatState state)
+{
+    if (GetEngineFloatState() != state)
+        SetEngineFloatState(state);
+}
+
+/* the processor's time stamp counter; cheap enough to read around every node of every block */
+inline unsigned long long ReadEngineTicks()
+{
+    return __rdtsc();
+}
+
+/* seconds per tick, calibrated against the steady clock over the life of the process */
+double GetEngineTickSeconds();
+
+/* gives back the calling engine thread's trace ring and log queue before it ends */
+void ReleaseEngineThread();
+
+/*
+    Every thread that runs engine DSP starts here, so denormals are flushed before its first
+    sample instead of being left to each filter. Tails decaying towards zero otherwise fall
+    into denormal range, where each operation costs ten to a hundred times more.
+*/
+template<typename Function, typename... Arguments>
+std::thread CreateEngineThread(Function function, Arguments... arguments)
+{
+    return std::thread([=]() {
+        EnableEngineDenormalFlush();
+        function(arguments...);
+        ReleaseEngineThread();
+    });
+}
+
+struct EngineDenormalReport {
+    double signalNanoseconds;
+    double tailNanoseconds;
+    double unprotectedTailNanoseconds;
+    double ratio;
+    double unprotectedRatio;
+    bool passed;
+};
+
+/* runs a filter bank over a loud signal and over a tail in denormal range on an engine thread; passes when the tail is not slower than ENGINE_DENORMAL_TOLERANCE times the signal */
+bool MeasureEngineDenormals(EngineDenormalReport* report);
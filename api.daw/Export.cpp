@@ -0,0 +1,770 @@
+#include"Export.h"
+#include"EngineThreads.h"
+#include"Trace.h"
+#include"Log.h"
+#include"sndfile.h"
+
+#include<algorithm>
+#include<chrono>
+#include<cmath>
+#include<condition_variable>
+#include<cstdio>
+#include<cstring>
+#include<deque>
+#include<mutex>
+
+using namespace std;
+
+/* Plays a rendered stem into the mix in place of its source. */
+struct ExportStemPlayer {
+    const float* channels[ENGINE_MAX_CHANNELS];
+    long long frameCount;
+    long long position;
+};
+
+static bool ProcessExportStemPlayer(void* state, EngineNodeContext* context)
+{
+    ExportStemPlayer* player = (ExportStemPlayer*)state;
+    const int available = (int)max(0LL, min((long long)context->frameCount, player->frameCount - player->position));
+    for (int c = 0; c < context->channelCount; c++)
+    {
+        if (available > 0)
+            memcpy(context->channels[c], player->channels[c] + player->position, sizeof(float) * available);
+        memset(context->channels[c] + available, 0, sizeof(float) * (context->frameCount - available));
+    }
+    player->position += context->frameCount;
+
+    return true;
+}
+
+static void ReleaseExportStemPlayer(void* state)
+{
+    delete (ExportStemPlayer*)state;
+}
+
+static bool SeekExportStemPlayer(void* state, long long frame)
+{
+    ((ExportStemPlayer*)state)->position = frame;
+    return true;
+}
+
+static long long GetExportStemPlayerTail(void*)
+{
+    return 0;
+}
+
+/* frames [start, end) of a stem, of the mix, or of the whole graph */
+struct ExportJob {
+    int stem;
+    long long start;
+    long long end;
+};
+
+struct ExportRender {
+    Engine* engine;
+    long long frameCount;
+    std::vector<int> stemNodes;
+    std::vector<long long> prerolls;
+    long long mixPreroll;
+
+    /* stem s, channel c at s * channelCount + c */
+    std::vector<std::vector<float>> stems;
+    std::vector<float>* output;
+
+    std::vector<ExportJob> jobs;
+    std::atomic<int> next;
+    std::atomic<bool> failed;
+
+    /* the jobs clone from the same template states, which are not made for several threads at once */
+    std::mutex cloneMutex;
+
+    /* while the mix renders with a progress: the frames each mix job has finished from its start */
+    std::atomic<long long>* mixProgress;
+    ExportProgress* progress;
+};
+
+/* a stem's subgraph, the mix with a player per stem in place of the sources, or the whole graph; returns the output node */
+static int BuildExportEngine(ExportRender* render, int stem, Engine* destination)
+{
+    Engine* engine = render->engine;
+    int copies[ENGINE_MAX_NODES];
+    for (int n = 0; n < ENGINE_MAX_NODES; n++)
+        copies[n] = ENGINE_NO_NODE;
+
+    int output = ENGINE_NO_NODE;
+    if (stem >= 0)
+        output = CloneEngineNodes(engine, render->stemNodes[stem], destination, copies);
+    else {
+
+        for (int s = 0; s < (int)render->stemNodes.size() && stem == EXPORT_MIX; s++)
+        {
+            ExportStemPlayer* player = new ExportStemPlayer();
+            for (int c = 0; c < engine->channelCount; c++)
+                player->channels[c] = render->stems[(size_t)s * engine->channelCount + c].data();
+            player->frameCount = render->frameCount;
+            player->position = 0;
+
+            const int node = AddEngineNode(destination, engine->nodes[render->stemNodes[s]].name, player, ProcessExportStemPlayer, false);
+            if (node == ENGINE_NO_NODE)
+            {
+
+                delete player;
+                return ENGINE_NO_NODE;
+            }
+            SetEngineNodeClone(destination, node, NULL, ReleaseExportStemPlayer);
+            SetEngineNodeSeek(destination, node, SeekExportStemPlayer);
+            SetEngineNodeTail(destination, node, GetExportStemPlayerTail);
+            copies[render->stemNodes[s]] = node;
+        }
+        output = CloneEngineNodes(engine, engine->outputNode, destination, copies);
+    }
+
+    if (output == ENGINE_NO_NODE || !SetEngineOutputNode(destination, output) || !CompileEngineGraph(destination))
+        return ENGINE_NO_NODE;
+    return output;
+}
+
+/* mix jobs start at 0 and follow each other, so the mix is ready up to the first job that has not finished */
+static void PublishExportProgress(ExportRender* render)
+{
+    long long ready = 0;
+    for (int j = 0; j < (int)render->jobs.size(); j++)
+    {
+        const long long done = render->mixProgress[j].load(std::memory_order_acquire);
+        ready = render->jobs[j].start + done;
+        if (done < render->jobs[j].end - render->jobs[j].start)
+            break;
+    }
+
+    long long published = render->progress->readyFrames.load();
+    while (ready > published && !render->progress->readyFrames.compare_exchange_weak(published, ready)) {}
+}
+
+/* rendered from the preroll before start, so the tails reaching into the job have built up; the latency and the preroll are dropped */
+static bool RenderExportJob(ExportRender* render, const ExportJob& job)
+{
+    Engine* source = render->engine;
+    Engine* engine = CreateEngine(source->sampleRate, source->blockSize, source->channelCount);
+    if (engine == NULL)
+        return false;
+
+    const long long preroll = job.stem >= 0 ? render->prerolls[job.stem] : render->mixPreroll;
+    const long long first = job.stem == EXPORT_WHOLE ? 0 : max(0LL, job.start - max(preroll, 0LL));
+    int output;
+    {
+        lock_guard<mutex> lock(render->cloneMutex);
+        output = BuildExportEngine(render, job.stem, engine);
+    }
+    bool succeeded = output != ENGINE_NO_NODE && SeekEngineNodes(engine, first);
+
+    float* destination[ENGINE_MAX_CHANNELS];
+    for (int c = 0; c < engine->channelCount; c++)
+        destination[c] = job.stem >= 0 ? render->stems[(size_t)job.stem * engine->channelCount + c].data() : render->output[c].data();
+
+    vector<float> storage((size_t)engine->blockSize * engine->channelCount);
+    float* channels[ENGINE_MAX_CHANNELS];
+    for (int c = 0; c < engine->channelCount; c++)
+        channels[c] = storage.data() + (size_t)c * engine->blockSize;
+
+    const long long skip = job.start - first + GetEngineOutputLatency(engine);
+    const long long total = skip + job.end - job.start;
+    long long position = 0;
+    while (succeeded && position < total)
+    {
+        const int frameCount = (int)min((long long)engine->blockSize, total - position);
+        succeeded = ProcessEngineBlock(engine, channels, frameCount);
+
+        const int skipped = (int)max(0LL, min((long long)frameCount, skip - position));
+        const long long target = job.start + position + skipped - skip;
+        for (int c = 0; c < engine->channelCount; c++)
+            memcpy(destination[c] + target, channels[c] + skipped, sizeof(float) * (frameCount - skipped));
+        position += frameCount;
+
+        if (job.stem < 0 && render->mixProgress != NULL && succeeded)
+        {
+
+            render->mixProgress[&job - render->jobs.data()].store(target + frameCount - skipped - job.start, std::memory_order_release);
+            PublishExportProgress(render);
+        }
+    }
+
+    ReleaseEngineClones(engine);
+    DestroyEngine(engine);
+    return succeeded;
+}
+
+static void RunExportWorker(ExportRender* render)
+{
+    SetTraceThreadName("Export");
+    for (int j = render->next.fetch_add(1); j < (int)render->jobs.size() && !render->failed.load(); j = render->next.fetch_add(1))
+    {
+        TraceScope trace(render->jobs[j].stem == EXPORT_MIX ? "Export mix" : "Export stem", render->jobs[j].stem);
+        if (!RenderExportJob(render, render->jobs[j]))
+            render->failed.store(true);
+    }
+}
+
+static bool RunExportJobs(ExportRender* render, int threadCount)
+{
+    render->next.store(0);
+    vector<thread> workers;
+    for (int t = 0; t < min(threadCount, (int)render->jobs.size()); t++)
+        workers.push_back(CreateEngineThread(RunExportWorker, render));
+    for (thread& worker : workers)
+        worker.join();
+
+    return !render->failed.load();
+}
+
+Engine* CreateExportTemplate(Engine* engine, int mixNode, int* templateMixNode)
+{
+    if (mixNode < 0 || mixNode >= engine->nodeCount || engine->outputNode == ENGINE_NO_NODE)
+        return NULL;
+
+    Engine* copy = CreateEngine(engine->sampleRate, engine->blockSize, engine->channelCount);
+    if (copy == NULL)
+        return NULL;
+
+    int copies[ENGINE_MAX_NODES];
+    for (int n = 0; n < ENGINE_MAX_NODES; n++)
+        copies[n] = ENGINE_NO_NODE;
+
+    const int output = CloneEngineNodes(engine, engine->outputNode, copy, copies);
+    if (output == ENGINE_NO_NODE || copies[mixNode] == ENGINE_NO_NODE || !SetEngineOutputNode(copy, output))
+    {
+
+        LogMessage(LOG_ERROR, "The graph could not be copied for export.");
+        DestroyExportTemplate(copy);
+        return NULL;
+    }
+
+    *templateMixNode = copies[mixNode];
+    return copy;
+}
+
+void DestroyExportTemplate(Engine* engine)
+{
+    if (engine == NULL)
+        return;
+
+    ReleaseEngineClones(engine);
+    DestroyEngine(engine);
+}
+
+/* a subgraph whose preroll would outweigh its segment renders in one job, which goes first since it is the longest */
+static bool PlanExportJobs(ExportRender* render, int stem, long long preroll, long long segmentFrames)
+{
+    if (preroll == ENGINE_UNBOUNDED_TAIL || preroll > segmentFrames)
+    {
+
+        ExportJob job = { stem, 0, render->frameCount };
+        render->jobs.insert(render->jobs.begin(), job);
+        return false;
+    }
+
+    for (long long start = 0; start < render->frameCount; start += segmentFrames)
+    {
+        ExportJob job = { stem, start, min(render->frameCount, start + segmentFrames) };
+        render->jobs.push_back(job);
+    }
+    return true;
+}
+
+bool RenderExport(Engine* engine, int mixNode, long long frameCount, int threadCount, vector<float>* output, ExportReport* report, ExportProgress* progress)
+{
+    if (mixNode < 0 || mixNode >= engine->nodeCount || engine->outputNode == ENGINE_NO_NODE || frameCount <= 0)
+        return false;
+
+    const unsigned long long startTicks = ReadEngineTicks();
+    ExportRender render;
+    render.engine = engine;
+    render.frameCount = frameCount;
+    render.stemNodes = engine->nodes[mixNode].inputs;
+    render.output = output;
+    render.next.store(0);
+    render.failed.store(false);
+    render.mixProgress = NULL;
+    render.progress = progress;
+
+    const int stemCount = (int)render.stemNodes.size();
+    render.stems.resize((size_t)stemCount * engine->channelCount);
+    for (vector<float>& stem : render.stems)
+        stem.assign((size_t)frameCount, 0.0f);
+    for (int c = 0; c < engine->channelCount; c++)
+        output[c].assign((size_t)frameCount, 0.0f);
+
+    /* the mix is built once up front, so a node that cannot be cloned fails the export before any rendering */
+    Engine* probe = CreateEngine(engine->sampleRate, engine->blockSize, engine->channelCount);
+    if (probe == NULL)
+        return false;
+    const int probeOutput = BuildExportEngine(&render, EXPORT_MIX, probe);
+    render.mixPreroll = probeOutput != ENGINE_NO_NODE ? GetEngineNodePreroll(probe, probeOutput) : ENGINE_UNBOUNDED_TAIL;
+    ReleaseEngineClones(probe);
+    DestroyEngine(probe);
+    if (probeOutput == ENGINE_NO_NODE)
+    {
+
+        LogMessage(LOG_ERROR, "The mix could not be prepared for export.");
+        return false;
+    }
+
+    if (threadCount <= 0)
+        threadCount = max(1, (int)thread::hardware_concurrency());
+
+    /* segments have a fixed length, so how the timeline is cut does not depend on the threads */
+    const long long segmentFrames = (long long)EXPORT_SEGMENT_SECONDS * engine->sampleRate;
+    int segmentedStems = 0;
+    for (int s = 0; s < stemCount; s++)
+    {
+        render.prerolls.push_back(GetEngineNodePreroll(engine, render.stemNodes[s]));
+        segmentedStems += PlanExportJobs(&render, s, render.prerolls[s], segmentFrames) ? 1 : 0;
+    }
+    const int stemJobs = (int)render.jobs.size();
+    if (!RunExportJobs(&render, threadCount))
+    {
+
+        LogMessage(LOG_ERROR, "The stems could not be rendered for export.");
+        return false;
+    }
+
+    render.jobs.clear();
+    const bool segmentedMix = PlanExportJobs(&render, EXPORT_MIX, render.mixPreroll, segmentFrames);
+    vector<atomic<long long>> mixProgress(render.jobs.size());
+    for (atomic<long long>& done : mixProgress)
+        done.store(0);
+    if (progress != NULL)
+        render.mixProgress = mixProgress.data();
+    if (!RunExportJobs(&render, threadCount))
+    {
+
+        LogMessage(LOG_ERROR, "The stems could not be mixed for export.");
+        return false;
+    }
+
+    const double seconds = (ReadEngineTicks() - startTicks) * GetEngineTickSeconds();
+    if (report != NULL)
+    {
+
+        report->threads = threadCount;
+        report->stems = stemCount;
+        report->segmentedStems = segmentedStems;
+        report->segmentedMix = segmentedMix;
+        report->stemJobs = stemJobs;
+        report->mixJobs = (int)render.jobs.size();
+        report->seconds = (double)frameCount / engine->sampleRate;
+        report->milliseconds = seconds * 1000.0;
+        report->realtimeFactor = seconds > 0.0 ? report->seconds / seconds : 0.0;
+    }
+
+    return true;
+}
+
+bool RenderExportSerial(Engine* engine, long long frameCount, vector<float>* output, double* milliseconds)
+{
+    if (engine->outputNode == ENGINE_NO_NODE || frameCount <= 0)
+        return false;
+
+    const unsigned long long startTicks = ReadEngineTicks();
+    ExportRender render;
+    render.engine = engine;
+    render.frameCount = frameCount;
+    render.mixPreroll = 0;
+    render.output = output;
+    render.mixProgress = NULL;
+    render.progress = NULL;
+    for (int c = 0; c < engine->channelCount; c++)
+        output[c].assign((size_t)frameCount, 0.0f);
+
+    ExportJob job = { EXPORT_WHOLE, 0, frameCount };
+    const bool succeeded = RenderExportJob(&render, job);
+    if (milliseconds != NULL)
+        *milliseconds = (ReadEngineTicks() - startTicks) * GetEngineTickSeconds() * 1000.0;
+    return succeeded;
+}
+
+/* One chunk of the mix in one sample format, shared by every target fed that format; the last to write it frees it. */
+struct ExportChunk {
+    int frameCount;
+    std::vector<float> floats;
+    std::vector<short> shorts;
+    std::vector<int> ints;
+    std::atomic<int> references;
+};
+
+struct ExportQueue {
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<ExportChunk*> chunks;
+    bool closed;
+};
+
+/* A target's encoder thread and the queue that feeds it. */
+struct ExportSink {
+    ExportTarget* target;
+    SNDFILE* file;
+    int samples;
+    int channelCount;
+    ExportQueue queue;
+    bool failed;
+};
+
+/* Converts the mix once for every target fed one sample format. */
+struct ExportConversion {
+    int samples;
+    unsigned random;
+    std::vector<ExportSink*> sinks;
+};
+
+int GetExportTargetSamples(int format)
+{
+    const int encoding = format & SF_FORMAT_SUBMASK;
+    if (encoding == SF_FORMAT_PCM_16)
+        return EXPORT_SAMPLES_16;
+    if (encoding == SF_FORMAT_PCM_24)
+        return EXPORT_SAMPLES_24;
+    if (encoding == SF_FORMAT_PCM_32)
+        return EXPORT_SAMPLES_32;
+
+    /* float and the lossy encoders, which quantize on their own */
+    return EXPORT_SAMPLES_FLOAT;
+}
+
+/* waits while the queue is full, so a slow encoder holds the converter back */
+static void PushExportChunk(ExportQueue* queue, ExportChunk* chunk)
+{
+    unique_lock<mutex> lock(queue->mutex);
+    queue->changed.wait(lock, [queue]() { return (int)queue->chunks.size() < EXPORT_QUEUE_CHUNKS; });
+    queue->chunks.push_back(chunk);
+    queue->changed.notify_all();
+}
+
+/* NULL once the queue is closed and empty */
+static ExportChunk* PopExportChunk(ExportQueue* queue)
+{
+    unique_lock<mutex> lock(queue->mutex);
+    queue->changed.wait(lock, [queue]() { return !queue->chunks.empty() || queue->closed; });
+    if (queue->chunks.empty())
+        return NULL;
+
+    ExportChunk* chunk = queue->chunks.front();
+    queue->chunks.pop_front();
+    queue->changed.notify_all();
+    return chunk;
+}
+
+static void CloseExportQueue(ExportQueue* queue)
+{
+    lock_guard<mutex> lock(queue->mutex);
+    queue->closed = true;
+    queue->changed.notify_all();
+}
+
+static void ReleaseExportChunk(ExportChunk* chunk)
+{
+    if (chunk->references.fetch_sub(1) == 1)
+        delete chunk;
+}
+
+/* triangular dither of one step: the sum of two uniform values in [-0.5, 0.5) */
+static float GetExportDither(unsigned* random)
+{
+    float sum = 0.0f;
+    for (int i = 0; i < 2; i++)
+    {
+        *random ^= *random << 13;
+        *random ^= *random >> 17;
+        *random ^= *random << 5;
+        sum += (float)(*random >> 8) * (1.0f / 16777216.0f) - 0.5f;
+    }
+    return sum;
+}
+
+/* interleaves frames [position, position + frameCount) of the mix in the conversion's sample format */
+static ExportChunk* ConvertExportChunk(ExportConversion* conversion, const vector<float>* output, int channelCount, long long position, int frameCount)
+{
+    ExportChunk* chunk = new ExportChunk();
+    chunk->frameCount = frameCount;
+    chunk->references.store((int)conversion->sinks.size());
+
+    const size_t sampleCount = (size_t)frameCount * channelCount;
+    if (conversion->samples == EXPORT_SAMPLES_FLOAT)
+        chunk->floats.resize(sampleCount);
+    else if (conversion->samples == EXPORT_SAMPLES_16)
+        chunk->shorts.resize(sampleCount);
+    else
+        chunk->ints.resize(sampleCount);
+
+    for (int n = 0; n < frameCount; n++)
+    {
+        for (int c = 0; c < channelCount; c++)
+        {
+            const float sample = output[c][(size_t)(position + n)];
+            const size_t index = (size_t)n * channelCount + c;
+            if (conversion->samples == EXPORT_SAMPLES_FLOAT)
+                chunk->floats[index] = sample;
+            else if (conversion->samples == EXPORT_SAMPLES_16)
+                chunk->shorts[index] = (short)max(-32768.0f, min(32767.0f, floorf(sample * 32767.0f + GetExportDither(&conversion->random) + 0.5f)));
+            else if (conversion->samples == EXPORT_SAMPLES_24)
+                chunk->ints[index] = (int)max(-8388608.0f, min(8388607.0f, floorf(sample * 8388607.0f + GetExportDither(&conversion->random) + 0.5f))) * 256;
+            else
+                chunk->ints[index] = (int)max(-2147483648.0, min(2147483647.0, floor(sample * 2147483647.0 + 0.5)));
+        }
+    }
+
+    return chunk;
+}
+
+static void RunExportSink(ExportSink* sink)
+{
+    SetTraceThreadName("Export encoder");
+    double seconds = 0.0;
+    for (ExportChunk* chunk = PopExportChunk(&sink->queue); chunk != NULL; chunk = PopExportChunk(&sink->queue))
+    {
+        /* a failed target keeps taking chunks, so the converter never waits on it */
+        if (!sink->failed)
+        {
+
+            TraceScope trace("Export encode", chunk->frameCount);
+            const unsigned long long start = ReadEngineTicks();
+            sf_count_t written = 0;
+            if (sink->samples == EXPORT_SAMPLES_FLOAT)
+                written = sf_writef_float(sink->file, chunk->floats.data(), chunk->frameCount);
+            else if (sink->samples == EXPORT_SAMPLES_16)
+                written = sf_writef_short(sink->file, chunk->shorts.data(), chunk->frameCount);
+            else
+                written = sf_writef_int(sink->file, chunk->ints.data(), chunk->frameCount);
+            seconds += (ReadEngineTicks() - start) * GetEngineTickSeconds();
+            sink->failed = written != chunk->frameCount;
+        }
+        ReleaseExportChunk(chunk);
+    }
+
+    sink->target->milliseconds = seconds * 1000.0;
+}
+
+struct ExportConverter {
+    std::vector<ExportConversion>* conversions;
+    const std::vector<float>* output;
+    int channelCount;
+    long long frameCount;
+    ExportProgress* progress;
+    long long converted;
+};
+
+static void RunExportConverter(ExportConverter* converter)
+{
+    SetTraceThreadName("Export converter");
+    ExportProgress* progress = converter->progress;
+    long long position = 0;
+    while (position < converter->frameCount)
+    {
+        /* whole chunks while the render runs, then whatever it left */
+        const bool finished = progress->finished.load();
+        const long long ready = progress->readyFrames.load(std::memory_order_acquire);
+        if (ready - position < EXPORT_CHUNK_FRAMES && ready < converter->frameCount)
+        {
+
+            if (finished)
+                break;
+            this_thread::sleep_for(chrono::milliseconds(EXPORT_POLL_MILLISECONDS));
+            continue;
+        }
+
+        TraceScope trace("Export convert");
+        const int frameCount = (int)min((long long)EXPORT_CHUNK_FRAMES, ready - position);
+        for (ExportConversion& conversion : *converter->conversions)
+        {
+            ExportChunk* chunk = ConvertExportChunk(&conversion, converter->output, converter->channelCount, position, frameCount);
+            for (ExportSink* sink : conversion.sinks)
+                PushExportChunk(&sink->queue, chunk);
+        }
+        position += frameCount;
+    }
+    converter->converted = position;
+
+    for (ExportConversion& conversion : *converter->conversions)
+    {
+        for (ExportSink* sink : conversion.sinks)
+            CloseExportQueue(&sink->queue);
+    }
+}
+
+bool ExportMixFormats(Engine* engine, int mixNode, long long frameCount, int threadCount, ExportTarget* targets, int count, ExportFormatsReport* report)
+{
+    if (count <= 0)
+        return false;
+
+    const unsigned long long startTicks = ReadEngineTicks();
+    const int channelCount = engine->channelCount;
+    SF_INFO info;
+    memset(&info, 0, sizeof(info));
+    info.samplerate = engine->sampleRate;
+    info.channels = channelCount;
+
+    /* every format is checked before any file is opened, so a bad one never leaves the others half written */
+    for (int t = 0; t < count; t++)
+    {
+        targets[t].succeeded = false;
+        targets[t].milliseconds = 0.0;
+    }
+    for (int t = 0; t < count; t++)
+    {
+        info.format = targets[t].format;
+        if (!sf_format_check(&info))
+        {
+
+            LogMessage(LOG_ERROR, "The format of %s cannot hold %d channels at %d Hz.", targets[t].path, channelCount, engine->sampleRate);
+            return false;
+        }
+    }
+
+    vector<ExportSink*> sinks;
+    vector<ExportConversion> conversions;
+    bool opened = true;
+    for (int t = 0; t < count && opened; t++)
+    {
+        ExportTarget* target = &targets[t];
+        info.frames = 0;
+        info.format = target->format;
+        SNDFILE* file = sf_open(target->path, SFM_WRITE, &info);
+        if (file == NULL)
+        {
+
+            LogMessage(LOG_ERROR, "The export could not be written to %s: %s", target->path, sf_strerror(NULL));
+            opened = false;
+            break;
+        }
+
+        ExportSink* sink = new ExportSink();
+        sink->target = target;
+        sink->file = file;
+        sink->samples = GetExportTargetSamples(target->format);
+        sink->channelCount = channelCount;
+        sink->queue.closed = false;
+        sink->failed = false;
+        sinks.push_back(sink);
+
+        /* one conversion, and one dither, per sample format however many targets take it */
+        int conversion = 0;
+        while (conversion < (int)conversions.size() && conversions[conversion].samples != sink->samples)
+            conversion++;
+        if (conversion == (int)conversions.size())
+        {
+
+            ExportConversion added;
+            added.samples = sink->samples;
+            added.random = EXPORT_DITHER_SEED;
+            conversions.push_back(added);
+        }
+        conversions[conversion].sinks.push_back(sink);
+    }
+
+    bool succeeded = false;
+    ExportFormatsReport formatsReport;
+    memset(&formatsReport, 0, sizeof(formatsReport));
+    if (opened)
+    {
+
+        vector<float> output[ENGINE_MAX_CHANNELS];
+        ExportProgress progress;
+        progress.readyFrames.store(0);
+        progress.finished.store(false);
+        ExportConverter converter;
+        converter.conversions = &conversions;
+        converter.output = output;
+        converter.channelCount = channelCount;
+        converter.frameCount = frameCount;
+        converter.progress = &progress;
+        converter.converted = 0;
+
+        vector<thread> encoders;
+        for (ExportSink* sink : sinks)
+            encoders.push_back(CreateEngineThread(RunExportSink, sink));
+        thread converterThread = CreateEngineThread(RunExportConverter, &converter);
+
+        const bool rendered = RenderExport(engine, mixNode, frameCount, threadCount, output, &formatsReport.render, &progress);
+        if (rendered)
+            progress.readyFrames.store(frameCount);
+        progress.finished.store(true);
+        const unsigned long long renderedTicks = ReadEngineTicks();
+
+        converterThread.join();
+        for (thread& encoder : encoders)
+            encoder.join();
+
+        succeeded = rendered && converter.converted == frameCount;
+        formatsReport.drainMilliseconds = (ReadEngineTicks() - renderedTicks) * GetEngineTickSeconds() * 1000.0;
+    }
+
+    for (ExportSink* sink : sinks)
+    {
+        if (opened && (!succeeded || sink->failed))
+            LogMessage(LOG_ERROR, "The export could not be written to %s.", sink->target->path);
+    }
+    for (ExportSink* sink : sinks)
+        succeeded = succeeded && !sink->failed;
+
+    /* the targets succeed or fail together, and a failed call removes every file it created */
+    for (ExportSink* sink : sinks)
+    {
+        sink->target->succeeded = succeeded;
+        sf_close(sink->file);
+        if (!succeeded)
+            remove(sink->target->path);
+        delete sink;
+    }
+
+    formatsReport.targets = count;
+    formatsReport.conversions = (int)conversions.size();
+    formatsReport.milliseconds = (ReadEngineTicks() - startTicks) * GetEngineTickSeconds() * 1000.0;
+    if (report != NULL)
+        *report = formatsReport;
+    return succeeded;
+}
+
+bool ExportMix(Engine* engine, int mixNode, long long frameCount, int threadCount, const char* path, ExportReport* report)
+{
+    ExportTarget target;
+    snprintf(target.path, EXPORT_PATH_LENGTH, "%s", path);
+    target.format = SF_FORMAT_WAV | SF_FORMAT_FLOAT;
+
+    ExportFormatsReport formatsReport;
+    const bool succeeded = ExportMixFormats(engine, mixNode, frameCount, threadCount, &target, 1, &formatsReport);
+    if (report != NULL)
+        *report = formatsReport.render;
+    return succeeded;
+}
+
+int BenchmarkExport(Engine* engine, int mixNode, long long frameCount, const int* threadCounts, int count, ExportBenchmarkResult* results, double* serialMilliseconds)
+{
+    vector<float> serial[ENGINE_MAX_CHANNELS];
+    double baseline = 0.0;
+    if (!RenderExportSerial(engine, frameCount, serial, &baseline))
+        return 0;
+    if (serialMilliseconds != NULL)
+        *serialMilliseconds = baseline;
+
+    int filled = 0;
+    for (int i = 0; i < count; i++)
+    {
+        vector<float> output[ENGINE_MAX_CHANNELS];
+        ExportReport report;
+        if (!RenderExport(engine, mixNode, frameCount, threadCounts[i], output, &report))
+            break;
+
+        float difference = 0.0f;
+        for (int c = 0; c < engine->channelCount; c++)
+        {
+            for (long long n = 0; n < frameCount; n++)
+                difference = max(difference, fabsf(output[c][(size_t)n] - serial[c][(size_t)n]));
+        }
+
+        ExportBenchmarkResult& result = results[filled++];
+        result.threads = report.threads;
+        result.milliseconds = report.milliseconds;
+        result.speedup = report.milliseconds > 0.0 ? baseline / report.milliseconds : 0.0;
+        result.peakDifference = difference;
+    }
+
+    return filled;
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include<atomic>
+#include<vector>
+
+#include"Engine.h"
+
+/*api.daw export*/
+#define EXPORT_SEGMENT_SECONDS 10
+#define EXPORT_PATH_LENGTH 260
+#define EXPORT_MIX -1
+#define EXPORT_WHOLE -2
+#define EXPORT_CHUNK_FRAMES 8192
+#define EXPORT_QUEUE_CHUNKS 8
+#define EXPORT_POLL_MILLISECONDS 2
+#define EXPORT_DITHER_SEED 0x9E3779B9u
+#define EXPORT_SAMPLES_FLOAT 0
+#define EXPORT_SAMPLES_16 1
+#define EXPORT_SAMPLES_24 2
+#define EXPORT_SAMPLES_32 3
+
+struct ExportReport {
+    int threads;
+    int stems;
+    int segmentedStems;
+    bool segmentedMix;
+    int stemJobs;
+    int mixJobs;
+    double seconds;
+    double milliseconds;
+    double realtimeFactor;
+};
+
+/* The frames of the mix RenderExport has finished from the start, published while it runs. */
+struct ExportProgress {
+    std::atomic<long long> readyFrames;
+    std::atomic<bool> finished;
+};
+
+/*
+    A private copy of the whole graph, with states of its own, for the functions below to
+    clone their jobs from, so no export thread touches a node the audio thread processes.
+    Build it on the UI thread while nothing processes engine, with the audio stream
+    stopped; templateMixNode receives the copy of mixNode. The copy keeps nothing of
+    engine and may be rendered while engine plays again.
+*/
+Engine* CreateExportTemplate(Engine* engine, int mixNode, int* templateMixNode);
+void DestroyExportTemplate(Engine* engine);
+
+/*
+    Renders what the engine's output node plays, offline and on up to threadCount threads.
+    engine is an export template rather than the live engine, and its states are cloned
+    one at a time. Every input of mixNode is a stem: its subgraph is cloned into a private
+    engine and rendered into a buffer, then a clone of mixNode and everything after it
+    mixes the buffers in place of the sources. A subgraph whose preroll
+    (GetEngineNodePreroll) fits in EXPORT_SEGMENT_SECONDS is also cut into segments of
+    that length, each seeked to its start less the preroll in its own engine; the rest
+    render from frame 0 in one job. Every job writes its own frames, so the result does
+    not depend on the threads. The calling thread waits; stems take
+    channelCount * frameCount floats each.
+    output receives channelCount channels of frameCount frames; with a progress, the frames
+    below its readyFrames may be read while the mix still renders.
+*/
+bool RenderExport(Engine* engine, int mixNode, long long frameCount, int threadCount, std::vector<float>* output, ExportReport* report, ExportProgress* progress = NULL);
+
+/* the whole graph cloned into one engine and rendered from start to finish on the calling thread: what RenderExport is measured against */
+bool RenderExportSerial(Engine* engine, long long frameCount, std::vector<float>* output, double* milliseconds);
+
+/* One file of a multi-format export; format is a container and encoding from sndfile.h. */
+struct ExportTarget {
+    char path[EXPORT_PATH_LENGTH];
+    int format;
+
+    /* filled by the export: the time its encoder spent writing */
+    bool succeeded;
+    double milliseconds;
+};
+
+struct ExportFormatsReport {
+    ExportReport render;
+    int targets;
+    int conversions;
+    double milliseconds;
+
+    /* how long the encoders ran on once the render had finished */
+    double drainMilliseconds;
+};
+
+/* the sample format a target's encoder is fed: EXPORT_SAMPLES_* */
+int GetExportTargetSamples(int format);
+
+/*
+    Renders the mix once and encodes it into every target at the same time. A converter
+    thread takes the mix in EXPORT_CHUNK_FRAMES chunks as RenderExport finishes them and
+    converts each chunk once per sample format, with TPDF dither for 16 and 24 bits; every
+    target has an encoder thread behind a queue of EXPORT_QUEUE_CHUNKS chunks, so the
+    slowest encoder holds the converter back instead of the chunks piling up. Every format
+    is checked before a file is opened; the targets succeed together, and a failed export
+    removes the files it created.
+*/
+bool ExportMixFormats(Engine* engine, int mixNode, long long frameCount, int threadCount, ExportTarget* targets, int count, ExportFormatsReport* report);
+
+/* ExportMixFormats into one 32-bit float WAV file */
+bool ExportMix(Engine* engine, int mixNode, long long frameCount, int threadCount, const char* path, ExportReport* report);
+
+struct ExportBenchmarkResult {
+    int threads;
+    double milliseconds;
+
+    /* against RenderExportSerial, and the largest sample difference from it */
+    double speedup;
+    float peakDifference;
+};
+
+/* the serial render once, then RenderExport with each thread count; returns the results filled */
+int BenchmarkExport(Engine* engine, int mixNode, long long frameCount, const int* threadCounts, int count, ExportBenchmarkResult* results, double* serialMilliseconds);
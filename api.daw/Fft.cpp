@@ -0,0 +1,239 @@
+#include"Fft.h"
+#include"Simd.h"
+
+#include<cmath>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+bool InitializeFft(Fft* fft, int size)
+{
+    if (size < FFT_MIN_SIZE || size > FFT_MAX_SIZE || (size & (size - 1)) != 0)
+        return false;
+
+    const int half = size / 2;
+    fft->size = size;
+    fft->half = half;
+    fft->avx2 = HasAVX2();
+    fft->reversal.assign(half, 0);
+    fft->real.assign(half, 0.0f);
+    fft->imaginary.assign(half, 0.0f);
+
+    int bits = 0;
+    while ((1 << bits) < half)
+        bits++;
+    for (int k = 0; k < half; k++)
+    {
+        int reversed = 0;
+        for (int b = 0; b < bits; b++)
+            reversed |= ((k >> b) & 1) << (bits - 1 - b);
+        fft->reversal[k] = reversed;
+    }
+
+    /* the stage whose butterflies span h keeps its h twiddles at offset h - 1 */
+    fft->stageCosines.assign(half > 1 ? half - 1 : 1, 0.0f);
+    fft->stageSines.assign(half > 1 ? half - 1 : 1, 0.0f);
+    for (int h = 1; h < half; h *= 2)
+    {
+        for (int j = 0; j < h; j++)
+        {
+            fft->stageCosines[h - 1 + j] = (float)cos(M_PI * j / h);
+            fft->stageSines[h - 1 + j] = (float)sin(M_PI * j / h);
+        }
+    }
+
+    fft->splitCosines.assign(half + 1, 0.0f);
+    fft->splitSines.assign(half + 1, 0.0f);
+    for (int k = 0; k <= half; k++)
+    {
+        fft->splitCosines[k] = (float)cos(2 * M_PI * k / size);
+        fft->splitSines[k] = (float)sin(2 * M_PI * k / size);
+    }
+
+    return true;
+}
+
+typedef void (*FftStageKernel)(float* real, float* imaginary, const float* cosines, const float* sines, int count, int span);
+
+static void FftStageScalar(float* real, float* imaginary, const float* cosines, const float* sines, int count, int span)
+{
+    for (int base = 0; base < count; base += 2 * span)
+    {
+        for (int j = 0; j < span; j++)
+        {
+            const int a = base + j;
+            const int b = a + span;
+            const float tr = cosines[j] * real[b] + sines[j] * imaginary[b];
+            const float ti = cosines[j] * imaginary[b] - sines[j] * real[b];
+            real[b] = real[a] - tr;
+            imaginary[b] = imaginary[a] - ti;
+            real[a] += tr;
+            imaginary[a] += ti;
+        }
+    }
+}
+
+DAW_TARGET_AVX2
+static void FftStageAVX2(float* real, float* imaginary, const float* cosines, const float* sines, int count, int span)
+{
+    if (span < 8)
+    {
+
+        FftStageScalar(real, imaginary, cosines, sines, count, span);
+        return;
+    }
+
+    for (int base = 0; base < count; base += 2 * span)
+    {
+        for (int j = 0; j < span; j += 8)
+        {
+            const int a = base + j;
+            const int b = a + span;
+            const __m256 c = _mm256_loadu_ps(cosines + j);
+            const __m256 s = _mm256_loadu_ps(sines + j);
+            const __m256 br = _mm256_loadu_ps(real + b);
+            const __m256 bi = _mm256_loadu_ps(imaginary + b);
+            const __m256 ar = _mm256_loadu_ps(real + a);
+            const __m256 ai = _mm256_loadu_ps(imaginary + a);
+            const __m256 tr = _mm256_fmadd_ps(c, br, _mm256_mul_ps(s, bi));
+            const __m256 ti = _mm256_fmsub_ps(c, bi, _mm256_mul_ps(s, br));
+            _mm256_storeu_ps(real + b, _mm256_sub_ps(ar, tr));
+            _mm256_storeu_ps(imaginary + b, _mm256_sub_ps(ai, ti));
+            _mm256_storeu_ps(real + a, _mm256_add_ps(ar, tr));
+            _mm256_storeu_ps(imaginary + a, _mm256_add_ps(ai, ti));
+        }
+    }
+}
+
+/* forward complex transform of the bit-reversed scratch, in place */
+static void TransformFft(Fft* fft)
+{
+    float* real = fft->real.data();
+    float* imaginary = fft->imaginary.data();
+    const FftStageKernel stage = fft->avx2 ? FftStageAVX2 : FftStageScalar;
+    for (int span = 1; span < fft->half; span *= 2)
+        stage(real, imaginary, fft->stageCosines.data() + span - 1, fft->stageSines.data() + span - 1, fft->half, span);
+}
+
+void ForwardFft(Fft* fft, const float* input, float* real, float* imaginary)
+{
+    const int half = fft->half;
+    const int* reversal = fft->reversal.data();
+
+    /* even samples become the real part, odd samples the imaginary part */
+    for (int k = 0; k < half; k++)
+    {
+        fft->real[reversal[k]] = input[2 * k];
+        fft->imaginary[reversal[k]] = input[2 * k + 1];
+    }
+    TransformFft(fft);
+
+    const float* zr = fft->real.data();
+    const float* zi = fft->imaginary.data();
+    real[0] = zr[0] + zi[0];
+    imaginary[0] = 0.0f;
+    real[half] = zr[0] - zi[0];
+    imaginary[half] = 0.0f;
+
+    /* bins k and half - k come from the same pair of complex bins */
+    for (int k = 1; k <= half / 2; k++)
+    {
+        const int m = half - k;
+        const float er = 0.5f * (zr[k] + zr[m]);
+        const float ei = 0.5f * (zi[k] - zi[m]);
+        const float or_ = 0.5f * (zi[k] + zi[m]);
+        const float oi = -0.5f * (zr[k] - zr[m]);
+
+        const float c = fft->splitCosines[k];
+        const float s = fft->splitSines[k];
+        const float wr = c * or_ + s * oi;
+        const float wi = c * oi - s * or_;
+
+        real[k] = er + wr;
+        imaginary[k] = ei + wi;
+        real[m] = er - wr;
+        imaginary[m] = -(ei - wi);
+    }
+}
+
+void InverseFft(Fft* fft, const float* real, const float* imaginary, float* output)
+{
+    const int half = fft->half;
+    const int* reversal = fft->reversal.data();
+    float* zr = fft->real.data();
+    float* zi = fft->imaginary.data();
+
+    /* the complex spectrum goes in conjugated, so the forward butterflies compute the inverse */
+    zr[reversal[0]] = 0.5f * (real[0] + real[half]);
+    zi[reversal[0]] = -0.5f * (real[0] - real[half]);
+    for (int k = 1; k <= half / 2; k++)
+    {
+        const int m = half - k;
+        const float er = 0.5f * (real[k] + real[m]);
+        const float ei = 0.5f * (imaginary[k] - imaginary[m]);
+        const float dr = 0.5f * (real[k] - real[m]);
+        const float di = 0.5f * (imaginary[k] + imaginary[m]);
+
+        const float c = fft->splitCosines[k];
+        const float s = fft->splitSines[k];
+        const float or_ = dr * c - di * s;
+        const float oi = di * c + dr * s;
+
+        zr[reversal[k]] = er - oi;
+        zi[reversal[k]] = -(ei + or_);
+        zr[reversal[m]] = er + oi;
+        zi[reversal[m]] = -(or_ - ei);
+    }
+    TransformFft(fft);
+
+    const float scale = 1.0f / half;
+    for (int n = 0; n < half; n++)
+    {
+        output[2 * n] = zr[n] * scale;
+        output[2 * n + 1] = -zi[n] * scale;
+    }
+}
+
+void SpectrumMultiplyAccumulateScalar(
+    const float* aReal, const float* aImaginary, const float* bReal, const float* bImaginary, float* accumulatorReal, float* accumulatorImaginary, int count)
+{
+    for (int k = 0; k < count; k++)
+    {
+        accumulatorReal[k] += aReal[k] * bReal[k] - aImaginary[k] * bImaginary[k];
+        accumulatorImaginary[k] += aReal[k] * bImaginary[k] + aImaginary[k] * bReal[k];
+    }
+}
+
+DAW_TARGET_AVX2
+void SpectrumMultiplyAccumulateAVX2(
+    const float* aReal, const float* aImaginary, const float* bReal, const float* bImaginary, float* accumulatorReal, float* accumulatorImaginary, int count)
+{
+    int k = 0;
+    for (; k + 8 <= count; k += 8)
+    {
+        const __m256 ar = _mm256_loadu_ps(aReal + k);
+        const __m256 ai = _mm256_loadu_ps(aImaginary + k);
+        const __m256 br = _mm256_loadu_ps(bReal + k);
+        const __m256 bi = _mm256_loadu_ps(bImaginary + k);
+        __m256 real = _mm256_fmadd_ps(ar, br, _mm256_loadu_ps(accumulatorReal + k));
+        __m256 imaginary = _mm256_fmadd_ps(ar, bi, _mm256_loadu_ps(accumulatorImaginary + k));
+        real = _mm256_fnmadd_ps(ai, bi, real);
+        imaginary = _mm256_fmadd_ps(ai, br, imaginary);
+        _mm256_storeu_ps(accumulatorReal + k, real);
+        _mm256_storeu_ps(accumulatorImaginary + k, imaginary);
+    }
+
+    for (; k < count; k++)
+    {
+        accumulatorReal[k] += aReal[k] * bReal[k] - aImaginary[k] * bImaginary[k];
+        accumulatorImaginary[k] += aReal[k] * bImaginary[k] + aImaginary[k] * bReal[k];
+    }
+}
+
+void SpectrumMultiplyAccumulate(
+    const Fft* fft, const float* aReal, const float* aImaginary, const float* bReal, const float* bImaginary, float* accumulatorReal, float* accumulatorImaginary, int count)
+{
+    const SpectrumMultiplyAccumulateKernel kernel = fft->avx2 ? SpectrumMultiplyAccumulateAVX2 : SpectrumMultiplyAccumulateScalar;
+    kernel(aReal, aImaginary, bReal, bImaginary, accumulatorReal, accumulatorImaginary, count);
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include<vector>
+
+/*api.daw fft*/
+#define FFT_MIN_SIZE 4
+#define FFT_MAX_SIZE 262144
+
+/*
+    Real transforms of a power-of-two size, computed as a complex transform of half the
+    size. Spectra are kept split, real parts and imaginary parts in separate arrays of
+    size / 2 + 1 bins from DC to Nyquist, so spectral arithmetic vectorizes without
+    shuffles. The scratch lives in the Fft, so each thread transforms with its own.
+*/
+struct Fft {
+    int size;
+    int half;
+
+    /* the butterflies and spectral multiplies use AVX2 whenever the processor has it */
+    bool avx2;
+
+    std::vector<int> reversal;
+    std::vector<float> stageCosines;
+    std::vector<float> stageSines;
+    std::vector<float> splitCosines;
+    std::vector<float> splitSines;
+    std::vector<float> real;
+    std::vector<float> imaginary;
+};
+
+bool InitializeFft(Fft* fft, int size);
+
+/* input holds size samples; real and imaginary receive size / 2 + 1 bins */
+void ForwardFft(Fft* fft, const float* input, float* real, float* imaginary);
+
+/* scaled so that the inverse of the forward transform gives the input back */
+void InverseFft(Fft* fft, const float* real, const float* imaginary, float* output);
+
+/* accumulator += a * b over count complex bins */
+typedef void (*SpectrumMultiplyAccumulateKernel)(
+    const float* aReal, const float* aImaginary, const float* bReal, const float* bImaginary, float* accumulatorReal, float* accumulatorImaginary, int count
+);
+
+void SpectrumMultiplyAccumulateScalar(
+    const float* aReal, const float* aImaginary, const float* bReal, const float* bImaginary, float* accumulatorReal, float* accumulatorImaginary, int count
+);
+
+void SpectrumMultiplyAccumulateAVX2(
+    const float* aReal, const float* aImaginary, const float* bReal, const float* bImaginary, float* accumulatorReal, float* accumulatorImaginary, int count
+);
+
+/* with the kernel of the Fft that made the spectra */
+void SpectrumMultiplyAccumulate(
+    const Fft* fft, const float* aReal, const float* aImaginary, const float* bReal, const float* bImaginary, float* accumulatorReal, float* accumulatorImaginary, int count
+);
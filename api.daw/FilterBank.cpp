@@ -0,0 +1,493 @@
+#include"FilterBank.h"
+#include"EngineThreads.h"
+#include"Simd.h"
+
+#include<algorithm>
+#include<cmath>
+#include<cstring>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+using namespace std;
+
+#define FILTER_BLOCK_COEFFICIENTS (FILTER_BANK_COEFFICIENTS * FILTER_BANK_GROUP_LANES)
+#define FILTER_BLOCK_STATES (FILTER_BANK_STATES * FILTER_BANK_GROUP_LANES)
+
+/* a1, a2 and a3 run the integrators; the output mixes m0 of the input, m1 of the band and m2 of the lowpass */
+static void ComputeFilterCoefficients(const FilterSettings* settings, float sampleRate, float* coefficients)
+{
+    const int type = settings->type;
+    if (type <= FILTER_BYPASS || type >= FILTER_TYPE_COUNT)
+    {
+
+        const float identity[FILTER_BANK_COEFFICIENTS] = { 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f };
+        memcpy(coefficients, identity, sizeof(identity));
+        return;
+    }
+
+    const double frequency = min(max((double)settings->frequency, (double)FILTER_MIN_FREQUENCY), 0.49 * sampleRate);
+    const double q = max((double)settings->q, (double)FILTER_MIN_Q);
+    const double a = pow(10.0, settings->gain / 40.0);
+    double g = tan(M_PI * frequency / sampleRate);
+    double k = 1.0 / q;
+    double m0 = 1.0, m1 = 0.0, m2 = 0.0;
+
+    switch (type)
+    {
+    case FILTER_LOWPASS:
+        m0 = 0.0;
+        m2 = 1.0;
+        break;
+    case FILTER_HIGHPASS:
+        m1 = -k;
+        m2 = -1.0;
+        break;
+    case FILTER_BANDPASS:
+        m0 = 0.0;
+        m1 = k;
+        break;
+    case FILTER_NOTCH:
+        m1 = -k;
+        break;
+    case FILTER_BELL:
+        k = 1.0 / (q * a);
+        m1 = k * (a * a - 1.0);
+        break;
+    case FILTER_LOW_SHELF:
+        g /= sqrt(a);
+        m1 = k * (a - 1.0);
+        m2 = a * a - 1.0;
+        break;
+    case FILTER_HIGH_SHELF:
+        g *= sqrt(a);
+        m0 = a * a;
+        m1 = k * (1.0 - a) * a;
+        m2 = 1.0 - a * a;
+        break;
+    case FILTER_ALLPASS:
+        m1 = -2.0 * k;
+        break;
+    }
+
+    const double a1 = 1.0 / (1.0 + g * (g + k));
+    coefficients[0] = (float)a1;
+    coefficients[1] = (float)(g * a1);
+    coefficients[2] = (float)(g * g * a1);
+    coefficients[3] = (float)m0;
+    coefficients[4] = (float)m1;
+    coefficients[5] = (float)m2;
+}
+
+bool InitializeFilterBank(FilterBank* bank, int laneCount, int stageCount, int maxFrames)
+{
+    if (laneCount <= 0 || stageCount <= 0 || maxFrames <= 0)
+        return false;
+
+    bank->laneCount = laneCount;
+    bank->groupCount = (laneCount + FILTER_BANK_GROUP_LANES - 1) / FILTER_BANK_GROUP_LANES;
+    bank->stageCount = stageCount;
+    bank->maxFrames = maxFrames;
+    bank->kernel = HasAVX2() ? FILTER_BANK_KERNEL_AVX2 : FILTER_BANK_KERNEL_SSE;
+
+    const size_t blocks = (size_t)stageCount * bank->groupCount;
+    bank->coefficients.assign(blocks * FILTER_BLOCK_COEFFICIENTS, 0.0f);
+    bank->states.assign(blocks * FILTER_BLOCK_STATES, 0.0f);
+    bank->bypassed.assign(blocks, 1);
+    bank->ramping.assign(blocks, 0);
+    bank->interleaved.assign((size_t)maxFrames * FILTER_BANK_GROUP_LANES, 0.0f);
+
+    FilterSettings bypass = { FILTER_BYPASS, 1000.0f, 1.0f, 0.0f };
+    float identity[FILTER_BANK_COEFFICIENTS];
+    ComputeFilterCoefficients(&bypass, 48000.0f, identity);
+    for (size_t b = 0; b < blocks; b++)
+    {
+        for (int c = 0; c < FILTER_BANK_COEFFICIENTS; c++)
+        {
+            for (int l = 0; l < FILTER_BANK_GROUP_LANES; l++)
+                bank->coefficients[b * FILTER_BLOCK_COEFFICIENTS + c * FILTER_BANK_GROUP_LANES + l] = identity[c];
+        }
+    }
+    bank->targets = bank->coefficients;
+
+    return true;
+}
+
+void ResetFilterBank(FilterBank* bank)
+{
+    fill(bank->states.begin(), bank->states.end(), 0.0f);
+}
+
+static bool IsFilterIdentity(const float* coefficients, int lane)
+{
+    return coefficients[3 * FILTER_BANK_GROUP_LANES + lane] == 1.0f && coefficients[4 * FILTER_BANK_GROUP_LANES + lane] == 0.0f &&
+        coefficients[5 * FILTER_BANK_GROUP_LANES + lane] == 0.0f;
+}
+
+bool SetFilterBankStage(FilterBank* bank, int stage, int lane, const FilterSettings* settings, float sampleRate)
+{
+    if (stage < 0 || stage >= bank->stageCount || lane < 0 || lane >= bank->laneCount || sampleRate <= 0.0f)
+        return false;
+
+    float coefficients[FILTER_BANK_COEFFICIENTS];
+    ComputeFilterCoefficients(settings, sampleRate, coefficients);
+
+    const size_t block = (size_t)stage * bank->groupCount + lane / FILTER_BANK_GROUP_LANES;
+    float* targets = bank->targets.data() + block * FILTER_BLOCK_COEFFICIENTS;
+    const int position = lane % FILTER_BANK_GROUP_LANES;
+
+    bool changed = false;
+    for (int c = 0; c < FILTER_BANK_COEFFICIENTS; c++)
+    {
+        changed |= targets[c * FILTER_BANK_GROUP_LANES + position] != coefficients[c];
+        targets[c * FILTER_BANK_GROUP_LANES + position] = coefficients[c];
+    }
+    if (!changed)
+        return true;
+
+    bool bypassed = true;
+    for (int l = 0; l < FILTER_BANK_GROUP_LANES && bypassed; l++)
+        bypassed = IsFilterIdentity(targets, l);
+    bank->bypassed[block] = bypassed;
+    bank->ramping[block] = 1;
+
+    return true;
+}
+
+bool SetFilterBankButterworth(FilterBank* bank, int firstStage, int order, int lane, int type, float frequency, float sampleRate)
+{
+    if (order < 2 || order % 2 != 0 || firstStage < 0 || firstStage + order / 2 > bank->stageCount)
+        return false;
+    if (type != FILTER_LOWPASS && type != FILTER_HIGHPASS)
+        return false;
+
+    /* the poles of the whole filter sit evenly on a half circle; each stage takes a conjugate pair */
+    for (int s = 0; s < order / 2; s++)
+    {
+        FilterSettings settings;
+        settings.type = type;
+        settings.frequency = frequency;
+        settings.q = (float)(1.0 / (2.0 * sin(M_PI * (2 * s + 1) / (2.0 * order))));
+        settings.gain = 0.0f;
+        if (!SetFilterBankStage(bank, firstStage + s, lane, &settings, sampleRate))
+            return false;
+    }
+
+    return true;
+}
+
+bool IsFilterBankGroupActive(const FilterBank* bank, int group)
+{
+    for (int s = 0; s < bank->stageCount; s++)
+    {
+        const size_t block = (size_t)s * bank->groupCount + group;
+        if (!bank->bypassed[block] || bank->ramping[block])
+            return true;
+    }
+
+    return false;
+}
+
+/* one stage over every frame of a group; when ramping, the coefficients step from their current values and land on the targets with the last frame */
+typedef void (*FilterStageKernel)(float* samples, int frameCount, const float* coefficients, const float* targets, float* states, bool ramp);
+
+static void FilterStageScalar(float* samples, int frameCount, const float* coefficients, const float* targets, float* states, bool ramp)
+{
+    const float inverse = 1.0f / frameCount;
+    for (int l = 0; l < FILTER_BANK_GROUP_LANES; l++)
+    {
+        float c[FILTER_BANK_COEFFICIENTS];
+        float step[FILTER_BANK_COEFFICIENTS];
+        for (int k = 0; k < FILTER_BANK_COEFFICIENTS; k++)
+        {
+            c[k] = coefficients[k * FILTER_BANK_GROUP_LANES + l];
+            step[k] = ramp ? (targets[k * FILTER_BANK_GROUP_LANES + l] - c[k]) * inverse : 0.0f;
+        }
+
+        float ic1 = states[l];
+        float ic2 = states[FILTER_BANK_GROUP_LANES + l];
+        for (int n = 0; n < frameCount; n++)
+        {
+            if (ramp)
+            {
+                for (int k = 0; k < FILTER_BANK_COEFFICIENTS; k++)
+                    c[k] += step[k];
+            }
+
+            float* sample = samples + n * FILTER_BANK_GROUP_LANES + l;
+            const float v0 = *sample;
+            const float v3 = v0 - ic2;
+            const float v1 = c[0] * ic1 + c[1] * v3;
+            const float v2 = ic2 + c[1] * ic1 + c[2] * v3;
+            ic1 = 2.0f * v1 - ic1;
+            ic2 = 2.0f * v2 - ic2;
+            *sample = c[3] * v0 + c[4] * v1 + c[5] * v2;
+        }
+        states[l] = ic1;
+        states[FILTER_BANK_GROUP_LANES + l] = ic2;
+    }
+}
+
+/* the group as two vectors of four lanes */
+static void FilterStageSSE(float* samples, int frameCount, const float* coefficients, const float* targets, float* states, bool ramp)
+{
+    const __m128 inverse = _mm_set1_ps(1.0f / frameCount);
+    const __m128 two = _mm_set1_ps(2.0f);
+    for (int half = 0; half < FILTER_BANK_GROUP_LANES; half += 4)
+    {
+        __m128 c[FILTER_BANK_COEFFICIENTS];
+        __m128 step[FILTER_BANK_COEFFICIENTS];
+        for (int k = 0; k < FILTER_BANK_COEFFICIENTS; k++)
+        {
+            c[k] = _mm_loadu_ps(coefficients + k * FILTER_BANK_GROUP_LANES + half);
+            step[k] = ramp ? _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(targets + k * FILTER_BANK_GROUP_LANES + half), c[k]), inverse) : _mm_setzero_ps();
+        }
+
+        __m128 ic1 = _mm_loadu_ps(states + half);
+        __m128 ic2 = _mm_loadu_ps(states + FILTER_BANK_GROUP_LANES + half);
+        for (int n = 0; n < frameCount; n++)
+        {
+            if (ramp)
+            {
+                for (int k = 0; k < FILTER_BANK_COEFFICIENTS; k++)
+                    c[k] = _mm_add_ps(c[k], step[k]);
+            }
+
+            float* sample = samples + n * FILTER_BANK_GROUP_LANES + half;
+            const __m128 v0 = _mm_loadu_ps(sample);
+            const __m128 v3 = _mm_sub_ps(v0, ic2);
+            const __m128 v1 = _mm_add_ps(_mm_mul_ps(c[0], ic1), _mm_mul_ps(c[1], v3));
+            const __m128 v2 = _mm_add_ps(ic2, _mm_add_ps(_mm_mul_ps(c[1], ic1), _mm_mul_ps(c[2], v3)));
+            ic1 = _mm_sub_ps(_mm_mul_ps(two, v1), ic1);
+            ic2 = _mm_sub_ps(_mm_mul_ps(two, v2), ic2);
+            _mm_storeu_ps(sample, _mm_add_ps(_mm_mul_ps(c[3], v0), _mm_add_ps(_mm_mul_ps(c[4], v1), _mm_mul_ps(c[5], v2))));
+        }
+        _mm_storeu_ps(states + half, ic1);
+        _mm_storeu_ps(states + FILTER_BANK_GROUP_LANES + half, ic2);
+    }
+}
+
+DAW_TARGET_AVX2
+static void FilterStageAVX2(float* samples, int frameCount, const float* coefficients, const float* targets, float* states, bool ramp)
+{
+    const __m256 inverse = _mm256_set1_ps(1.0f / frameCount);
+    const __m256 two = _mm256_set1_ps(2.0f);
+    __m256 c[FILTER_BANK_COEFFICIENTS];
+    __m256 step[FILTER_BANK_COEFFICIENTS];
+    for (int k = 0; k < FILTER_BANK_COEFFICIENTS; k++)
+    {
+        c[k] = _mm256_loadu_ps(coefficients + k * FILTER_BANK_GROUP_LANES);
+        step[k] = ramp ? _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(targets + k * FILTER_BANK_GROUP_LANES), c[k]), inverse) : _mm256_setzero_ps();
+    }
+
+    __m256 ic1 = _mm256_loadu_ps(states);
+    __m256 ic2 = _mm256_loadu_ps(states + FILTER_BANK_GROUP_LANES);
+    for (int n = 0; n < frameCount; n++)
+    {
+        if (ramp)
+        {
+            for (int k = 0; k < FILTER_BANK_COEFFICIENTS; k++)
+                c[k] = _mm256_add_ps(c[k], step[k]);
+        }
+
+        float* sample = samples + n * FILTER_BANK_GROUP_LANES;
+        const __m256 v0 = _mm256_loadu_ps(sample);
+        const __m256 v3 = _mm256_sub_ps(v0, ic2);
+        const __m256 v1 = _mm256_fmadd_ps(c[1], v3, _mm256_mul_ps(c[0], ic1));
+        const __m256 v2 = _mm256_fmadd_ps(c[2], v3, _mm256_fmadd_ps(c[1], ic1, ic2));
+        ic1 = _mm256_fmsub_ps(two, v1, ic1);
+        ic2 = _mm256_fmsub_ps(two, v2, ic2);
+        _mm256_storeu_ps(sample, _mm256_fmadd_ps(c[5], v2, _mm256_fmadd_ps(c[4], v1, _mm256_mul_ps(c[3], v0))));
+    }
+    _mm256_storeu_ps(states, ic1);
+    _mm256_storeu_ps(states + FILTER_BANK_GROUP_LANES, ic2);
+}
+
+static const FilterStageKernel FilterStageKernels[] = { FilterStageScalar, FilterStageSSE, FilterStageAVX2 };
+
+bool ProcessFilterBankGroup(FilterBank* bank, int group, float* samples, int frameCount)
+{
+    if (group < 0 || group >= bank->groupCount || frameCount <= 0)
+        return false;
+
+    const FilterStageKernel stage = FilterStageKernels[bank->kernel];
+
+    /* stage by stage over the whole block, so a stage's state and coefficients stay in registers */
+    for (int s = 0; s < bank->stageCount; s++)
+    {
+        const size_t block = (size_t)s * bank->groupCount + group;
+        if (bank->bypassed[block] && !bank->ramping[block])
+            continue;
+
+        float* coefficients = bank->coefficients.data() + block * FILTER_BLOCK_COEFFICIENTS;
+        const float* targets = bank->targets.data() + block * FILTER_BLOCK_COEFFICIENTS;
+        float* states = bank->states.data() + block * FILTER_BLOCK_STATES;
+        stage(samples, frameCount, coefficients, targets, states, bank->ramping[block] != 0);
+
+        if (bank->ramping[block])
+        {
+
+            memcpy(coefficients, targets, sizeof(float) * FILTER_BLOCK_COEFFICIENTS);
+            bank->ramping[block] = 0;
+
+            /* a stage that ramped out stops running, so it must not come back with a stale state */
+            if (bank->bypassed[block])
+                memset(states, 0, sizeof(float) * FILTER_BLOCK_STATES);
+        }
+    }
+
+    return true;
+}
+
+bool ProcessFilterBankLanes(FilterBank* bank, int group, const float* const* input, float* const* output, int frameCount)
+{
+    if (frameCount <= 0 || frameCount > bank->maxFrames)
+        return false;
+
+    float* samples = bank->interleaved.data();
+    for (int l = 0; l < FILTER_BANK_GROUP_LANES; l++)
+    {
+        const float* lane = input[l];
+        for (int n = 0; n < frameCount; n++)
+            samples[n * FILTER_BANK_GROUP_LANES + l] = lane != NULL ? lane[n] : 0.0f;
+    }
+
+    if (!ProcessFilterBankGroup(bank, group, samples, frameCount))
+        return false;
+
+    for (int l = 0; l < FILTER_BANK_GROUP_LANES; l++)
+    {
+        float* lane = output[l];
+        if (lane == NULL)
+            continue;
+        for (int n = 0; n < frameCount; n++)
+            lane[n] = samples[n * FILTER_BANK_GROUP_LANES + l];
+    }
+
+    return true;
+}
+
+bool ProcessFilterBank(FilterBank* bank, float** lanes, int frameCount)
+{
+    for (int g = 0; g < bank->groupCount; g++)
+    {
+        if (!IsFilterBankGroupActive(bank, g))
+            continue;
+
+        float* group[FILTER_BANK_GROUP_LANES] = {};
+        for (int l = 0; l < FILTER_BANK_GROUP_LANES && g * FILTER_BANK_GROUP_LANES + l < bank->laneCount; l++)
+            group[l] = lanes[g * FILTER_BANK_GROUP_LANES + l];
+        if (!ProcessFilterBankLanes(bank, g, group, group, frameCount))
+            return false;
+    }
+
+    return true;
+}
+
+bool SetFilterBankKernel(FilterBank* bank, int kernel)
+{
+    if (kernel < FILTER_BANK_KERNEL_SCALAR || kernel > FILTER_BANK_KERNEL_AVX2)
+        return false;
+    if (kernel == FILTER_BANK_KERNEL_AVX2 && !HasAVX2())
+        return false;
+
+    bank->kernel = kernel;
+    return true;
+}
+
+struct FilterBankBenchmark {
+    FilterBank* bank;
+    float sampleRate;
+    int blockSize;
+    int blocks;
+    bool modulated;
+    unsigned long long ticks;
+};
+
+static void RunFilterBankBenchmark(FilterBankBenchmark* benchmark)
+{
+    FilterBank* bank = benchmark->bank;
+    const int blockSize = benchmark->blockSize;
+    vector<float> noise((size_t)bank->laneCount * blockSize);
+    vector<float> samples(noise.size());
+    vector<float*> lanes(bank->laneCount);
+    for (int l = 0; l < bank->laneCount; l++)
+        lanes[l] = samples.data() + (size_t)l * blockSize;
+
+    unsigned seed = 1;
+    for (size_t i = 0; i < noise.size(); i++)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        noise[i] = (float)(seed >> 8) / 16777216.0f - 0.5f;
+    }
+
+    /* bells spread evenly in octaves over the audible range */
+    FilterSettings settings;
+    settings.type = FILTER_BELL;
+    settings.q = 1.4f;
+    for (int b = 0; b < benchmark->blocks; b++)
+    {
+        memcpy(samples.data(), noise.data(), sizeof(float) * noise.size());
+
+        const unsigned long long start = ReadEngineTicks();
+        if (b == 0 || benchmark->modulated)
+        {
+            for (int s = 0; s < bank->stageCount; s++)
+            {
+                settings.frequency = 30.0f * powf(500.0f, (float)s / bank->stageCount);
+                settings.gain = 6.0f * sinf(0.01f * b + s);
+                for (int l = 0; l < bank->laneCount; l++)
+                    SetFilterBankStage(bank, s, l, &settings, benchmark->sampleRate);
+            }
+        }
+        ProcessFilterBank(bank, lanes.data(), blockSize);
+        benchmark->ticks += ReadEngineTicks() - start;
+    }
+}
+
+int BenchmarkFilterBank(int sampleRate, int blockSize, int laneCount, int stageCount, FilterBankBenchmarkResult* results)
+{
+    const double tickSeconds = GetEngineTickSeconds();
+    int written = 0;
+
+    /* every kernel runs on a bank of the benchmark's own, so the selection the mixer's banks use is left alone */
+    for (int kernel = FILTER_BANK_KERNEL_SCALAR; kernel <= FILTER_BANK_KERNEL_AVX2; kernel++)
+    {
+        if (kernel == FILTER_BANK_KERNEL_AVX2 && !HasAVX2())
+            continue;
+
+        for (int modulated = 0; modulated < 2; modulated++)
+        {
+            FilterBank bank;
+            if (!InitializeFilterBank(&bank, laneCount, stageCount, blockSize))
+                break;
+            SetFilterBankKernel(&bank, kernel);
+
+            FilterBankBenchmark benchmark;
+            benchmark.bank = &bank;
+            benchmark.sampleRate = (float)sampleRate;
+            benchmark.blockSize = blockSize;
+            benchmark.blocks = FILTER_BENCHMARK_SECONDS * sampleRate / blockSize;
+            benchmark.modulated = modulated != 0;
+            benchmark.ticks = 0;
+
+            thread render = CreateEngineThread(RunFilterBankBenchmark, &benchmark);
+            render.join();
+
+            const double seconds = benchmark.ticks * tickSeconds;
+            const double audioSeconds = (double)benchmark.blocks * blockSize / sampleRate;
+
+            FilterBankBenchmarkResult& result = results[written++];
+            result.kernel = kernel;
+            result.laneCount = laneCount;
+            result.stageCount = stageCount;
+            result.modulated = benchmark.modulated;
+            result.microsecondsPerBlock = seconds / benchmark.blocks * 1e6;
+            result.nanosecondsPerFilterSample = seconds / ((double)benchmark.blocks * blockSize * laneCount * stageCount) * 1e9;
+            result.corePercent = seconds / audioSeconds * 100.0;
+        }
+    }
+
+    return written;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include<vector>
+
+/*api.daw filter bank*/
+#define FILTER_BANK_GROUP_LANES 8
+#define FILTER_BANK_COEFFICIENTS 6
+#define FILTER_BANK_STATES 2
+#define FILTER_MIN_FREQUENCY 10.0f
+#define FILTER_MIN_Q 0.05f
+#define FILTER_BENCHMARK_SECONDS 5
+
+#define FILTER_BYPASS 0
+#define FILTER_LOWPASS 1
+#define FILTER_HIGHPASS 2
+#define FILTER_BANDPASS 3
+#define FILTER_NOTCH 4
+#define FILTER_BELL 5
+#define FILTER_LOW_SHELF 6
+#define FILTER_HIGH_SHELF 7
+#define FILTER_ALLPASS 8
+#define FILTER_TYPE_COUNT 9
+
+#define FILTER_BANK_KERNEL_SCALAR 0
+#define FILTER_BANK_KERNEL_SSE 1
+#define FILTER_BANK_KERNEL_AVX2 2
+
+struct FilterSettings {
+    int type;
+    float frequency;
+    float q;
+    float gain;
+};
+
+/*
+    Many independent signals, the lanes, each through the same cascade of stages. Every
+    stage is a trapezoidal state variable filter: unlike a direct form biquad it stays
+    stable and quiet while its coefficients move, so a new setting ramps in across one
+    block. Lanes are grouped by FILTER_BANK_GROUP_LANES and stored transposed, coefficient
+    by coefficient and then lane by lane, so one vector holds a coefficient or a state for
+    a whole group; a group is processed frame-interleaved, one vector per frame.
+*/
+struct FilterBank {
+    int laneCount;
+    int groupCount;
+    int stageCount;
+    int maxFrames;
+
+    /* FILTER_BANK_KERNEL_*, the fastest the processor supports unless SetFilterBankKernel picks another */
+    int kernel;
+
+    /* [stage][group][coefficient or state][lane] */
+    std::vector<float> coefficients;
+    std::vector<float> targets;
+    std::vector<float> states;
+    std::vector<unsigned char> bypassed;
+    std::vector<unsigned char> ramping;
+
+    std::vector<float> interleaved;
+};
+
+/* Settings and processing belong to one thread, the one that owns the bank. */
+
+bool InitializeFilterBank(FilterBank* bank, int laneCount, int stageCount, int maxFrames);
+void ResetFilterBank(FilterBank* bank);
+
+/* a new setting ramps in over the next block the lane's group processes */
+bool SetFilterBankStage(FilterBank* bank, int stage, int lane, const FilterSettings* settings, float sampleRate);
+
+/* sets order / 2 stages from firstStage to a Butterworth lowpass or highpass; order must be even */
+bool SetFilterBankButterworth(FilterBank* bank, int firstStage, int order, int lane, int type, float frequency, float sampleRate);
+
+/* false when every stage of the group passes its input through untouched */
+bool IsFilterBankGroupActive(const FilterBank* bank, int group);
+
+/* samples hold frameCount frames of FILTER_BANK_GROUP_LANES interleaved lanes, filtered in place */
+bool ProcessFilterBankGroup(FilterBank* bank, int group, float* samples, int frameCount);
+
+/* input and output hold FILTER_BANK_GROUP_LANES channel pointers each; a NULL input is silence and a NULL output is dropped */
+bool ProcessFilterBankLanes(FilterBank* bank, int group, const float* const* input, float* const* output, int frameCount);
+
+/* lanes holds laneCount channel pointers, filtered in place */
+bool ProcessFilterBank(FilterBank* bank, float** lanes, int frameCount);
+
+/* like the settings, a bank's kernel is changed by the thread that owns it */
+bool SetFilterBankKernel(FilterBank* bank, int kernel);
+
+struct FilterBankBenchmarkResult {
+    int kernel;
+    int laneCount;
+    int stageCount;
+    bool modulated;
+    double microsecondsPerBlock;
+    double nanosecondsPerFilterSample;
+    double corePercent;
+};
+
+/* every stage a bell, with settings changed every block when modulated; one result per available kernel and modulation, up to 6 */
+int BenchmarkFilterBank(int sampleRate, int blockSize, int laneCount, int stageCount, FilterBankBenchmarkResult* results);
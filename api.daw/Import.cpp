@@ -0,0 +1,332 @@
+#include"Import.h"
+#include"EngineThreads.h"
+#include"Trace.h"
+#include"Log.h"
+#include"Resample.h"
+#include"sndfile.h"
+
+#include<algorithm>
+#include<cctype>
+#include<cstdio>
+#include<cstring>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include<windows.h>
+#else
+#include<dirent.h>
+#include<sys/stat.h>
+#endif
+
+using namespace std;
+
+static const char* ImportExtensions[] = { ".wav", ".w64", ".aif", ".aiff", ".flac", ".ogg", ".mp3" };
+
+static bool HasImportExtension(const char* name)
+{
+    const size_t length = strlen(name);
+    for (const char* extension : ImportExtensions)
+    {
+        const size_t extensionLength = strlen(extension);
+        if (length <= extensionLength)
+            continue;
+
+        size_t c = 0;
+        while (c < extensionLength && tolower((unsigned char)name[length - extensionLength + c]) == extension[c])
+            c++;
+        if (c == extensionLength)
+            return true;
+    }
+
+    return false;
+}
+
+static void AddImportedAsset(AssetImport* import, const char* directory, const char* name, unsigned long long bytes)
+{
+    if ((int)import->assets.size() == IMPORT_MAX_FILES || !HasImportExtension(name))
+        return;
+
+    ImportedAsset* asset = new ImportedAsset();
+#if defined(_WIN32)
+    snprintf(asset->path, IMPORT_PATH_LENGTH, "%s\\%s", directory, name);
+#else
+    snprintf(asset->path, IMPORT_PATH_LENGTH, "%s/%s", directory, name);
+#endif
+    asset->stage.store(IMPORT_QUEUED);
+    asset->sourceRate = 0;
+    asset->channelCount = 0;
+    asset->sourceFrames = 0;
+    asset->fileBytes = bytes;
+    asset->frameCount = 0;
+    asset->milliseconds = 0.0;
+    asset->collected = false;
+    import->assets.push_back(asset);
+}
+
+static void ScanImportDirectory(AssetImport* import, const char* directory)
+{
+#if defined(_WIN32)
+    char pattern[IMPORT_PATH_LENGTH];
+    snprintf(pattern, IMPORT_PATH_LENGTH, "%s\\*", directory);
+
+    WIN32_FIND_DATAA entry;
+    HANDLE search = FindFirstFileA(pattern, &entry);
+    if (search == INVALID_HANDLE_VALUE)
+        return;
+
+    do
+    {
+        if ((entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0)
+            AddImportedAsset(import, directory, entry.cFileName, ((unsigned long long)entry.nFileSizeHigh << 32) | entry.nFileSizeLow);
+    } while (FindNextFileA(search, &entry));
+
+    FindClose(search);
+#else
+    DIR* search = opendir(directory);
+    if (search == NULL)
+        return;
+
+    char path[IMPORT_PATH_LENGTH];
+    struct stat status;
+    while (dirent* entry = readdir(search))
+    {
+        snprintf(path, IMPORT_PATH_LENGTH, "%s/%s", directory, entry->d_name);
+        if (stat(path, &status) == 0 && S_ISREG(status.st_mode))
+            AddImportedAsset(import, directory, entry->d_name, (unsigned long long)status.st_size);
+    }
+
+    closedir(search);
+#endif
+
+    /* the folder's order does not depend on the file system */
+    sort(import->assets.begin(), import->assets.end(), [](const ImportedAsset* a, const ImportedAsset* b) { return strcmp(a->path, b->path) < 0; });
+}
+
+static bool ImportAsset(AssetImport* import, ImportedAsset* asset)
+{
+    asset->stage.store(IMPORT_PROBING);
+    SF_INFO info;
+    memset(&info, 0, sizeof(info));
+    SNDFILE* file = sf_open(asset->path, SFM_READ, &info);
+    if (file == NULL)
+    {
+
+        LogMessage(LOG_ERROR, "The file %s could not be imported: %s", asset->path, sf_strerror(NULL));
+        return false;
+    }
+    if (info.frames <= 0 || info.samplerate <= 0 || info.channels <= 0)
+    {
+
+        sf_close(file);
+        LogMessage(LOG_ERROR, "The file %s holds no audio.", asset->path);
+        return false;
+    }
+
+    asset->sourceRate = info.samplerate;
+    asset->channelCount = min(info.channels, ENGINE_MAX_CHANNELS);
+    if (info.channels > asset->channelCount)
+        LogMessage(LOG_WARNING, "Only the first %d channels of %s are imported.", asset->channelCount, asset->path);
+
+    /* decoded in blocks, so a cancelled import stops within one */
+    asset->stage.store(IMPORT_DECODING);
+    vector<float> source[ENGINE_MAX_CHANNELS];
+    for (int c = 0; c < asset->channelCount; c++)
+        source[c].resize((size_t)info.frames);
+    vector<float> interleaved((size_t)IMPORT_READ_FRAMES * info.channels);
+    long long read = 0;
+    while (read < info.frames && !import->cancelled.load())
+    {
+        const long long frames = sf_readf_float(file, interleaved.data(), min((long long)IMPORT_READ_FRAMES, info.frames - read));
+        if (frames <= 0)
+            break;
+
+        for (int c = 0; c < asset->channelCount; c++)
+        {
+            float* channel = source[c].data() + read;
+            for (long long n = 0; n < frames; n++)
+                channel[n] = interleaved[(size_t)n * info.channels + c];
+        }
+        read += frames;
+    }
+    sf_close(file);
+    if (import->cancelled.load() || read == 0)
+        return false;
+    asset->sourceFrames = read;
+
+    /* the decoded audio only lives until the peaks are built; playback decodes the asset again. Resampling and peaks go in blocks too */
+    asset->stage.store(IMPORT_RESAMPLING);
+    asset->frameCount = GetResampledFrames(read, info.samplerate, import->sampleRate);
+    vector<float> channels[ENGINE_MAX_CHANNELS];
+    for (int c = 0; c < asset->channelCount; c++)
+    {
+        if (info.samplerate == import->sampleRate)
+        {
+
+            source[c].resize((size_t)read);
+            channels[c].swap(source[c]);
+            continue;
+        }
+
+        channels[c].resize((size_t)asset->frameCount);
+        for (long long n = 0; n < asset->frameCount && !import->cancelled.load(); n += IMPORT_READ_FRAMES)
+            ResampleChannelFrames(source[c].data(), read, 1, info.samplerate, channels[c].data(), n, min((long long)IMPORT_READ_FRAMES, asset->frameCount - n), import->sampleRate);
+        vector<float>().swap(source[c]);
+    }
+    if (import->cancelled.load())
+        return false;
+
+    asset->stage.store(IMPORT_PEAKS);
+    const long long peakCount = (asset->frameCount + IMPORT_PEAK_FRAMES - 1) / IMPORT_PEAK_FRAMES;
+    asset->peaks.resize((size_t)peakCount * 2);
+    for (long long p = 0; p < peakCount && !import->cancelled.load(); p++)
+    {
+        float lowest = 0.0f;
+        float highest = 0.0f;
+        const long long end = min(asset->frameCount, (p + 1) * IMPORT_PEAK_FRAMES);
+        for (int c = 0; c < asset->channelCount; c++)
+        {
+            const float* channel = channels[c].data();
+            for (long long n = p * IMPORT_PEAK_FRAMES; n < end; n++)
+            {
+                lowest = min(lowest, channel[n]);
+                highest = max(highest, channel[n]);
+            }
+        }
+        asset->peaks[(size_t)p * 2] = lowest;
+        asset->peaks[(size_t)p * 2 + 1] = highest;
+    }
+
+    return !import->cancelled.load();
+}
+
+static void RunAssetImportWorker(AssetImport* import)
+{
+    SetTraceThreadName("Import");
+    const int count = (int)import->assets.size();
+    for (int a = import->next.fetch_add(1); a < count && !import->cancelled.load(); a = import->next.fetch_add(1))
+    {
+        ImportedAsset* asset = import->assets[a];
+        const unsigned long long start = ReadEngineTicks();
+        bool imported = false;
+        {
+            TraceScope trace("Import file", a);
+            imported = ImportAsset(import, asset);
+        }
+        asset->milliseconds = (ReadEngineTicks() - start) * GetEngineTickSeconds() * 1000.0;
+
+        if (imported)
+            import->bytes.fetch_add(asset->fileBytes);
+        else
+            import->failed.fetch_add(1);
+        asset->stage.store(imported ? IMPORT_DONE : IMPORT_FAILED, std::memory_order_release);
+        if (import->finished.fetch_add(1) + 1 == count)
+            import->endTicks.store(ReadEngineTicks());
+    }
+}
+
+int StartAssetImport(AssetImport* import, const char* directory, int sampleRate, int threadCount)
+{
+    StopAssetImport(import);
+    import->sampleRate = sampleRate;
+    import->next.store(0);
+    import->finished.store(0);
+    import->failed.store(0);
+    import->bytes.store(0);
+    import->cancelled.store(false);
+    import->endTicks.store(0);
+    import->startTicks = ReadEngineTicks();
+
+    ScanImportDirectory(import, directory);
+    const int count = (int)import->assets.size();
+    if (count == 0)
+    {
+
+        LogMessage(LOG_WARNING, "The folder %s holds no sound files to import.", directory);
+        import->threads = 0;
+        return 0;
+    }
+
+    if (threadCount <= 0)
+        threadCount = max(1, (int)thread::hardware_concurrency() - 1);
+    import->threads = min(threadCount, count);
+    for (int t = 0; t < import->threads; t++)
+        import->workers.push_back(CreateEngineThread(RunAssetImportWorker, import));
+
+    return count;
+}
+
+bool StopAssetImport(AssetImport* import)
+{
+    import->cancelled.store(true);
+    for (thread& worker : import->workers)
+        worker.join();
+    import->workers.clear();
+
+    for (ImportedAsset* asset : import->assets)
+        delete asset;
+    import->assets.clear();
+    return true;
+}
+
+int CollectImportedAssets(AssetImport* import, ImportedAsset** assets, int capacity)
+{
+    int count = 0;
+    for (ImportedAsset* asset : import->assets)
+    {
+        if (count == capacity)
+            break;
+        if (asset->collected || asset->stage.load(std::memory_order_acquire) != IMPORT_DONE)
+            continue;
+
+        asset->collected = true;
+        assets[count++] = asset;
+    }
+
+    return count;
+}
+
+bool GetAssetImportReport(const AssetImport* import, AssetImportReport* report)
+{
+    memset(report, 0, sizeof(*report));
+    report->files = (int)import->assets.size();
+    if (report->files == 0)
+        return false;
+
+    report->finished = import->finished.load();
+    report->failed = import->failed.load();
+    report->threads = import->threads;
+    report->done = report->finished == report->files;
+
+    const unsigned long long end = import->endTicks.load();
+    report->seconds = ((end != 0 ? end : ReadEngineTicks()) - import->startTicks) * GetEngineTickSeconds();
+    report->megabytes = import->bytes.load() / (1024.0 * 1024.0);
+    if (report->seconds > 0.0)
+    {
+
+        report->filesPerSecond = (report->finished - report->failed) / report->seconds;
+        report->megabytesPerSecond = report->megabytes / report->seconds;
+    }
+
+    return true;
+}
+
+const char* GetImportStageName(int stage)
+{
+    switch (stage)
+    {
+    case IMPORT_QUEUED:
+        return "queued";
+    case IMPORT_PROBING:
+        return "probing";
+    case IMPORT_DECODING:
+        return "decoding";
+    case IMPORT_RESAMPLING:
+        return "resampling";
+    case IMPORT_PEAKS:
+        return "peaks";
+    case IMPORT_DONE:
+        return "done";
+    default:
+        return "failed";
+    }
+}
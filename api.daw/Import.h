@@ -0,0 +1,85 @@
+#pragma once
+
+#include<atomic>
+#include<thread>
+#include<vector>
+
+#include"Engine.h"
+
+/*api.daw import*/
+#define IMPORT_PATH_LENGTH 260
+#define IMPORT_MAX_FILES 4096
+#define IMPORT_READ_FRAMES 65536
+#define IMPORT_PEAK_FRAMES 512
+
+#define IMPORT_QUEUED 0
+#define IMPORT_PROBING 1
+#define IMPORT_DECODING 2
+#define IMPORT_RESAMPLING 3
+#define IMPORT_PEAKS 4
+#define IMPORT_DONE 5
+#define IMPORT_FAILED 6
+
+/* One file of an import. The worker fills everything below stage before it stores IMPORT_DONE. */
+struct ImportedAsset {
+    char path[IMPORT_PATH_LENGTH];
+    std::atomic<int> stage;
+
+    int sourceRate;
+    int channelCount;
+    long long sourceFrames;
+    unsigned long long fileBytes;
+
+    /* at the import's sample rate; peaks hold the lowest and highest sample of every IMPORT_PEAK_FRAMES frames across the channels */
+    long long frameCount;
+    std::vector<float> peaks;
+    double milliseconds;
+
+    /* UI thread */
+    bool collected;
+};
+
+/*
+    Imports the sound files of a folder on a pool of workers. Each worker takes the next
+    file, probes it, decodes it in IMPORT_READ_FRAMES blocks, resamples it to the engine's
+    rate and builds its peaks; the UI polls the stages without locking, so it never waits on
+    a decode, and collects each file as soon as it is done.
+*/
+struct AssetImport {
+    std::vector<ImportedAsset*> assets;
+    std::vector<std::thread> workers;
+    int sampleRate;
+    int threads;
+
+    std::atomic<int> next;
+    std::atomic<int> finished;
+    std::atomic<int> failed;
+    std::atomic<unsigned long long> bytes;
+    std::atomic<bool> cancelled;
+    unsigned long long startTicks;
+    std::atomic<unsigned long long> endTicks;
+};
+
+/* stops an import still running first; threadCount <= 0 leaves one core to the UI and audio threads; returns the files found */
+int StartAssetImport(AssetImport* import, const char* directory, int sampleRate, int threadCount);
+
+/* cancels the files not started yet, waits for the workers and frees the assets */
+bool StopAssetImport(AssetImport* import);
+
+/* the assets done since the last call, each returned once; returns how many were written */
+int CollectImportedAssets(AssetImport* import, ImportedAsset** assets, int capacity);
+
+struct AssetImportReport {
+    int files;
+    int finished;
+    int failed;
+    int threads;
+    bool done;
+    double seconds;
+    double megabytes;
+    double filesPerSecond;
+    double megabytesPerSecond;
+};
+
+bool GetAssetImportReport(const AssetImport* import, AssetImportReport* report);
+const char* GetImportStageName(int stage);
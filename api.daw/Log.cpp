@@ -0,0 +1,420 @@
+#include"Log.h"
+#include"EngineThreads.h"
+#include"RealtimeSafety.h"
+
+#include<algorithm>
+#include<chrono>
+#include<condition_variable>
+#include<cstdio>
+#include<mutex>
+#include<thread>
+#include<vector>
+
+using namespace std;
+
+/* single producer, the owning thread; single consumer, the log thread */
+struct LogRing {
+    atomic<bool> owned;
+    atomic<unsigned> head;
+    atomic<unsigned> tail;
+    atomic<unsigned long long> dropped;
+    LogRecord records[LOG_RING_RECORDS];
+};
+
+struct Log {
+    LogRing rings[LOG_MAX_THREADS];
+    atomic<int> minimumLevel;
+    atomic<unsigned long long> written;
+    atomic<unsigned long long> unowned;
+
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool running;
+    bool wakeRequested;
+    FILE* file;
+
+    /* log thread */
+    vector<const LogRecord*> batch;
+    unsigned long long reportedDrops;
+};
+
+static Log ApplicationLog;
+static thread_local LogRing* LogThreadRing = NULL;
+
+/* records are stamped with the time stamp counter, cheaper than the clock, and converted on the log thread */
+static const chrono::steady_clock::time_point LogEpoch = chrono::steady_clock::now();
+static const unsigned long long LogEpochTicks = ReadEngineTicks();
+
+/* records with this format are timed by MeasureLogOverhead and never printed */
+static const char LogBenchmarkFormat[] = "Log benchmark %d at %.3f in %s";
+
+static LogRing* AcquireLogRing()
+{
+    for (LogRing& ring : ApplicationLog.rings)
+    {
+        if (!ring.owned.load(memory_order_relaxed) && !ring.owned.exchange(true, memory_order_acquire))
+            return &ring;
+    }
+
+    return NULL;
+}
+
+LogRecord* BeginLogRecord(int level, const char* format)
+{
+    if (level < ApplicationLog.minimumLevel.load(memory_order_relaxed))
+        return NULL;
+
+    /* a ring is claimed from a fixed pool on the first call, so even that call does not allocate */
+    LogRing* ring = LogThreadRing;
+    if (ring == NULL)
+    {
+
+        ring = AcquireLogRing();
+        if (ring == NULL)
+        {
+
+            ApplicationLog.unowned.fetch_add(1, memory_order_relaxed);
+            return NULL;
+        }
+        LogThreadRing = ring;
+    }
+
+    const unsigned head = ring->head.load(memory_order_relaxed);
+    if (head - ring->tail.load(memory_order_acquire) >= LOG_RING_RECORDS)
+    {
+
+        ring->dropped.store(ring->dropped.load(memory_order_relaxed) + 1, memory_order_relaxed);
+        return NULL;
+    }
+
+    LogRecord* record = &ring->records[head % LOG_RING_RECORDS];
+    record->ticks = (long long)ReadEngineTicks();
+    record->format = format;
+    record->level = level;
+    record->argumentCount = 0;
+    record->textLength = 0;
+    return record;
+}
+
+void CommitLogRecord()
+{
+    LogRing* ring = LogThreadRing;
+    ring->head.store(ring->head.load(memory_order_relaxed) + 1, memory_order_release);
+}
+
+void ReleaseLogThread()
+{
+    LogRing* ring = LogThreadRing;
+    if (ring == NULL)
+        return;
+
+    /* records still in the ring are written by the log thread whoever owns it next */
+    LogThreadRing = NULL;
+    ring->owned.store(false, memory_order_release);
+}
+
+static long long GetLogInteger(const LogArgument& argument)
+{
+    if (argument.type == LOG_ARGUMENT_UNSIGNED)
+        return (long long)argument.unsignedInteger;
+    if (argument.type == LOG_ARGUMENT_REAL)
+        return (long long)argument.real;
+    if (argument.type == LOG_ARGUMENT_POINTER)
+        return (long long)(size_t)argument.pointer;
+    return argument.type == LOG_ARGUMENT_INTEGER ? argument.integer : 0;
+}
+
+static double GetLogReal(const LogArgument& argument)
+{
+    if (argument.type == LOG_ARGUMENT_REAL)
+        return argument.real;
+    if (argument.type == LOG_ARGUMENT_UNSIGNED)
+        return (double)argument.unsignedInteger;
+    return (double)GetLogInteger(argument);
+}
+
+int FormatLogRecord(const LogRecord* record, char* text, size_t capacity)
+{
+    if (capacity == 0)
+        return 0;
+
+    size_t length = 0;
+    int argument = 0;
+    const char* c = record->format;
+    while (*c != '\0' && length + 1 < capacity)
+    {
+        if (*c != '%' || c[1] == '%')
+        {
+
+            text[length++] = *c;
+            c += *c == '%' ? 2 : 1;
+            continue;
+        }
+
+        /* flags, width and precision are kept; the length modifier is replaced to match the stored argument */
+        char specification[32];
+        int s = 0;
+        specification[s++] = *c++;
+        while (*c != '\0' && strchr("-+ #0123456789.", *c) != NULL && s < 24)
+            specification[s++] = *c++;
+        while (*c != '\0' && strchr("hljztL", *c) != NULL)
+            c++;
+        const char conversion = *c;
+        if (conversion == '\0')
+            break;
+        c++;
+
+        if (argument >= record->argumentCount)
+        {
+
+            text[length++] = '?';
+            continue;
+        }
+        const LogArgument& value = record->arguments[argument++];
+
+        int written = 0;
+        if (conversion == 'd' || conversion == 'i')
+        {
+
+            memcpy(specification + s, "lld", 4);
+            written = snprintf(text + length, capacity - length, specification, GetLogInteger(value));
+        }
+        else if (conversion == 'u' || conversion == 'x' || conversion == 'X' || conversion == 'o')
+        {
+
+            specification[s++] = 'l';
+            specification[s++] = 'l';
+            specification[s++] = conversion;
+            specification[s] = '\0';
+            written = snprintf(text + length, capacity - length, specification, (unsigned long long)GetLogInteger(value));
+        }
+        else if (strchr("fFeEgGaA", conversion) != NULL)
+        {
+
+            specification[s++] = conversion;
+            specification[s] = '\0';
+            written = snprintf(text + length, capacity - length, specification, GetLogReal(value));
+        }
+        else if (conversion == 'c')
+        {
+
+            memcpy(specification + s, "c", 2);
+            written = snprintf(text + length, capacity - length, specification, (int)GetLogInteger(value));
+        }
+        else if (conversion == 'p')
+        {
+
+            memcpy(specification + s, "p", 2);
+            written = snprintf(text + length, capacity - length, specification, value.type == LOG_ARGUMENT_POINTER ? value.pointer : NULL);
+        }
+        else if (conversion == 's')
+        {
+
+            memcpy(specification + s, "s", 2);
+            written = snprintf(text + length, capacity - length, specification, value.type == LOG_ARGUMENT_TEXT ? record->text + value.text : "?");
+        }
+        if (written < 0)
+            break;
+        length = min(length + (size_t)written, capacity - 1);
+    }
+
+    text[length] = '\0';
+    return (int)length;
+}
+
+static void WriteLogLine(const char* line)
+{
+    fputs(line, stdout);
+    if (ApplicationLog.file != NULL)
+        fputs(line, ApplicationLog.file);
+}
+
+/* writes everything committed so far, oldest first across all rings */
+static bool DrainLog()
+{
+    Log* log = &ApplicationLog;
+    log->batch.clear();
+
+    unsigned heads[LOG_MAX_THREADS];
+    for (int r = 0; r < LOG_MAX_THREADS; r++)
+    {
+        LogRing& ring = log->rings[r];
+        heads[r] = ring.head.load(memory_order_acquire);
+        for (unsigned position = ring.tail.load(memory_order_relaxed); position != heads[r]; position++)
+            log->batch.push_back(&ring.records[position % LOG_RING_RECORDS]);
+    }
+
+    stable_sort(log->batch.begin(), log->batch.end(), [](const LogRecord* a, const LogRecord* b) { return a->ticks < b->ticks; });
+
+    const double secondsPerTick = GetEngineTickSeconds();
+    static const char* levels[] = { "debug", "info", "warning", "error" };
+    unsigned long long written = 0;
+    char message[LOG_MESSAGE_LENGTH];
+    char line[LOG_MESSAGE_LENGTH + 64];
+    for (const LogRecord* record : log->batch)
+    {
+        if (record->format == LogBenchmarkFormat)
+            continue;
+
+        FormatLogRecord(record, message, sizeof(message));
+        const double seconds = (double)(record->ticks - (long long)LogEpochTicks) * secondsPerTick;
+        snprintf(line, sizeof(line), "[%10.3f] %s: %s\n", seconds, levels[record->level & 3], message);
+        WriteLogLine(line);
+        written++;
+    }
+    log->written.fetch_add(written, memory_order_relaxed);
+
+    for (int r = 0; r < LOG_MAX_THREADS; r++)
+        log->rings[r].tail.store(heads[r], memory_order_release);
+
+    const unsigned long long dropped = GetLogDroppedCount();
+    if (dropped != log->reportedDrops)
+    {
+
+        snprintf(line, sizeof(line), "[%10.3f] warning: %llu log records were dropped\n", chrono::duration<double>(chrono::steady_clock::now() - LogEpoch).count(), dropped - log->reportedDrops);
+        WriteLogLine(line);
+        log->reportedDrops = dropped;
+    }
+
+    if (written > 0)
+    {
+
+        fflush(stdout);
+        if (log->file != NULL)
+            fflush(log->file);
+    }
+
+    return !log->batch.empty();
+}
+
+static void RunLog(Log* log)
+{
+    unique_lock<mutex> lock(log->mutex);
+    while (log->running)
+    {
+        lock.unlock();
+        DrainLog();
+        lock.lock();
+
+        /* writers never signal, so the log thread polls */
+        log->wake.wait_for(lock, chrono::milliseconds(LOG_POLL_MILLISECONDS), [log]() { return !log->running || log->wakeRequested; });
+        log->wakeRequested = false;
+    }
+    lock.unlock();
+
+    DrainLog();
+}
+
+bool StartLog(const char* path, int minimumLevel)
+{
+    Log* log = &ApplicationLog;
+    if (log->thread.joinable())
+        return false;
+
+    log->file = NULL;
+    if (path != NULL)
+    {
+
+        log->file = fopen(path, "a");
+        if (log->file == NULL)
+            LogMessage(LOG_ERROR, "The log file %s could not be opened.", path);
+    }
+
+    log->minimumLevel.store(minimumLevel);
+    log->batch.reserve(LOG_MAX_THREADS * LOG_RING_RECORDS);
+    log->running = true;
+    log->wakeRequested = false;
+    log->thread = thread(RunLog, log);
+    return true;
+}
+
+bool StopLog()
+{
+    Log* log = &ApplicationLog;
+    if (!log->thread.joinable())
+        return false;
+
+    {
+        lock_guard<mutex> lock(log->mutex);
+        log->running = false;
+    }
+    log->wake.notify_one();
+    log->thread.join();
+
+    if (log->file != NULL)
+        fclose(log->file);
+    log->file = NULL;
+    return true;
+}
+
+static void WakeLog()
+{
+    {
+        lock_guard<mutex> lock(ApplicationLog.mutex);
+        ApplicationLog.wakeRequested = true;
+    }
+    ApplicationLog.wake.notify_one();
+}
+
+unsigned long long GetLogWrittenCount()
+{
+    return ApplicationLog.written.load(memory_order_relaxed);
+}
+
+unsigned long long GetLogDroppedCount()
+{
+    unsigned long long dropped = ApplicationLog.unowned.load(memory_order_relaxed);
+    for (const LogRing& ring : ApplicationLog.rings)
+        dropped += ring.dropped.load(memory_order_relaxed);
+    return dropped;
+}
+
+static void RunLogBenchmark(LogBenchmarkReport* report)
+{
+    const char* name = "benchmark";
+    const int burst = LOG_RING_RECORDS / 2;
+    const unsigned long long droppedBefore = GetLogDroppedCount();
+    const unsigned long long violationsBefore = GetRealtimeViolationTotal();
+    report->checked = IsRealtimeSafetyInstalled();
+
+    double total = 0.0;
+    int calls = 0;
+    while (calls < LOG_BENCHMARK_CALLS)
+    {
+        const bool realtime = SetRealtimeThread(true);
+        const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        for (int n = 0; n < burst; n++)
+            LogMessage(LOG_DEBUG, LogBenchmarkFormat, calls + n, 0.5 * n, name);
+        const double elapsed = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+        SetRealtimeThread(realtime);
+
+        total += elapsed;
+        report->worstNanoseconds = max(report->worstNanoseconds, elapsed / burst);
+        calls += burst;
+
+        /* the next burst starts on an empty ring, so what is timed is the write, not the drop path */
+        LogRing* ring = LogThreadRing;
+        while (ring != NULL && ring->tail.load(memory_order_acquire) != ring->head.load(memory_order_relaxed))
+        {
+            WakeLog();
+            this_thread::yield();
+        }
+    }
+
+    report->calls = calls;
+    report->nanosecondsPerCall = total / calls;
+    report->dropped = GetLogDroppedCount() - droppedBefore;
+    report->violations = GetRealtimeViolationTotal() - violationsBefore;
+}
+
+bool MeasureLogOverhead(LogBenchmarkReport* report)
+{
+    memset(report, 0, sizeof(LogBenchmarkReport));
+    if (!ApplicationLog.thread.joinable() || ApplicationLog.minimumLevel.load() > LOG_DEBUG)
+        return false;
+
+    thread benchmark = CreateEngineThread(RunLogBenchmark, report);
+    benchmark.join();
+    return true;
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+#include<atomic>
+#include<cstring>
+
+/*api.daw log*/
+#define LOG_MAX_THREADS 32
+#define LOG_RING_RECORDS 512
+#define LOG_RECORD_ARGUMENTS 8
+#define LOG_RECORD_TEXT 64
+#define LOG_MESSAGE_LENGTH 1024
+#define LOG_POLL_MILLISECONDS 5
+#define LOG_BENCHMARK_CALLS 200000
+
+#define LOG_DEBUG 0
+#define LOG_INFO 1
+#define LOG_WARNING 2
+#define LOG_ERROR 3
+
+#define LOG_ARGUMENT_INTEGER 0
+#define LOG_ARGUMENT_UNSIGNED 1
+#define LOG_ARGUMENT_REAL 2
+#define LOG_ARGUMENT_POINTER 3
+#define LOG_ARGUMENT_TEXT 4
+
+/*
+    Any thread, the audio thread included, can log: a call packs the format pointer and its
+    arguments into a fixed-size record in a ring owned by the calling thread and returns.
+    Formatting and output happen on the log thread. Strings are copied into the record, up
+    to LOG_RECORD_TEXT bytes for all of them together; the format must be a literal. When a
+    ring is full the record is dropped and counted, never waited for.
+*/
+struct LogArgument {
+    int type;
+    union {
+        long long integer;
+        unsigned long long unsignedInteger;
+        double real;
+        const void* pointer;
+        int text;
+    };
+};
+
+struct LogRecord {
+    long long ticks;
+    const char* format;
+    int level;
+    int argumentCount;
+    int textLength;
+    LogArgument arguments[LOG_RECORD_ARGUMENTS];
+    char text[LOG_RECORD_TEXT];
+};
+
+/* the record for the calling thread, or NULL when the ring is full or no ring is left */
+LogRecord* BeginLogRecord(int level, const char* format);
+void CommitLogRecord();
+
+inline void PackLogArgument(LogRecord* record, LogArgument argument)
+{
+    if (record->argumentCount < LOG_RECORD_ARGUMENTS)
+        record->arguments[record->argumentCount++] = argument;
+}
+
+inline void PackLogArgument(LogRecord* record, long long value)
+{
+    LogArgument argument;
+    argument.type = LOG_ARGUMENT_INTEGER;
+    argument.integer = value;
+    PackLogArgument(record, argument);
+}
+
+inline void PackLogArgument(LogRecord* record, unsigned long long value)
+{
+    LogArgument argument;
+    argument.type = LOG_ARGUMENT_UNSIGNED;
+    argument.unsignedInteger = value;
+    PackLogArgument(record, argument);
+}
+
+inline void PackLogArgument(LogRecord* record, double value)
+{
+    LogArgument argument;
+    argument.type = LOG_ARGUMENT_REAL;
+    argument.real = value;
+    PackLogArgument(record, argument);
+}
+
+inline void PackLogArgument(LogRecord* record, const void* value)
+{
+    LogArgument argument;
+    argument.type = LOG_ARGUMENT_POINTER;
+    argument.pointer = value;
+    PackLogArgument(record, argument);
+}
+
+inline void PackLogArgument(LogRecord* record, const char* value)
+{
+    LogArgument argument;
+    argument.type = LOG_ARGUMENT_TEXT;
+    argument.text = record->textLength;
+    if (value == NULL)
+        value = "(null)";
+
+    /* every string keeps its terminator; one that does not fit is cut short */
+    int length = 0;
+    while (value[length] != '\0' && record->textLength + length < LOG_RECORD_TEXT - 1)
+        length++;
+    if (record->textLength < LOG_RECORD_TEXT)
+    {
+
+        memcpy(record->text + record->textLength, value, length);
+        record->text[record->textLength + length] = '\0';
+        record->textLength += length + 1;
+    }
+    else
+        argument.text = LOG_RECORD_TEXT - 1;
+    PackLogArgument(record, argument);
+}
+
+inline void PackLogArgument(LogRecord* record, char* value) { PackLogArgument(record, (const char*)value); }
+inline void PackLogArgument(LogRecord* record, bool value) { PackLogArgument(record, (long long)value); }
+inline void PackLogArgument(LogRecord* record, char value) { PackLogArgument(record, (long long)value); }
+inline void PackLogArgument(LogRecord* record, int value) { PackLogArgument(record, (long long)value); }
+inline void PackLogArgument(LogRecord* record, long value) { PackLogArgument(record, (long long)value); }
+inline void PackLogArgument(LogRecord* record, unsigned value) { PackLogArgument(record, (unsigned long long)value); }
+inline void PackLogArgument(LogRecord* record, unsigned long value) { PackLogArgument(record, (unsigned long long)value); }
+inline void PackLogArgument(LogRecord* record, float value) { PackLogArgument(record, (double)value); }
+
+/* printf-style; integers print with any length modifier, floats as double, %s copies the string */
+template<typename... Arguments>
+void LogMessage(int level, const char* format, Arguments... arguments)
+{
+    LogRecord* record = BeginLogRecord(level, format);
+    if (record == NULL)
+        return;
+
+    int packed[] = { 0, (PackLogArgument(record, arguments), 0)... };
+    (void)packed;
+    CommitLogRecord();
+}
+
+/* output goes to stdout and, when path is given, to that file */
+bool StartLog(const char* path = NULL, int minimumLevel = LOG_DEBUG);
+bool StopLog();
+
+/* gives the calling thread's ring back once its records are written; threads that log should call it before exiting */
+void ReleaseLogThread();
+
+unsigned long long GetLogWrittenCount();
+unsigned long long GetLogDroppedCount();
+
+/* formats a record the way the log thread does */
+int FormatLogRecord(const LogRecord* record, char* text, size_t capacity);
+
+struct LogBenchmarkReport {
+    int calls;
+    double nanosecondsPerCall;
+    double worstNanoseconds;
+    unsigned long long dropped;
+    unsigned long long violations;
+    bool checked;
+};
+
+/* times LogMessage on an engine thread, in bursts the ring can hold; counts real-time violations when the checks are installed */
+bool MeasureLogOverhead(LogBenchmarkReport* report);
@@ -0,0 +1,99 @@
+#include"MappedFile.h"
+#include"Log.h"
+
+#include<cstdio>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include<windows.h>
+#else
+#include<fcntl.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<unistd.h>
+#endif
+
+bool OpenMappedFile(const char* path, MappedFile* mapped)
+{
+    mapped->data = NULL;
+    mapped->size = 0;
+    mapped->file = NULL;
+    mapped->mapping = NULL;
+
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+    {
+
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    const void* view = mapping != NULL ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+    if (view == NULL)
+    {
+
+        if (mapping != NULL)
+            CloseHandle(mapping);
+        CloseHandle(file);
+        LogMessage(LOG_ERROR, "The file %s could not be mapped.", path);
+        return false;
+    }
+
+    mapped->data = (const unsigned char*)view;
+    mapped->size = (size_t)size.QuadPart;
+    mapped->file = (void*)file;
+    mapped->mapping = (void*)mapping;
+#else
+    const int file = open(path, O_RDONLY);
+    if (file < 0)
+        return false;
+
+    struct stat status;
+    if (fstat(file, &status) != 0 || status.st_size == 0)
+    {
+
+        close(file);
+        return false;
+    }
+
+    /* the mapping keeps the pages alive, so the descriptor can go right away */
+    void* view = mmap(NULL, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (view == MAP_FAILED)
+    {
+
+        LogMessage(LOG_ERROR, "The file %s could not be mapped.", path);
+        return false;
+    }
+
+    mapped->data = (const unsigned char*)view;
+    mapped->size = (size_t)status.st_size;
+#endif
+
+    return true;
+}
+
+void CloseMappedFile(MappedFile* mapped)
+{
+    if (mapped->data == NULL)
+        return;
+
+#if defined(_WIN32)
+    UnmapViewOfFile(mapped->data);
+    CloseHandle((HANDLE)mapped->mapping);
+    CloseHandle((HANDLE)mapped->file);
+#else
+    munmap((void*)mapped->data, mapped->size);
+#endif
+
+    mapped->data = NULL;
+    mapped->size = 0;
+    mapped->file = NULL;
+    mapped->mapping = NULL;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include<cstddef>
+
+/*api.daw mapped file*/
+struct MappedFile {
+    const unsigned char* data;
+    size_t size;
+    void* file;
+    void* mapping;
+};
+
+/* read-only view of the whole file; pages fault in as they are touched */
+bool OpenMappedFile(const char* path, MappedFile* mapped);
+void CloseMappedFile(MappedFile* mapped);
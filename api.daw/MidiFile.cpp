@@ -0,0 +1,274 @@
+#include"MidiFile.h"
+#include"Log.h"
+
+#include<algorithm>
+#include<cstdio>
+
+using namespace std;
+
+struct MidiReader {
+    const unsigned char* data;
+    size_t position;
+    size_t end;
+};
+
+static bool ReadMidiByte(MidiReader* reader, unsigned* value)
+{
+    if (reader->position >= reader->end)
+        return false;
+
+    *value = reader->data[reader->position++];
+    return true;
+}
+
+static bool ReadMidiVariable(MidiReader* reader, unsigned* value)
+{
+    *value = 0;
+    for (int b = 0; b < 4; b++)
+    {
+        unsigned byte;
+        if (!ReadMidiByte(reader, &byte))
+            return false;
+
+        *value = (*value << 7) | (byte & 0x7F);
+        if ((byte & 0x80) == 0)
+            return true;
+    }
+
+    return false;
+}
+
+static unsigned ReadMidiBigEndian(const unsigned char* data, int count)
+{
+    unsigned value = 0;
+    for (int b = 0; b < count; b++)
+        value = (value << 8) | data[b];
+
+    return value;
+}
+
+static bool ParseMidiTrack(MidiReader* reader, int track, MidiSequence* sequence)
+{
+    unsigned tick = 0;
+    unsigned runningStatus = 0;
+
+    while (reader->position < reader->end)
+    {
+        unsigned delta, status;
+        if (!ReadMidiVariable(reader, &delta) || !ReadMidiByte(reader, &status))
+            return false;
+        tick += delta;
+
+        if (status == 0xFF)
+        {
+
+            unsigned type, length;
+            if (!ReadMidiByte(reader, &type) || !ReadMidiVariable(reader, &length) || length > reader->end - reader->position)
+                return false;
+
+            const unsigned char* payload = reader->data + reader->position;
+            reader->position += length;
+
+            if (type == 0x51 && length == 3)
+            {
+
+                MidiTempoEvent tempo;
+                tempo.tick = tick;
+                tempo.microsecondsPerQuarter = ReadMidiBigEndian(payload, 3);
+                sequence->tempos.push_back(tempo);
+            }
+            else if (type == 0x58 && length >= 2)
+            {
+
+                MidiMeterEvent meter;
+                meter.tick = tick;
+                meter.numerator = payload[0];
+                meter.denominator = (unsigned char)(1 << min((int)payload[1], 7));
+                sequence->meters.push_back(meter);
+            }
+            else if (type == 0x2F)
+                break;
+
+            continue;
+        }
+
+        if (status == 0xF0 || status == 0xF7)
+        {
+
+            unsigned length;
+            if (!ReadMidiVariable(reader, &length) || length > reader->end - reader->position)
+                return false;
+
+            reader->position += length;
+            runningStatus = 0;
+            continue;
+        }
+
+        unsigned data1;
+        if (status < 0x80)
+        {
+
+            /* running status: the byte just read was the first data byte */
+            if (runningStatus == 0)
+                return false;
+
+            data1 = status;
+            status = runningStatus;
+        }
+        else if (!ReadMidiByte(reader, &data1))
+            return false;
+        runningStatus = status;
+
+        const unsigned type = status & 0xF0;
+        unsigned data2 = 0;
+        if (type != 0xC0 && type != 0xD0 && !ReadMidiByte(reader, &data2))
+            return false;
+
+        MidiEvent event;
+        event.tick = tick;
+        event.status = (unsigned char)status;
+        event.data1 = (unsigned char)(data1 & 0x7F);
+        event.data2 = (unsigned char)(data2 & 0x7F);
+        event.track = (unsigned char)min(track, 255);
+
+        /* a note on with zero velocity is a note off */
+        if (type == MIDI_NOTE_ON && event.data2 == 0)
+            event.status = (unsigned char)(MIDI_NOTE_OFF | (status & 0x0F));
+
+        sequence->events.push_back(event);
+    }
+
+    sequence->lengthTicks = max(sequence->lengthTicks, tick);
+    return true;
+}
+
+bool ParseMidiFile(const unsigned char* data, size_t size, MidiSequence* sequence)
+{
+    if (size < 14 || ReadMidiBigEndian(data, 4) != 0x4D546864 || ReadMidiBigEndian(data + 4, 4) < 6)
+    {
+
+        LogMessage(LOG_ERROR, "The MIDI file header could not be read.");
+        return false;
+    }
+
+    const unsigned division = ReadMidiBigEndian(data + 12, 2);
+    sequence->format = (int)ReadMidiBigEndian(data + 8, 2);
+    sequence->trackCount = 0;
+    sequence->timecode = (division & 0x8000) != 0;
+    sequence->division = sequence->timecode ? (int)(256 - (division >> 8)) * (int)(division & 0xFF) : (int)division;
+    sequence->lengthTicks = 0;
+    sequence->events.clear();
+    sequence->tempos.clear();
+    sequence->meters.clear();
+
+    if (sequence->division <= 0)
+    {
+
+        LogMessage(LOG_ERROR, "The MIDI file division is not supported.");
+        return false;
+    }
+
+    /* channel events average around three bytes each, so this avoids most regrowth */
+    sequence->events.reserve(size / 3);
+
+    const int declaredTracks = (int)ReadMidiBigEndian(data + 10, 2);
+    size_t position = 8 + ReadMidiBigEndian(data + 4, 4);
+    while (position + 8 <= size && sequence->trackCount < declaredTracks)
+    {
+        const unsigned type = ReadMidiBigEndian(data + position, 4);
+        const size_t length = ReadMidiBigEndian(data + position + 4, 4);
+        position += 8;
+        if (length > size - position)
+        {
+
+            LogMessage(LOG_ERROR, "The MIDI file is truncated.");
+            return false;
+        }
+
+        if (type == 0x4D54726B)
+        {
+
+            MidiReader reader;
+            reader.data = data;
+            reader.position = position;
+            reader.end = position + length;
+            if (!ParseMidiTrack(&reader, sequence->trackCount, sequence))
+            {
+
+                LogMessage(LOG_ERROR, "The MIDI track %d could not be parsed.", sequence->trackCount);
+                return false;
+            }
+            sequence->trackCount++;
+        }
+        position += length;
+    }
+
+    /* each track is already in tick order; a stable sort keeps same-tick events in file order */
+    if (sequence->trackCount > 1)
+    {
+
+        const auto earlier = [](const MidiEvent& a, const MidiEvent& b) { return a.tick < b.tick; };
+        stable_sort(sequence->events.begin(), sequence->events.end(), earlier);
+        stable_sort(sequence->tempos.begin(), sequence->tempos.end(), [](const MidiTempoEvent& a, const MidiTempoEvent& b) { return a.tick < b.tick; });
+        stable_sort(sequence->meters.begin(), sequence->meters.end(), [](const MidiMeterEvent& a, const MidiMeterEvent& b) { return a.tick < b.tick; });
+    }
+
+    sequence->events.shrink_to_fit();
+    return true;
+}
+
+bool LoadMidiFile(const char* path, MidiSequence* sequence)
+{
+    FILE* file = fopen(path, "rb");
+    if (file == NULL)
+    {
+
+        LogMessage(LOG_ERROR, "The MIDI file %s could not be opened.", path);
+        return false;
+    }
+
+    fseek(file, 0, SEEK_END);
+    const long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    vector<unsigned char> data(size > 0 ? size : 0);
+    const bool read = size > 0 && fread(data.data(), 1, data.size(), file) == data.size();
+    fclose(file);
+
+    if (!read)
+    {
+
+        LogMessage(LOG_ERROR, "The MIDI file %s could not be read.", path);
+        return false;
+    }
+
+    return ParseMidiFile(data.data(), data.size(), sequence);
+}
+
+bool BuildMidiTempoMap(const MidiSequence* sequence, double sampleRate, TempoMap* map)
+{
+    if (sequence->timecode)
+        return InitializeTempoMap(map, sampleRate, 60.0);
+
+    if (!InitializeTempoMap(map, sampleRate, 60000000.0 / MIDI_DEFAULT_MICROSECONDS_PER_QUARTER))
+        return false;
+
+    for (const MidiTempoEvent& tempo : sequence->tempos)
+    {
+        if (tempo.microsecondsPerQuarter > 0)
+            SetTempoChange(map, (double)tempo.tick / sequence->division, 60000000.0 / tempo.microsecondsPerQuarter);
+    }
+
+    /* a meter event on a downbeat of the meter before it starts that bar; anywhere else it waits for the next bar line */
+    for (const MidiMeterEvent& meter : sequence->meters)
+    {
+        const double beat = (double)meter.tick / sequence->division;
+        int bar;
+        double beatInBar;
+        BeatToBar(map, beat, &bar, &beatInBar);
+        const bool downbeat = beat - BarToBeat(map, bar, 0.0) <= (double)MIDI_METER_TOLERANCE_TICKS / sequence->division;
+        SetMeterChange(map, downbeat ? bar : bar + 1, meter.numerator, meter.denominator);
+    }
+
+    return true;
+}
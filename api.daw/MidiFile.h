@@ -0,0 +1,52 @@
+#pragma once
+
+#include<cstddef>
+#include<vector>
+
+#include"TempoMap.h"
+
+/*api.daw midi*/
+#define MIDI_NOTE_OFF 0x80
+#define MIDI_NOTE_ON 0x90
+#define MIDI_CONTROL_CHANGE 0xB0
+#define MIDI_ALL_NOTES_OFF 123
+#define MIDI_CHANNEL_COUNT 16
+#define MIDI_DEFAULT_MICROSECONDS_PER_QUARTER 500000
+#define MIDI_METER_TOLERANCE_TICKS 1
+
+/* Channel events only, packed into 8 bytes and sorted by tick; tempo and meter live beside them. */
+struct MidiEvent {
+    unsigned tick;
+    unsigned char status;
+    unsigned char data1;
+    unsigned char data2;
+    unsigned char track;
+};
+
+struct MidiTempoEvent {
+    unsigned tick;
+    unsigned microsecondsPerQuarter;
+};
+
+struct MidiMeterEvent {
+    unsigned tick;
+    unsigned char numerator;
+    unsigned char denominator;
+};
+
+struct MidiSequence {
+    int format;
+    int trackCount;
+    int division;
+    bool timecode;
+    unsigned lengthTicks;
+    std::vector<MidiEvent> events;
+    std::vector<MidiTempoEvent> tempos;
+    std::vector<MidiMeterEvent> meters;
+};
+
+bool ParseMidiFile(const unsigned char* data, size_t size, MidiSequence* sequence);
+bool LoadMidiFile(const char* path, MidiSequence* sequence);
+
+/* ticks become beats through the division; SMPTE files map one beat to one second */
+bool BuildMidiTempoMap(const MidiSequence* sequence, double sampleRate, TempoMap* map);
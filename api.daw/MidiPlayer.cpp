@@ -0,0 +1,331 @@
+#include"MidiPlayer.h"
+
+#include<algorithm>
+#include<cmath>
+
+#include <corecrt_math_defines.h>
+
+using namespace std;
+
+#define MIDI_SYNTH_ATTACK_SECONDS 0.005
+#define MIDI_SYNTH_RELEASE_SECONDS 0.05
+
+bool InitializeMidiScheduler(MidiScheduler* scheduler)
+{
+    scheduler->pendingPlayback.store(NULL);
+    scheduler->retiredPlayback.store(NULL);
+    scheduler->activePlayback = NULL;
+    scheduler->playing.store(false);
+    scheduler->seekRequest.store(MIDI_NO_SEEK);
+    scheduler->position.store(0);
+    scheduler->cursor = 0;
+    InitializeTempoCursor(&scheduler->tempoCursor, NULL);
+    scheduler->sounding = false;
+    scheduler->playback = NULL;
+
+    return true;
+}
+
+void ReleaseMidiScheduler(MidiScheduler* scheduler)
+{
+    delete scheduler->pendingPlayback.exchange(NULL);
+    delete scheduler->retiredPlayback.exchange(NULL);
+    delete scheduler->activePlayback;
+    scheduler->activePlayback = NULL;
+    scheduler->playback = NULL;
+}
+
+bool SetMidiSchedulerPlayback(MidiScheduler* scheduler, MidiPlayback* playback)
+{
+    delete scheduler->pendingPlayback.exchange(playback);
+    scheduler->playback = playback;
+    return true;
+}
+
+bool CollectMidiSchedulerGarbage(MidiScheduler* scheduler)
+{
+    MidiPlayback* retired = scheduler->retiredPlayback.exchange(NULL);
+    if (retired == NULL)
+        return false;
+
+    delete retired;
+    return true;
+}
+
+bool SetMidiSchedulerPlaying(MidiScheduler* scheduler, bool playing)
+{
+    scheduler->playing.store(playing);
+    return true;
+}
+
+bool SeekMidiScheduler(MidiScheduler* scheduler, long long sample)
+{
+    if (sample < 0)
+        return false;
+
+    scheduler->seekRequest.store(sample);
+    return true;
+}
+
+static long long GetMidiEventSample(const MidiPlayback* playback, const MidiEvent& event)
+{
+    return llround(BeatToSample(&playback->tempoMap, (double)event.tick / playback->sequence.division));
+}
+
+static size_t FindMidiCursor(const MidiPlayback* playback, long long sample)
+{
+    const vector<MidiEvent>& events = playback->sequence.events;
+    return partition_point(
+        events.begin(), events.end(),
+        [playback, sample](const MidiEvent& event) { return GetMidiEventSample(playback, event) < sample; }
+    ) - events.begin();
+}
+
+static int SilenceMidiChannels(MidiScheduledEvent* events, int count, int capacity)
+{
+    for (int c = 0; c < MIDI_CHANNEL_COUNT && count < capacity; c++)
+    {
+        MidiScheduledEvent& scheduled = events[count++];
+        scheduled.frameOffset = 0;
+        scheduled.event.tick = 0;
+        scheduled.event.status = (unsigned char)(MIDI_CONTROL_CHANGE | c);
+        scheduled.event.data1 = MIDI_ALL_NOTES_OFF;
+        scheduled.event.data2 = 0;
+        scheduled.event.track = 0;
+    }
+
+    return count;
+}
+
+int ScheduleMidiBlock(MidiScheduler* scheduler, int frameCount, MidiScheduledEvent* events, int capacity)
+{
+    int count = 0;
+    long long position = scheduler->position.load(std::memory_order_relaxed);
+    bool relocated = false;
+
+    /* wait until the UI thread has freed the last retired playback before swapping again */
+    if (scheduler->retiredPlayback.load(std::memory_order_acquire) == NULL)
+    {
+
+        MidiPlayback* playback = scheduler->pendingPlayback.exchange(NULL, std::memory_order_acq_rel);
+        if (playback != NULL)
+        {
+
+            scheduler->retiredPlayback.store(scheduler->activePlayback, std::memory_order_release);
+            scheduler->activePlayback = playback;
+            InitializeTempoCursor(&scheduler->tempoCursor, &playback->tempoMap);
+            relocated = true;
+        }
+    }
+
+    const long long seek = scheduler->seekRequest.exchange(MIDI_NO_SEEK, std::memory_order_acquire);
+    if (seek != MIDI_NO_SEEK)
+    {
+
+        position = seek;
+        relocated = true;
+    }
+
+    const MidiPlayback* playback = scheduler->activePlayback;
+    if (relocated && playback != NULL)
+        scheduler->cursor = FindMidiCursor(playback, position);
+
+    const bool playing = scheduler->playing.load(std::memory_order_relaxed);
+    if (scheduler->sounding && (relocated || !playing))
+    {
+
+        count = SilenceMidiChannels(events, count, capacity);
+        scheduler->sounding = false;
+    }
+
+    if (!playing)
+    {
+
+        scheduler->position.store(position, std::memory_order_relaxed);
+        return count;
+    }
+
+    if (playback != NULL)
+    {
+
+        const vector<MidiEvent>& sequence = playback->sequence.events;
+        const long long end = position + frameCount;
+        while (scheduler->cursor < sequence.size() && count < capacity)
+        {
+            const MidiEvent& event = sequence[scheduler->cursor];
+            const long long sample = llround(CursorBeatToSample(&scheduler->tempoCursor, (double)event.tick / playback->sequence.division));
+            if (sample >= end)
+                break;
+
+            /* an overflowing block leaves the rest for the next one, where they land at offset 0 */
+            events[count].frameOffset = (int)max(sample - position, 0LL);
+            events[count].event = event;
+            count++;
+            scheduler->cursor++;
+        }
+        scheduler->sounding = true;
+    }
+
+    scheduler->position.store(position + frameCount, std::memory_order_relaxed);
+    return count;
+}
+
+static void StartMidiSynthVoice(MidiSynth* synth, int sampleRate, const MidiEvent& event)
+{
+    /* take a free voice, or steal the quietest one */
+    MidiSynthVoice* voice = &synth->voices[0];
+    for (int v = 0; v < MIDI_SYNTH_VOICES; v++)
+    {
+        MidiSynthVoice* candidate = &synth->voices[v];
+        if (!candidate->active)
+        {
+
+            voice = candidate;
+            break;
+        }
+        if (candidate->envelope < voice->envelope)
+            voice = candidate;
+    }
+
+    voice->active = true;
+    voice->released = false;
+    voice->channel = event.status & 0x0F;
+    voice->note = event.data1;
+    voice->velocity = event.data2 / 127.0f;
+    voice->envelope = 0.0f;
+    voice->phase = 0.0;
+    voice->increment = 2 * M_PI * 440.0 * pow(2.0, (event.data1 - 69) / 12.0) / sampleRate;
+}
+
+static void ApplyMidiSynthEvent(MidiSynth* synth, int sampleRate, const MidiEvent& event)
+{
+    const int type = event.status & 0xF0;
+    const int channel = event.status & 0x0F;
+
+    if (type == MIDI_NOTE_ON)
+    {
+
+        StartMidiSynthVoice(synth, sampleRate, event);
+        return;
+    }
+
+    const bool allNotes = type == MIDI_CONTROL_CHANGE && event.data1 == MIDI_ALL_NOTES_OFF;
+    if (type != MIDI_NOTE_OFF && !allNotes)
+        return;
+
+    for (int v = 0; v < MIDI_SYNTH_VOICES; v++)
+    {
+        MidiSynthVoice& voice = synth->voices[v];
+        if (voice.active && voice.channel == channel && (allNotes || voice.note == event.data1))
+            voice.released = true;
+    }
+}
+
+static void RenderMidiSynth(MidiSynth* synth, float* output, int start, int end)
+{
+    const float amplitude = synth->amplitude.load(std::memory_order_relaxed);
+
+    for (int v = 0; v < MIDI_SYNTH_VOICES; v++)
+    {
+        MidiSynthVoice& voice = synth->voices[v];
+        if (!voice.active)
+            continue;
+
+        const float gain = amplitude * voice.velocity;
+        for (int n = start; n < end; n++)
+        {
+            if (voice.released)
+            {
+
+                voice.envelope -= synth->releaseStep;
+                if (voice.envelope <= 0.0f)
+                {
+
+                    voice.active = false;
+                    break;
+                }
+            }
+            else if (voice.envelope < 1.0f)
+                voice.envelope = min(voice.envelope + synth->attackStep, 1.0f);
+
+            output[n] += gain * voice.envelope * (float)sin(voice.phase);
+            voice.phase += voice.increment;
+            if (voice.phase >= 2 * M_PI)
+                voice.phase -= 2 * M_PI;
+        }
+    }
+}
+
+static bool ProcessMidiSynthNode(void* state, EngineNodeContext* context)
+{
+    MidiSynth* synth = (MidiSynth*)state;
+    float* output = context->channels[0];
+    const int sampleRate = context->engine->sampleRate;
+
+    for (int n = 0; n < context->frameCount; n++)
+        output[n] = 0.0f;
+
+    const int count = ScheduleMidiBlock(&synth->scheduler, context->frameCount, synth->events, MIDI_MAX_BLOCK_EVENTS);
+
+    /* render up to each event so it takes effect on its own sample */
+    int rendered = 0;
+    for (int e = 0; e < count; e++)
+    {
+        const MidiScheduledEvent& scheduled = synth->events[e];
+        RenderMidiSynth(synth, output, rendered, scheduled.frameOffset);
+        rendered = max(rendered, scheduled.frameOffset);
+        ApplyMidiSynthEvent(synth, sampleRate, scheduled.event);
+    }
+    RenderMidiSynth(synth, output, rendered, context->frameCount);
+
+    for (int c = 1; c < context->channelCount; c++)
+        copy(output, output + context->frameCount, context->channels[c]);
+
+    return true;
+}
+
+static void InitializeMidiSynth(MidiSynth* synth, int sampleRate)
+{
+    InitializeMidiScheduler(&synth->scheduler);
+    for (int v = 0; v < MIDI_SYNTH_VOICES; v++)
+        synth->voices[v].active = false;
+    synth->amplitude.store(0.15f);
+    synth->attackStep = (float)(1.0 / (MIDI_SYNTH_ATTACK_SECONDS * sampleRate));
+    synth->releaseStep = (float)(1.0 / (MIDI_SYNTH_RELEASE_SECONDS * sampleRate));
+}
+
+/* a copy of the sequence that plays from wherever it is seeked, whether or not the transport runs */
+static void* CloneMidiSynthNode(void* state, Engine* destination)
+{
+    MidiSynth* synth = (MidiSynth*)state;
+    MidiSynth* clone = new MidiSynth();
+    InitializeMidiSynth(clone, destination->sampleRate);
+    clone->amplitude.store(synth->amplitude.load());
+    if (synth->scheduler.playback != NULL)
+        SetMidiSchedulerPlayback(&clone->scheduler, new MidiPlayback(*synth->scheduler.playback));
+    SetMidiSchedulerPlaying(&clone->scheduler, true);
+    return clone;
+}
+
+static void ReleaseMidiSynthNode(void* state)
+{
+    MidiSynth* synth = (MidiSynth*)state;
+    ReleaseMidiScheduler(&synth->scheduler);
+    delete synth;
+}
+
+static bool SeekMidiSynthNode(void* state, long long frame)
+{
+    return SeekMidiScheduler(&((MidiSynth*)state)->scheduler, frame);
+}
+
+/* notes sound for as long as they are held, so the synth has no tail and renders from the start */
+int AddMidiSynthNode(Engine* engine, MidiSynth* synth)
+{
+    InitializeMidiSynth(synth, engine->sampleRate);
+
+    const int node = AddEngineNode(engine, "MIDI Synth", synth, ProcessMidiSynthNode, false);
+    SetEngineNodeClone(engine, node, CloneMidiSynthNode, ReleaseMidiSynthNode);
+    SetEngineNodeSeek(engine, node, SeekMidiSynthNode);
+    return node;
+}
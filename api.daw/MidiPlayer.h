@@ -0,0 +1,78 @@
+#pragma once
+
+#include<atomic>
+
+#include"Engine.h"
+#include"MidiFile.h"
+#include"TempoMap.h"
+
+/*api.daw midi player*/
+#define MIDI_MAX_BLOCK_EVENTS 4096
+#define MIDI_SYNTH_VOICES 32
+#define MIDI_NO_SEEK -1
+
+/* An immutable sequence and its tempo map, swapped in by the audio thread like an engine schedule. */
+struct MidiPlayback {
+    MidiSequence sequence;
+    TempoMap tempoMap;
+};
+
+struct MidiScheduledEvent {
+    int frameOffset;
+    MidiEvent event;
+};
+
+/*
+    Walks the sorted events with a cursor, so a block costs the events it contains
+    plus an O(1) tempo cursor step each and never depends on the length of the sequence.
+*/
+struct MidiScheduler {
+    std::atomic<MidiPlayback*> pendingPlayback;
+    std::atomic<MidiPlayback*> retiredPlayback;
+    MidiPlayback* activePlayback;
+
+    std::atomic<bool> playing;
+    std::atomic<long long> seekRequest;
+    std::atomic<long long> position;
+    size_t cursor;
+    TempoCursor tempoCursor;
+    bool sounding;
+
+    /* UI side: the playback set last */
+    MidiPlayback* playback;
+};
+
+bool InitializeMidiScheduler(MidiScheduler* scheduler);
+void ReleaseMidiScheduler(MidiScheduler* scheduler);
+
+/* takes ownership of playback */
+bool SetMidiSchedulerPlayback(MidiScheduler* scheduler, MidiPlayback* playback);
+bool CollectMidiSchedulerGarbage(MidiScheduler* scheduler);
+bool SetMidiSchedulerPlaying(MidiScheduler* scheduler, bool playing);
+bool SeekMidiScheduler(MidiScheduler* scheduler, long long sample);
+
+/* audio thread: the events due in the next frameCount samples, with offsets inside the block */
+int ScheduleMidiBlock(MidiScheduler* scheduler, int frameCount, MidiScheduledEvent* events, int capacity);
+
+struct MidiSynthVoice {
+    bool active;
+    bool released;
+    unsigned char channel;
+    unsigned char note;
+    float velocity;
+    float envelope;
+    double phase;
+    double increment;
+};
+
+/* A small sine instrument that renders up to each event offset, so notes start on their exact sample. */
+struct MidiSynth {
+    MidiScheduler scheduler;
+    MidiSynthVoice voices[MIDI_SYNTH_VOICES];
+    MidiScheduledEvent events[MIDI_MAX_BLOCK_EVENTS];
+    std::atomic<float> amplitude;
+    float attackStep;
+    float releaseStep;
+};
+
+int AddMidiSynthNode(Engine* engine, MidiSynth* synth);
@@ -0,0 +1,517 @@
+#include"Mixer.h"
+#include"MixerKernels.h"
+#include"Log.h"
+
+#include<algorithm>
+#include<chrono>
+#include<cmath>
+#include<cstdio>
+#include<cstring>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+static void ResetMixerStrip(MixerStrip* strip, const char* name)
+{
+    snprintf(strip->name, MIXER_NAME_LENGTH, "%s", name);
+    strip->gain.store(1.0f);
+    strip->pan.store(0.0f);
+    strip->mute.store(false);
+    strip->solo.store(false);
+    strip->output.store(MIXER_MASTER);
+    strip->appliedLeft = 1.0f;
+    strip->appliedRight = 1.0f;
+
+    for (int s = 0; s < MIXER_MAX_SENDS; s++)
+    {
+        strip->sends[s].bus.store(MIXER_NO_BUS);
+        strip->sends[s].gain.store(0.0f);
+        strip->sends[s].preFader.store(false);
+        strip->sends[s].appliedLeft = 0.0f;
+        strip->sends[s].appliedRight = 0.0f;
+    }
+}
+
+/* every band starts bypassed, spread evenly in octaves so switching one on lands somewhere useful */
+static void ResetMixerTrackEq(MixerTrack* track)
+{
+    for (int b = 0; b < MIXER_EQ_BANDS; b++)
+    {
+        const float position = (float)b / (MIXER_EQ_BANDS - 1);
+        track->eq[b].type.store(FILTER_BYPASS);
+        track->eq[b].frequency.store(MIXER_EQ_MIN_FREQUENCY * powf(MIXER_EQ_MAX_FREQUENCY / MIXER_EQ_MIN_FREQUENCY, position));
+        track->eq[b].q.store(1.0f);
+        track->eq[b].gain.store(0.0f);
+    }
+    track->eqChanges.store(0);
+    track->eqApplied = 0;
+}
+
+/* a band read while the UI writes it may mix old and new values for one block; the next change counter catches up */
+static void UpdateMixerTrackEq(Mixer* mixer, int t)
+{
+    MixerTrack& track = mixer->tracks[t];
+    const unsigned changes = track.eqChanges.load(std::memory_order_acquire);
+    if (changes == track.eqApplied)
+        return;
+
+    for (int b = 0; b < MIXER_EQ_BANDS; b++)
+    {
+        FilterSettings settings;
+        settings.type = track.eq[b].type.load(std::memory_order_relaxed);
+        settings.frequency = track.eq[b].frequency.load(std::memory_order_relaxed);
+        settings.q = track.eq[b].q.load(std::memory_order_relaxed);
+        settings.gain = track.eq[b].gain.load(std::memory_order_relaxed);
+        for (int c = 0; c < 2; c++)
+            SetFilterBankStage(&mixer->eq, b, 2 * t + c, &settings, (float)mixer->engine->sampleRate);
+    }
+    track.eqApplied = changes;
+}
+
+static float* GetMixerDestination(Mixer* mixer, int output, int channel)
+{
+    if (output == MIXER_MASTER)
+        return mixer->masterChannels[channel];
+
+    return mixer->buses[output].channels[channel];
+}
+
+/* Mixes one strip into its output and sends; input holds two channel pointers. */
+static void MixMixerStrip(Mixer* mixer, MixerStrip* strip, float* const* input, bool silenced, int busCount, int frameCount)
+{
+    const float gain = silenced || strip->mute.load(std::memory_order_relaxed) ? 0.0f : strip->gain.load(std::memory_order_relaxed);
+    const float pan = strip->pan.load(std::memory_order_relaxed);
+
+    /* balance law: the centre is unity and the far side fades out */
+    const float targetLeft = gain * (pan > 0.0f ? 1.0f - pan : 1.0f);
+    const float targetRight = gain * (pan < 0.0f ? 1.0f + pan : 1.0f);
+
+    int output = strip->output.load(std::memory_order_relaxed);
+    if (output != MIXER_MASTER && (output < 0 || output >= busCount))
+        output = MIXER_MASTER;
+
+    mixer->kernel(
+        input[0], input[1], GetMixerDestination(mixer, output, 0), GetMixerDestination(mixer, output, 1),
+        strip->appliedLeft, strip->appliedRight, targetLeft, targetRight, frameCount
+    );
+    strip->appliedLeft = targetLeft;
+    strip->appliedRight = targetRight;
+
+    for (int s = 0; s < MIXER_MAX_SENDS; s++)
+    {
+        MixerSend& send = strip->sends[s];
+        const int bus = send.bus.load(std::memory_order_relaxed);
+        if (bus < 0 || bus >= busCount)
+        {
+
+            send.appliedLeft = 0.0f;
+            send.appliedRight = 0.0f;
+            continue;
+        }
+
+        const bool preFader = send.preFader.load(std::memory_order_relaxed);
+        const float level = silenced || strip->mute.load(std::memory_order_relaxed) ? 0.0f : send.gain.load(std::memory_order_relaxed);
+        const float sendLeft = preFader ? level : level * targetLeft;
+        const float sendRight = preFader ? level : level * targetRight;
+
+        mixer->kernel(
+            input[0], input[1], mixer->buses[bus].channels[0], mixer->buses[bus].channels[1],
+            send.appliedLeft, send.appliedRight, sendLeft, sendRight, frameCount
+        );
+        send.appliedLeft = sendLeft;
+        send.appliedRight = sendRight;
+    }
+}
+
+static bool ProcessMixerNode(void* state, EngineNodeContext* context)
+{
+    Mixer* mixer = (Mixer*)state;
+    const int frameCount = context->frameCount;
+    const int trackCount = mixer->trackCount.load(std::memory_order_acquire);
+    const int busCount = mixer->busCount.load(std::memory_order_acquire);
+
+    for (int c = 0; c < ENGINE_MAX_CHANNELS; c++)
+    {
+        memset(mixer->masterChannels[c], 0, sizeof(float) * frameCount);
+        for (int b = 0; b < busCount; b++)
+            memset(mixer->buses[b].channels[c], 0, sizeof(float) * frameCount);
+    }
+
+    bool soloActive = false;
+    for (int t = 0; t < trackCount && !soloActive; t++)
+        soloActive = mixer->tracks[t].strip.solo.load(std::memory_order_relaxed);
+
+    for (int first = 0; first < trackCount; first += MIXER_EQ_GROUP_TRACKS)
+    {
+        const int group = first / MIXER_EQ_GROUP_TRACKS;
+        const int last = first + MIXER_EQ_GROUP_TRACKS < trackCount ? first + MIXER_EQ_GROUP_TRACKS : trackCount;
+
+        /* tracks added since the schedule was compiled join on the next schedule */
+        const float* lanes[FILTER_BANK_GROUP_LANES] = {};
+        for (int t = first; t < last; t++)
+        {
+            UpdateMixerTrackEq(mixer, t);
+            if (mixer->tracks[t].input >= context->step->inputCount)
+                continue;
+
+            float* const* input = GetEngineNodeInput(context, mixer->tracks[t].input);
+            lanes[2 * (t - first)] = input[0];
+            lanes[2 * (t - first) + 1] = input[1];
+        }
+
+        /* the inputs belong to the source nodes, so the equalized signal goes to the mixer's own channels */
+        const bool equalized = IsFilterBankGroupActive(&mixer->eq, group);
+        if (equalized)
+            ProcessFilterBankLanes(&mixer->eq, group, lanes, mixer->eqChannels, frameCount);
+
+        for (int t = first; t < last; t++)
+        {
+            MixerTrack& track = mixer->tracks[t];
+            if (track.input >= context->step->inputCount)
+                continue;
+
+            const bool silenced = soloActive && !track.strip.solo.load(std::memory_order_relaxed);
+            float* const* input = equalized ? mixer->eqChannels + 2 * (t - first) : GetEngineNodeInput(context, track.input);
+            MixMixerStrip(mixer, &track.strip, input, silenced, busCount, frameCount);
+        }
+    }
+
+    for (int b = 0; b < busCount; b++)
+        MixMixerStrip(mixer, &mixer->buses[b].strip, mixer->buses[b].channels, false, busCount, frameCount);
+
+    MixerStrip& master = mixer->master;
+    const float gain = master.mute.load(std::memory_order_relaxed) ? 0.0f : master.gain.load(std::memory_order_relaxed);
+    for (int c = 0; c < ENGINE_MAX_CHANNELS; c++)
+        memset(context->channels[c], 0, sizeof(float) * frameCount);
+
+    mixer->kernel(
+        mixer->masterChannels[0], mixer->masterChannels[1], context->channels[0], context->channels[1],
+        master.appliedLeft, master.appliedRight, gain, gain, frameCount
+    );
+    master.appliedLeft = gain;
+    master.appliedRight = gain;
+
+    return true;
+}
+
+/* the mixer's storage is sized by the engine's block, so a private copy is allocated against the engine it renders in */
+static Mixer* AllocateMixer(Engine* engine)
+{
+    Mixer* mixer = new Mixer();
+    mixer->engine = engine;
+    mixer->node = ENGINE_NO_NODE;
+    mixer->kernel = GetMixKernel(IsMixKernelAVX2());
+    mixer->trackCount.store(0);
+    mixer->busCount.store(0);
+    ResetMixerStrip(&mixer->master, "Master");
+
+    /* master accumulator first, then every bus, then one group of equalized lanes */
+    const size_t block = (size_t)engine->blockSize;
+    const size_t busStorage = block * ENGINE_MAX_CHANNELS * (MIXER_MAX_BUSES + 1);
+    mixer->storage = new float[busStorage + block * FILTER_BANK_GROUP_LANES]();
+    for (int c = 0; c < ENGINE_MAX_CHANNELS; c++)
+        mixer->masterChannels[c] = mixer->storage + block * c;
+    for (int b = 0; b < MIXER_MAX_BUSES; b++)
+    {
+        for (int c = 0; c < ENGINE_MAX_CHANNELS; c++)
+            mixer->buses[b].channels[c] = mixer->storage + block * (ENGINE_MAX_CHANNELS * (b + 1) + c);
+    }
+    for (int l = 0; l < FILTER_BANK_GROUP_LANES; l++)
+        mixer->eqChannels[l] = mixer->storage + busStorage + block * l;
+    InitializeFilterBank(&mixer->eq, 2 * MIXER_MAX_TRACKS, MIXER_EQ_BANDS, engine->blockSize);
+
+    return mixer;
+}
+
+static void CopyMixerStrip(MixerStrip* destination, const MixerStrip* source)
+{
+    ResetMixerStrip(destination, source->name);
+    destination->gain.store(source->gain.load());
+    destination->pan.store(source->pan.load());
+    destination->mute.store(source->mute.load());
+    destination->solo.store(source->solo.load());
+    destination->output.store(source->output.load());
+    for (int s = 0; s < MIXER_MAX_SENDS; s++)
+    {
+        destination->sends[s].bus.store(source->sends[s].bus.load());
+        destination->sends[s].gain.store(source->sends[s].gain.load());
+        destination->sends[s].preFader.store(source->sends[s].preFader.load());
+    }
+}
+
+/* tracks keep their input slots, since the copied node is connected in the same order */
+static void* CloneMixerNode(void* state, Engine* destination)
+{
+    Mixer* mixer = (Mixer*)state;
+    Mixer* clone = AllocateMixer(destination);
+    CopyMixerStrip(&clone->master, &mixer->master);
+
+    const int busCount = mixer->busCount.load();
+    for (int b = 0; b < busCount; b++)
+        CopyMixerStrip(&clone->buses[b].strip, &mixer->buses[b].strip);
+    clone->busCount.store(busCount);
+
+    const int trackCount = mixer->trackCount.load();
+    for (int t = 0; t < trackCount; t++)
+    {
+        const MixerTrack& track = mixer->tracks[t];
+        MixerTrack& copy = clone->tracks[t];
+        CopyMixerStrip(&copy.strip, &track.strip);
+        copy.sourceNode = track.sourceNode;
+        copy.input = track.input;
+        for (int b = 0; b < MIXER_EQ_BANDS; b++)
+        {
+            copy.eq[b].type.store(track.eq[b].type.load());
+            copy.eq[b].frequency.store(track.eq[b].frequency.load());
+            copy.eq[b].q.store(track.eq[b].q.load());
+            copy.eq[b].gain.store(track.eq[b].gain.load());
+        }
+        copy.eqChanges.store(1);
+        copy.eqApplied = 0;
+    }
+    clone->trackCount.store(trackCount);
+
+    return clone;
+}
+
+static void ReleaseMixerNode(void* state)
+{
+    DestroyMixer((Mixer*)state);
+}
+
+/* gains ramp over one block; each active band rings for a few of its time constants, Q / (pi * frequency) */
+static long long GetMixerTail(void* state)
+{
+    Mixer* mixer = (Mixer*)state;
+    const int trackCount = mixer->trackCount.load();
+    float seconds = 0.0f;
+    for (int t = 0; t < trackCount; t++)
+    {
+        for (int b = 0; b < MIXER_EQ_BANDS; b++)
+        {
+            const MixerEqBand& band = mixer->tracks[t].eq[b];
+            if (band.type.load() != FILTER_BYPASS)
+                seconds = std::max(seconds, MIXER_EQ_TAIL_TIME_CONSTANTS * band.q.load() / ((float)M_PI * std::max(band.frequency.load(), 1.0f)));
+        }
+    }
+
+    return mixer->engine->blockSize + (long long)ceil(seconds * mixer->engine->sampleRate);
+}
+
+Mixer* CreateMixer(Engine* engine)
+{
+    if (engine->channelCount != 2)
+    {
+
+        LogMessage(LOG_ERROR, "The mixer needs a stereo engine.");
+        return NULL;
+    }
+
+    Mixer* mixer = AllocateMixer(engine);
+    mixer->node = AddEngineNode(engine, "Mixer", mixer, ProcessMixerNode, false);
+    if (mixer->node == ENGINE_NO_NODE)
+    {
+
+        DestroyMixer(mixer);
+        return NULL;
+    }
+
+    SetEngineNodeClone(engine, mixer->node, CloneMixerNode, ReleaseMixerNode);
+    SetEngineNodeTail(engine, mixer->node, GetMixerTail);
+    return mixer;
+}
+
+void DestroyMixer(Mixer* mixer)
+{
+    if (mixer == NULL)
+        return;
+
+    delete[] mixer->storage;
+    delete mixer;
+}
+
+int AddMixerTrack(Mixer* mixer, const char* name, int sourceNode)
+{
+    const int index = mixer->trackCount.load();
+    if (index == MIXER_MAX_TRACKS)
+        return -1;
+
+    MixerTrack& track = mixer->tracks[index];
+    ResetMixerStrip(&track.strip, name);
+    ResetMixerTrackEq(&track);
+    track.sourceNode = sourceNode;
+    track.input = (int)mixer->engine->nodes[mixer->node].inputs.size();
+
+    if (!ConnectEngineNodes(mixer->engine, sourceNode, mixer->node))
+        return -1;
+
+    mixer->trackCount.store(index + 1, std::memory_order_release);
+    return index;
+}
+
+int AddMixerBus(Mixer* mixer, const char* name)
+{
+    const int index = mixer->busCount.load();
+    if (index == MIXER_MAX_BUSES)
+        return -1;
+
+    ResetMixerStrip(&mixer->buses[index].strip, name);
+    mixer->busCount.store(index + 1, std::memory_order_release);
+    return index;
+}
+
+bool SetMixerStripGain(MixerStrip* strip, float gain)
+{
+    strip->gain.store(gain < 0.0f ? 0.0f : gain, std::memory_order_relaxed);
+    return true;
+}
+
+bool SetMixerStripPan(MixerStrip* strip, float pan)
+{
+    strip->pan.store(pan < -1.0f ? -1.0f : (pan > 1.0f ? 1.0f : pan), std::memory_order_relaxed);
+    return true;
+}
+
+bool SetMixerStripMute(MixerStrip* strip, bool mute)
+{
+    strip->mute.store(mute, std::memory_order_relaxed);
+    return true;
+}
+
+bool SetMixerStripSolo(MixerStrip* strip, bool solo)
+{
+    strip->solo.store(solo, std::memory_order_relaxed);
+    return true;
+}
+
+bool SetMixerTrackOutput(Mixer* mixer, int track, int bus)
+{
+    if (track < 0 || track >= mixer->trackCount.load() || (bus != MIXER_MASTER && (bus < 0 || bus >= mixer->busCount.load())))
+        return false;
+
+    mixer->tracks[track].strip.output.store(bus, std::memory_order_relaxed);
+    return true;
+}
+
+bool SetMixerBusOutput(Mixer* mixer, int bus, int output)
+{
+    if (bus < 0 || bus >= mixer->busCount.load())
+        return false;
+    if (output != MIXER_MASTER && (output <= bus || output >= mixer->busCount.load()))
+        return false;
+
+    mixer->buses[bus].strip.output.store(output, std::memory_order_relaxed);
+    return true;
+}
+
+bool SetMixerSend(Mixer* mixer, MixerStrip* strip, int send, int bus, float gain, bool preFader)
+{
+    if (send < 0 || send >= MIXER_MAX_SENDS || (bus != MIXER_NO_BUS && (bus < 0 || bus >= mixer->busCount.load())))
+        return false;
+
+    /* a bus may only send forward, like its main output */
+    for (int b = 0; b < mixer->busCount.load(); b++)
+    {
+        if (strip == &mixer->buses[b].strip && bus != MIXER_NO_BUS && bus <= b)
+            return false;
+    }
+
+    strip->sends[send].preFader.store(preFader, std::memory_order_relaxed);
+    strip->sends[send].gain.store(gain, std::memory_order_relaxed);
+    strip->sends[send].bus.store(bus, std::memory_order_release);
+    return true;
+}
+
+bool SetMixerTrackEq(Mixer* mixer, int track, int band, const FilterSettings* settings)
+{
+    if (track < 0 || track >= mixer->trackCount.load() || band < 0 || band >= MIXER_EQ_BANDS)
+        return false;
+    if (settings->type < FILTER_BYPASS || settings->type >= FILTER_TYPE_COUNT)
+        return false;
+
+    MixerEqBand& eq = mixer->tracks[track].eq[band];
+    eq.type.store(settings->type, std::memory_order_relaxed);
+    eq.frequency.store(settings->frequency, std::memory_order_relaxed);
+    eq.q.store(settings->q, std::memory_order_relaxed);
+    eq.gain.store(settings->gain, std::memory_order_relaxed);
+    mixer->tracks[track].eqChanges.fetch_add(1, std::memory_order_release);
+    return true;
+}
+
+bool GetMixerTrackEq(Mixer* mixer, int track, int band, FilterSettings* settings)
+{
+    if (track < 0 || track >= mixer->trackCount.load() || band < 0 || band >= MIXER_EQ_BANDS)
+        return false;
+
+    const MixerEqBand& eq = mixer->tracks[track].eq[band];
+    settings->type = eq.type.load(std::memory_order_relaxed);
+    settings->frequency = eq.frequency.load(std::memory_order_relaxed);
+    settings->q = eq.q.load(std::memory_order_relaxed);
+    settings->gain = eq.gain.load(std::memory_order_relaxed);
+    return true;
+}
+
+int BenchmarkMixer(int sampleRate, int blockSize, const int* trackCounts, int count, int blocks, MixerBenchmarkResult* results)
+{
+    int written = 0;
+
+    /* each pass sets the kernel on its own mixers only, so the live mix keeps running on its kernel */
+    for (int pass = 0; pass < 2; pass++)
+    {
+        const bool avx2 = pass == 1;
+        const MixAccumulateKernel kernel = GetMixKernel(avx2);
+        if (kernel == NULL)
+            break;
+
+        for (int i = 0; i < count; i++)
+        {
+            Engine* engine = CreateEngine(sampleRate, blockSize, 2);
+            Mixer* mixer = CreateMixer(engine);
+            mixer->kernel = kernel;
+            const int tracks = trackCounts[i] < MIXER_MAX_TRACKS ? trackCounts[i] : MIXER_MAX_TRACKS;
+
+            /* sources without a process callback keep the signal written here, so only mixing is timed */
+            unsigned seed = 1;
+            for (int t = 0; t < tracks; t++)
+            {
+                int source = AddEngineNode(engine, "Source", NULL, NULL, false);
+                for (int c = 0; c < 2; c++)
+                {
+                    for (int n = 0; n < blockSize; n++)
+                    {
+                        seed = seed * 1664525u + 1013904223u;
+                        engine->nodes[source].channels[c][n] = (float)(seed >> 8) / (float)(1 << 24) - 0.5f;
+                    }
+                }
+
+                AddMixerTrack(mixer, "Track", source);
+                SetMixerStripPan(&mixer->tracks[t].strip, (float)(t % 7) / 3.0f - 1.0f);
+            }
+            SetEngineOutputNode(engine, mixer->node);
+            CompileEngineGraph(engine);
+
+            float* output[2] = { new float[blockSize], new float[blockSize] };
+            ProcessEngineBlock(engine, output, blockSize);
+
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            for (int b = 0; b < blocks; b++)
+                ProcessEngineBlock(engine, output, blockSize);
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            MixerBenchmarkResult& result = results[written++];
+            result.trackCount = tracks;
+            result.avx2 = avx2;
+            result.microsecondsPerBlock = seconds * 1e6 / blocks;
+            result.nanosecondsPerTrackFrame = tracks > 0 ? seconds * 1e9 / blocks / tracks / blockSize : 0.0;
+            result.gigabytesPerSecond = (double)tracks * blockSize * 2 * sizeof(float) * blocks / seconds / 1e9;
+
+            delete[] output[0];
+            delete[] output[1];
+            DestroyMixer(mixer);
+            DestroyEngine(engine);
+        }
+    }
+
+    return written;
+}
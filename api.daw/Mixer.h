@@ -0,0 +1,113 @@
+#pragma once
+
+#include<atomic>
+
+#include"Engine.h"
+#include"FilterBank.h"
+#include"MixerKernels.h"
+
+/*api.daw mixer*/
+#define MIXER_MAX_TRACKS 512
+#define MIXER_MAX_BUSES 64
+#define MIXER_MAX_SENDS 4
+#define MIXER_NAME_LENGTH 32
+#define MIXER_MASTER -1
+#define MIXER_NO_BUS -2
+#define MIXER_EQ_BANDS 32
+#define MIXER_EQ_GROUP_TRACKS (FILTER_BANK_GROUP_LANES / 2)
+#define MIXER_EQ_MIN_FREQUENCY 20.0f
+#define MIXER_EQ_MAX_FREQUENCY 20000.0f
+#define MIXER_EQ_TAIL_TIME_CONSTANTS 12.0f
+
+struct MixerSend {
+    std::atomic<int> bus;
+    std::atomic<float> gain;
+    std::atomic<bool> preFader;
+    float appliedLeft;
+    float appliedRight;
+};
+
+/* Settings are written by the UI thread; the applied gains belong to the audio thread and ramp towards them. */
+struct MixerStrip {
+    char name[MIXER_NAME_LENGTH];
+    std::atomic<float> gain;
+    std::atomic<float> pan;
+    std::atomic<bool> mute;
+    std::atomic<bool> solo;
+    std::atomic<int> output;
+    MixerSend sends[MIXER_MAX_SENDS];
+    float appliedLeft;
+    float appliedRight;
+};
+
+struct MixerEqBand {
+    std::atomic<int> type;
+    std::atomic<float> frequency;
+    std::atomic<float> q;
+    std::atomic<float> gain;
+};
+
+/* The audio thread rebuilds the track's filters whenever eqChanges moves past eqApplied. */
+struct MixerTrack {
+    MixerStrip strip;
+    int sourceNode;
+    int input;
+    MixerEqBand eq[MIXER_EQ_BANDS];
+    std::atomic<unsigned> eqChanges;
+    unsigned eqApplied;
+};
+
+/* Buses are solo-safe and may only feed a bus with a higher index or the master, so they mix in index order. */
+struct MixerBus {
+    MixerStrip strip;
+    float* channels[ENGINE_MAX_CHANNELS];
+};
+
+struct Mixer {
+    Engine* engine;
+    int node;
+
+    /* picked when the mixer is created and only changed on a mixer that is not processing */
+    MixAccumulateKernel kernel;
+
+    MixerTrack tracks[MIXER_MAX_TRACKS];
+    std::atomic<int> trackCount;
+    MixerBus buses[MIXER_MAX_BUSES];
+    std::atomic<int> busCount;
+    MixerStrip master;
+
+    float* storage;
+    float* masterChannels[ENGINE_MAX_CHANNELS];
+
+    /* track t owns lanes 2t and 2t + 1, so each group of lanes equalizes MIXER_EQ_GROUP_TRACKS tracks at once */
+    FilterBank eq;
+    float* eqChannels[FILTER_BANK_GROUP_LANES];
+};
+
+Mixer* CreateMixer(Engine* engine);
+void DestroyMixer(Mixer* mixer);
+
+/* connects sourceNode to the mixer node; recompile the engine graph afterwards */
+int AddMixerTrack(Mixer* mixer, const char* name, int sourceNode);
+int AddMixerBus(Mixer* mixer, const char* name);
+
+bool SetMixerStripGain(MixerStrip* strip, float gain);
+bool SetMixerStripPan(MixerStrip* strip, float pan);
+bool SetMixerStripMute(MixerStrip* strip, bool mute);
+bool SetMixerStripSolo(MixerStrip* strip, bool solo);
+bool SetMixerTrackOutput(Mixer* mixer, int track, int bus);
+bool SetMixerBusOutput(Mixer* mixer, int bus, int output);
+bool SetMixerSend(Mixer* mixer, MixerStrip* strip, int send, int bus, float gain, bool preFader);
+bool SetMixerTrackEq(Mixer* mixer, int track, int band, const FilterSettings* settings);
+bool GetMixerTrackEq(Mixer* mixer, int track, int band, FilterSettings* settings);
+
+struct MixerBenchmarkResult {
+    int trackCount;
+    bool avx2;
+    double microsecondsPerBlock;
+    double nanosecondsPerTrackFrame;
+    double gigabytesPerSecond;
+};
+
+/* results receive the scalar pass and, when supported, the AVX2 pass: up to 2 * count entries */
+int BenchmarkMixer(int sampleRate, int blockSize, const int* trackCounts, int count, int blocks, MixerBenchmarkResult* results);
@@ -0,0 +1,61 @@
+#include"MixerKernels.h"
+#include"Simd.h"
+
+void MixAccumulateScalar(
+    const float* sourceLeft, const float* sourceRight, float* destinationLeft, float* destinationRight,
+    float startLeft, float startRight, float endLeft, float endRight, int frameCount)
+{
+    const float stepLeft = (endLeft - startLeft) / frameCount;
+    const float stepRight = (endRight - startRight) / frameCount;
+
+    for (int n = 0; n < frameCount; n++)
+    {
+        destinationLeft[n] += sourceLeft[n] * (startLeft + stepLeft * n);
+        destinationRight[n] += sourceRight[n] * (startRight + stepRight * n);
+    }
+}
+
+DAW_TARGET_AVX2
+void MixAccumulateAVX2(
+    const float* sourceLeft, const float* sourceRight, float* destinationLeft, float* destinationRight,
+    float startLeft, float startRight, float endLeft, float endRight, int frameCount)
+{
+    const float stepLeft = (endLeft - startLeft) / frameCount;
+    const float stepRight = (endRight - startRight) / frameCount;
+
+    const __m256 lanes = _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256 gainLeft = _mm256_fmadd_ps(lanes, _mm256_set1_ps(stepLeft), _mm256_set1_ps(startLeft));
+    __m256 gainRight = _mm256_fmadd_ps(lanes, _mm256_set1_ps(stepRight), _mm256_set1_ps(startRight));
+    const __m256 advanceLeft = _mm256_set1_ps(stepLeft * 8);
+    const __m256 advanceRight = _mm256_set1_ps(stepRight * 8);
+
+    int n = 0;
+    for (; n + 8 <= frameCount; n += 8)
+    {
+        __m256 left = _mm256_fmadd_ps(_mm256_loadu_ps(sourceLeft + n), gainLeft, _mm256_loadu_ps(destinationLeft + n));
+        __m256 right = _mm256_fmadd_ps(_mm256_loadu_ps(sourceRight + n), gainRight, _mm256_loadu_ps(destinationRight + n));
+        _mm256_storeu_ps(destinationLeft + n, left);
+        _mm256_storeu_ps(destinationRight + n, right);
+
+        gainLeft = _mm256_add_ps(gainLeft, advanceLeft);
+        gainRight = _mm256_add_ps(gainRight, advanceRight);
+    }
+
+    for (; n < frameCount; n++)
+    {
+        destinationLeft[n] += sourceLeft[n] * (startLeft + stepLeft * n);
+        destinationRight[n] += sourceRight[n] * (startRight + stepRight * n);
+    }
+}
+
+bool IsMixKernelAVX2()
+{
+    return HasAVX2();
+}
+
+MixAccumulateKernel GetMixKernel(bool avx2)
+{
+    if (!avx2)
+        return MixAccumulateScalar;
+    return HasAVX2() ? MixAccumulateAVX2 : NULL;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+/*api.daw mixer kernels*/
+
+/*
+    destination += source * gain, with the left and right gains ramped linearly
+    from their start to their end value across the block. A mono source passes
+    the same pointer for both sides.
+*/
+typedef void (*MixAccumulateKernel)(
+    const float* sourceLeft, const float* sourceRight, float* destinationLeft, float* destinationRight,
+    float startLeft, float startRight, float endLeft, float endRight, int frameCount
+);
+
+void MixAccumulateScalar(
+    const float* sourceLeft, const float* sourceRight, float* destinationLeft, float* destinationRight,
+    float startLeft, float startRight, float endLeft, float endRight, int frameCount
+);
+
+void MixAccumulateAVX2(
+    const float* sourceLeft, const float* sourceRight, float* destinationLeft, float* destinationRight,
+    float startLeft, float startRight, float endLeft, float endRight, int frameCount
+);
+
+/* new mixers take the AVX2 kernel whenever the processor has it */
+bool IsMixKernelAVX2();
+
+/* NULL when AVX2 is asked for and not supported */
+MixAccumulateKernel GetMixKernel(bool avx2);
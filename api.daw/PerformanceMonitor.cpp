@@ -0,0 +1,163 @@
+#include"PerformanceMonitor.h"
+#include"EngineThreads.h"
+
+#include<cmath>
+#include<cstdio>
+#include<cstring>
+
+static void ClearPerformanceStats(PerformanceStats* stats)
+{
+    memset(stats, 0, sizeof(PerformanceStats));
+}
+
+static void AddPerformanceSample(PerformanceStats* stats, double seconds)
+{
+    stats->blocks++;
+    stats->totalSeconds += seconds;
+    stats->lastSeconds = seconds;
+    if (seconds > stats->worstSeconds)
+        stats->worstSeconds = seconds;
+
+    const double nanoseconds = seconds * 1e9;
+    int bin = nanoseconds < PERFORMANCE_HISTOGRAM_FIRST_NANOSECONDS ? 0 : 1 + (int)log2(nanoseconds / PERFORMANCE_HISTOGRAM_FIRST_NANOSECONDS);
+    if (bin >= PERFORMANCE_HISTOGRAM_BINS)
+        bin = PERFORMANCE_HISTOGRAM_BINS - 1;
+    stats->histogram[bin] += 1.0f;
+}
+
+bool StartPerformanceMonitor(PerformanceMonitor* monitor, Engine* engine)
+{
+    monitor->engine = engine;
+    monitor->profile = new EngineProfile();
+    monitor->trackCount = 0;
+    for (int n = 0; n < ENGINE_MAX_NODES; n++)
+        monitor->nodeTrack[n] = PERFORMANCE_NO_TRACK;
+    ResetPerformanceMonitor(monitor);
+
+    return SetEngineProfile(engine, monitor->profile);
+}
+
+bool StopPerformanceMonitor(PerformanceMonitor* monitor)
+{
+    if (monitor->profile == NULL)
+        return false;
+
+    SetEngineProfile(monitor->engine, NULL);
+    delete monitor->profile;
+    monitor->profile = NULL;
+    return true;
+}
+
+static void MarkPerformanceTrack(PerformanceMonitor* monitor, int node, int track)
+{
+    if (node < 0 || node >= monitor->engine->nodeCount || monitor->nodeTrack[node] != PERFORMANCE_NO_TRACK)
+        return;
+
+    monitor->nodeTrack[node] = track;
+    for (int input : monitor->engine->nodes[node].inputs)
+        MarkPerformanceTrack(monitor, input, track);
+}
+
+bool SetPerformanceMonitorTracks(PerformanceMonitor* monitor, const int* nodes, const char* const* names, int trackCount)
+{
+    if (trackCount > PERFORMANCE_MAX_TRACKS)
+        trackCount = PERFORMANCE_MAX_TRACKS;
+
+    /* a track whose node stays keeps its history */
+    PerformanceTrack previous[PERFORMANCE_MAX_TRACKS];
+    const int previousCount = monitor->trackCount;
+    memcpy(previous, monitor->tracks, sizeof(PerformanceTrack) * previousCount);
+
+    for (int t = 0; t < trackCount; t++)
+    {
+        PerformanceTrack& track = monitor->tracks[t];
+        ClearPerformanceStats(&track.stats);
+        for (int p = 0; p < previousCount; p++)
+        {
+            if (previous[p].node == nodes[t])
+                track.stats = previous[p].stats;
+        }
+        track.node = nodes[t];
+        snprintf(track.name, PERFORMANCE_NAME_LENGTH, "%s", names[t]);
+    }
+    monitor->trackCount = trackCount;
+
+    for (int n = 0; n < ENGINE_MAX_NODES; n++)
+        monitor->nodeTrack[n] = PERFORMANCE_NO_TRACK;
+    for (int t = 0; t < trackCount; t++)
+        MarkPerformanceTrack(monitor, nodes[t], t);
+
+    return true;
+}
+
+bool UpdatePerformanceMonitor(PerformanceMonitor* monitor)
+{
+    EngineProfile* profile = monitor->profile;
+    if (profile == NULL)
+        return false;
+
+    const double tickSeconds = GetEngineTickSeconds();
+    const unsigned head = profile->head.load(std::memory_order_acquire);
+    unsigned tail = profile->tail.load(std::memory_order_relaxed);
+    for (; tail != head; tail++)
+    {
+        const EngineBlockProfile& block = profile->blocks[tail % ENGINE_PROFILE_BLOCKS];
+        const double seconds = block.ticks * tickSeconds;
+        const double period = (double)block.frameCount / monitor->engine->sampleRate;
+        const double load = period > 0.0 ? seconds / period : 0.0;
+
+        AddPerformanceSample(&monitor->blocks, seconds);
+        monitor->load += (load - monitor->load) * PERFORMANCE_LOAD_SMOOTHING;
+        if (load > monitor->peakLoad)
+            monitor->peakLoad = load;
+        monitor->loadHistory[monitor->historyPosition] = (float)(load * 100.0);
+        monitor->historyPosition = (monitor->historyPosition + 1) % PERFORMANCE_HISTORY_BLOCKS;
+
+        double trackSeconds[PERFORMANCE_MAX_TRACKS] = {};
+        for (int s = 0; s < block.stepCount; s++)
+        {
+            const int node = block.nodes[s];
+            const double stepSeconds = block.stepTicks[s] * tickSeconds;
+            AddPerformanceSample(&monitor->nodes[node], stepSeconds);
+            if (monitor->nodeTrack[node] != PERFORMANCE_NO_TRACK)
+                trackSeconds[monitor->nodeTrack[node]] += stepSeconds;
+        }
+        for (int t = 0; t < monitor->trackCount; t++)
+            AddPerformanceSample(&monitor->tracks[t].stats, trackSeconds[t]);
+    }
+    profile->tail.store(tail, std::memory_order_release);
+
+    return true;
+}
+
+bool ResetPerformanceMonitor(PerformanceMonitor* monitor)
+{
+    monitor->load = 0.0;
+    monitor->peakLoad = 0.0;
+    memset(monitor->loadHistory, 0, sizeof(monitor->loadHistory));
+    monitor->historyPosition = 0;
+    ClearPerformanceStats(&monitor->blocks);
+    for (PerformanceStats& stats : monitor->nodes)
+        ClearPerformanceStats(&stats);
+    for (int t = 0; t < monitor->trackCount; t++)
+        ClearPerformanceStats(&monitor->tracks[t].stats);
+
+    if (monitor->profile != NULL)
+    {
+
+        monitor->profile->dropped.store(0, std::memory_order_relaxed);
+        monitor->profile->worstTicks.store(0, std::memory_order_relaxed);
+    }
+    return true;
+}
+
+unsigned long long GetPerformanceDroppedBlocks(const PerformanceMonitor* monitor)
+{
+    return monitor->profile != NULL ? monitor->profile->dropped.load(std::memory_order_relaxed) : 0;
+}
+
+/* the audio thread's own worst, which also covers blocks the ring had no room for */
+double GetPerformanceWorstSeconds(const PerformanceMonitor* monitor)
+{
+    return monitor->profile != NULL ? monitor->profile->worstTicks.load(std::memory_order_relaxed) * GetEngineTickSeconds() : 0.0;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include"Engine.h"
+
+/*api.daw performance monitor*/
+#define PERFORMANCE_HISTOGRAM_BINS 20
+#define PERFORMANCE_HISTOGRAM_FIRST_NANOSECONDS 256.0
+#define PERFORMANCE_HISTORY_BLOCKS 512
+#define PERFORMANCE_MAX_TRACKS 64
+#define PERFORMANCE_NAME_LENGTH 64
+#define PERFORMANCE_LOAD_SMOOTHING 0.05
+#define PERFORMANCE_NO_TRACK -1
+
+/* Histogram bins double in width: bin 0 is below PERFORMANCE_HISTOGRAM_FIRST_NANOSECONDS, the last holds everything longer. */
+struct PerformanceStats {
+    unsigned long long blocks;
+    double totalSeconds;
+    double lastSeconds;
+    double worstSeconds;
+    float histogram[PERFORMANCE_HISTOGRAM_BINS];
+};
+
+struct PerformanceTrack {
+    char name[PERFORMANCE_NAME_LENGTH];
+    int node;
+    PerformanceStats stats;
+};
+
+/*
+    The UI side of the engine profile: drains the blocks the audio thread timed and keeps
+    the load of each block against its period, histograms per node and per track, and the
+    worst block. A track is its node and everything upstream that feeds no earlier track.
+*/
+struct PerformanceMonitor {
+    Engine* engine;
+    EngineProfile* profile;
+
+    double load;
+    double peakLoad;
+    float loadHistory[PERFORMANCE_HISTORY_BLOCKS];
+    int historyPosition;
+    PerformanceStats blocks;
+    PerformanceStats nodes[ENGINE_MAX_NODES];
+
+    int trackCount;
+    PerformanceTrack tracks[PERFORMANCE_MAX_TRACKS];
+    int nodeTrack[ENGINE_MAX_NODES];
+};
+
+bool StartPerformanceMonitor(PerformanceMonitor* monitor, Engine* engine);
+
+/* after the audio thread has stopped */
+bool StopPerformanceMonitor(PerformanceMonitor* monitor);
+
+/* UI thread; call again whenever the graph is rewired, keeping stats of tracks that stay */
+bool SetPerformanceMonitorTracks(PerformanceMonitor* monitor, const int* nodes, const char* const* names, int trackCount);
+
+/* UI thread, once per frame: drains every block timed since the last call */
+bool UpdatePerformanceMonitor(PerformanceMonitor* monitor);
+bool ResetPerformanceMonitor(PerformanceMonitor* monitor);
+
+unsigned long long GetPerformanceDroppedBlocks(const PerformanceMonitor* monitor);
+double GetPerformanceWorstSeconds(const PerformanceMonitor* monitor);
@@ -0,0 +1,374 @@
+#pragma once
+
+#include<atomic>
+#include<cstddef>
+#include<vector>
+
+/*api.daw persistent vector*/
+#define PERSISTENT_BITS 5
+#define PERSISTENT_WIDTH (1 << PERSISTENT_BITS)
+#define PERSISTENT_MASK (PERSISTENT_WIDTH - 1)
+
+struct PersistentNode {
+    std::atomic<int> references;
+};
+
+/* bytes held by every live persistent node, shared nodes counted once */
+inline std::atomic<long long>& GetPersistentMemory()
+{
+    static std::atomic<long long> memory(0);
+    return memory;
+}
+
+/*
+    A 32-way trie of values. Every update copies only the path to the changed leaf and
+    shares the rest with the previous version, so an edit costs O(log32 n) time and
+    memory and old versions stay valid and immutable. Reference counts are atomic,
+    so a version may be released on any thread.
+*/
+template<typename T>
+class PersistentVector {
+public:
+    PersistentVector() : root(NULL), count(0), shift(0) {}
+    PersistentVector(const PersistentVector& other) : root(other.root), count(other.count), shift(other.shift) { Retain(root); }
+    ~PersistentVector() { Release(root, shift); }
+
+    PersistentVector& operator=(const PersistentVector& other)
+    {
+        Retain(other.root);
+        Release(root, shift);
+        root = other.root;
+        count = other.count;
+        shift = other.shift;
+        return *this;
+    }
+
+    /* builds leaves and branches bottom up instead of pushing one value at a time */
+    static PersistentVector FromArray(const T* values, size_t valueCount)
+    {
+        if (valueCount == 0)
+            return PersistentVector();
+
+        std::vector<PersistentNode*> level;
+        for (size_t first = 0; first < valueCount; first += PERSISTENT_WIDTH)
+        {
+            Leaf* leaf = NewLeaf();
+            for (size_t v = first; v < valueCount && v < first + PERSISTENT_WIDTH; v++)
+                leaf->values[v - first] = values[v];
+            level.push_back(leaf);
+        }
+
+        unsigned levelShift = 0;
+        while (level.size() > 1)
+        {
+            std::vector<PersistentNode*> parents;
+            for (size_t first = 0; first < level.size(); first += PERSISTENT_WIDTH)
+            {
+                Branch* branch = NewBranch();
+                for (size_t c = first; c < level.size() && c < first + PERSISTENT_WIDTH; c++)
+                    branch->children[c - first] = level[c];
+                parents.push_back(branch);
+            }
+            level.swap(parents);
+            levelShift += PERSISTENT_BITS;
+        }
+
+        return PersistentVector(level[0], valueCount, levelShift);
+    }
+
+    size_t Size() const { return count; }
+
+    /* calls visit(value) for every value in order */
+    template<typename Visit>
+    void ForEach(Visit visit) const
+    {
+        if (root != NULL)
+            ForEachNode(root, shift, count, visit);
+    }
+
+    const T& Get(size_t index) const
+    {
+        const PersistentNode* node = root;
+        for (unsigned level = shift; level > 0; level -= PERSISTENT_BITS)
+            node = ((const Branch*)node)->children[(index >> level) & PERSISTENT_MASK];
+
+        return ((const Leaf*)node)->values[index & PERSISTENT_MASK];
+    }
+
+    PersistentVector Set(size_t index, const T& value) const
+    {
+        return PersistentVector(SetNode(root, shift, index, value), count, shift);
+    }
+
+    PersistentVector Push(const T& value) const
+    {
+        if (root == NULL)
+            return PersistentVector(SetNode(NULL, 0, 0, value), 1, 0);
+
+        /* a full tree grows a new root with the old one as its first child */
+        if ((count >> PERSISTENT_BITS) >= ((size_t)1 << shift))
+        {
+
+            Branch* branch = NewBranch();
+            branch->children[0] = root;
+            Retain(root);
+            branch->children[1] = SetNode(NULL, shift, count, value);
+            return PersistentVector(branch, count + 1, shift + PERSISTENT_BITS);
+        }
+
+        return PersistentVector(SetNode(root, shift, count, value), count + 1, shift);
+    }
+
+    PersistentVector Pop() const
+    {
+        if (count <= 1)
+            return PersistentVector();
+
+        PersistentNode* node = PopNode(root, shift, count - 1);
+        unsigned level = shift;
+
+        /* a root left with a single child hands over to it */
+        while (level > 0 && ((Branch*)node)->children[1] == NULL)
+        {
+            PersistentNode* child = ((Branch*)node)->children[0];
+            Retain(child);
+            Release(node, level);
+            node = child;
+            level -= PERSISTENT_BITS;
+        }
+
+        return PersistentVector(node, count - 1, level);
+    }
+
+    /* bytes of the nodes this vector holds that other does not share with it; all of them when other is NULL */
+    size_t GetMemory(const PersistentVector* other = NULL) const
+    {
+        if (other == NULL)
+            return NodeMemory(root, shift, NULL);
+
+        /* a taller tree's extra branches are its own, and only their first child lines up with the other root */
+        size_t bytes = 0;
+        const PersistentNode* mine = root;
+        unsigned level = shift;
+        for (; level > other->shift && mine != NULL; level -= PERSISTENT_BITS)
+        {
+            bytes += sizeof(Branch);
+            for (int c = 1; c < PERSISTENT_WIDTH; c++)
+                bytes += NodeMemory(((const Branch*)mine)->children[c], level - PERSISTENT_BITS, NULL);
+            mine = ((const Branch*)mine)->children[0];
+        }
+
+        const PersistentNode* theirs = other->root;
+        for (unsigned taller = other->shift; taller > level && theirs != NULL; taller -= PERSISTENT_BITS)
+            theirs = ((const Branch*)theirs)->children[0];
+
+        return bytes + NodeMemory(mine, level, theirs);
+    }
+
+    /* calls visit(index) for every index whose value may differ from other, skipping shared subtrees */
+    template<typename Visit>
+    void Diff(const PersistentVector& other, Visit visit) const
+    {
+        const size_t shared = count < other.count ? count : other.count;
+        const PersistentNode* mine = root;
+        const PersistentNode* theirs = other.root;
+        const unsigned level = shift < other.shift ? shift : other.shift;
+
+        /* the shorter tree lies under the first child of the taller one */
+        for (unsigned taller = shift; taller > level && mine != NULL; taller -= PERSISTENT_BITS)
+            mine = ((const Branch*)mine)->children[0];
+        for (unsigned taller = other.shift; taller > level && theirs != NULL; taller -= PERSISTENT_BITS)
+            theirs = ((const Branch*)theirs)->children[0];
+
+        if (shared > 0)
+            DiffNodes(mine, theirs, level, 0, shared, visit);
+
+        const size_t longer = count > other.count ? count : other.count;
+        for (size_t index = shared; index < longer; index++)
+            visit(index);
+    }
+
+private:
+    struct Branch : PersistentNode {
+        PersistentNode* children[PERSISTENT_WIDTH];
+    };
+
+    struct Leaf : PersistentNode {
+        T values[PERSISTENT_WIDTH];
+    };
+
+    PersistentNode* root;
+    size_t count;
+    unsigned shift;
+
+    PersistentVector(PersistentNode* root, size_t count, unsigned shift) : root(root), count(count), shift(shift) {}
+
+    static Branch* NewBranch()
+    {
+        Branch* branch = new Branch();
+        branch->references.store(1, std::memory_order_relaxed);
+        for (int c = 0; c < PERSISTENT_WIDTH; c++)
+            branch->children[c] = NULL;
+
+        GetPersistentMemory().fetch_add(sizeof(Branch), std::memory_order_relaxed);
+        return branch;
+    }
+
+    static Leaf* NewLeaf()
+    {
+        Leaf* leaf = new Leaf();
+        leaf->references.store(1, std::memory_order_relaxed);
+
+        GetPersistentMemory().fetch_add(sizeof(Leaf), std::memory_order_relaxed);
+        return leaf;
+    }
+
+    static void Retain(PersistentNode* node)
+    {
+        if (node != NULL)
+            node->references.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    static void Release(PersistentNode* node, unsigned level)
+    {
+        if (node == NULL || node->references.fetch_sub(1, std::memory_order_acq_rel) != 1)
+            return;
+
+        if (level > 0)
+        {
+
+            Branch* branch = (Branch*)node;
+            for (int c = 0; c < PERSISTENT_WIDTH; c++)
+                Release(branch->children[c], level - PERSISTENT_BITS);
+
+            GetPersistentMemory().fetch_sub(sizeof(Branch), std::memory_order_relaxed);
+            delete branch;
+        }
+        else {
+            GetPersistentMemory().fetch_sub(sizeof(Leaf), std::memory_order_relaxed);
+            delete (Leaf*)node;
+        }
+    }
+
+    /* copies node (or starts an empty one) and stores value along the path to index */
+    static PersistentNode* SetNode(const PersistentNode* node, unsigned level, size_t index, const T& value)
+    {
+        if (level == 0)
+        {
+
+            Leaf* leaf = NewLeaf();
+            if (node != NULL)
+            {
+
+                for (int v = 0; v < PERSISTENT_WIDTH; v++)
+                    leaf->values[v] = ((const Leaf*)node)->values[v];
+            }
+            leaf->values[index & PERSISTENT_MASK] = value;
+            return leaf;
+        }
+
+        Branch* branch = NewBranch();
+        const int slot = (int)((index >> level) & PERSISTENT_MASK);
+        if (node != NULL)
+        {
+
+            for (int c = 0; c < PERSISTENT_WIDTH; c++)
+            {
+                if (c == slot)
+                    continue;
+
+                branch->children[c] = ((const Branch*)node)->children[c];
+                Retain(branch->children[c]);
+            }
+        }
+        branch->children[slot] = SetNode(node != NULL ? ((const Branch*)node)->children[slot] : NULL, level - PERSISTENT_BITS, index, value);
+        return branch;
+    }
+
+    /* copies the path to index, dropping it; returns NULL when the node ends up empty */
+    static PersistentNode* PopNode(const PersistentNode* node, unsigned level, size_t index)
+    {
+        if (level == 0)
+        {
+
+            if ((index & PERSISTENT_MASK) == 0)
+                return NULL;
+
+            Leaf* leaf = NewLeaf();
+            for (int v = 0; v < PERSISTENT_WIDTH; v++)
+                leaf->values[v] = ((const Leaf*)node)->values[v];
+            return leaf;
+        }
+
+        const int slot = (int)((index >> level) & PERSISTENT_MASK);
+        PersistentNode* child = PopNode(((const Branch*)node)->children[slot], level - PERSISTENT_BITS, index);
+        if (child == NULL && slot == 0)
+            return NULL;
+
+        Branch* branch = NewBranch();
+        for (int c = 0; c < slot; c++)
+        {
+            branch->children[c] = ((const Branch*)node)->children[c];
+            Retain(branch->children[c]);
+        }
+        branch->children[slot] = child;
+        return branch;
+    }
+
+    /* theirs sits at the same place and level in the other tree; nodes shared with it are skipped */
+    static size_t NodeMemory(const PersistentNode* mine, unsigned level, const PersistentNode* theirs)
+    {
+        if (mine == NULL || mine == theirs)
+            return 0;
+        if (level == 0)
+            return sizeof(Leaf);
+
+        size_t bytes = sizeof(Branch);
+        for (int c = 0; c < PERSISTENT_WIDTH; c++)
+            bytes += NodeMemory(((const Branch*)mine)->children[c], level - PERSISTENT_BITS, theirs != NULL ? ((const Branch*)theirs)->children[c] : NULL);
+        return bytes;
+    }
+
+    template<typename Visit>
+    static size_t ForEachNode(const PersistentNode* node, unsigned level, size_t remaining, Visit& visit)
+    {
+        size_t visited = 0;
+        if (level == 0)
+        {
+
+            for (; visited < remaining && visited < PERSISTENT_WIDTH; visited++)
+                visit(((const Leaf*)node)->values[visited]);
+            return visited;
+        }
+
+        for (int c = 0; c < PERSISTENT_WIDTH && visited < remaining; c++)
+            visited += ForEachNode(((const Branch*)node)->children[c], level - PERSISTENT_BITS, remaining - visited, visit);
+        return visited;
+    }
+
+    template<typename Visit>
+    static void DiffNodes(const PersistentNode* mine, const PersistentNode* theirs, unsigned level, size_t base, size_t limit, Visit& visit)
+    {
+        if (mine == theirs)
+            return;
+
+        const size_t span = (size_t)1 << (level + PERSISTENT_BITS);
+        const size_t end = base + span < limit ? base + span : limit;
+        if (level == 0 || mine == NULL || theirs == NULL)
+        {
+
+            for (size_t index = base; index < end; index++)
+                visit(index);
+            return;
+        }
+
+        for (int c = 0; c < PERSISTENT_WIDTH; c++)
+        {
+            const size_t childBase = base + ((size_t)c << level);
+            if (childBase >= end)
+                break;
+
+            DiffNodes(((const Branch*)mine)->children[c], ((const Branch*)theirs)->children[c], level - PERSISTENT_BITS, childBase, end, visit);
+        }
+    }
+};
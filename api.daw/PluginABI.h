@@ -0,0 +1,72 @@
+#ifndef API_DAW_PLUGIN_ABI_H
+#define API_DAW_PLUGIN_ABI_H
+
+/*
+    api.daw plugin ABI
+
+    A plugin is a shared library exporting DAW_PLUGIN_ENTRY_NAME, which returns a
+    descriptor for the ABI version the host asks for. Everything crossing the
+    boundary is plain C so any compiler can build a plugin.
+
+    process, setParameter and getLatency are called on the audio thread and must
+    not allocate, lock or block. Every other function is called from the UI thread
+    while the instance is not being processed.
+*/
+
+#include<stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DAW_PLUGIN_ABI_VERSION 1
+#define DAW_PLUGIN_ENTRY_NAME "DawPluginEntry"
+#define DAW_PLUGIN_NAME_LENGTH 32
+
+#if defined(_WIN32)
+#define DAW_PLUGIN_EXPORT __declspec(dllexport)
+#else
+#define DAW_PLUGIN_EXPORT __attribute__((visibility("default")))
+#endif
+
+typedef struct DawPluginParameter {
+    char name[DAW_PLUGIN_NAME_LENGTH];
+    float minimum;
+    float maximum;
+    float defaultValue;
+} DawPluginParameter;
+
+typedef struct DawPluginDescriptor {
+    uint32_t abiVersion;
+    const char* name;
+    const char* vendor;
+    uint32_t channelCount;
+
+    uint32_t parameterCount;
+    const DawPluginParameter* parameters;
+
+    void* (*create)(double sampleRate, uint32_t maximumBlockSize);
+    void (*destroy)(void* instance);
+    void (*reset)(void* instance);
+
+    /* channels are processed in place */
+    void (*process)(void* instance, float** channels, uint32_t channelCount, uint32_t frameCount);
+
+    void (*setParameter)(void* instance, uint32_t index, float value);
+    float (*getParameter)(void* instance, uint32_t index);
+
+    /* latency in samples introduced by process */
+    uint32_t (*getLatency)(void* instance);
+
+    /* saveState returns the number of bytes written, or the size needed when data is NULL */
+    uint32_t (*saveState)(void* instance, void* data, uint32_t capacity);
+    int (*loadState)(void* instance, const void* data, uint32_t size);
+} DawPluginDescriptor;
+
+typedef const DawPluginDescriptor* (*DawPluginEntryFunction)(uint32_t hostAbiVersion);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,439 @@
+#include"PluginHost.h"
+#include"EngineThreads.h"
+#include"Log.h"
+
+#include<cstdio>
+#include<cstdlib>
+#include<cstring>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include<windows.h>
+#else
+#include<dirent.h>
+#include<dlfcn.h>
+#endif
+
+static void* OpenPluginModule(const char* path)
+{
+#if defined(_WIN32)
+    return (void*)LoadLibraryA(path);
+#else
+    return dlopen(path, RTLD_NOW | RTLD_LOCAL);
+#endif
+}
+
+static void* FindPluginSymbol(void* module, const char* name)
+{
+#if defined(_WIN32)
+    return (void*)GetProcAddress((HMODULE)module, name);
+#else
+    return dlsym(module, name);
+#endif
+}
+
+static void ClosePluginModule(void* module)
+{
+#if defined(_WIN32)
+    FreeLibrary((HMODULE)module);
+#else
+    dlclose(module);
+#endif
+}
+
+bool LoadPluginLibrary(const char* path, PluginLibrary* library)
+{
+    memset(library, 0, sizeof(PluginLibrary));
+    snprintf(library->path, PLUGIN_PATH_LENGTH, "%s", path);
+
+    library->module = OpenPluginModule(path);
+    if (library->module == NULL)
+    {
+
+        LogMessage(LOG_ERROR, "The plugin %s could not be opened.", path);
+        return false;
+    }
+
+    DawPluginEntryFunction entry = (DawPluginEntryFunction)FindPluginSymbol(library->module, DAW_PLUGIN_ENTRY_NAME);
+    const DawPluginDescriptor* descriptor = entry != NULL ? entry(DAW_PLUGIN_ABI_VERSION) : NULL;
+
+    if (descriptor == NULL || descriptor->abiVersion != DAW_PLUGIN_ABI_VERSION || descriptor->create == NULL || descriptor->process == NULL)
+    {
+
+        LogMessage(LOG_ERROR, "The plugin %s does not export a compatible descriptor.", path);
+        ClosePluginModule(library->module);
+        library->module = NULL;
+        return false;
+    }
+
+    library->descriptor = descriptor;
+    return true;
+}
+
+bool UnloadPluginLibrary(PluginLibrary* library)
+{
+    if (library->module == NULL)
+        return false;
+
+    ClosePluginModule(library->module);
+    library->module = NULL;
+    library->descriptor = NULL;
+    return true;
+}
+
+static bool HasPluginExtension(const char* name)
+{
+    size_t length = strlen(name);
+    size_t extension = strlen(PLUGIN_LIBRARY_EXTENSION);
+    return length > extension && strcmp(name + length - extension, PLUGIN_LIBRARY_EXTENSION) == 0;
+}
+
+int ScanPluginDirectory(const char* directory, PluginLibrary* libraries, int capacity)
+{
+    int count = 0;
+    char path[PLUGIN_PATH_LENGTH];
+
+#if defined(_WIN32)
+    char pattern[PLUGIN_PATH_LENGTH];
+    snprintf(pattern, PLUGIN_PATH_LENGTH, "%s\\*%s", directory, PLUGIN_LIBRARY_EXTENSION);
+
+    WIN32_FIND_DATAA entry;
+    HANDLE search = FindFirstFileA(pattern, &entry);
+    if (search == INVALID_HANDLE_VALUE)
+        return 0;
+
+    do
+    {
+        if (count == capacity)
+            break;
+
+        snprintf(path, PLUGIN_PATH_LENGTH, "%s\\%s", directory, entry.cFileName);
+        if (LoadPluginLibrary(path, &libraries[count]))
+            count++;
+    } while (FindNextFileA(search, &entry));
+
+    FindClose(search);
+#else
+    DIR* search = opendir(directory);
+    if (search == NULL)
+        return 0;
+
+    while (dirent* entry = readdir(search))
+    {
+        if (count == capacity)
+            break;
+        if (!HasPluginExtension(entry->d_name))
+            continue;
+
+        snprintf(path, PLUGIN_PATH_LENGTH, "%s/%s", directory, entry->d_name);
+        if (LoadPluginLibrary(path, &libraries[count]))
+            count++;
+    }
+
+    closedir(search);
+#endif
+
+    return count;
+}
+
+int ScanPluginDirectories(PluginLibrary* libraries, int capacity)
+{
+    int count = ScanPluginDirectory(PLUGIN_DEFAULT_DIRECTORY, libraries, capacity);
+
+    const char* variable = getenv(PLUGIN_PATH_VARIABLE);
+    if (variable == NULL)
+        return count;
+
+    char directory[PLUGIN_PATH_LENGTH];
+    while (*variable != '\0' && count < capacity)
+    {
+        const char* end = strchr(variable, PLUGIN_PATH_SEPARATOR);
+        size_t length = end != NULL ? (size_t)(end - variable) : strlen(variable);
+
+        if (length > 0 && length < PLUGIN_PATH_LENGTH)
+        {
+
+            memcpy(directory, variable, length);
+            directory[length] = '\0';
+            count += ScanPluginDirectory(directory, libraries + count, capacity - count);
+        }
+
+        variable += end != NULL ? length + 1 : length;
+    }
+
+    return count;
+}
+
+PluginInstance* CreatePluginInstance(PluginLibrary* library, int sampleRate, int maximumBlockSize, bool sandboxed)
+{
+    const DawPluginDescriptor* descriptor = library->descriptor;
+    if (descriptor == NULL)
+        return NULL;
+
+    void* instance = NULL;
+    PluginSandbox* sandbox = NULL;
+    const EngineFloatState floatState = GetEngineFloatState();
+    if (sandboxed)
+        sandbox = StartPluginSandbox(library->path, descriptor, sampleRate, maximumBlockSize, ENGINE_MAX_CHANNELS);
+    else
+        instance = descriptor->create((double)sampleRate, (uint32_t)maximumBlockSize);
+
+    if (instance == NULL && sandbox == NULL)
+    {
+
+        RestoreEngineFloatState(floatState);
+        LogMessage(LOG_ERROR, "The plugin %s could not create an instance.", descriptor->name);
+        return NULL;
+    }
+
+    PluginInstance* plugin = new PluginInstance();
+    plugin->library = library;
+    plugin->descriptor = descriptor;
+    plugin->instance = instance;
+    plugin->sandbox = sandbox;
+    plugin->node = ENGINE_NO_NODE;
+    plugin->parameterCount = descriptor->parameterCount < PLUGIN_MAX_PARAMETERS ? (int)descriptor->parameterCount : PLUGIN_MAX_PARAMETERS;
+
+    for (int p = 0; p < plugin->parameterCount; p++)
+    {
+        float value = descriptor->parameters[p].defaultValue;
+        if (sandbox != NULL)
+            value = sandbox->shared->parameters[p].load();
+        else if (descriptor->getParameter != NULL)
+            value = descriptor->getParameter(instance, p);
+        plugin->parameters[p].store(value);
+    }
+    plugin->changedParameters.store(0);
+    plugin->bypassed.store(false);
+
+    if (sandbox != NULL)
+        plugin->latency.store(sandbox->shared->latency.load());
+    else
+        plugin->latency.store(descriptor->getLatency != NULL ? (int)descriptor->getLatency(instance) : 0);
+
+    RestoreEngineFloatState(floatState);
+    return plugin;
+}
+
+bool DestroyPluginInstance(PluginInstance* plugin)
+{
+    if (plugin == NULL)
+        return false;
+
+    if (plugin->sandbox != NULL)
+        StopPluginSandbox(plugin->sandbox);
+    else if (plugin->descriptor->destroy != NULL)
+    {
+
+        const EngineFloatState floatState = GetEngineFloatState();
+        plugin->descriptor->destroy(plugin->instance);
+        RestoreEngineFloatState(floatState);
+    }
+
+    delete plugin;
+    return true;
+}
+
+bool PollPluginInstance(PluginInstance* plugin)
+{
+    if (plugin->sandbox == NULL)
+        return true;
+
+    return PollPluginSandbox(plugin->sandbox);
+}
+
+bool SetPluginParameter(PluginInstance* plugin, int index, float value)
+{
+    if (index < 0 || index >= plugin->parameterCount)
+        return false;
+
+    plugin->parameters[index].store(value, std::memory_order_relaxed);
+    plugin->changedParameters.fetch_or(1ull << index, std::memory_order_release);
+    return true;
+}
+
+float GetPluginParameter(PluginInstance* plugin, int index)
+{
+    if (index < 0 || index >= plugin->parameterCount)
+        return 0.0f;
+
+    return plugin->parameters[index].load(std::memory_order_relaxed);
+}
+
+bool SetPluginBypassed(PluginInstance* plugin, bool bypassed)
+{
+    plugin->bypassed.store(bypassed, std::memory_order_release);
+    return true;
+}
+
+bool SavePluginState(PluginInstance* plugin, std::vector<unsigned char>& state)
+{
+    const DawPluginDescriptor* descriptor = plugin->descriptor;
+    if (plugin->sandbox != NULL)
+        return SavePluginSandboxState(plugin->sandbox, state);
+    if (descriptor->saveState == NULL)
+        return false;
+
+    const EngineFloatState floatState = GetEngineFloatState();
+    uint32_t size = descriptor->saveState(plugin->instance, NULL, 0);
+    state.resize(size);
+    const bool saved = size == 0 || descriptor->saveState(plugin->instance, state.data(), size) == size;
+    RestoreEngineFloatState(floatState);
+
+    return saved;
+}
+
+bool LoadPluginState(PluginInstance* plugin, const std::vector<unsigned char>& state)
+{
+    const DawPluginDescriptor* descriptor = plugin->descriptor;
+    if (plugin->sandbox != NULL)
+    {
+
+        if (!LoadPluginSandboxState(plugin->sandbox, state))
+            return false;
+
+        for (int p = 0; p < plugin->parameterCount; p++)
+            plugin->parameters[p].store(plugin->sandbox->shared->parameters[p].load());
+        return true;
+    }
+
+    if (descriptor->loadState == NULL)
+        return false;
+
+    const EngineFloatState floatState = GetEngineFloatState();
+    const bool loaded = descriptor->loadState(plugin->instance, state.data(), (uint32_t)state.size()) != 0;
+
+    /* the host copy of the parameters follows the restored state */
+    for (int p = 0; loaded && p < plugin->parameterCount && descriptor->getParameter != NULL; p++)
+        plugin->parameters[p].store(descriptor->getParameter(plugin->instance, p));
+    if (loaded && descriptor->getLatency != NULL)
+        plugin->latency.store((int)descriptor->getLatency(plugin->instance));
+    RestoreEngineFloatState(floatState);
+
+    return loaded;
+}
+
+static bool ProcessSandboxedPluginNode(PluginInstance* plugin, EngineNodeContext* context)
+{
+    PluginSandbox* sandbox = plugin->sandbox;
+
+    unsigned long long changed = plugin->changedParameters.exchange(0, std::memory_order_acquire);
+    for (int p = 0; changed != 0 && p < plugin->parameterCount; p++)
+    {
+        if ((changed & (1ull << p)) != 0)
+            SetPluginSandboxParameter(sandbox, p, plugin->parameters[p].load(std::memory_order_relaxed));
+        changed &= ~(1ull << p);
+    }
+
+    if (plugin->bypassed.load(std::memory_order_acquire))
+        return true;
+
+    const int deadline = (int)(PLUGIN_SANDBOX_DEADLINE_FRACTION * 1000000.0 * context->frameCount / context->engine->sampleRate);
+    bool processed = ProcessPluginSandbox(sandbox, context->channels, context->channelCount, context->frameCount, deadline);
+    plugin->latency.store(sandbox->shared->latency.load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+    return processed;
+}
+
+static bool ProcessPluginNode(void* state, EngineNodeContext* context)
+{
+    PluginInstance* plugin = (PluginInstance*)state;
+    const DawPluginDescriptor* descriptor = plugin->descriptor;
+
+    if (plugin->sandbox != NULL)
+        return ProcessSandboxedPluginNode(plugin, context);
+
+    /* a plugin that changes rounding or turns flushing off must not leave it that way for the rest of the graph */
+    const EngineFloatState floatState = GetEngineFloatState();
+    unsigned long long changed = plugin->changedParameters.exchange(0, std::memory_order_acquire);
+    while (changed != 0 && descriptor->setParameter != NULL)
+    {
+        int index = 0;
+        while ((changed & (1ull << index)) == 0)
+            index++;
+        changed &= ~(1ull << index);
+
+        descriptor->setParameter(plugin->instance, (uint32_t)index, plugin->parameters[index].load(std::memory_order_relaxed));
+    }
+
+    if (plugin->bypassed.load(std::memory_order_acquire))
+    {
+
+        RestoreEngineFloatState(floatState);
+        return true;
+    }
+
+    uint32_t channelCount = (uint32_t)context->channelCount;
+    if (descriptor->channelCount != 0 && descriptor->channelCount < channelCount)
+        channelCount = descriptor->channelCount;
+
+    descriptor->process(plugin->instance, context->channels, channelCount, (uint32_t)context->frameCount);
+
+    if (descriptor->getLatency != NULL)
+        plugin->latency.store((int)descriptor->getLatency(plugin->instance), std::memory_order_relaxed);
+    RestoreEngineFloatState(floatState);
+
+    return true;
+}
+
+static unsigned long long HashPluginNode(void* state, unsigned long long hash)
+{
+    PluginInstance* plugin = (PluginInstance*)state;
+    hash = HashEngineBytes(hash, plugin->library->path, strlen(plugin->library->path));
+
+    const bool bypassed = plugin->bypassed.load(std::memory_order_acquire);
+    hash = HashEngineBytes(hash, &bypassed, sizeof(bypassed));
+    for (int p = 0; p < plugin->parameterCount; p++)
+    {
+        const float value = plugin->parameters[p].load(std::memory_order_relaxed);
+        hash = HashEngineBytes(hash, &value, sizeof(value));
+    }
+
+    /* the opaque state covers anything the parameters do not */
+    std::vector<unsigned char> saved;
+    if (SavePluginState(plugin, saved))
+        hash = HashEngineBytes(hash, saved.data(), saved.size());
+
+    return hash;
+}
+
+/* a new instance, in a sandbox of its own when the original runs in one, restored from the original's state and parameters */
+static void* ClonePluginNode(void* state, Engine* destination)
+{
+    PluginInstance* plugin = (PluginInstance*)state;
+    std::vector<unsigned char> saved;
+    const bool hasState = SavePluginState(plugin, saved);
+
+    PluginInstance* clone = CreatePluginInstance(plugin->library, destination->sampleRate, destination->blockSize, plugin->sandbox != NULL);
+    if (clone == NULL)
+        return NULL;
+    if (hasState)
+        LoadPluginState(clone, saved);
+
+    for (int p = 0; p < clone->parameterCount; p++)
+        SetPluginParameter(clone, p, GetPluginParameter(plugin, p));
+    SetPluginBypassed(clone, plugin->bypassed.load(std::memory_order_acquire));
+    return clone;
+}
+
+static void ReleasePluginNode(void* state)
+{
+    DestroyPluginInstance((PluginInstance*)state);
+}
+
+int AddPluginNode(Engine* engine, PluginInstance* plugin)
+{
+    plugin->node = AddEngineNode(engine, plugin->descriptor->name, plugin, ProcessPluginNode);
+    SetEngineNodeHash(engine, plugin->node, HashPluginNode);
+    SetEngineNodeClone(engine, plugin->node, ClonePluginNode, ReleasePluginNode);
+    UpdatePluginLatency(engine, plugin);
+    return plugin->node;
+}
+
+bool UpdatePluginLatency(Engine* engine, PluginInstance* plugin)
+{
+    if (plugin->node == ENGINE_NO_NODE)
+        return false;
+
+    return SetEngineNodeLatency(engine, plugin->node, plugin->latency.load(std::memory_order_relaxed));
+}
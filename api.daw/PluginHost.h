@@ -0,0 +1,71 @@
+#pragma once
+
+#include<atomic>
+#include<vector>
+
+#include"Engine.h"
+#include"PluginABI.h"
+#include"PluginSandbox.h"
+
+/*api.daw plugin host*/
+#define PLUGIN_MAX_LIBRARIES 128
+#define PLUGIN_MAX_PARAMETERS 64
+#define PLUGIN_PATH_LENGTH 260
+#define PLUGIN_PATH_VARIABLE "DAW_PLUGIN_PATH"
+#define PLUGIN_DEFAULT_DIRECTORY "plugins"
+#define PLUGIN_SANDBOX_DEADLINE_FRACTION 0.5
+
+#if defined(_WIN32)
+#define PLUGIN_LIBRARY_EXTENSION ".dll"
+#define PLUGIN_PATH_SEPARATOR ';'
+#else
+#define PLUGIN_LIBRARY_EXTENSION ".so"
+#define PLUGIN_PATH_SEPARATOR ':'
+#endif
+
+struct PluginLibrary {
+    char path[PLUGIN_PATH_LENGTH];
+    void* module;
+    const DawPluginDescriptor* descriptor;
+};
+
+struct PluginInstance {
+    PluginLibrary* library;
+    const DawPluginDescriptor* descriptor;
+    void* instance;
+    PluginSandbox* sandbox;
+    int node;
+    int parameterCount;
+
+    /* written by any thread, applied by the audio thread before the next block */
+    std::atomic<float> parameters[PLUGIN_MAX_PARAMETERS];
+    std::atomic<unsigned long long> changedParameters;
+    std::atomic<bool> bypassed;
+
+    /* written by the audio thread after every block */
+    std::atomic<int> latency;
+};
+
+bool LoadPluginLibrary(const char* path, PluginLibrary* library);
+bool UnloadPluginLibrary(PluginLibrary* library);
+
+int ScanPluginDirectory(const char* directory, PluginLibrary* libraries, int capacity);
+int ScanPluginDirectories(PluginLibrary* libraries, int capacity);
+
+/* a sandboxed instance runs in a child process and is bypassed if that process dies or misses its deadline */
+PluginInstance* CreatePluginInstance(PluginLibrary* library, int sampleRate, int maximumBlockSize, bool sandboxed = false);
+bool DestroyPluginInstance(PluginInstance* plugin);
+bool PollPluginInstance(PluginInstance* plugin);
+
+bool SetPluginParameter(PluginInstance* plugin, int index, float value);
+float GetPluginParameter(PluginInstance* plugin, int index);
+bool SetPluginBypassed(PluginInstance* plugin, bool bypassed);
+
+/* state save/restore must not overlap processing: bypass the node or stop the engine first */
+bool SavePluginState(PluginInstance* plugin, std::vector<unsigned char>& state);
+bool LoadPluginState(PluginInstance* plugin, const std::vector<unsigned char>& state);
+
+int AddPluginNode(Engine* engine, PluginInstance* plugin);
+
+/* UI thread: hands a latency the plugin reported on the audio thread to delay compensation */
+bool UpdatePluginLatency(Engine* engine, PluginInstance* plugin);
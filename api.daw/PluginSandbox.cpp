@@ -0,0 +1,795 @@
+#include"PluginSandbox.h"
+#include"PluginHost.h"
+#include"EngineThreads.h"
+#include"RealtimeSafety.h"
+#include"Log.h"
+
+#include<algorithm>
+#include<chrono>
+#include<climits>
+#include<cstdint>
+#include<cstdio>
+#include<cstdlib>
+#include<cstring>
+#include<new>
+#include<thread>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include<windows.h>
+#else
+#include<fcntl.h>
+#include<signal.h>
+#include<sys/mman.h>
+#include<sys/wait.h>
+#include<unistd.h>
+#if defined(__linux__)
+#include<linux/futex.h>
+#include<sys/syscall.h>
+#elif defined(__APPLE__)
+#include<mach-o/dyld.h>
+/* the wait-on-address calls under libc++'s atomic wait; the shared variant works across processes */
+#define UL_COMPARE_AND_WAIT_SHARED 3
+#define ULF_WAKE_ALL 0x00000100
+extern "C" int __ulock_wait(uint32_t operation, void* address, uint64_t value, uint32_t timeout);
+extern "C" int __ulock_wake(uint32_t operation, void* address, uint64_t value);
+#else
+#include<semaphore.h>
+#if defined(__FreeBSD__)
+#include<sys/sysctl.h>
+#endif
+#endif
+#endif
+
+using namespace std;
+
+typedef chrono::steady_clock SandboxClock;
+
+static atomic<unsigned> SandboxCounter(0);
+
+static size_t SandboxHeaderSize()
+{
+    return (sizeof(PluginSandboxShared) + 63) & ~(size_t)63;
+}
+
+static size_t SandboxSharedSize(int blockSize, int channelCount)
+{
+    return SandboxHeaderSize() + sizeof(float) * (size_t)PLUGIN_SANDBOX_RING_SLOTS * channelCount * blockSize;
+}
+
+static float* SandboxSlotChannel(PluginSandboxShared* shared, uint32_t slot, uint32_t channel)
+{
+    float* audio = (float*)((char*)shared + SandboxHeaderSize());
+    return audio + ((size_t)slot * shared->channelCount + channel) * shared->blockSize;
+}
+
+/* Windows and the POSIX systems without a wait on a shared address signal a named event or semaphore beside each word; Linux and macOS wait on the word itself. */
+static void* OpenSandboxEvent(const char* sandbox, const char* suffix, bool create)
+{
+#if defined(_WIN32)
+    char name[PLUGIN_SANDBOX_NAME_LENGTH + 16];
+    snprintf(name, sizeof(name), "Local\\%s.%s", sandbox, suffix);
+    return create ? (void*)CreateEventA(NULL, FALSE, FALSE, name) : (void*)OpenEventA(EVENT_MODIFY_STATE | SYNCHRONIZE, FALSE, name);
+#elif defined(__linux__) || defined(__APPLE__)
+    (void)sandbox;
+    (void)suffix;
+    (void)create;
+    return NULL;
+#else
+    char name[PLUGIN_SANDBOX_NAME_LENGTH + 16];
+    snprintf(name, sizeof(name), "/%s.%s", sandbox, suffix);
+    sem_t* semaphore = create ? sem_open(name, O_CREAT | O_EXCL, 0600, 0) : sem_open(name, 0);
+    return semaphore != SEM_FAILED ? (void*)semaphore : NULL;
+#endif
+}
+
+static void CloseSandboxEvent(void* event)
+{
+#if defined(_WIN32)
+    if (event != NULL)
+        CloseHandle((HANDLE)event);
+#elif !defined(__linux__) && !defined(__APPLE__)
+    if (event != NULL)
+        sem_close((sem_t*)event);
+#else
+    (void)event;
+#endif
+}
+
+static void UnlinkSandboxEvent(const char* sandbox, const char* suffix)
+{
+#if !defined(_WIN32) && !defined(__linux__) && !defined(__APPLE__)
+    char name[PLUGIN_SANDBOX_NAME_LENGTH + 16];
+    snprintf(name, sizeof(name), "/%s.%s", sandbox, suffix);
+    sem_unlink(name);
+#else
+    (void)sandbox;
+    (void)suffix;
+#endif
+}
+
+static void SignalSandboxWord(atomic<uint32_t>* word, void* event)
+{
+#if defined(_WIN32)
+    SetEvent((HANDLE)event);
+#elif defined(__linux__)
+    (void)event;
+    syscall(SYS_futex, (uint32_t*)word, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+#elif defined(__APPLE__)
+    (void)event;
+    __ulock_wake(UL_COMPARE_AND_WAIT_SHARED | ULF_WAKE_ALL, (void*)word, 0);
+#else
+    (void)word;
+    if (event != NULL)
+        sem_post((sem_t*)event);
+#endif
+}
+
+/* Spins briefly, then sleeps in the kernel until the word differs from value or the deadline passes. */
+static bool WaitForSandboxWord(atomic<uint32_t>* word, uint32_t value, void* event, SandboxClock::time_point deadline)
+{
+    for (int i = 0; i < PLUGIN_SANDBOX_SPIN_ITERATIONS; i++)
+    {
+        if (word->load(memory_order_acquire) != value)
+            return true;
+    }
+
+    while (word->load(memory_order_acquire) == value)
+    {
+        long long remaining = chrono::duration_cast<chrono::microseconds>(deadline - SandboxClock::now()).count();
+        if (remaining <= 0)
+            return false;
+
+#if defined(_WIN32)
+        WaitForSingleObject((HANDLE)event, (DWORD)((remaining + 999) / 1000));
+#elif defined(__linux__)
+        (void)event;
+        timespec timeout;
+        timeout.tv_sec = (time_t)(remaining / 1000000);
+        timeout.tv_nsec = (long)(remaining % 1000000) * 1000;
+        syscall(SYS_futex, (uint32_t*)word, FUTEX_WAIT, value, &timeout, NULL, 0);
+#elif defined(__APPLE__)
+        (void)event;
+        __ulock_wait(UL_COMPARE_AND_WAIT_SHARED, (void*)word, value, (uint32_t)min(remaining, (long long)UINT32_MAX));
+#else
+        /* a semaphore counts every signal, so a stale one only costs another look at the word */
+        if (event == NULL)
+        {
+
+            this_thread::sleep_for(chrono::microseconds(min(remaining, 100LL)));
+            continue;
+        }
+        timespec timeout;
+        clock_gettime(CLOCK_REALTIME, &timeout);
+        const long long nanoseconds = timeout.tv_nsec + (remaining % 1000000) * 1000;
+        timeout.tv_sec += (time_t)(remaining / 1000000 + nanoseconds / 1000000000);
+        timeout.tv_nsec = (long)(nanoseconds % 1000000000);
+        sem_timedwait((sem_t*)event, &timeout);
+#endif
+    }
+
+    return true;
+}
+
+static bool WaitForSandboxCount(atomic<uint32_t>* word, uint32_t target, void* event, SandboxClock::time_point deadline)
+{
+    uint32_t value = word->load(memory_order_acquire);
+    while ((int32_t)(value - target) < 0)
+    {
+        if (!WaitForSandboxWord(word, value, event, deadline))
+            return false;
+        value = word->load(memory_order_acquire);
+    }
+
+    return true;
+}
+
+static PluginSandboxShared* MapSandboxMemory(const char* name, size_t size, bool create, void** mapping)
+{
+#if defined(_WIN32)
+    HANDLE handle = create
+        ? CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, (DWORD)((unsigned long long)size >> 32), (DWORD)size, name)
+        : OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, name);
+    if (handle == NULL)
+        return NULL;
+
+    void* view = MapViewOfFile(handle, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    if (view == NULL)
+    {
+
+        CloseHandle(handle);
+        return NULL;
+    }
+
+    *mapping = (void*)handle;
+    return (PluginSandboxShared*)view;
+#else
+    char path[PLUGIN_SANDBOX_NAME_LENGTH + 1];
+    snprintf(path, sizeof(path), "/%s", name);
+
+    int descriptor = create ? shm_open(path, O_CREAT | O_EXCL | O_RDWR, 0600) : shm_open(path, O_RDWR, 0600);
+    if (descriptor < 0)
+        return NULL;
+
+    if (create && ftruncate(descriptor, (off_t)size) != 0)
+    {
+
+        close(descriptor);
+        shm_unlink(path);
+        return NULL;
+    }
+
+    void* view = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+    close(descriptor);
+    if (view == MAP_FAILED)
+        return NULL;
+
+    *mapping = NULL;
+    return (PluginSandboxShared*)view;
+#endif
+}
+
+static void UnmapSandboxMemory(const char* name, PluginSandboxShared* shared, size_t size, void* mapping, bool owner)
+{
+#if defined(_WIN32)
+    UnmapViewOfFile(shared);
+    CloseHandle((HANDLE)mapping);
+#else
+    (void)mapping;
+    munmap(shared, size);
+    if (owner)
+    {
+
+        char path[PLUGIN_SANDBOX_NAME_LENGTH + 1];
+        snprintf(path, sizeof(path), "/%s", name);
+        shm_unlink(path);
+    }
+#endif
+}
+
+static bool IsSandboxParentAlive(int parent)
+{
+#if defined(_WIN32)
+    HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, (DWORD)parent);
+    if (process == NULL)
+        return false;
+
+    bool alive = WaitForSingleObject(process, 0) == WAIT_TIMEOUT;
+    CloseHandle(process);
+    return alive;
+#else
+    return getppid() == parent;
+#endif
+}
+
+static int GetSandboxProcessIdentifier()
+{
+#if defined(_WIN32)
+    return (int)GetCurrentProcessId();
+#else
+    return (int)getpid();
+#endif
+}
+
+bool IsPluginSandboxCommandLine(int argc, char** argv)
+{
+    return argc >= 5 && strcmp(argv[1], PLUGIN_SANDBOX_ARGUMENT) == 0;
+}
+
+static void RunPluginSandboxCommand(PluginSandboxShared* shared, const DawPluginDescriptor* descriptor, void* instance)
+{
+    const EngineFloatState floatState = GetEngineFloatState();
+    uint32_t command = shared->command.load(memory_order_acquire);
+    int32_t result = 0;
+
+    if (command == PLUGIN_SANDBOX_COMMAND_SAVE_STATE && descriptor->saveState != NULL)
+    {
+
+        uint32_t size = descriptor->saveState(instance, NULL, 0);
+        if (size <= PLUGIN_SANDBOX_COMMAND_CAPACITY)
+        {
+
+            shared->commandSize = descriptor->saveState(instance, shared->commandData, size);
+            result = 1;
+        }
+    }
+    else if (command == PLUGIN_SANDBOX_COMMAND_LOAD_STATE && descriptor->loadState != NULL)
+    {
+
+        result = descriptor->loadState(instance, shared->commandData, shared->commandSize);
+        for (uint32_t p = 0; p < shared->parameterCount && descriptor->getParameter != NULL; p++)
+            shared->parameters[p].store(descriptor->getParameter(instance, p), memory_order_relaxed);
+    }
+    else if (command == PLUGIN_SANDBOX_COMMAND_RESET && descriptor->reset != NULL)
+    {
+
+        descriptor->reset(instance);
+        result = 1;
+    }
+    else if (command == PLUGIN_SANDBOX_COMMAND_SHUTDOWN)
+    {
+
+        result = 1;
+    }
+
+    RestoreEngineFloatState(floatState);
+    shared->commandResult = result;
+    shared->command.store(PLUGIN_SANDBOX_COMMAND_NONE, memory_order_relaxed);
+    shared->commandsCompleted.fetch_add(1, memory_order_release);
+}
+
+static void ProcessPluginSandboxBlocks(PluginSandboxShared* shared, const DawPluginDescriptor* descriptor, void* instance, void* completedEvent)
+{
+    const EngineFloatState floatState = GetEngineFloatState();
+    unsigned long long changed = shared->changedParameters.exchange(0, memory_order_acquire);
+    for (uint32_t p = 0; changed != 0 && p < shared->parameterCount; p++)
+    {
+        if ((changed & (1ull << p)) != 0 && descriptor->setParameter != NULL)
+            descriptor->setParameter(instance, p, shared->parameters[p].load(memory_order_relaxed));
+        changed &= ~(1ull << p);
+    }
+    RestoreEngineFloatState(floatState);
+
+    uint32_t completed = shared->completedBlocks.load(memory_order_relaxed);
+    while (completed != shared->submittedBlocks.load(memory_order_acquire))
+    {
+        uint32_t slot = completed % PLUGIN_SANDBOX_RING_SLOTS;
+        float* channels[PLUGIN_SANDBOX_MAX_CHANNELS];
+        for (uint32_t c = 0; c < shared->channelCount; c++)
+            channels[c] = SandboxSlotChannel(shared, slot, c);
+
+        uint32_t channelCount = shared->channelCount;
+        if (descriptor->channelCount != 0 && descriptor->channelCount < channelCount)
+            channelCount = descriptor->channelCount;
+
+        descriptor->process(instance, channels, channelCount, shared->slotFrames[slot]);
+        if (descriptor->getLatency != NULL)
+            shared->latency.store((int32_t)descriptor->getLatency(instance), memory_order_relaxed);
+        RestoreEngineFloatState(floatState);
+
+        shared->completedBlocks.store(++completed, memory_order_release);
+        SignalSandboxWord(&shared->completedBlocks, completedEvent);
+    }
+}
+
+int RunPluginSandbox(int argc, char** argv)
+{
+    if (!IsPluginSandboxCommandLine(argc, argv))
+        return -1;
+
+    const char* name = argv[2];
+    const char* pluginPath = argv[3];
+    const int parent = atoi(argv[4]);
+
+    /* the child's main thread is the plugin's audio thread */
+    EnableEngineDenormalFlush();
+
+    void* mapping = NULL;
+    PluginSandboxShared* header = MapSandboxMemory(name, sizeof(PluginSandboxShared), false, &mapping);
+    if (header == NULL)
+        return -1;
+
+    size_t size = SandboxSharedSize(header->blockSize, header->channelCount);
+    UnmapSandboxMemory(name, header, sizeof(PluginSandboxShared), mapping, false);
+
+    PluginSandboxShared* shared = MapSandboxMemory(name, size, false, &mapping);
+    if (shared == NULL)
+        return -1;
+
+    void* doorbellEvent = OpenSandboxEvent(name, "doorbell", false);
+    void* completedEvent = OpenSandboxEvent(name, "completed", false);
+    void* commandEvent = OpenSandboxEvent(name, "command", false);
+
+    PluginLibrary library;
+    void* instance = NULL;
+    if (LoadPluginLibrary(pluginPath, &library))
+        instance = library.descriptor->create((double)shared->sampleRate, shared->blockSize);
+
+    if (instance == NULL)
+    {
+
+        shared->state.store(PLUGIN_SANDBOX_FAILED, memory_order_release);
+        UnmapSandboxMemory(name, shared, size, mapping, false);
+        return -1;
+    }
+
+    const DawPluginDescriptor* descriptor = library.descriptor;
+    shared->parameterCount = descriptor->parameterCount < PLUGIN_SANDBOX_MAX_PARAMETERS ? descriptor->parameterCount : PLUGIN_SANDBOX_MAX_PARAMETERS;
+    for (uint32_t p = 0; p < shared->parameterCount; p++)
+        shared->parameters[p].store(descriptor->getParameter != NULL ? descriptor->getParameter(instance, p) : descriptor->parameters[p].defaultValue);
+    shared->latency.store(descriptor->getLatency != NULL ? (int32_t)descriptor->getLatency(instance) : 0);
+    shared->state.store(PLUGIN_SANDBOX_READY, memory_order_release);
+
+    bool running = true;
+    while (running)
+    {
+        uint32_t doorbell = shared->doorbell.load(memory_order_acquire);
+
+        if (shared->command.load(memory_order_acquire) != PLUGIN_SANDBOX_COMMAND_NONE)
+        {
+
+            running = shared->command.load(memory_order_relaxed) != PLUGIN_SANDBOX_COMMAND_SHUTDOWN;
+            RunPluginSandboxCommand(shared, descriptor, instance);
+            SignalSandboxWord(&shared->commandsCompleted, commandEvent);
+        }
+
+        ProcessPluginSandboxBlocks(shared, descriptor, instance, completedEvent);
+
+        SandboxClock::time_point deadline = SandboxClock::now() + chrono::milliseconds(PLUGIN_SANDBOX_IDLE_TIMEOUT_MILLISECONDS);
+        if (running && !WaitForSandboxWord(&shared->doorbell, doorbell, doorbellEvent, deadline))
+            running = IsSandboxParentAlive(parent);
+    }
+
+    if (descriptor->destroy != NULL)
+        descriptor->destroy(instance);
+    UnloadPluginLibrary(&library);
+
+    CloseSandboxEvent(doorbellEvent);
+    CloseSandboxEvent(completedEvent);
+    CloseSandboxEvent(commandEvent);
+    UnmapSandboxMemory(name, shared, size, mapping, false);
+
+    return 0;
+}
+
+#if !defined(_WIN32)
+/* resolved before fork, so the child only has to call execv */
+static bool GetSandboxExecutable(char* path, size_t capacity)
+{
+#if defined(__linux__)
+    return snprintf(path, capacity, "/proc/self/exe") < (int)capacity;
+#elif defined(__APPLE__)
+    uint32_t size = (uint32_t)capacity;
+    return _NSGetExecutablePath(path, &size) == 0;
+#elif defined(__FreeBSD__)
+    int name[4] = { CTL_KERN, KERN_PROC, KERN_PROC_PATHNAME, -1 };
+    size_t size = capacity;
+    return sysctl(name, 4, path, &size, NULL, 0) == 0;
+#else
+    (void)path;
+    (void)capacity;
+    return false;
+#endif
+}
+#endif
+
+static bool SpawnPluginSandbox(PluginSandbox* sandbox, const char* pluginPath)
+{
+    char parent[16];
+    snprintf(parent, sizeof(parent), "%d", GetSandboxProcessIdentifier());
+
+#if defined(_WIN32)
+    char executable[MAX_PATH];
+    if (GetModuleFileNameA(NULL, executable, MAX_PATH) == 0)
+        return false;
+
+    char commandLine[3 * MAX_PATH];
+    snprintf(commandLine, sizeof(commandLine), "\"%s\" %s %s \"%s\" %s", executable, PLUGIN_SANDBOX_ARGUMENT, sandbox->name, pluginPath, parent);
+
+    STARTUPINFOA startup;
+    PROCESS_INFORMATION information;
+    memset(&startup, 0, sizeof(startup));
+    startup.cb = sizeof(startup);
+
+    if (!CreateProcessA(executable, commandLine, NULL, NULL, FALSE, CREATE_NO_WINDOW, NULL, NULL, &startup, &information))
+        return false;
+
+    CloseHandle(information.hThread);
+    sandbox->process = (void*)information.hProcess;
+    sandbox->processIdentifier = (int)information.dwProcessId;
+    return true;
+#else
+    char executable[PATH_MAX];
+    if (!GetSandboxExecutable(executable, sizeof(executable)))
+    {
+
+        LogMessage(LOG_ERROR, "The path of the running executable could not be found, so plugins cannot be sandboxed on this system.");
+        return false;
+    }
+
+    pid_t child = fork();
+    if (child < 0)
+        return false;
+
+    if (child == 0)
+    {
+
+        char* arguments[] = { (char*)"api.daw", (char*)PLUGIN_SANDBOX_ARGUMENT, sandbox->name, (char*)pluginPath, parent, NULL };
+        execv(executable, arguments);
+        _exit(127);
+    }
+
+    sandbox->process = NULL;
+    sandbox->processIdentifier = (int)child;
+    return true;
+#endif
+}
+
+PluginSandbox* StartPluginSandbox(const char* pluginPath, const DawPluginDescriptor* descriptor, int sampleRate, int blockSize, int channelCount)
+{
+    if (channelCount > PLUGIN_SANDBOX_MAX_CHANNELS)
+        return NULL;
+
+    PluginSandbox* sandbox = new PluginSandbox();
+    snprintf(sandbox->name, PLUGIN_SANDBOX_NAME_LENGTH, "api.daw.sandbox.%d.%u", GetSandboxProcessIdentifier(), SandboxCounter.fetch_add(1));
+    sandbox->sharedSize = SandboxSharedSize(blockSize, channelCount);
+    sandbox->shared = MapSandboxMemory(sandbox->name, sandbox->sharedSize, true, &sandbox->mapping);
+    sandbox->crashed.store(false);
+    sandbox->timeouts.store(0);
+    sandbox->commandsSent = 0;
+
+    if (sandbox->shared == NULL)
+    {
+
+        LogMessage(LOG_ERROR, "The plugin sandbox memory could not be created.");
+        delete sandbox;
+        return NULL;
+    }
+
+    PluginSandboxShared* shared = new (sandbox->shared) PluginSandboxShared();
+    shared->sampleRate = (uint32_t)sampleRate;
+    shared->blockSize = (uint32_t)blockSize;
+    shared->channelCount = (uint32_t)channelCount;
+    shared->state.store(PLUGIN_SANDBOX_STARTING, memory_order_release);
+
+    sandbox->doorbellEvent = OpenSandboxEvent(sandbox->name, "doorbell", true);
+    sandbox->completedEvent = OpenSandboxEvent(sandbox->name, "completed", true);
+    sandbox->commandEvent = OpenSandboxEvent(sandbox->name, "command", true);
+
+    if (!SpawnPluginSandbox(sandbox, pluginPath))
+    {
+
+        LogMessage(LOG_ERROR, "The plugin sandbox for %s could not be started.", descriptor->name);
+        sandbox->crashed.store(true);
+        StopPluginSandbox(sandbox);
+        return NULL;
+    }
+
+    SandboxClock::time_point deadline = SandboxClock::now() + chrono::milliseconds(PLUGIN_SANDBOX_START_TIMEOUT_MILLISECONDS);
+    while (shared->state.load(memory_order_acquire) == PLUGIN_SANDBOX_STARTING && SandboxClock::now() < deadline && PollPluginSandbox(sandbox))
+        this_thread::sleep_for(chrono::milliseconds(1));
+
+    if (shared->state.load(memory_order_acquire) != PLUGIN_SANDBOX_READY)
+    {
+
+        LogMessage(LOG_ERROR, "The plugin sandbox for %s did not become ready.", descriptor->name);
+        sandbox->crashed.store(true);
+        StopPluginSandbox(sandbox);
+        return NULL;
+    }
+
+    return sandbox;
+}
+
+static bool SendPluginSandboxCommand(PluginSandbox* sandbox, uint32_t command, int timeoutMilliseconds)
+{
+    if (sandbox->crashed.load())
+        return false;
+
+    PluginSandboxShared* shared = sandbox->shared;
+    uint32_t target = ++sandbox->commandsSent;
+
+    shared->command.store(command, memory_order_release);
+    shared->doorbell.fetch_add(1, memory_order_release);
+    SignalSandboxWord(&shared->doorbell, sandbox->doorbellEvent);
+
+    SandboxClock::time_point deadline = SandboxClock::now() + chrono::milliseconds(timeoutMilliseconds);
+    if (!WaitForSandboxCount(&shared->commandsCompleted, target, sandbox->commandEvent, deadline))
+        return false;
+
+    return shared->commandResult != 0;
+}
+
+bool StopPluginSandbox(PluginSandbox* sandbox)
+{
+    if (sandbox == NULL)
+        return false;
+
+    if (sandbox->processIdentifier != 0)
+    {
+
+        bool clean = SendPluginSandboxCommand(sandbox, PLUGIN_SANDBOX_COMMAND_SHUTDOWN, PLUGIN_SANDBOX_COMMAND_TIMEOUT_MILLISECONDS);
+
+#if defined(_WIN32)
+        if (!clean || WaitForSingleObject((HANDLE)sandbox->process, PLUGIN_SANDBOX_COMMAND_TIMEOUT_MILLISECONDS) != WAIT_OBJECT_0)
+            TerminateProcess((HANDLE)sandbox->process, 1);
+        CloseHandle((HANDLE)sandbox->process);
+#else
+        if (!clean)
+            kill((pid_t)sandbox->processIdentifier, SIGKILL);
+        waitpid((pid_t)sandbox->processIdentifier, NULL, 0);
+#endif
+    }
+
+    CloseSandboxEvent(sandbox->doorbellEvent);
+    CloseSandboxEvent(sandbox->completedEvent);
+    CloseSandboxEvent(sandbox->commandEvent);
+    UnlinkSandboxEvent(sandbox->name, "doorbell");
+    UnlinkSandboxEvent(sandbox->name, "completed");
+    UnlinkSandboxEvent(sandbox->name, "command");
+
+    sandbox->shared->~PluginSandboxShared();
+    UnmapSandboxMemory(sandbox->name, sandbox->shared, sandbox->sharedSize, sandbox->mapping, true);
+
+    delete sandbox;
+    return true;
+}
+
+bool PollPluginSandbox(PluginSandbox* sandbox)
+{
+    if (sandbox->crashed.load())
+        return false;
+
+#if defined(_WIN32)
+    bool exited = WaitForSingleObject((HANDLE)sandbox->process, 0) == WAIT_OBJECT_0;
+#else
+    bool exited = waitpid((pid_t)sandbox->processIdentifier, NULL, WNOHANG) == (pid_t)sandbox->processIdentifier;
+    if (exited)
+        sandbox->processIdentifier = 0;
+#endif
+
+    if (exited)
+    {
+
+        LogMessage(LOG_WARNING, "The plugin sandbox %s exited; its node is now bypassed.", sandbox->name);
+        sandbox->crashed.store(true);
+    }
+
+    return !exited;
+}
+
+bool ProcessPluginSandbox(PluginSandbox* sandbox, float** channels, int channelCount, int frameCount, int timeoutMicroseconds)
+{
+    PluginSandboxShared* shared = sandbox->shared;
+    if (sandbox->crashed.load(memory_order_relaxed) || shared->state.load(memory_order_relaxed) != PLUGIN_SANDBOX_READY)
+        return false;
+
+    uint32_t submitted = shared->submittedBlocks.load(memory_order_relaxed);
+    uint32_t completed = shared->completedBlocks.load(memory_order_acquire);
+
+    /* a stalled child keeps its old blocks; nothing new is queued until it catches up */
+    if (submitted - completed >= PLUGIN_SANDBOX_RING_SLOTS)
+    {
+
+        sandbox->timeouts.fetch_add(1, memory_order_relaxed);
+        return false;
+    }
+
+    int sharedChannels = channelCount < (int)shared->channelCount ? channelCount : (int)shared->channelCount;
+    uint32_t slot = submitted % PLUGIN_SANDBOX_RING_SLOTS;
+    for (int c = 0; c < sharedChannels; c++)
+        memcpy(SandboxSlotChannel(shared, slot, c), channels[c], sizeof(float) * frameCount);
+    shared->slotFrames[slot] = (uint32_t)frameCount;
+
+    shared->submittedBlocks.store(submitted + 1, memory_order_release);
+    shared->doorbell.fetch_add(1, memory_order_release);
+    SignalSandboxWord(&shared->doorbell, sandbox->doorbellEvent);
+
+    /* waiting on the child is bounded by the deadline, so it is exempt from the real-time checks */
+    SandboxClock::time_point deadline = SandboxClock::now() + chrono::microseconds(timeoutMicroseconds);
+    const bool realtime = SetRealtimeThread(false);
+    const bool returned = WaitForSandboxCount(&shared->completedBlocks, submitted + 1, sandbox->completedEvent, deadline);
+    SetRealtimeThread(realtime);
+    if (!returned)
+    {
+
+        sandbox->timeouts.fetch_add(1, memory_order_relaxed);
+        return false;
+    }
+
+    for (int c = 0; c < sharedChannels; c++)
+        memcpy(channels[c], SandboxSlotChannel(shared, slot, c), sizeof(float) * frameCount);
+
+    return true;
+}
+
+bool SetPluginSandboxParameter(PluginSandbox* sandbox, int index, float value)
+{
+    PluginSandboxShared* shared = sandbox->shared;
+    if (index < 0 || index >= (int)shared->parameterCount)
+        return false;
+
+    shared->parameters[index].store(value, memory_order_relaxed);
+    shared->changedParameters.fetch_or(1ull << index, memory_order_release);
+    return true;
+}
+
+bool SavePluginSandboxState(PluginSandbox* sandbox, vector<unsigned char>& state)
+{
+    if (!SendPluginSandboxCommand(sandbox, PLUGIN_SANDBOX_COMMAND_SAVE_STATE, PLUGIN_SANDBOX_COMMAND_TIMEOUT_MILLISECONDS))
+        return false;
+
+    state.assign(sandbox->shared->commandData, sandbox->shared->commandData + sandbox->shared->commandSize);
+    return true;
+}
+
+bool LoadPluginSandboxState(PluginSandbox* sandbox, const vector<unsigned char>& state)
+{
+    if (state.size() > PLUGIN_SANDBOX_COMMAND_CAPACITY)
+        return false;
+
+    memcpy(sandbox->shared->commandData, state.data(), state.size());
+    sandbox->shared->commandSize = (uint32_t)state.size();
+    return SendPluginSandboxCommand(sandbox, PLUGIN_SANDBOX_COMMAND_LOAD_STATE, PLUGIN_SANDBOX_COMMAND_TIMEOUT_MILLISECONDS);
+}
+
+static void FillSandboxMeasurementBlock(float** channels, int channelCount, int blockSize, unsigned* seed)
+{
+    for (int c = 0; c < channelCount; c++)
+    {
+        for (int n = 0; n < blockSize; n++)
+        {
+            *seed = *seed * 1664525u + 1013904223u;
+            channels[c][n] = (float)(*seed >> 8) / (float)(1 << 24) * 2.0f - 1.0f;
+        }
+    }
+}
+
+bool MeasurePluginSandboxOverhead(const char* pluginPath, const DawPluginDescriptor* descriptor, int sampleRate, int blockSize, int blockCount, PluginSandboxReport* report)
+{
+    const int channelCount = 2;
+    vector<float> storage((size_t)channelCount * blockSize);
+    float* channels[channelCount] = { storage.data(), storage.data() + blockSize };
+    unsigned seed = 1;
+
+    memset(report, 0, sizeof(PluginSandboxReport));
+    report->blockSize = blockSize;
+    report->blockCount = blockCount;
+
+    /* timed under the same floating point state the engine threads use */
+    const EngineFloatState floatState = EnableEngineDenormalFlush();
+    void* instance = descriptor->create((double)sampleRate, (uint32_t)blockSize);
+    if (instance == NULL)
+    {
+
+        SetEngineFloatState(floatState);
+        return false;
+    }
+
+    uint32_t pluginChannels = descriptor->channelCount != 0 && descriptor->channelCount < (uint32_t)channelCount ? descriptor->channelCount : (uint32_t)channelCount;
+    double inProcess = 0.0;
+    for (int b = 0; b < blockCount; b++)
+    {
+        FillSandboxMeasurementBlock(channels, channelCount, blockSize, &seed);
+        SandboxClock::time_point start = SandboxClock::now();
+        descriptor->process(instance, channels, pluginChannels, (uint32_t)blockSize);
+        inProcess += chrono::duration<double, micro>(SandboxClock::now() - start).count();
+    }
+    if (descriptor->destroy != NULL)
+        descriptor->destroy(instance);
+    SetEngineFloatState(floatState);
+
+    PluginSandbox* sandbox = StartPluginSandbox(pluginPath, descriptor, sampleRate, blockSize, channelCount);
+    if (sandbox == NULL)
+        return false;
+
+    const int timeout = (int)(1000000.0 * blockSize / sampleRate);
+    double sandboxed = 0.0;
+    double worst = 0.0;
+    int processed = 0;
+    for (int b = 0; b < blockCount; b++)
+    {
+        FillSandboxMeasurementBlock(channels, channelCount, blockSize, &seed);
+        SandboxClock::time_point start = SandboxClock::now();
+        bool completed = ProcessPluginSandbox(sandbox, channels, channelCount, blockSize, timeout);
+        double elapsed = chrono::duration<double, micro>(SandboxClock::now() - start).count();
+
+        if (completed)
+        {
+
+            sandboxed += elapsed;
+            worst = elapsed > worst ? elapsed : worst;
+            processed++;
+        }
+    }
+    StopPluginSandbox(sandbox);
+
+    if (processed == 0)
+        return false;
+
+    report->inProcessMicroseconds = inProcess / blockCount;
+    report->sandboxMicroseconds = sandboxed / processed;
+    report->sandboxWorstMicroseconds = worst;
+    report->overheadMicroseconds = report->sandboxMicroseconds - report->inProcessMicroseconds;
+    return true;
+}
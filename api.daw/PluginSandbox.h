@@ -0,0 +1,96 @@
+#pragma once
+
+#include<atomic>
+#include<cstddef>
+#include<vector>
+
+#include"PluginABI.h"
+
+/*api.daw plugin sandbox*/
+#define PLUGIN_SANDBOX_ARGUMENT "--plugin-sandbox"
+#define PLUGIN_SANDBOX_NAME_LENGTH 64
+#define PLUGIN_SANDBOX_RING_SLOTS 4
+#define PLUGIN_SANDBOX_MAX_CHANNELS 8
+#define PLUGIN_SANDBOX_MAX_PARAMETERS 64
+#define PLUGIN_SANDBOX_COMMAND_CAPACITY 65536
+#define PLUGIN_SANDBOX_SPIN_ITERATIONS 4000
+#define PLUGIN_SANDBOX_START_TIMEOUT_MILLISECONDS 5000
+#define PLUGIN_SANDBOX_COMMAND_TIMEOUT_MILLISECONDS 1000
+#define PLUGIN_SANDBOX_IDLE_TIMEOUT_MILLISECONDS 100
+
+#define PLUGIN_SANDBOX_STARTING 0
+#define PLUGIN_SANDBOX_READY 1
+#define PLUGIN_SANDBOX_FAILED 2
+
+#define PLUGIN_SANDBOX_COMMAND_NONE 0
+#define PLUGIN_SANDBOX_COMMAND_SAVE_STATE 1
+#define PLUGIN_SANDBOX_COMMAND_LOAD_STATE 2
+#define PLUGIN_SANDBOX_COMMAND_RESET 3
+#define PLUGIN_SANDBOX_COMMAND_SHUTDOWN 4
+
+/* Lives in the shared mapping; the audio blocks follow it, one ring slot per block in flight. */
+struct PluginSandboxShared {
+    uint32_t sampleRate;
+    uint32_t blockSize;
+    uint32_t channelCount;
+    uint32_t parameterCount;
+
+    std::atomic<uint32_t> state;
+    std::atomic<uint32_t> doorbell;
+    std::atomic<uint32_t> submittedBlocks;
+    std::atomic<uint32_t> completedBlocks;
+    std::atomic<int32_t> latency;
+
+    std::atomic<unsigned long long> changedParameters;
+    std::atomic<float> parameters[PLUGIN_SANDBOX_MAX_PARAMETERS];
+
+    uint32_t slotFrames[PLUGIN_SANDBOX_RING_SLOTS];
+
+    std::atomic<uint32_t> command;
+    std::atomic<uint32_t> commandsCompleted;
+    uint32_t commandSize;
+    int32_t commandResult;
+    unsigned char commandData[PLUGIN_SANDBOX_COMMAND_CAPACITY];
+};
+
+struct PluginSandbox {
+    char name[PLUGIN_SANDBOX_NAME_LENGTH];
+    PluginSandboxShared* shared;
+    size_t sharedSize;
+
+    void* mapping;
+    void* process;
+    void* doorbellEvent;
+    void* completedEvent;
+    void* commandEvent;
+    int processIdentifier;
+
+    uint32_t commandsSent;
+    std::atomic<bool> crashed;
+    std::atomic<unsigned> timeouts;
+};
+
+struct PluginSandboxReport {
+    int blockSize;
+    int blockCount;
+    double inProcessMicroseconds;
+    double sandboxMicroseconds;
+    double sandboxWorstMicroseconds;
+    double overheadMicroseconds;
+};
+
+bool IsPluginSandboxCommandLine(int argc, char** argv);
+int RunPluginSandbox(int argc, char** argv);
+
+PluginSandbox* StartPluginSandbox(const char* pluginPath, const DawPluginDescriptor* descriptor, int sampleRate, int blockSize, int channelCount);
+bool StopPluginSandbox(PluginSandbox* sandbox);
+bool PollPluginSandbox(PluginSandbox* sandbox);
+
+/* audio thread: returns false and leaves the channels dry when the child misses the deadline */
+bool ProcessPluginSandbox(PluginSandbox* sandbox, float** channels, int channelCount, int frameCount, int timeoutMicroseconds);
+bool SetPluginSandboxParameter(PluginSandbox* sandbox, int index, float value);
+
+bool SavePluginSandboxState(PluginSandbox* sandbox, std::vector<unsigned char>& state);
+bool LoadPluginSandboxState(PluginSandbox* sandbox, const std::vector<unsigned char>& state);
+
+bool MeasurePluginSandboxOverhead(const char* pluginPath, const DawPluginDescriptor* descriptor, int sampleRate, int blockSize, int blockCount, PluginSandboxReport* report);
@@ -0,0 +1,89 @@
+#include"Project.h"
+
+#include<cstdio>
+#include<cstring>
+
+bool InitializeProject(Project* project, const char* name, double sampleRate)
+{
+    snprintf(project->name, PROJECT_NAME_LENGTH, "%s", name);
+    project->timeline = Timeline();
+    project->assets.clear();
+    project->strips.clear();
+
+    return InitializeTempoMap(&project->tempoMap, sampleRate);
+}
+
+int AddProjectAsset(Project* project, const char* path)
+{
+    for (size_t a = 0; a < project->assets.size(); a++)
+    {
+        if (strcmp(project->assets[a].path, path) == 0)
+            return (int)a;
+    }
+
+    ProjectAsset asset;
+    snprintf(asset.path, PROJECT_PATH_LENGTH, "%s", path);
+    project->assets.push_back(asset);
+    return (int)project->assets.size() - 1;
+}
+
+static ProjectStrip CaptureProjectStrip(int kind, MixerStrip* strip)
+{
+    ProjectStrip captured;
+    captured.kind = kind;
+    snprintf(captured.name, MIXER_NAME_LENGTH, "%s", strip->name);
+    captured.gain = strip->gain.load();
+    captured.pan = strip->pan.load();
+    captured.mute = strip->mute.load();
+    captured.solo = strip->solo.load();
+    captured.output = strip->output.load();
+
+    return captured;
+}
+
+bool CaptureProjectMixer(Project* project, Mixer* mixer)
+{
+    project->strips.clear();
+    for (int t = 0; t < mixer->trackCount.load(); t++)
+        project->strips.push_back(CaptureProjectStrip(PROJECT_STRIP_TRACK, &mixer->tracks[t].strip));
+    for (int b = 0; b < mixer->busCount.load(); b++)
+        project->strips.push_back(CaptureProjectStrip(PROJECT_STRIP_BUS, &mixer->buses[b].strip));
+    project->strips.push_back(CaptureProjectStrip(PROJECT_STRIP_MASTER, &mixer->master));
+
+    return true;
+}
+
+bool ApplyProjectMixer(const Project* project, Mixer* mixer)
+{
+    /* strips are matched by kind and order; extra ones on either side are left alone */
+    int track = 0;
+    int bus = 0;
+    for (const ProjectStrip& captured : project->strips)
+    {
+        MixerStrip* strip = NULL;
+        if (captured.kind == PROJECT_STRIP_TRACK && track < mixer->trackCount.load())
+        {
+
+            SetMixerTrackOutput(mixer, track, captured.output);
+            strip = &mixer->tracks[track++].strip;
+        }
+        else if (captured.kind == PROJECT_STRIP_BUS && bus < mixer->busCount.load())
+        {
+
+            SetMixerBusOutput(mixer, bus, captured.output);
+            strip = &mixer->buses[bus++].strip;
+        }
+        else if (captured.kind == PROJECT_STRIP_MASTER)
+            strip = &mixer->master;
+
+        if (strip == NULL)
+            continue;
+
+        SetMixerStripGain(strip, captured.gain);
+        SetMixerStripPan(strip, captured.pan);
+        SetMixerStripMute(strip, captured.mute);
+        SetMixerStripSolo(strip, captured.solo);
+    }
+
+    return true;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include<vector>
+
+#include"Mixer.h"
+#include"TempoMap.h"
+#include"Timeline.h"
+
+/*api.daw project*/
+#define PROJECT_NAME_LENGTH 64
+#define PROJECT_PATH_LENGTH 260
+#define PROJECT_STRIP_TRACK 0
+#define PROJECT_STRIP_BUS 1
+#define PROJECT_STRIP_MASTER 2
+
+struct ProjectAsset {
+    char path[PROJECT_PATH_LENGTH];
+};
+
+/* Plain copy of a mixer strip's settings; the live mixer keeps them in atomics. */
+struct ProjectStrip {
+    int kind;
+    char name[MIXER_NAME_LENGTH];
+    float gain;
+    float pan;
+    bool mute;
+    bool solo;
+    int output;
+};
+
+struct Project {
+    char name[PROJECT_NAME_LENGTH];
+    Timeline timeline;
+    TempoMap tempoMap;
+    std::vector<ProjectAsset> assets;
+    std::vector<ProjectStrip> strips;
+};
+
+bool InitializeProject(Project* project, const char* name, double sampleRate);
+int AddProjectAsset(Project* project, const char* path);
+
+bool CaptureProjectMixer(Project* project, Mixer* mixer);
+bool ApplyProjectMixer(const Project* project, Mixer* mixer);
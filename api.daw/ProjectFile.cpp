@@ -0,0 +1,814 @@
+#include"ProjectFile.h"
+#include"Log.h"
+
+#include<algorithm>
+#include<chrono>
+#include<cstdio>
+#include<cstring>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include<windows.h>
+#include<io.h>
+#else
+#include<fcntl.h>
+#include<unistd.h>
+#endif
+
+using namespace std;
+
+#define PROJECT_TRACK_RECORD_SIZE (TIMELINE_NAME_LENGTH + 8)
+#define PROJECT_CLIP_RECORD_SIZE 40
+#define PROJECT_REGION_RECORD_SIZE (TIMELINE_NAME_LENGTH + 16)
+#define PROJECT_MARKER_RECORD_SIZE (TIMELINE_NAME_LENGTH + 8)
+#define PROJECT_TEMPO_RECORD_SIZE 20
+#define PROJECT_METER_RECORD_SIZE 12
+#define PROJECT_ASSET_RECORD_SIZE PROJECT_PATH_LENGTH
+#define PROJECT_STRIP_RECORD_SIZE (MIXER_NAME_LENGTH + 20)
+#define PROJECT_INFO_SIZE (PROJECT_NAME_LENGTH + 8)
+
+/* Values are written byte by byte so the format stays little-endian on any host. */
+static void WriteProjectValue(vector<unsigned char>* buffer, unsigned long long value, int size)
+{
+    for (int b = 0; b < size; b++)
+        buffer->push_back((unsigned char)(value >> (8 * b)));
+}
+
+static void WriteProjectFloat(vector<unsigned char>* buffer, float value)
+{
+    unsigned bits;
+    memcpy(&bits, &value, sizeof(bits));
+    WriteProjectValue(buffer, bits, 4);
+}
+
+static void WriteProjectDouble(vector<unsigned char>* buffer, double value)
+{
+    unsigned long long bits;
+    memcpy(&bits, &value, sizeof(bits));
+    WriteProjectValue(buffer, bits, 8);
+}
+
+static void WriteProjectText(vector<unsigned char>* buffer, const char* text, int size)
+{
+    const size_t length = strnlen(text, size - 1);
+    buffer->insert(buffer->end(), text, text + length);
+    buffer->insert(buffer->end(), size - length, 0);
+}
+
+static unsigned long long ReadProjectValue(const unsigned char* data, int size)
+{
+    unsigned long long value = 0;
+    for (int b = size - 1; b >= 0; b--)
+        value = (value << 8) | data[b];
+
+    return value;
+}
+
+static float ReadProjectFloat(const unsigned char* data)
+{
+    const unsigned bits = (unsigned)ReadProjectValue(data, 4);
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static double ReadProjectDouble(const unsigned char* data)
+{
+    const unsigned long long bits = ReadProjectValue(data, 8);
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static void ReadProjectText(const unsigned char* data, char* text, int size)
+{
+    memcpy(text, data, size);
+    text[size - 1] = '\0';
+}
+
+static unsigned long long HashProjectChunk(const vector<unsigned char>& data)
+{
+    /* FNV-1a */
+    unsigned long long hash = 14695981039346656037ULL;
+    for (unsigned char byte : data)
+        hash = (hash ^ byte) * 1099511628211ULL;
+
+    return hash;
+}
+
+bool OpenProjectFile(const char* path, ProjectFile* file)
+{
+    file->version = 0;
+    file->chunks.clear();
+    if (!OpenMappedFile(path, &file->mapped))
+    {
+
+        LogMessage(LOG_ERROR, "The project %s could not be opened.", path);
+        return false;
+    }
+
+    const unsigned char* data = file->mapped.data;
+    const size_t size = file->mapped.size;
+    if (size < PROJECT_FILE_HEADER_SIZE || ReadProjectValue(data, 4) != PROJECT_FILE_MAGIC)
+    {
+
+        LogMessage(LOG_ERROR, "The project %s is not a project file.", path);
+        CloseProjectFile(file);
+        return false;
+    }
+
+    file->version = (unsigned)ReadProjectValue(data + 4, 4);
+    const unsigned long long tableOffset = ReadProjectValue(data + 8, 8);
+    const unsigned long long chunkCount = ReadProjectValue(data + 16, 4);
+    if (file->version > PROJECT_FILE_VERSION || tableOffset > size || chunkCount > (size - tableOffset) / PROJECT_FILE_TABLE_ENTRY_SIZE)
+    {
+
+        LogMessage(LOG_ERROR, "The project %s has an unsupported version or a damaged table.", path);
+        CloseProjectFile(file);
+        return false;
+    }
+
+    file->chunks.resize((size_t)chunkCount);
+    for (size_t c = 0; c < file->chunks.size(); c++)
+    {
+        const unsigned char* entry = data + tableOffset + c * PROJECT_FILE_TABLE_ENTRY_SIZE;
+        ProjectChunk& chunk = file->chunks[c];
+        chunk.id = (unsigned)ReadProjectValue(entry, 4);
+        chunk.version = (unsigned)ReadProjectValue(entry + 4, 4);
+        chunk.offset = ReadProjectValue(entry + 8, 8);
+        chunk.size = ReadProjectValue(entry + 16, 8);
+        chunk.count = ReadProjectValue(entry + 24, 8);
+        chunk.hash = ReadProjectValue(entry + 32, 8);
+
+        if (chunk.offset > size || chunk.size > size - chunk.offset)
+        {
+
+            LogMessage(LOG_ERROR, "The project %s has a chunk outside the file.", path);
+            CloseProjectFile(file);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void CloseProjectFile(ProjectFile* file)
+{
+    CloseMappedFile(&file->mapped);
+    file->chunks.clear();
+}
+
+const ProjectChunk* FindProjectChunk(const ProjectFile* file, unsigned id)
+{
+    for (const ProjectChunk& chunk : file->chunks)
+    {
+        if (chunk.id == id)
+            return &chunk;
+    }
+
+    return NULL;
+}
+
+/* the records of a chunk, or NULL when it is missing or too small for count records of recordSize */
+static const unsigned char* GetProjectRecords(const ProjectFile* file, unsigned id, size_t recordSize, size_t* count)
+{
+    const ProjectChunk* chunk = FindProjectChunk(file, id);
+    *count = 0;
+    if (chunk == NULL || chunk->count > chunk->size / recordSize)
+        return NULL;
+
+    *count = (size_t)chunk->count;
+    return file->mapped.data + chunk->offset;
+}
+
+bool ReadProjectInfo(const ProjectFile* file, Project* project)
+{
+    size_t count;
+    const unsigned char* record = GetProjectRecords(file, PROJECT_CHUNK_INFO, PROJECT_INFO_SIZE, &count);
+    if (record == NULL || count != 1)
+        return false;
+
+    ReadProjectText(record, project->name, PROJECT_NAME_LENGTH);
+    project->tempoMap.sampleRate = ReadProjectDouble(record + PROJECT_NAME_LENGTH);
+    return true;
+}
+
+bool ReadProjectTimeline(const ProjectFile* file, Timeline* timeline)
+{
+    *timeline = Timeline();
+
+    size_t count;
+    const unsigned char* record = GetProjectRecords(file, PROJECT_CHUNK_TRACKS, PROJECT_TRACK_RECORD_SIZE, &count);
+    timeline->tracks.resize(count);
+    for (size_t t = 0; t < count; t++, record += PROJECT_TRACK_RECORD_SIZE)
+    {
+        TimelineTrack& track = timeline->tracks[t];
+        ReadProjectText(record, track.name, TIMELINE_NAME_LENGTH);
+        track.gain = ReadProjectFloat(record + TIMELINE_NAME_LENGTH);
+        track.mute = ReadProjectValue(record + TIMELINE_NAME_LENGTH + 4, 4) != 0;
+    }
+
+    /* clip pages follow each other in table order */
+    unsigned long long dropped = 0;
+    for (const ProjectChunk& chunk : file->chunks)
+    {
+        if (chunk.id != PROJECT_CHUNK_CLIPS || chunk.count > chunk.size / PROJECT_CLIP_RECORD_SIZE)
+            continue;
+
+        record = file->mapped.data + chunk.offset;
+        size_t kept = timeline->clips.size();
+        timeline->clips.resize(kept + (size_t)chunk.count);
+        for (unsigned long long c = 0; c < chunk.count; c++, record += PROJECT_CLIP_RECORD_SIZE)
+        {
+            TimelineClip& clip = timeline->clips[kept];
+            clip.start = (long long)ReadProjectValue(record, 8);
+            clip.length = (long long)ReadProjectValue(record + 8, 8);
+            clip.sourceOffset = (long long)ReadProjectValue(record + 16, 8);
+            clip.track = (unsigned)ReadProjectValue(record + 24, 4);
+            clip.asset = (unsigned)ReadProjectValue(record + 28, 4);
+            clip.gain = ReadProjectFloat(record + 32);
+
+            /* the clips AddTimelineClip would refuse, on a track the file does not hold or without length, are dropped */
+            if (clip.length <= 0 || clip.track >= timeline->tracks.size())
+                dropped++;
+            else
+                kept++;
+        }
+        timeline->clips.resize(kept);
+    }
+    if (dropped > 0)
+        LogMessage(LOG_WARNING, "%llu clips of the project were dropped: their track is missing or they have no length.", dropped);
+
+    record = GetProjectRecords(file, PROJECT_CHUNK_REGIONS, PROJECT_REGION_RECORD_SIZE, &count);
+    timeline->regions.resize(count);
+    for (size_t r = 0; r < count; r++, record += PROJECT_REGION_RECORD_SIZE)
+    {
+        TimelineRegion& region = timeline->regions[r];
+        region.start = (long long)ReadProjectValue(record, 8);
+        region.length = (long long)ReadProjectValue(record + 8, 8);
+        ReadProjectText(record + 16, region.name, TIMELINE_NAME_LENGTH);
+    }
+
+    /* markers were saved in order, so they stay sorted */
+    record = GetProjectRecords(file, PROJECT_CHUNK_MARKERS, PROJECT_MARKER_RECORD_SIZE, &count);
+    timeline->markers.resize(count);
+    for (size_t m = 0; m < count; m++, record += PROJECT_MARKER_RECORD_SIZE)
+    {
+        TimelineMarker& marker = timeline->markers[m];
+        marker.position = (long long)ReadProjectValue(record, 8);
+        ReadProjectText(record + 8, marker.name, TIMELINE_NAME_LENGTH);
+    }
+
+    return BuildTimelineIndex(timeline);
+}
+
+bool ReadProjectTempoMap(const ProjectFile* file, double sampleRate, TempoMap* map)
+{
+    size_t count;
+    const unsigned char* record = GetProjectRecords(file, PROJECT_CHUNK_TEMPO, PROJECT_TEMPO_RECORD_SIZE, &count);
+    if (record == NULL || count == 0)
+        return InitializeTempoMap(map, sampleRate);
+
+    if (!InitializeTempoMap(map, sampleRate, ReadProjectDouble(record + 8)))
+        return false;
+
+    map->segments.resize(count);
+    for (size_t s = 0; s < count; s++, record += PROJECT_TEMPO_RECORD_SIZE)
+    {
+        TempoSegment& segment = map->segments[s];
+        segment.beat = ReadProjectDouble(record);
+        segment.beatsPerMinute = ReadProjectDouble(record + 8);
+        segment.ramp = ReadProjectValue(record + 16, 4) != 0;
+    }
+
+    /* the last segment is set again so cumulative positions and slopes are rebuilt once */
+    const TempoSegment last = map->segments.back();
+    SetTempoChange(map, last.beat, last.beatsPerMinute, last.ramp);
+
+    record = GetProjectRecords(file, PROJECT_CHUNK_METERS, PROJECT_METER_RECORD_SIZE, &count);
+    for (size_t m = 0; m < count; m++, record += PROJECT_METER_RECORD_SIZE)
+        SetMeterChange(map, (int)ReadProjectValue(record, 4), (int)ReadProjectValue(record + 4, 4), (int)ReadProjectValue(record + 8, 4));
+
+    return true;
+}
+
+bool ReadProjectAssets(const ProjectFile* file, vector<ProjectAsset>* assets)
+{
+    size_t count;
+    const unsigned char* record = GetProjectRecords(file, PROJECT_CHUNK_ASSETS, PROJECT_ASSET_RECORD_SIZE, &count);
+    assets->resize(count);
+    for (size_t a = 0; a < count; a++, record += PROJECT_ASSET_RECORD_SIZE)
+        ReadProjectText(record, (*assets)[a].path, PROJECT_PATH_LENGTH);
+
+    return true;
+}
+
+bool ReadProjectMixer(const ProjectFile* file, vector<ProjectStrip>* strips)
+{
+    size_t count;
+    const unsigned char* record = GetProjectRecords(file, PROJECT_CHUNK_MIXER, PROJECT_STRIP_RECORD_SIZE, &count);
+    strips->resize(count);
+    for (size_t s = 0; s < count; s++, record += PROJECT_STRIP_RECORD_SIZE)
+    {
+        ProjectStrip& strip = (*strips)[s];
+        strip.kind = (int)ReadProjectValue(record, 4);
+        ReadProjectText(record + 4, strip.name, MIXER_NAME_LENGTH);
+        strip.gain = ReadProjectFloat(record + 4 + MIXER_NAME_LENGTH);
+        strip.pan = ReadProjectFloat(record + 8 + MIXER_NAME_LENGTH);
+        strip.mute = record[12 + MIXER_NAME_LENGTH] != 0;
+        strip.solo = record[13 + MIXER_NAME_LENGTH] != 0;
+        strip.output = (int)ReadProjectValue(record + 16 + MIXER_NAME_LENGTH, 4);
+    }
+
+    return true;
+}
+
+bool LoadProject(const char* path, Project* project)
+{
+    ProjectFile file;
+    if (!OpenProjectFile(path, &file))
+        return false;
+
+    const bool loaded = ReadProjectInfo(&file, project)
+        && ReadProjectTempoMap(&file, project->tempoMap.sampleRate, &project->tempoMap)
+        && ReadProjectTimeline(&file, &project->timeline)
+        && ReadProjectAssets(&file, &project->assets)
+        && ReadProjectMixer(&file, &project->strips);
+    CloseProjectFile(&file);
+
+    if (!loaded)
+        LogMessage(LOG_ERROR, "The project %s could not be read.", path);
+    return loaded;
+}
+
+struct ProjectChunkData {
+    ProjectChunk chunk;
+    vector<unsigned char> data;
+};
+
+static void AddProjectChunk(vector<ProjectChunkData>* chunks, unsigned id, unsigned long long count)
+{
+    ProjectChunkData chunk;
+    chunk.chunk.id = id;
+    chunk.chunk.version = PROJECT_FILE_VERSION;
+    chunk.chunk.offset = 0;
+    chunk.chunk.size = 0;
+    chunk.chunk.count = count;
+    chunk.chunk.hash = 0;
+    chunks->push_back(chunk);
+}
+
+static void SerializeProject(const Project* project, vector<ProjectChunkData>* chunks)
+{
+    const Timeline& timeline = project->timeline;
+
+    AddProjectChunk(chunks, PROJECT_CHUNK_INFO, 1);
+    WriteProjectText(&chunks->back().data, project->name, PROJECT_NAME_LENGTH);
+    WriteProjectDouble(&chunks->back().data, project->tempoMap.sampleRate);
+
+    AddProjectChunk(chunks, PROJECT_CHUNK_TRACKS, timeline.tracks.size());
+    for (const TimelineTrack& track : timeline.tracks)
+    {
+        vector<unsigned char>* data = &chunks->back().data;
+        WriteProjectText(data, track.name, TIMELINE_NAME_LENGTH);
+        WriteProjectFloat(data, track.gain);
+        WriteProjectValue(data, track.mute ? 1 : 0, 4);
+    }
+
+    for (size_t c = 0; c < timeline.clips.size(); c++)
+    {
+        if (c % PROJECT_CLIP_PAGE_SIZE == 0)
+        {
+
+            AddProjectChunk(chunks, PROJECT_CHUNK_CLIPS, min(timeline.clips.size() - c, (size_t)PROJECT_CLIP_PAGE_SIZE));
+            chunks->back().data.reserve(PROJECT_CLIP_PAGE_SIZE * PROJECT_CLIP_RECORD_SIZE);
+        }
+
+        const TimelineClip& clip = timeline.clips[c];
+        vector<unsigned char>* data = &chunks->back().data;
+        WriteProjectValue(data, (unsigned long long)clip.start, 8);
+        WriteProjectValue(data, (unsigned long long)clip.length, 8);
+        WriteProjectValue(data, (unsigned long long)clip.sourceOffset, 8);
+        WriteProjectValue(data, clip.track, 4);
+        WriteProjectValue(data, clip.asset, 4);
+        WriteProjectFloat(data, clip.gain);
+        WriteProjectValue(data, 0, 4);
+    }
+
+    AddProjectChunk(chunks, PROJECT_CHUNK_REGIONS, timeline.regions.size());
+    for (const TimelineRegion& region : timeline.regions)
+    {
+        vector<unsigned char>* data = &chunks->back().data;
+        WriteProjectValue(data, (unsigned long long)region.start, 8);
+        WriteProjectValue(data, (unsigned long long)region.length, 8);
+        WriteProjectText(data, region.name, TIMELINE_NAME_LENGTH);
+    }
+
+    AddProjectChunk(chunks, PROJECT_CHUNK_MARKERS, timeline.markers.size());
+    for (const TimelineMarker& marker : timeline.markers)
+    {
+        vector<unsigned char>* data = &chunks->back().data;
+        WriteProjectValue(data, (unsigned long long)marker.position, 8);
+        WriteProjectText(data, marker.name, TIMELINE_NAME_LENGTH);
+    }
+
+    AddProjectChunk(chunks, PROJECT_CHUNK_TEMPO, project->tempoMap.segments.size());
+    for (const TempoSegment& segment : project->tempoMap.segments)
+    {
+        vector<unsigned char>* data = &chunks->back().data;
+        WriteProjectDouble(data, segment.beat);
+        WriteProjectDouble(data, segment.beatsPerMinute);
+        WriteProjectValue(data, segment.ramp ? 1 : 0, 4);
+    }
+
+    AddProjectChunk(chunks, PROJECT_CHUNK_METERS, project->tempoMap.meters.size());
+    for (const TempoMeter& meter : project->tempoMap.meters)
+    {
+        vector<unsigned char>* data = &chunks->back().data;
+        WriteProjectValue(data, (unsigned)meter.bar, 4);
+        WriteProjectValue(data, (unsigned)meter.numerator, 4);
+        WriteProjectValue(data, (unsigned)meter.denominator, 4);
+    }
+
+    AddProjectChunk(chunks, PROJECT_CHUNK_ASSETS, project->assets.size());
+    for (const ProjectAsset& asset : project->assets)
+        WriteProjectText(&chunks->back().data, asset.path, PROJECT_PATH_LENGTH);
+
+    AddProjectChunk(chunks, PROJECT_CHUNK_MIXER, project->strips.size());
+    for (const ProjectStrip& strip : project->strips)
+    {
+        vector<unsigned char>* data = &chunks->back().data;
+        WriteProjectValue(data, (unsigned)strip.kind, 4);
+        WriteProjectText(data, strip.name, MIXER_NAME_LENGTH);
+        WriteProjectFloat(data, strip.gain);
+        WriteProjectFloat(data, strip.pan);
+        data->push_back(strip.mute ? 1 : 0);
+        data->push_back(strip.solo ? 1 : 0);
+        WriteProjectValue(data, 0, 2);
+        WriteProjectValue(data, (unsigned)strip.output, 4);
+    }
+
+    for (ProjectChunkData& chunk : *chunks)
+    {
+        chunk.chunk.size = chunk.data.size();
+        chunk.chunk.hash = HashProjectChunk(chunk.data);
+    }
+}
+
+/* long is 32 bits on Windows, so offsets in files past 2 GB go through the 64-bit calls */
+static bool SeekProjectFile(FILE* file, unsigned long long offset, int origin)
+{
+#if defined(_WIN32)
+    return _fseeki64(file, (__int64)offset, origin) == 0;
+#else
+    return fseeko(file, (off_t)offset, origin) == 0;
+#endif
+}
+
+static bool TellProjectFile(FILE* file, unsigned long long* offset)
+{
+#if defined(_WIN32)
+    const __int64 position = _ftelli64(file);
+#else
+    const off_t position = ftello(file);
+#endif
+    if (position < 0)
+        return false;
+
+    *offset = (unsigned long long)position;
+    return true;
+}
+
+static bool ReadSavedProjectTable(FILE* file, vector<ProjectChunk>* chunks, unsigned long long* fileSize)
+{
+    unsigned char header[PROJECT_FILE_HEADER_SIZE];
+    if (!SeekProjectFile(file, 0, SEEK_END) || !TellProjectFile(file, fileSize))
+        return false;
+    if (!SeekProjectFile(file, 0, SEEK_SET) || fread(header, 1, sizeof(header), file) != sizeof(header))
+        return false;
+    if (ReadProjectValue(header, 4) != PROJECT_FILE_MAGIC || ReadProjectValue(header + 4, 4) != PROJECT_FILE_VERSION)
+        return false;
+
+    const unsigned long long tableOffset = ReadProjectValue(header + 8, 8);
+    const unsigned long long chunkCount = ReadProjectValue(header + 16, 4);
+    if (tableOffset > *fileSize || chunkCount > (*fileSize - tableOffset) / PROJECT_FILE_TABLE_ENTRY_SIZE)
+        return false;
+
+    vector<unsigned char> table((size_t)chunkCount * PROJECT_FILE_TABLE_ENTRY_SIZE);
+    if (!SeekProjectFile(file, tableOffset, SEEK_SET) || fread(table.data(), 1, table.size(), file) != table.size())
+        return false;
+
+    chunks->resize((size_t)chunkCount);
+    for (size_t c = 0; c < chunks->size(); c++)
+    {
+        const unsigned char* entry = table.data() + c * PROJECT_FILE_TABLE_ENTRY_SIZE;
+        ProjectChunk& chunk = (*chunks)[c];
+        chunk.id = (unsigned)ReadProjectValue(entry, 4);
+        chunk.version = (unsigned)ReadProjectValue(entry + 4, 4);
+        chunk.offset = ReadProjectValue(entry + 8, 8);
+        chunk.size = ReadProjectValue(entry + 16, 8);
+        chunk.count = ReadProjectValue(entry + 24, 8);
+        chunk.hash = ReadProjectValue(entry + 32, 8);
+    }
+
+    return true;
+}
+
+/* pushes buffered data through the OS cache so it survives a crash or power loss */
+static bool FlushProjectFile(FILE* file)
+{
+    if (fflush(file) != 0)
+        return false;
+
+#if defined(_WIN32)
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+static bool WriteProjectTail(FILE* file, vector<ProjectChunkData>* chunks, unsigned long long end, ProjectSaveReport* report)
+{
+    /* changed chunks go after everything the current header still points at */
+    if (!SeekProjectFile(file, end, SEEK_SET))
+        return false;
+
+    for (ProjectChunkData& chunk : *chunks)
+    {
+        if (chunk.chunk.offset != 0)
+            continue;
+
+        chunk.chunk.offset = end;
+        if (fwrite(chunk.data.data(), 1, chunk.data.size(), file) != chunk.data.size())
+            return false;
+
+        end += chunk.data.size();
+        report->writtenChunks++;
+        report->writtenBytes += chunk.data.size();
+    }
+
+    vector<unsigned char> table;
+    for (const ProjectChunkData& chunk : *chunks)
+    {
+        WriteProjectValue(&table, chunk.chunk.id, 4);
+        WriteProjectValue(&table, chunk.chunk.version, 4);
+        WriteProjectValue(&table, chunk.chunk.offset, 8);
+        WriteProjectValue(&table, chunk.chunk.size, 8);
+        WriteProjectValue(&table, chunk.chunk.count, 8);
+        WriteProjectValue(&table, chunk.chunk.hash, 8);
+    }
+    /* the new chunks and table are durable before the header points at them */
+    if (fwrite(table.data(), 1, table.size(), file) != table.size() || !FlushProjectFile(file))
+        return false;
+
+    vector<unsigned char> header;
+    WriteProjectValue(&header, PROJECT_FILE_MAGIC, 4);
+    WriteProjectValue(&header, PROJECT_FILE_VERSION, 4);
+    WriteProjectValue(&header, end, 8);
+    WriteProjectValue(&header, chunks->size(), 4);
+    WriteProjectValue(&header, 0, 4);
+
+    report->writtenBytes += table.size() + header.size();
+    return SeekProjectFile(file, 0, SEEK_SET) && fwrite(header.data(), 1, header.size(), file) == header.size() && FlushProjectFile(file);
+}
+
+static bool ReplaceProjectFile(const char* source, const char* destination)
+{
+#if defined(_WIN32)
+    return MoveFileExA(source, destination, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    if (rename(source, destination) != 0)
+        return false;
+
+    /* the rename itself is only durable once the directory entry is synced */
+    char directory[PROJECT_PATH_LENGTH];
+    snprintf(directory, sizeof(directory), "%s", destination);
+    char* slash = strrchr(directory, '/');
+    if (slash == NULL)
+        snprintf(directory, sizeof(directory), ".");
+    else if (slash == directory)
+        slash[1] = 0;
+    else
+        *slash = 0;
+
+    const int descriptor = open(directory, O_RDONLY);
+    if (descriptor < 0)
+        return false;
+
+    const bool synced = fsync(descriptor) == 0;
+    close(descriptor);
+    return synced;
+#endif
+}
+
+/* writes every chunk to path.tmp and swaps it in, so path always holds a complete project */
+static bool WriteProjectCopy(const char* path, vector<ProjectChunkData>* chunks, ProjectSaveReport* report)
+{
+    for (ProjectChunkData& chunk : *chunks)
+        chunk.chunk.offset = 0;
+    report->writtenChunks = 0;
+    report->writtenBytes = 0;
+    report->compacted = true;
+
+    char temporary[PROJECT_PATH_LENGTH + 8];
+    snprintf(temporary, sizeof(temporary), "%s.tmp", path);
+    FILE* file = fopen(temporary, "wb");
+    if (file == NULL)
+    {
+
+        LogMessage(LOG_ERROR, "The project %s could not be written.", path);
+        return false;
+    }
+
+    vector<unsigned char> placeholder(PROJECT_FILE_HEADER_SIZE, 0);
+    bool saved = fwrite(placeholder.data(), 1, placeholder.size(), file) == placeholder.size()
+        && WriteProjectTail(file, chunks, PROJECT_FILE_HEADER_SIZE, report);
+    fclose(file);
+
+    saved = saved && ReplaceProjectFile(temporary, path);
+    if (!saved)
+    {
+
+        remove(temporary);
+        LogMessage(LOG_ERROR, "The project %s could not be written.", path);
+    }
+
+    return saved;
+}
+
+bool SaveProject(const char* path, const Project* project, ProjectSaveReport* report)
+{
+    const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    ProjectSaveReport local;
+    if (report == NULL)
+        report = &local;
+    memset(report, 0, sizeof(ProjectSaveReport));
+
+    vector<ProjectChunkData> chunks;
+    SerializeProject(project, &chunks);
+    report->chunkCount = (int)chunks.size();
+
+    unsigned long long liveBytes = 0;
+    for (const ProjectChunkData& chunk : chunks)
+        liveBytes += chunk.data.size();
+
+    /* reuse every unchanged chunk of the existing file */
+    bool saved = false;
+    FILE* file = fopen(path, "r+b");
+    if (file != NULL)
+    {
+
+        vector<ProjectChunk> previous;
+        unsigned long long fileSize;
+        if (ReadSavedProjectTable(file, &previous, &fileSize) && fileSize < 2 * liveBytes + PROJECT_FILE_COMPACT_MINIMUM)
+        {
+
+            for (ProjectChunkData& chunk : chunks)
+            {
+                for (const ProjectChunk& old : previous)
+                {
+                    if (old.id == chunk.chunk.id && old.hash == chunk.chunk.hash && old.size == chunk.chunk.size && old.count == chunk.chunk.count)
+                    {
+
+                        chunk.chunk.offset = old.offset;
+                        break;
+                    }
+                }
+            }
+            saved = WriteProjectTail(file, &chunks, fileSize, report);
+        }
+        fclose(file);
+    }
+
+    /* a new file, an unreadable one, or one with too much dead space is written in full and swapped in */
+    if (!saved)
+        saved = WriteProjectCopy(path, &chunks, report);
+
+    report->milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    return saved;
+}
+
+bool SaveProjectCopy(const char* path, const Project* project, ProjectSaveReport* report)
+{
+    const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    ProjectSaveReport local;
+    if (report == NULL)
+        report = &local;
+    memset(report, 0, sizeof(ProjectSaveReport));
+
+    vector<ProjectChunkData> chunks;
+    SerializeProject(project, &chunks);
+    report->chunkCount = (int)chunks.size();
+
+    const bool saved = WriteProjectCopy(path, &chunks, report);
+    report->milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    return saved;
+}
+
+static void WriteProjectJsonText(FILE* file, const char* text)
+{
+    fputc('"', file);
+    for (const char* c = text; *c != '\0'; c++)
+    {
+        if (*c == '"' || *c == '\\')
+            fprintf(file, "\\%c", *c);
+        else if ((unsigned char)*c < 0x20)
+            fprintf(file, "\\u%04x", (unsigned char)*c);
+        else
+            fputc(*c, file);
+    }
+    fputc('"', file);
+}
+
+bool ExportProjectJson(const Project* project, const char* path)
+{
+    FILE* file = fopen(path, "w");
+    if (file == NULL)
+    {
+
+        LogMessage(LOG_ERROR, "The project export %s could not be written.", path);
+        return false;
+    }
+
+    const Timeline& timeline = project->timeline;
+    fprintf(file, "{\n  \"version\": %d,\n  \"name\": ", PROJECT_FILE_VERSION);
+    WriteProjectJsonText(file, project->name);
+    fprintf(file, ",\n  \"sampleRate\": %.17g,\n", project->tempoMap.sampleRate);
+
+    fprintf(file, "  \"tempo\": [");
+    for (size_t s = 0; s < project->tempoMap.segments.size(); s++)
+    {
+        const TempoSegment& segment = project->tempoMap.segments[s];
+        fprintf(file, "%s\n    { \"beat\": %.17g, \"bpm\": %.17g, \"ramp\": %s }", s > 0 ? "," : "", segment.beat, segment.beatsPerMinute, segment.ramp ? "true" : "false");
+    }
+    fprintf(file, "\n  ],\n  \"meters\": [");
+    for (size_t m = 0; m < project->tempoMap.meters.size(); m++)
+    {
+        const TempoMeter& meter = project->tempoMap.meters[m];
+        fprintf(file, "%s\n    { \"bar\": %d, \"numerator\": %d, \"denominator\": %d }", m > 0 ? "," : "", meter.bar, meter.numerator, meter.denominator);
+    }
+
+    fprintf(file, "\n  ],\n  \"tracks\": [");
+    for (size_t t = 0; t < timeline.tracks.size(); t++)
+    {
+        const TimelineTrack& track = timeline.tracks[t];
+        fprintf(file, "%s\n    { \"name\": ", t > 0 ? "," : "");
+        WriteProjectJsonText(file, track.name);
+        fprintf(file, ", \"gain\": %.9g, \"mute\": %s }", track.gain, track.mute ? "true" : "false");
+    }
+
+    fprintf(file, "\n  ],\n  \"clips\": [");
+    for (size_t c = 0; c < timeline.clips.size(); c++)
+    {
+        const TimelineClip& clip = timeline.clips[c];
+        fprintf(
+            file, "%s\n    { \"track\": %u, \"start\": %lld, \"length\": %lld, \"sourceOffset\": %lld, \"asset\": %d, \"gain\": %.9g }",
+            c > 0 ? "," : "", clip.track, clip.start, clip.length, clip.sourceOffset, clip.asset == TIMELINE_NO_ASSET ? -1 : (int)clip.asset, clip.gain
+        );
+    }
+
+    fprintf(file, "\n  ],\n  \"regions\": [");
+    for (size_t r = 0; r < timeline.regions.size(); r++)
+    {
+        const TimelineRegion& region = timeline.regions[r];
+        fprintf(file, "%s\n    { \"name\": ", r > 0 ? "," : "");
+        WriteProjectJsonText(file, region.name);
+        fprintf(file, ", \"start\": %lld, \"length\": %lld }", region.start, region.length);
+    }
+
+    fprintf(file, "\n  ],\n  \"markers\": [");
+    for (size_t m = 0; m < timeline.markers.size(); m++)
+    {
+        const TimelineMarker& marker = timeline.markers[m];
+        fprintf(file, "%s\n    { \"name\": ", m > 0 ? "," : "");
+        WriteProjectJsonText(file, marker.name);
+        fprintf(file, ", \"position\": %lld }", marker.position);
+    }
+
+    fprintf(file, "\n  ],\n  \"assets\": [");
+    for (size_t a = 0; a < project->assets.size(); a++)
+    {
+        fprintf(file, "%s\n    ", a > 0 ? "," : "");
+        WriteProjectJsonText(file, project->assets[a].path);
+    }
+
+    fprintf(file, "\n  ],\n  \"mixer\": [");
+    for (size_t s = 0; s < project->strips.size(); s++)
+    {
+        const ProjectStrip& strip = project->strips[s];
+        static const char* kinds[] = { "track", "bus", "master" };
+        fprintf(file, "%s\n    { \"kind\": \"%s\", \"name\": ", s > 0 ? "," : "", kinds[strip.kind >= 0 && strip.kind <= 2 ? strip.kind : 0]);
+        WriteProjectJsonText(file, strip.name);
+        fprintf(
+            file, ", \"gain\": %.9g, \"pan\": %.9g, \"mute\": %s, \"solo\": %s, \"output\": %d }",
+            strip.gain, strip.pan, strip.mute ? "true" : "false", strip.solo ? "true" : "false", strip.output
+        );
+    }
+    fprintf(file, "\n  ]\n}\n");
+
+    const bool written = ferror(file) == 0;
+    fclose(file);
+    return written;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include<vector>
+
+#include"MappedFile.h"
+#include"Project.h"
+
+/*api.daw project file*/
+#define PROJECT_FILE_MAGIC 0x50574144u
+#define PROJECT_FILE_VERSION 1
+#define PROJECT_FILE_HEADER_SIZE 24
+#define PROJECT_FILE_TABLE_ENTRY_SIZE 40
+#define PROJECT_FILE_COMPACT_MINIMUM (1 << 20)
+#define PROJECT_CLIP_PAGE_SIZE 4096
+
+#define PROJECT_CHUNK_ID(a, b, c, d) ((unsigned)(a) | ((unsigned)(b) << 8) | ((unsigned)(c) << 16) | ((unsigned)(d) << 24))
+#define PROJECT_CHUNK_INFO PROJECT_CHUNK_ID('I', 'N', 'F', 'O')
+#define PROJECT_CHUNK_TRACKS PROJECT_CHUNK_ID('T', 'R', 'A', 'K')
+#define PROJECT_CHUNK_CLIPS PROJECT_CHUNK_ID('C', 'L', 'I', 'P')
+#define PROJECT_CHUNK_REGIONS PROJECT_CHUNK_ID('R', 'E', 'G', 'N')
+#define PROJECT_CHUNK_MARKERS PROJECT_CHUNK_ID('M', 'A', 'R', 'K')
+#define PROJECT_CHUNK_TEMPO PROJECT_CHUNK_ID('T', 'M', 'P', 'O')
+#define PROJECT_CHUNK_METERS PROJECT_CHUNK_ID('M', 'E', 'T', 'R')
+#define PROJECT_CHUNK_ASSETS PROJECT_CHUNK_ID('A', 'S', 'S', 'T')
+#define PROJECT_CHUNK_MIXER PROJECT_CHUNK_ID('M', 'I', 'X', 'R')
+
+/*
+    Layout, all little-endian:
+        header   magic, version, table offset (u64), chunk count, reserved
+        chunks   fixed-size records, anywhere in the file
+        table    id, version, offset (u64), size (u64), record count (u64), hash (u64) per chunk
+    Clips are split into pages of PROJECT_CLIP_PAGE_SIZE records, one chunk each.
+    Saving appends only the chunks whose hash changed, then a new table, and rewrites
+    the header last, so an interrupted save still leaves the previous table valid.
+*/
+struct ProjectChunk {
+    unsigned id;
+    unsigned version;
+    unsigned long long offset;
+    unsigned long long size;
+    unsigned long long count;
+    unsigned long long hash;
+};
+
+/* An open file reads only its header and table; chunks are decoded from the mapping on request. */
+struct ProjectFile {
+    MappedFile mapped;
+    unsigned version;
+    std::vector<ProjectChunk> chunks;
+};
+
+bool OpenProjectFile(const char* path, ProjectFile* file);
+void CloseProjectFile(ProjectFile* file);
+const ProjectChunk* FindProjectChunk(const ProjectFile* file, unsigned id);
+
+bool ReadProjectInfo(const ProjectFile* file, Project* project);
+bool ReadProjectTimeline(const ProjectFile* file, Timeline* timeline);
+bool ReadProjectTempoMap(const ProjectFile* file, double sampleRate, TempoMap* map);
+bool ReadProjectAssets(const ProjectFile* file, std::vector<ProjectAsset>* assets);
+bool ReadProjectMixer(const ProjectFile* file, std::vector<ProjectStrip>* strips);
+
+bool LoadProject(const char* path, Project* project);
+
+struct ProjectSaveReport {
+    int chunkCount;
+    int writtenChunks;
+    unsigned long long writtenBytes;
+    bool compacted;
+    double milliseconds;
+};
+
+bool SaveProject(const char* path, const Project* project, ProjectSaveReport* report = NULL);
+
+/* always rewrites the whole file through a synced temporary, never appending to an existing one */
+bool SaveProjectCopy(const char* path, const Project* project, ProjectSaveReport* report = NULL);
+bool ExportProjectJson(const Project* project, const char* path);
@@ -0,0 +1,346 @@
+#include"ProjectHistory.h"
+
+#include<atomic>
+#include<cstdio>
+#include<cstring>
+
+using namespace std;
+
+/* serials are unique across every history in the process, so a reopened project never repeats one */
+static atomic<unsigned long long> ProjectVersionSerial(1);
+
+template<typename T>
+static PersistentVector<T> BuildPersistentVector(const vector<T>& values)
+{
+    return PersistentVector<T>::FromArray(values.data(), values.size());
+}
+
+template<typename T>
+static vector<T> BuildVector(const PersistentVector<T>& values)
+{
+    vector<T> result;
+    result.reserve(values.Size());
+    values.ForEach([&result](const T& value) { result.push_back(value); });
+    return result;
+}
+
+template<typename T>
+static bool UpdateChangedVector(const PersistentVector<T>& from, const PersistentVector<T>& to, vector<T>* values)
+{
+    bool changed = false;
+    from.Diff(to, [&changed](size_t) { changed = true; });
+    if (changed)
+        *values = BuildVector(to);
+
+    return changed;
+}
+
+/* bytes of the nodes version holds that previous does not; all of them when previous is NULL */
+static unsigned long long GetProjectVersionMemory(const ProjectVersion& version, const ProjectVersion* previous)
+{
+    unsigned long long bytes = 0;
+    bytes += version.tracks.GetMemory(previous != NULL ? &previous->tracks : NULL);
+    bytes += version.clips.GetMemory(previous != NULL ? &previous->clips : NULL);
+    bytes += version.regions.GetMemory(previous != NULL ? &previous->regions : NULL);
+    bytes += version.markers.GetMemory(previous != NULL ? &previous->markers : NULL);
+    bytes += version.tempo.GetMemory(previous != NULL ? &previous->tempo : NULL);
+    bytes += version.meters.GetMemory(previous != NULL ? &previous->meters : NULL);
+    bytes += version.assets.GetMemory(previous != NULL ? &previous->assets : NULL);
+    bytes += version.strips.GetMemory(previous != NULL ? &previous->strips : NULL);
+    return bytes;
+}
+
+bool ResetProjectHistory(ProjectHistory* history, const Project* project, unsigned long long memoryCap)
+{
+    ProjectVersion version;
+    snprintf(version.name, PROJECT_NAME_LENGTH, "%s", project->name);
+    snprintf(version.label, PROJECT_HISTORY_LABEL_LENGTH, "Open");
+    version.serial = ProjectVersionSerial.fetch_add(1, memory_order_relaxed);
+    version.sampleRate = project->tempoMap.sampleRate;
+    version.tracks = BuildPersistentVector(project->timeline.tracks);
+    version.clips = BuildPersistentVector(project->timeline.clips);
+    version.regions = BuildPersistentVector(project->timeline.regions);
+    version.markers = BuildPersistentVector(project->timeline.markers);
+    version.tempo = BuildPersistentVector(project->tempoMap.segments);
+    version.meters = BuildPersistentVector(project->tempoMap.meters);
+    version.assets = BuildPersistentVector(project->assets);
+    version.strips = BuildPersistentVector(project->strips);
+    version.memory = GetProjectVersionMemory(version, NULL);
+
+    history->versions.clear();
+    history->versions.push_back(version);
+    history->current = 0;
+    history->memoryCap = memoryCap;
+    return true;
+}
+
+static void TrimProjectHistory(ProjectHistory* history)
+{
+    /* the oldest undo steps go first; the current version always stays, and the version after a dropped one now owns all its nodes */
+    unsigned long long memory = GetProjectHistoryMemory(history);
+    int dropped = 0;
+    while (history->current - dropped > 0 && memory > history->memoryCap)
+    {
+        ProjectVersion* next = &history->versions[dropped + 1];
+        const unsigned long long owned = GetProjectVersionMemory(*next, NULL);
+        memory = memory + owned - history->versions[dropped].memory - next->memory;
+        next->memory = owned;
+        history->versions[dropped] = ProjectVersion();
+        dropped++;
+    }
+
+    if (dropped > 0)
+    {
+
+        history->versions.erase(history->versions.begin(), history->versions.begin() + dropped);
+        history->current -= dropped;
+    }
+}
+
+bool SetProjectHistoryMemoryCap(ProjectHistory* history, unsigned long long memoryCap)
+{
+    history->memoryCap = memoryCap;
+    TrimProjectHistory(history);
+    return true;
+}
+
+/* drops the redo steps and starts a new version from the current one */
+static ProjectVersion* BeginProjectEdit(ProjectHistory* history, const char* label)
+{
+    history->versions.erase(history->versions.begin() + history->current + 1, history->versions.end());
+
+    const ProjectVersion version = history->versions[history->current];
+    history->versions.push_back(version);
+    history->current++;
+
+    ProjectVersion* edited = &history->versions.back();
+    snprintf(edited->label, PROJECT_HISTORY_LABEL_LENGTH, "%s", label);
+    edited->serial = ProjectVersionSerial.fetch_add(1, memory_order_relaxed);
+    return edited;
+}
+
+static void EndProjectEdit(ProjectHistory* history)
+{
+    ProjectVersion* edited = &history->versions[history->current];
+    edited->memory = GetProjectVersionMemory(*edited, &history->versions[history->current - 1]);
+    TrimProjectHistory(history);
+}
+
+int AddProjectTrack(ProjectHistory* history, Project* project, const char* name)
+{
+    const int track = AddTimelineTrack(&project->timeline, name);
+
+    ProjectVersion* version = BeginProjectEdit(history, "Add track");
+    version->tracks = version->tracks.Push(project->timeline.tracks[track]);
+    EndProjectEdit(history);
+
+    return track;
+}
+
+int AddProjectClip(ProjectHistory* history, Project* project, const TimelineClip& clip)
+{
+    const int added = AddTimelineClip(&project->timeline, clip);
+    if (added < 0)
+        return added;
+
+    ProjectVersion* version = BeginProjectEdit(history, "Add clip");
+    version->clips = version->clips.Push(clip);
+    EndProjectEdit(history);
+
+    return added;
+}
+
+bool MoveProjectClip(ProjectHistory* history, Project* project, int clip, long long start)
+{
+    if (!MoveTimelineClip(&project->timeline, clip, start))
+        return false;
+
+    ProjectVersion* version = BeginProjectEdit(history, "Move clip");
+    version->clips = version->clips.Set(clip, project->timeline.clips[clip]);
+    EndProjectEdit(history);
+
+    return true;
+}
+
+bool RemoveProjectClip(ProjectHistory* history, Project* project, int clip)
+{
+    const int last = (int)project->timeline.clips.size() - 1;
+    if (!RemoveTimelineClip(&project->timeline, clip))
+        return false;
+
+    /* mirror the timeline: the last clip moves into the freed slot */
+    ProjectVersion* version = BeginProjectEdit(history, "Remove clip");
+    if (clip != last)
+        version->clips = version->clips.Set(clip, project->timeline.clips[clip]);
+    version->clips = version->clips.Pop();
+    EndProjectEdit(history);
+
+    return true;
+}
+
+int AddProjectMarker(ProjectHistory* history, Project* project, long long position, const char* name)
+{
+    const int marker = AddTimelineMarker(&project->timeline, position, name);
+
+    /* markers are few and kept sorted, so they are rebuilt rather than inserted into */
+    ProjectVersion* version = BeginProjectEdit(history, "Add marker");
+    version->markers = BuildPersistentVector(project->timeline.markers);
+    EndProjectEdit(history);
+
+    return marker;
+}
+
+int ImportProjectAssets(ProjectHistory* history, Project* project, const char* const* paths, int count)
+{
+    const size_t first = project->assets.size();
+    for (int p = 0; p < count; p++)
+        AddProjectAsset(project, paths[p]);
+    if (project->assets.size() == first)
+        return 0;
+
+    ProjectVersion* version = BeginProjectEdit(history, "Import assets");
+    for (size_t a = first; a < project->assets.size(); a++)
+        version->assets = version->assets.Push(project->assets[a]);
+    EndProjectEdit(history);
+
+    return (int)(project->assets.size() - first);
+}
+
+bool SetProjectTempoMap(ProjectHistory* history, Project* project, const TempoMap& map, const char* label)
+{
+    project->tempoMap = map;
+
+    ProjectVersion* version = BeginProjectEdit(history, label);
+    version->sampleRate = map.sampleRate;
+    version->tempo = BuildPersistentVector(map.segments);
+    version->meters = BuildPersistentVector(map.meters);
+    EndProjectEdit(history);
+
+    return true;
+}
+
+static bool IsSameProjectStrip(const ProjectStrip& a, const ProjectStrip& b)
+{
+    return a.kind == b.kind && strcmp(a.name, b.name) == 0 && a.gain == b.gain && a.pan == b.pan && a.mute == b.mute && a.solo == b.solo && a.output == b.output;
+}
+
+bool RecordProjectMixer(ProjectHistory* history, Project* project, Mixer* mixer)
+{
+    CaptureProjectMixer(project, mixer);
+
+    /* an unchanged mixer records nothing, so the serial only moves when there is something to save */
+    const PersistentVector<ProjectStrip>& recorded = history->versions[history->current].strips;
+    bool changed = recorded.Size() != project->strips.size();
+    for (size_t s = 0; s < project->strips.size() && !changed; s++)
+        changed = !IsSameProjectStrip(recorded.Get(s), project->strips[s]);
+    if (!changed)
+        return false;
+
+    ProjectVersion* version = BeginProjectEdit(history, "Mixer");
+    version->strips = BuildPersistentVector(project->strips);
+    EndProjectEdit(history);
+
+    return true;
+}
+
+static void ApplyProjectClips(const PersistentVector<TimelineClip>& from, const PersistentVector<TimelineClip>& to, Timeline* timeline)
+{
+    /* only clips outside the shared subtrees are looked at */
+    vector<size_t> changed;
+    from.Diff(to, [&](size_t index) {
+        if (index >= from.Size() || index >= to.Size() || memcmp(&from.Get(index), &to.Get(index), sizeof(TimelineClip)) != 0)
+            changed.push_back(index);
+    });
+
+    if (changed.size() > to.Size() / 16 + 64)
+    {
+
+        timeline->clips = BuildVector(to);
+        BuildTimelineIndex(timeline);
+        return;
+    }
+
+    while (timeline->clips.size() > to.Size())
+        PopTimelineClip(timeline);
+    for (size_t index : changed)
+    {
+        if (index < to.Size())
+            SetTimelineClip(timeline, (int)index, to.Get(index));
+    }
+}
+
+static bool ApplyProjectVersion(const ProjectVersion& from, const ProjectVersion& to, Project* project)
+{
+    snprintf(project->name, PROJECT_NAME_LENGTH, "%s", to.name);
+
+    UpdateChangedVector(from.tracks, to.tracks, &project->timeline.tracks);
+    UpdateChangedVector(from.regions, to.regions, &project->timeline.regions);
+    UpdateChangedVector(from.markers, to.markers, &project->timeline.markers);
+    UpdateChangedVector(from.assets, to.assets, &project->assets);
+    UpdateChangedVector(from.strips, to.strips, &project->strips);
+    ApplyProjectClips(from.clips, to.clips, &project->timeline);
+
+    project->tempoMap.sampleRate = to.sampleRate;
+    UpdateChangedVector(from.tempo, to.tempo, &project->tempoMap.segments);
+    UpdateChangedVector(from.meters, to.meters, &project->tempoMap.meters);
+    return true;
+}
+
+bool CanUndoProjectEdit(const ProjectHistory* history)
+{
+    return history->current > 0;
+}
+
+bool CanRedoProjectEdit(const ProjectHistory* history)
+{
+    return history->current + 1 < (int)history->versions.size();
+}
+
+bool UndoProjectEdit(ProjectHistory* history, Project* project)
+{
+    if (!CanUndoProjectEdit(history))
+        return false;
+
+    history->current--;
+    return ApplyProjectVersion(history->versions[history->current + 1], history->versions[history->current], project);
+}
+
+bool RedoProjectEdit(ProjectHistory* history, Project* project)
+{
+    if (!CanRedoProjectEdit(history))
+        return false;
+
+    history->current++;
+    return ApplyProjectVersion(history->versions[history->current - 1], history->versions[history->current], project);
+}
+
+ProjectVersion GetProjectSnapshot(const ProjectHistory* history)
+{
+    return history->versions[history->current];
+}
+
+bool BuildProjectFromVersion(const ProjectVersion& version, Project* project)
+{
+    snprintf(project->name, PROJECT_NAME_LENGTH, "%s", version.name);
+    project->timeline.tracks = BuildVector(version.tracks);
+    project->timeline.clips = BuildVector(version.clips);
+    project->timeline.regions = BuildVector(version.regions);
+    project->timeline.markers = BuildVector(version.markers);
+    project->tempoMap.sampleRate = version.sampleRate;
+    project->tempoMap.segments = BuildVector(version.tempo);
+    project->tempoMap.meters = BuildVector(version.meters);
+    project->assets = BuildVector(version.assets);
+    project->strips = BuildVector(version.strips);
+
+    return BuildTimelineIndex(&project->timeline);
+}
+
+unsigned long long GetProjectHistoryMemory(const ProjectHistory* history)
+{
+    /* versions form a chain, so summing what each adds to the one before it counts every node once */
+    unsigned long long memory = 0;
+    for (const ProjectVersion& version : history->versions)
+        memory += version.memory;
+
+    return memory - GetProjectVersionMemory(history->versions[history->current], NULL);
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include<vector>
+
+#include"Persistent.h"
+#include"Project.h"
+
+/*api.daw project history*/
+#define PROJECT_HISTORY_LABEL_LENGTH 64
+#define PROJECT_HISTORY_DEFAULT_MEMORY (256ull << 20)
+
+/* An immutable version of the document. Copying one is O(1) and shares every node. */
+struct ProjectVersion {
+    char name[PROJECT_NAME_LENGTH];
+    char label[PROJECT_HISTORY_LABEL_LENGTH];
+    unsigned long long serial;
+    double sampleRate;
+
+    PersistentVector<TimelineTrack> tracks;
+    PersistentVector<TimelineClip> clips;
+    PersistentVector<TimelineRegion> regions;
+    PersistentVector<TimelineMarker> markers;
+    PersistentVector<TempoSegment> tempo;
+    PersistentVector<TempoMeter> meters;
+    PersistentVector<ProjectAsset> assets;
+    PersistentVector<ProjectStrip> strips;
+
+    /* bytes of the nodes this version does not share with the one before it in its history */
+    unsigned long long memory;
+};
+
+/*
+    versions[current] matches the working Project; the ones before it are undo steps and the
+    ones after it redo steps. Each edit below changes the Project and records a version that
+    shares structure with the previous one; the oldest undo steps are dropped once the nodes
+    the other versions hold apart from the current one pass memoryCap.
+*/
+struct ProjectHistory {
+    std::vector<ProjectVersion> versions;
+    int current;
+    unsigned long long memoryCap;
+};
+
+bool ResetProjectHistory(ProjectHistory* history, const Project* project, unsigned long long memoryCap = PROJECT_HISTORY_DEFAULT_MEMORY);
+bool SetProjectHistoryMemoryCap(ProjectHistory* history, unsigned long long memoryCap);
+
+int AddProjectTrack(ProjectHistory* history, Project* project, const char* name);
+int AddProjectClip(ProjectHistory* history, Project* project, const TimelineClip& clip);
+bool MoveProjectClip(ProjectHistory* history, Project* project, int clip, long long start);
+bool RemoveProjectClip(ProjectHistory* history, Project* project, int clip);
+int AddProjectMarker(ProjectHistory* history, Project* project, long long position, const char* name);
+/* adds the paths not in the project yet as one undo step; returns how many were added */
+int ImportProjectAssets(ProjectHistory* history, Project* project, const char* const* paths, int count);
+bool SetProjectTempoMap(ProjectHistory* history, Project* project, const TempoMap& map, const char* label);
+/* the mixer's controls change the live mixer only; this records it as one undo step when it differs from the current version, and runs before every save */
+bool RecordProjectMixer(ProjectHistory* history, Project* project, Mixer* mixer);
+
+bool CanUndoProjectEdit(const ProjectHistory* history);
+bool CanRedoProjectEdit(const ProjectHistory* history);
+bool UndoProjectEdit(ProjectHistory* history, Project* project);
+bool RedoProjectEdit(ProjectHistory* history, Project* project);
+
+/* the current version, safe to hand to another thread */
+ProjectVersion GetProjectSnapshot(const ProjectHistory* history);
+bool BuildProjectFromVersion(const ProjectVersion& version, Project* project);
+/* bytes held by the undo and redo steps beyond what the current version holds; nodes an autosave snapshot keeps alive are not counted */
+unsigned long long GetProjectHistoryMemory(const ProjectHistory* history);
@@ -0,0 +1,755 @@
+#include"RealtimeSafety.h"
+#include"EngineThreads.h"
+#include"Log.h"
+
+#include<algorithm>
+#include<atomic>
+#include<chrono>
+#include<cstdio>
+#include<cstdlib>
+#include<cstring>
+#include<vector>
+
+/* interposing replaces these calls for the whole process, so glibc builds only do it in debug builds or when asked to */
+#if defined(__GLIBC__) && !defined(NDEBUG) && !defined(REALTIME_SAFETY_INTERPOSE)
+#define REALTIME_SAFETY_INTERPOSE
+#endif
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include<windows.h>
+#include<psapi.h>
+#include<dbghelp.h>
+#include<malloc.h>
+#elif defined(__GLIBC__) && defined(REALTIME_SAFETY_INTERPOSE)
+#include<dlfcn.h>
+#include<execinfo.h>
+#include<pthread.h>
+#include<semaphore.h>
+#include<time.h>
+#include<unistd.h>
+#endif
+
+using namespace std;
+
+/* the stack is captured a fixed number of frames below the hook, so these must stay real frames */
+#if defined(_MSC_VER)
+#define REALTIME_SAFETY_NOINLINE __declspec(noinline)
+#else
+#define REALTIME_SAFETY_NOINLINE __attribute__((noinline))
+#endif
+
+struct RealtimeViolationSlot {
+    atomic<bool> recorded;
+    atomic<unsigned long long> count;
+    unsigned long long site;
+    RealtimeViolation violation;
+};
+
+static RealtimeViolationSlot RealtimeViolationSlots[REALTIME_SAFETY_MAX_VIOLATIONS];
+static atomic<int> RealtimeViolationClaimed(0);
+static atomic<unsigned long long> RealtimeViolationTotal(0);
+static atomic<bool> RealtimeSafetyInstalled(false);
+
+static thread_local bool RealtimeThread = false;
+static thread_local bool RealtimeReporting = false;
+
+static int CaptureRealtimeStack(void** frames, int depth);
+static unsigned long long GetRealtimeThreadId();
+
+REALTIME_SAFETY_NOINLINE static void RecordRealtimeViolation(int kind, const char* call)
+{
+    RealtimeViolationTotal.fetch_add(1, memory_order_relaxed);
+
+    void* frames[REALTIME_SAFETY_STACK_DEPTH];
+    const int frameCount = CaptureRealtimeStack(frames, REALTIME_SAFETY_STACK_DEPTH);
+    unsigned long long site = HashEngineBytes(ENGINE_HASH_SEED, &kind, sizeof(kind));
+    site = HashEngineBytes(site, frames, sizeof(void*) * frameCount);
+
+    /* the same call from the same place is one violation, however many blocks it happens in */
+    const int claimed = RealtimeViolationClaimed.load(memory_order_acquire);
+    for (int v = 0; v < claimed && v < REALTIME_SAFETY_MAX_VIOLATIONS; v++)
+    {
+        RealtimeViolationSlot& slot = RealtimeViolationSlots[v];
+        if (slot.recorded.load(memory_order_acquire) && slot.site == site)
+        {
+
+            slot.count.fetch_add(1, memory_order_relaxed);
+            return;
+        }
+    }
+
+    const int index = RealtimeViolationClaimed.fetch_add(1, memory_order_acq_rel);
+    if (index >= REALTIME_SAFETY_MAX_VIOLATIONS)
+        return;
+
+    RealtimeViolationSlot& slot = RealtimeViolationSlots[index];
+    slot.site = site;
+    slot.violation.kind = kind;
+    slot.violation.call = call;
+    slot.violation.thread = GetRealtimeThreadId();
+    slot.violation.frameCount = frameCount;
+    memcpy(slot.violation.frames, frames, sizeof(void*) * frameCount);
+    slot.count.store(1, memory_order_relaxed);
+    slot.recorded.store(true, memory_order_release);
+}
+
+/* every interposed call passes through here before doing its work */
+REALTIME_SAFETY_NOINLINE static void CheckRealtimeCall(int kind, const char* call)
+{
+    if (!RealtimeThread || RealtimeReporting || !RealtimeSafetyInstalled.load(memory_order_relaxed))
+        return;
+
+    RealtimeReporting = true;
+    RecordRealtimeViolation(kind, call);
+    RealtimeReporting = false;
+}
+
+#if defined(_WIN32)
+
+REALTIME_SAFETY_NOINLINE static int CaptureRealtimeStack(void** frames, int depth)
+{
+    /* skips this function, RecordRealtimeViolation and CheckRealtimeCall; the hook stays as the first frame */
+    return (int)CaptureStackBackTrace(3, (DWORD)depth, frames, NULL);
+}
+
+static unsigned long long GetRealtimeThreadId()
+{
+    return GetCurrentThreadId();
+}
+
+typedef void* (__cdecl* RealtimeMalloc)(size_t size);
+typedef void* (__cdecl* RealtimeCalloc)(size_t count, size_t size);
+typedef void* (__cdecl* RealtimeRealloc)(void* pointer, size_t size);
+typedef void (__cdecl* RealtimeFree)(void* pointer);
+typedef void* (__cdecl* RealtimeAlignedMalloc)(size_t size, size_t alignment);
+typedef void (__cdecl* RealtimeAlignedFree)(void* pointer);
+typedef void (WINAPI* RealtimeAcquireSRWLock)(PSRWLOCK lock);
+typedef void (WINAPI* RealtimeEnterCriticalSection)(LPCRITICAL_SECTION section);
+typedef BOOL (WINAPI* RealtimeSleepConditionVariableSRW)(PCONDITION_VARIABLE condition, PSRWLOCK lock, DWORD milliseconds, ULONG flags);
+typedef DWORD (WINAPI* RealtimeWaitForSingleObject)(HANDLE handle, DWORD milliseconds);
+typedef DWORD (WINAPI* RealtimeWaitForSingleObjectEx)(HANDLE handle, DWORD milliseconds, BOOL alertable);
+typedef DWORD (WINAPI* RealtimeWaitForMultipleObjects)(DWORD count, const HANDLE* handles, BOOL waitAll, DWORD milliseconds);
+typedef void (WINAPI* RealtimeSleep)(DWORD milliseconds);
+typedef DWORD (WINAPI* RealtimeSleepEx)(DWORD milliseconds, BOOL alertable);
+typedef HANDLE (WINAPI* RealtimeCreateFileW)(LPCWSTR path, DWORD access, DWORD share, LPSECURITY_ATTRIBUTES security, DWORD disposition, DWORD flags, HANDLE templateFile);
+typedef BOOL (WINAPI* RealtimeReadFile)(HANDLE file, LPVOID buffer, DWORD size, LPDWORD read, LPOVERLAPPED overlapped);
+typedef BOOL (WINAPI* RealtimeWriteFile)(HANDLE file, LPCVOID buffer, DWORD size, LPDWORD written, LPOVERLAPPED overlapped);
+
+static RealtimeMalloc OriginalMalloc = NULL;
+static RealtimeCalloc OriginalCalloc = NULL;
+static RealtimeRealloc OriginalRealloc = NULL;
+static RealtimeFree OriginalFree = NULL;
+static RealtimeAlignedMalloc OriginalAlignedMalloc = NULL;
+static RealtimeAlignedFree OriginalAlignedFree = NULL;
+static RealtimeAcquireSRWLock OriginalAcquireSRWLockExclusive = NULL;
+static RealtimeAcquireSRWLock OriginalAcquireSRWLockShared = NULL;
+static RealtimeEnterCriticalSection OriginalEnterCriticalSection = NULL;
+static RealtimeSleepConditionVariableSRW OriginalSleepConditionVariableSRW = NULL;
+static RealtimeWaitForSingleObject OriginalWaitForSingleObject = NULL;
+static RealtimeWaitForSingleObjectEx OriginalWaitForSingleObjectEx = NULL;
+static RealtimeWaitForMultipleObjects OriginalWaitForMultipleObjects = NULL;
+static RealtimeSleep OriginalSleep = NULL;
+static RealtimeSleepEx OriginalSleepEx = NULL;
+static RealtimeCreateFileW OriginalCreateFileW = NULL;
+static RealtimeReadFile OriginalReadFile = NULL;
+static RealtimeWriteFile OriginalWriteFile = NULL;
+
+static void* __cdecl HookMalloc(size_t size)
+{
+    CheckRealtimeCall(REALTIME_VIOLATION_ALLOCATION, "malloc");
+    return OriginalMalloc(size);
+}
+
+static void* __cdecl HookCalloc(size_t count, size_t size)
+{
+    CheckRealtimeCall(REALTIME_VIOLATION_ALLOCATION, "calloc");
+    return OriginalCalloc(count, size);
+}
+
+static void* __cdecl HookRealloc(void* pointer, size_t size)
+{
+    CheckRealtimeCall(REALTIME_VIOLATION_ALLOCATION, "realloc");
+    return OriginalRealloc(pointer, size);
+}
+
+static void __cdecl HookFree(void* pointer)
+{
+    if (pointer != NULL)
+        CheckRealtimeCall(REALTIME_VIOLATION_ALLOCATION, "free");
+    OriginalFree(pointer);
+}
+
+static void* __cdecl HookAlignedMalloc(size_t size, size_t alignment)
+{
+    CheckRealtimeCall(REALTIME_VIOLATION_ALLOCATION, "_aligned_malloc");
+    return OriginalAlignedMalloc(size, alignment);
+}
+
+static void __cdecl HookAlignedFree(void* pointer)
+{
+    if (pointer != NULL)
+        CheckRealtimeCall(REALTIME_VIOLATION_ALLOCATION, "_aligned_free");
+    OriginalAlignedFree(pointer);
+}
+
+static void WINAPI HookAcquireSRWLockExclusive(PSRWLOCK lock)
+{
+    CheckRealtimeCall(REALTIME_VIOLATION_LOCK, "AcquireSRWLockExclusive");
+    OriginalAcquireSRWLockExclusive(lock);
+}
+
+static void WINAPI HookAcquireSRWLockShared(PSRWLOCK lock)
+{
+    CheckRealtimeCall(REALTIME_VIOLATION_LOCK, "AcquireSRWLockShared");
+    OriginalAcquireSRWLockShared(lock);
+}
+
+static void WINAPI HookEnterCriticalSection(LPCRITICAL_SECTION section)
+{
+    CheckRealtimeCall(REALTIME_VIOLATION_LOCK, "EnterCriticalSection");
+    OriginalEnterCriticalSection(section);
+}
+
+static BOOL WINAPI HookSleepConditionVariableSRW(PCONDITION_VARIABLE condition, PSRWLOCK lock, DWORD milliseconds, ULONG flags)
+{
+    CheckRealtimeCall(REALTIME_VIOLATION_LOCK, "SleepConditionVariableSRW");
+    return OriginalSleepConditionVariableSRW(condition, lock, milliseconds, flags);
+}
+
+/* a wait with a zero timeout is a poll and never blocks */
+static DWORD WINAPI HookWaitForSingleObject(HANDLE handle, DWORD milliseconds)
+{
+    if (milliseconds != 0)
+        CheckRealtimeCall(REALTIME_VIOLATION_SYSCALL, "WaitForSingleObject");
+    return OriginalWaitForSingleObject(handle, milliseconds);
+}
+
+static DWORD WINAPI HookWaitForSingleObjectEx(HANDLE handle, DWORD milliseconds, BOOL alertable)
+{
+    if (milliseconds != 0)
+        CheckRealtimeCall(REALTIME_VIOLATION_SYSCALL, "WaitForSingleObjectEx");
+    return OriginalWaitForSingleObjectEx(handle, milliseconds, alertable);
+}
+
+static DWORD WINAPI HookWaitForMultipleObjects(DWORD count, const HANDLE* handles, BOOL waitAll, DWORD milliseconds)
+{
+    if (milliseconds != 0)
+        CheckRealtimeCall(REALTIME_VIOLATION_SYSCALL, "WaitForMultipleObjects");
+    return OriginalWaitForMultipleObjects(count, handles, waitAll, milliseconds);
+}
+
+static void WINAPI HookSleep(DWORD milliseconds)
+{
+    CheckRealtimeCall(REALTIME_VIOLATION_SYSCALL, "Sleep");
+    OriginalSleep(milliseconds);
+}
+
+static DWORD WINAPI HookSleepEx(DWORD milliseconds, BOOL alertable)
+{
+    CheckRealtimeCall(REALTIME_VIOLATION_SYSCALL, "SleepEx");
+    return OriginalSleepEx(milliseconds, alertable);
+}
+
+static HANDLE WINAPI HookCreateFileW(LPCWSTR path, DWORD access, DWORD share, LPSECURITY_ATTRIBUTES security, DWORD disposition, DWORD flags, HANDLE templateFile)
+{
+    CheckRealtimeCall(REALTIME_VIOLATION_SYSCALL, "CreateFileW");
+    return OriginalCreateFileW(path, access, share, security, disposition, flags, templateFile);
+}
+
+static BOOL WINAPI HookReadFile(HANDLE file, LPVOID buffer, DWORD size, LPDWORD read, LPOVERLAPPED overlapped)
+{
+    CheckRealtimeCall(REALTIME_VIOLATION_SYSCALL, "ReadFile");
+    return OriginalReadFile(file, buffer, size, read, overlapped);
+}
+
+static BOOL WINAPI HookWriteFile(HANDLE file, LPCVOID buffer, DWORD size, LPDWORD written, LPOVERLAPPED overlapped)
+{
+    CheckRealtimeCall(REALTIME_VIOLATION_SYSCALL, "WriteFile");
+    return OriginalWriteFile(file, buffer, size, written, overlapped);
+}
+
+struct RealtimeSafetyHook {
+    const char* name;
+    void* replacement;
+    void** original;
+
+    /* heap functions must stay with the CRT they came from; kernel functions are the same wherever they resolve */
+    bool anyTarget;
+};
+
+static RealtimeSafetyHook RealtimeSafetyHooks[] = {
+    { "malloc", (void*)HookMalloc, (void**)&OriginalMalloc, false },
+    { "calloc", (void*)HookCalloc, (void**)&OriginalCalloc, false },
+    { "realloc", (void*)HookRealloc, (void**)&OriginalRealloc, false },
+    { "free", (void*)HookFree, (void**)&OriginalFree, false },
+    { "_aligned_malloc", (void*)HookAlignedMalloc, (void**)&OriginalAlignedMalloc, false },
+    { "_aligned_free", (void*)HookAlignedFree, (void**)&OriginalAlignedFree, false },
+    { "AcquireSRWLockExclusive", (void*)HookAcquireSRWLockExclusive, (void**)&OriginalAcquireSRWLockExclusive, true },
+    { "AcquireSRWLockShared", (void*)HookAcquireSRWLockShared, (void**)&OriginalAcquireSRWLockShared, true },
+    { "EnterCriticalSection", (void*)HookEnterCriticalSection, (void**)&OriginalEnterCriticalSection, true },
+    { "SleepConditionVariableSRW", (void*)HookSleepConditionVariableSRW, (void**)&OriginalSleepConditionVariableSRW, true },
+    { "WaitForSingleObject", (void*)HookWaitForSingleObject, (void**)&OriginalWaitForSingleObject, true },
+    { "WaitForSingleObjectEx", (void*)HookWaitForSingleObjectEx, (void**)&OriginalWaitForSingleObjectEx, true },
+    { "WaitForMultipleObjects", (void*)HookWaitForMultipleObjects, (void**)&OriginalWaitForMultipleObjects, true },
+    { "Sleep", (void*)HookSleep, (void**)&OriginalSleep, true },
+    { "SleepEx", (void*)HookSleepEx, (void**)&OriginalSleepEx, true },
+    { "CreateFileW", (void*)HookCreateFileW, (void**)&OriginalCreateFileW, true },
+    { "ReadFile", (void*)HookReadFile, (void**)&OriginalReadFile, true },
+    { "WriteFile", (void*)HookWriteFile, (void**)&OriginalWriteFile, true },
+};
+
+static void PatchRealtimeSafetySlot(void** slot, RealtimeSafetyHook* hook)
+{
+    if (*slot == hook->replacement)
+        return;
+    if (*hook->original == NULL)
+        *hook->original = *slot;
+    else if (*slot != *hook->original && !hook->anyTarget)
+        return;
+
+    DWORD protection = 0;
+    if (!VirtualProtect(slot, sizeof(void*), PAGE_READWRITE, &protection))
+        return;
+    InterlockedExchangePointer(slot, hook->replacement);
+    VirtualProtect(slot, sizeof(void*), protection, &protection);
+}
+
+static bool PatchRealtimeSafetyModule(HMODULE module)
+{
+    BYTE* base = (BYTE*)module;
+    const IMAGE_DOS_HEADER* dos = (const IMAGE_DOS_HEADER*)base;
+    if (dos->e_magic != IMAGE_DOS_SIGNATURE)
+        return false;
+    const IMAGE_NT_HEADERS* headers = (const IMAGE_NT_HEADERS*)(base + dos->e_lfanew);
+    if (headers->Signature != IMAGE_NT_SIGNATURE)
+        return false;
+
+    const IMAGE_DATA_DIRECTORY& directory = headers->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_IMPORT];
+    if (directory.VirtualAddress == 0)
+        return true;
+
+    for (const IMAGE_IMPORT_DESCRIPTOR* import = (const IMAGE_IMPORT_DESCRIPTOR*)(base + directory.VirtualAddress); import->Name != 0; import++)
+    {
+        /* without the name table the imports cannot be told apart */
+        if (import->OriginalFirstThunk == 0)
+            continue;
+
+        const IMAGE_THUNK_DATA* names = (const IMAGE_THUNK_DATA*)(base + import->OriginalFirstThunk);
+        IMAGE_THUNK_DATA* slots = (IMAGE_THUNK_DATA*)(base + import->FirstThunk);
+        for (; names->u1.AddressOfData != 0; names++, slots++)
+        {
+            if (IMAGE_SNAP_BY_ORDINAL(names->u1.Ordinal))
+                continue;
+
+            const IMAGE_IMPORT_BY_NAME* name = (const IMAGE_IMPORT_BY_NAME*)(base + names->u1.AddressOfData);
+            for (RealtimeSafetyHook& hook : RealtimeSafetyHooks)
+            {
+                if (strcmp((const char*)name->Name, hook.name) == 0)
+                {
+
+                    PatchRealtimeSafetySlot((void**)&slots->u1.Function, &hook);
+                    break;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+static bool InstallRealtimeSafetyHooks()
+{
+    HMODULE modules[1024];
+    DWORD needed = 0;
+    if (!EnumProcessModules(GetCurrentProcess(), modules, sizeof(modules), &needed))
+        return false;
+
+    const int moduleCount = (int)(min(needed, (DWORD)sizeof(modules)) / sizeof(HMODULE));
+    for (int m = 0; m < moduleCount; m++)
+        PatchRealtimeSafetyModule(modules[m]);
+
+    return OriginalMalloc != NULL && OriginalFree != NULL;
+}
+
+static bool DescribeRealtimeFrames(const RealtimeViolation* violation, char* text, size_t capacity, size_t length)
+{
+    static bool symbols = false;
+    if (!symbols)
+    {
+
+        SymSetOptions(SYMOPT_DEFERRED_LOADS | SYMOPT_LOAD_LINES | SYMOPT_UNDNAME);
+        symbols = SymInitialize(GetCurrentProcess(), NULL, TRUE) != FALSE;
+    }
+
+    for (int f = 0; f < violation->frameCount && length < capacity; f++)
+    {
+        const DWORD64 address = (DWORD64)violation->frames[f];
+        char storage[sizeof(SYMBOL_INFO) + MAX_SYM_NAME];
+        SYMBOL_INFO* symbol = (SYMBOL_INFO*)storage;
+        memset(symbol, 0, sizeof(SYMBOL_INFO));
+        symbol->SizeOfStruct = sizeof(SYMBOL_INFO);
+        symbol->MaxNameLen = MAX_SYM_NAME;
+
+        DWORD64 displacement = 0;
+        DWORD lineDisplacement = 0;
+        IMAGEHLP_LINE64 line;
+        memset(&line, 0, sizeof(line));
+        line.SizeOfStruct = sizeof(line);
+
+        int written = 0;
+        if (symbols && SymFromAddr(GetCurrentProcess(), address, &displacement, symbol))
+        {
+
+            if (SymGetLineFromAddr64(GetCurrentProcess(), address, &lineDisplacement, &line))
+                written = snprintf(text + length, capacity - length, "  #%d %s (%s:%lu)\n", f, symbol->Name, line.FileName, line.LineNumber);
+            else
+                written = snprintf(text + length, capacity - length, "  #%d %s+0x%llx\n", f, symbol->Name, (unsigned long long)displacement);
+        }
+        else {
+            char module[MAX_PATH] = "?";
+            HMODULE handle = NULL;
+            if (GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT, (LPCSTR)violation->frames[f], &handle))
+                GetModuleFileNameA(handle, module, MAX_PATH);
+            written = snprintf(text + length, capacity - length, "  #%d %s+0x%llx\n", f, module, (unsigned long long)(address - (DWORD64)handle));
+        }
+        if (written < 0)
+            return false;
+        length += (size_t)written;
+    }
+
+    return true;
+}
+
+#elif defined(__GLIBC__) && defined(REALTIME_SAFETY_INTERPOSE)
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* pointer, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void __libc_free(void* pointer);
+}
+
+REALTIME_SAFETY_NOINLINE static int CaptureRealtimeStack(void** frames, int depth)
+{
+    /* skips this function, RecordRealtimeViolation and CheckRealtimeCall */
+    void* captured[REALTIME_SAFETY_STACK_DEPTH + 3];
+    const int capturedCount = backtrace(captured, depth + 3);
+    const int frameCount = capturedCount > 3 ? capturedCount - 3 : 0;
+    memcpy(frames, captured + 3, sizeof(void*) * frameCount);
+    return frameCount;
+}
+
+static unsigned long long GetRealtimeThreadId()
+{
+    return (unsigned long long)pthread_self();
+}
+
+/* the allocator is replaced at link time; the rest resolve the next definition on first use */
+template<typename Function>
+static Function ResolveRealtimeOriginal(Function* original, const char* name)
+{
+    if (*original == NULL)
+        *original = (Function)dlsym(RTLD_NEXT, name);
+    return *original;
+}
+
+extern "C" void* malloc(size_t size)
+{
+    CheckRealtimeCall(REALTIME_VIOLATION_ALLOCATION, "malloc");
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size)
+{
+    CheckRealtimeCall(REALTIME_VIOLATION_ALLOCATION, "calloc");
+    return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* pointer, size_t size)
+{
+    CheckRealtimeCall(REALTIME_VIOLATION_ALLOCATION, "realloc");
+    return __libc_realloc(pointer, size);
+}
+
+extern "C" void free(void* pointer)
+{
+    if (pointer != NULL)
+        CheckRealtimeCall(REALTIME_VIOLATION_ALLOCATION, "free");
+    __libc_free(pointer);
+}
+
+extern "C" void* aligned_alloc(size_t alignment, size_t size)
+{
+    CheckRealtimeCall(REALTIME_VIOLATION_ALLOCATION, "aligned_alloc");
+    return __libc_memalign(alignment, size);
+}
+
+extern "C" int posix_memalign(void** pointer, size_t alignment, size_t size)
+{
+    CheckRealtimeCall(REALTIME_VIOLATION_ALLOCATION, "posix_memalign");
+    if (alignment < sizeof(void*) || (alignment & (alignment - 1)) != 0)
+        return 22;
+
+    *pointer = __libc_memalign(alignment, size);
+    return *pointer != NULL || size == 0 ? 0 : 12;
+}
+
+typedef int (*RealtimeMutexLock)(pthread_mutex_t* mutex);
+typedef int (*RealtimeSemaphoreWait)(sem_t* semaphore);
+typedef int (*RealtimeNanosleep)(const struct timespec* duration, struct timespec* remaining);
+typedef int (*RealtimeClockNanosleep)(clockid_t clock, int flags, const struct timespec* duration, struct timespec* remaining);
+typedef int (*RealtimeUsleep)(useconds_t microseconds);
+typedef ssize_t (*RealtimeRead)(int file, void* buffer, size_t size);
+typedef ssize_t (*RealtimeWrite)(int file, const void* buffer, size_t size);
+
+static RealtimeMutexLock OriginalMutexLock = NULL;
+static RealtimeSemaphoreWait OriginalSemaphoreWait = NULL;
+static RealtimeNanosleep OriginalNanosleep = NULL;
+static RealtimeClockNanosleep OriginalClockNanosleep = NULL;
+static RealtimeUsleep OriginalUsleep = NULL;
+static RealtimeRead OriginalRead = NULL;
+static RealtimeWrite OriginalWrite = NULL;
+
+extern "C" int pthread_mutex_lock(pthread_mutex_t* mutex)
+{
+    CheckRealtimeCall(REALTIME_VIOLATION_LOCK, "pthread_mutex_lock");
+    return ResolveRealtimeOriginal(&OriginalMutexLock, "pthread_mutex_lock")(mutex);
+}
+
+extern "C" int sem_wait(sem_t* semaphore)
+{
+    CheckRealtimeCall(REALTIME_VIOLATION_LOCK, "sem_wait");
+    return ResolveRealtimeOriginal(&OriginalSemaphoreWait, "sem_wait")(semaphore);
+}
+
+extern "C" int nanosleep(const struct timespec* duration, struct timespec* remaining)
+{
+    CheckRealtimeCall(REALTIME_VIOLATION_SYSCALL, "nanosleep");
+    return ResolveRealtimeOriginal(&OriginalNanosleep, "nanosleep")(duration, remaining);
+}
+
+extern "C" int clock_nanosleep(clockid_t clock, int flags, const struct timespec* duration, struct timespec* remaining)
+{
+    CheckRealtimeCall(REALTIME_VIOLATION_SYSCALL, "clock_nanosleep");
+    return ResolveRealtimeOriginal(&OriginalClockNanosleep, "clock_nanosleep")(clock, flags, duration, remaining);
+}
+
+extern "C" int usleep(useconds_t microseconds)
+{
+    CheckRealtimeCall(REALTIME_VIOLATION_SYSCALL, "usleep");
+    return ResolveRealtimeOriginal(&OriginalUsleep, "usleep")(microseconds);
+}
+
+extern "C" ssize_t read(int file, void* buffer, size_t size)
+{
+    CheckRealtimeCall(REALTIME_VIOLATION_SYSCALL, "read");
+    return ResolveRealtimeOriginal(&OriginalRead, "read")(file, buffer, size);
+}
+
+extern "C" ssize_t write(int file, const void* buffer, size_t size)
+{
+    CheckRealtimeCall(REALTIME_VIOLATION_SYSCALL, "write");
+    return ResolveRealtimeOriginal(&OriginalWrite, "write")(file, buffer, size);
+}
+
+static bool InstallRealtimeSafetyHooks()
+{
+    /* the first backtrace loads the unwinder, which allocates; it must not happen inside a hook */
+    void* frames[2];
+    backtrace(frames, 2);
+
+    ResolveRealtimeOriginal(&OriginalMutexLock, "pthread_mutex_lock");
+    ResolveRealtimeOriginal(&OriginalSemaphoreWait, "sem_wait");
+    ResolveRealtimeOriginal(&OriginalNanosleep, "nanosleep");
+    ResolveRealtimeOriginal(&OriginalClockNanosleep, "clock_nanosleep");
+    ResolveRealtimeOriginal(&OriginalUsleep, "usleep");
+    ResolveRealtimeOriginal(&OriginalRead, "read");
+    ResolveRealtimeOriginal(&OriginalWrite, "write");
+    return OriginalMutexLock != NULL && OriginalNanosleep != NULL;
+}
+
+static bool DescribeRealtimeFrames(const RealtimeViolation* violation, char* text, size_t capacity, size_t length)
+{
+    char** symbols = backtrace_symbols((void* const*)violation->frames, violation->frameCount);
+    for (int f = 0; f < violation->frameCount && length < capacity; f++)
+    {
+        const int written = symbols != NULL ?
+            snprintf(text + length, capacity - length, "  #%d %s\n", f, symbols[f]) :
+            snprintf(text + length, capacity - length, "  #%d %p\n", f, violation->frames[f]);
+        if (written < 0)
+            break;
+        length += (size_t)written;
+    }
+    free(symbols);
+
+    return true;
+}
+
+#else
+
+REALTIME_SAFETY_NOINLINE static int CaptureRealtimeStack(void** frames, int depth)
+{
+    (void)frames;
+    (void)depth;
+    return 0;
+}
+
+static unsigned long long GetRealtimeThreadId()
+{
+    return 0;
+}
+
+static bool InstallRealtimeSafetyHooks()
+{
+    return false;
+}
+
+static bool DescribeRealtimeFrames(const RealtimeViolation* violation, char* text, size_t capacity, size_t length)
+{
+    (void)violation;
+    (void)text;
+    (void)capacity;
+    (void)length;
+    return true;
+}
+
+#endif
+
+bool InstallRealtimeSafety()
+{
+    if (!InstallRealtimeSafetyHooks())
+    {
+
+        LogMessage(LOG_ERROR, "The real-time safety checks could not be installed.");
+        return false;
+    }
+
+    RealtimeSafetyInstalled.store(true);
+    return true;
+}
+
+bool IsRealtimeSafetyInstalled()
+{
+    return RealtimeSafetyInstalled.load();
+}
+
+bool SetRealtimeThread(bool realtime)
+{
+    const bool previous = RealtimeThread;
+    RealtimeThread = realtime;
+    return previous;
+}
+
+bool IsRealtimeThread()
+{
+    return RealtimeThread;
+}
+
+int GetRealtimeViolationCount()
+{
+    const int claimed = RealtimeViolationClaimed.load(memory_order_acquire);
+    return claimed < REALTIME_SAFETY_MAX_VIOLATIONS ? claimed : REALTIME_SAFETY_MAX_VIOLATIONS;
+}
+
+unsigned long long GetRealtimeViolationTotal()
+{
+    return RealtimeViolationTotal.load(memory_order_relaxed);
+}
+
+bool GetRealtimeViolation(int index, RealtimeViolation* violation)
+{
+    if (index < 0 || index >= GetRealtimeViolationCount())
+        return false;
+
+    const RealtimeViolationSlot& slot = RealtimeViolationSlots[index];
+    if (!slot.recorded.load(memory_order_acquire))
+        return false;
+
+    *violation = slot.violation;
+    violation->count = slot.count.load(memory_order_relaxed);
+    return true;
+}
+
+/* a marked thread racing the clear may keep or lose the one violation it was recording */
+void ClearRealtimeViolations()
+{
+    for (RealtimeViolationSlot& slot : RealtimeViolationSlots)
+        slot.recorded.store(false, memory_order_relaxed);
+    RealtimeViolationClaimed.store(0, memory_order_release);
+    RealtimeViolationTotal.store(0, memory_order_relaxed);
+}
+
+bool DescribeRealtimeViolation(const RealtimeViolation* violation, char* text, size_t capacity)
+{
+    static const char* kinds[] = { "allocation", "lock", "blocking call" };
+    const int written = snprintf(
+        text, capacity, "%s %s on thread %llu, %llu times\n", kinds[violation->kind], violation->call, violation->thread, violation->count
+    );
+    if (written < 0 || (size_t)written >= capacity)
+        return false;
+
+    return DescribeRealtimeFrames(violation, text, capacity, (size_t)written);
+}
+
+struct RealtimeSafetyCheck {
+    Engine* engine;
+    long long frameCount;
+    float** channels;
+    RealtimeSafetyReport* report;
+};
+
+static void RunRealtimeSafetyCheck(RealtimeSafetyCheck* check)
+{
+    Engine* engine = check->engine;
+    RealtimeSafetyReport* report = check->report;
+
+    /* a checker that misses a deliberate allocation would pass anything */
+    ClearRealtimeViolations();
+    SetRealtimeThread(true);
+    void* volatile canary = malloc(16);
+    free(canary);
+    SetRealtimeThread(false);
+    report->checkerActive = GetRealtimeViolationTotal() > 0;
+    ClearRealtimeViolations();
+
+    const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    SetRealtimeThread(true);
+    long long position = 0;
+    while (position < check->frameCount)
+    {
+        const int frameCount = (int)min((long long)engine->blockSize, check->frameCount - position);
+        ProcessEngineBlock(engine, check->channels, frameCount);
+        position += frameCount;
+    }
+    SetRealtimeThread(false);
+
+    report->renderMilliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    report->renderedFrames = position;
+    report->violationCount = GetRealtimeViolationCount();
+    report->violationTotal = GetRealtimeViolationTotal();
+    report->passed = report->checkerActive && report->violationTotal == 0;
+}
+
+bool CheckEngineRealtimeSafety(Engine* engine, long long frameCount, RealtimeSafetyReport* report)
+{
+    memset(report, 0, sizeof(RealtimeSafetyReport));
+    if (!IsRealtimeSafetyInstalled())
+        return false;
+
+    vector<float> storage((size_t)engine->blockSize * engine->channelCount);
+    float* channels[ENGINE_MAX_CHANNELS];
+    for (int c = 0; c < engine->channelCount; c++)
+        channels[c] = storage.data() + (size_t)c * engine->blockSize;
+
+    RealtimeSafetyCheck check;
+    check.engine = engine;
+    check.frameCount = frameCount;
+    check.channels = channels;
+    check.report = report;
+
+    thread render = CreateEngineThread(RunRealtimeSafetyCheck, &check);
+    render.join();
+    return report->passed;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include<cstddef>
+
+#include"Engine.h"
+
+/*api.daw realtime safety*/
+#define REALTIME_SAFETY_MAX_VIOLATIONS 256
+#define REALTIME_SAFETY_STACK_DEPTH 32
+#define REALTIME_SAFETY_DESCRIPTION_LENGTH 4096
+#define REALTIME_SAFETY_TEST_ARGUMENT "--realtime-test"
+#define REALTIME_SAFETY_ARGUMENT "--realtime-safety"
+#define REALTIME_SAFETY_TEST_SECONDS 60
+
+#define REALTIME_VIOLATION_ALLOCATION 0
+#define REALTIME_VIOLATION_LOCK 1
+#define REALTIME_VIOLATION_SYSCALL 2
+
+/*
+    Debug checks for code that runs on a real-time thread. Once installed, allocation
+    (malloc, new and free), blocking lock acquisition and blocking calls such as sleeps,
+    waits and file I/O are interposed; when one happens on a thread marked real-time the
+    call still goes through, but its stack is recorded as a violation. Calls with the same
+    stack are counted against one violation rather than filling the table.
+
+    Windows patches the import tables of every module loaded at install time, so install
+    again after loading plugin libraries. glibc builds interpose the symbols at link time,
+    and only when NDEBUG is not defined or REALTIME_SAFETY_INTERPOSE is; elsewhere
+    installing fails and nothing is checked.
+*/
+struct RealtimeViolation {
+    int kind;
+    const char* call;
+    unsigned long long thread;
+    unsigned long long count;
+    int frameCount;
+    void* frames[REALTIME_SAFETY_STACK_DEPTH];
+};
+
+bool InstallRealtimeSafety();
+bool IsRealtimeSafetyInstalled();
+
+/* marks or unmarks the calling thread; returns the previous mark so a section can step out and back */
+bool SetRealtimeThread(bool realtime);
+bool IsRealtimeThread();
+
+int GetRealtimeViolationCount();
+unsigned long long GetRealtimeViolationTotal();
+bool GetRealtimeViolation(int index, RealtimeViolation* violation);
+void ClearRealtimeViolations();
+
+/* the kind, call and symbolized stack as text; UI thread only */
+bool DescribeRealtimeViolation(const RealtimeViolation* violation, char* text, size_t capacity);
+
+struct RealtimeSafetyReport {
+    long long renderedFrames;
+    double renderMilliseconds;
+    bool checkerActive;
+    int violationCount;
+    unsigned long long violationTotal;
+    bool passed;
+};
+
+/* renders frameCount frames of the engine on a marked engine thread; nothing else may be processing the engine. Passes when the checks are live and nothing was recorded */
+bool CheckEngineRealtimeSafety(Engine* engine, long long frameCount, RealtimeSafetyReport* report);
@@ -0,0 +1,86 @@
+#include"Resample.h"
+
+#include<algorithm>
+#include<cmath>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+using namespace std;
+
+#define RESAMPLE_TABLE_SIZE (RESAMPLE_ZERO_CROSSINGS * RESAMPLE_PHASES + 2)
+
+/* entry i weighs a tap i / RESAMPLE_PHASES zero crossings from the read point; the last two stay zero */
+static float ResampleTable[RESAMPLE_TABLE_SIZE];
+
+static bool ComputeResampleTable()
+{
+    const int width = RESAMPLE_ZERO_CROSSINGS * RESAMPLE_PHASES;
+    for (int i = 0; i < width; i++)
+    {
+        const double t = (double)i / RESAMPLE_PHASES;
+        const double sinc = i == 0 ? 1.0 : sin(M_PI * t) / (M_PI * t);
+        const double w = M_PI * (1.0 + (double)i / width);
+        ResampleTable[i] = (float)(sinc * (0.42 - 0.5 * cos(w) + 0.08 * cos(2.0 * w)));
+    }
+
+    return true;
+}
+
+static const bool ResampleTableComputed = ComputeResampleTable();
+
+long long GetResampledFrames(long long frames, int sourceRate, int destinationRate)
+{
+    if (sourceRate <= 0 || destinationRate <= 0)
+        return max(1LL, frames);
+
+    return max(1LL, (long long)((double)frames * destinationRate / sourceRate));
+}
+
+bool ResampleChannel(const float* source, long long sourceFrames, int stride, int sourceRate, float* destination, long long destinationFrames, int destinationRate)
+{
+    return ResampleChannelFrames(source, sourceFrames, stride, sourceRate, destination, 0, destinationFrames, destinationRate);
+}
+
+bool ResampleChannelFrames(const float* source, long long sourceFrames, int stride, int sourceRate, float* destination, long long first, long long count, int destinationRate)
+{
+    if (sourceFrames <= 0 || sourceRate <= 0 || destinationRate <= 0)
+        return false;
+
+    const long long end = first + count;
+    if (sourceRate == destinationRate)
+    {
+
+        for (long long n = first; n < end; n++)
+            destination[n] = n < sourceFrames ? source[n * stride] : 0.0f;
+        return true;
+    }
+
+    /* the kernel widens by the ratio when downsampling, so its cutoff follows the destination's Nyquist */
+    const double ratio = (double)sourceRate / destinationRate;
+    const double cutoff = RESAMPLE_CUTOFF * min(1.0, 1.0 / ratio);
+    const double halfWidth = RESAMPLE_ZERO_CROSSINGS / cutoff;
+    const double step = cutoff * RESAMPLE_PHASES;
+    for (long long n = first; n < end; n++)
+    {
+        const double position = n * ratio;
+        const long long lowest = max(0LL, (long long)floor(position - halfWidth) + 1);
+        const long long highest = min(sourceFrames - 1, (long long)floor(position + halfWidth));
+
+        /* normalized by the weights actually used, so the gain stays unity at the ends of the file too */
+        double sum = 0.0;
+        double weights = 0.0;
+        for (long long k = lowest; k <= highest; k++)
+        {
+            const double x = fabs(position - k) * step;
+            const int i = min((int)x, RESAMPLE_TABLE_SIZE - 2);
+            const double weight = ResampleTable[i] + (ResampleTable[i + 1] - ResampleTable[i]) * (x - i);
+            sum += weight * source[k * stride];
+            weights += weight;
+        }
+        destination[n] = weights > 0.0 ? (float)(sum / weights) : 0.0f;
+    }
+
+    return true;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+/*api.daw resample*/
+#define RESAMPLE_ZERO_CROSSINGS 16
+#define RESAMPLE_PHASES 512
+#define RESAMPLE_CUTOFF 0.95
+
+/*
+    Offline sample rate conversion for whole files, as audio is loaded. Every output frame
+    is a Blackman windowed sinc over RESAMPLE_ZERO_CROSSINGS zero crossings on each side,
+    read from a table of RESAMPLE_PHASES steps per crossing. The cutoff sits just below the
+    lower of the two Nyquist frequencies, so when downsampling the content the destination
+    cannot hold is filtered out instead of folding back as aliases.
+*/
+
+/* the length of frames source frames at the destination rate, at least one frame */
+long long GetResampledFrames(long long frames, int sourceRate, int destinationRate);
+
+/* source holds sourceFrames frames stepped by stride floats, so one channel of interleaved audio is read in place; destination receives destinationFrames */
+bool ResampleChannel(const float* source, long long sourceFrames, int stride, int sourceRate, float* destination, long long destinationFrames, int destinationRate);
+
+/* the same, but writes only destination[first] to destination[first + count - 1], so a long file can be resampled in blocks */
+bool ResampleChannelFrames(const float* source, long long sourceFrames, int stride, int sourceRate, float* destination, long long first, long long count, int destinationRate);
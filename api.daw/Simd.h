@@ -0,0 +1,37 @@
+#pragma once
+
+/*api.daw simd*/
+#if defined(_MSC_VER)
+#include<intrin.h>
+#define DAW_TARGET_AVX2
+#else
+#include<cpuid.h>
+#define DAW_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif
+
+#include<immintrin.h>
+
+/* AVX2 code is compiled for every build and only selected when the processor and OS support it. */
+inline bool DetectAVX2()
+{
+#if defined(_MSC_VER)
+    int information[4];
+    __cpuid(information, 1);
+    const bool osxsave = (information[2] & (1 << 27)) != 0;
+    const bool fma = (information[2] & (1 << 12)) != 0;
+    if (!osxsave || !fma || (_xgetbv(0) & 6) != 6)
+        return false;
+
+    __cpuidex(information, 7, 0);
+    return (information[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+}
+
+inline bool HasAVX2()
+{
+    static const bool supported = DetectAVX2();
+    return supported;
+}
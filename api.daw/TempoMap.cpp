@@ -0,0 +1,241 @@
+#include"TempoMap.h"
+
+#include<algorithm>
+#include<cmath>
+
+using namespace std;
+
+#define TEMPO_FLAT_SLOPE 1e-12
+
+static double GetSamplesPerMinute(const TempoMap* map)
+{
+    return 60.0 * map->sampleRate;
+}
+
+/* samples from the start of the segment to beat; a ramp integrates 60 / (bpm + slope * x) */
+static double GetSegmentSamples(const TempoMap* map, const TempoSegment& segment, double beat)
+{
+    const double beats = beat - segment.beat;
+    if (fabs(segment.slope) < TEMPO_FLAT_SLOPE)
+        return beats * GetSamplesPerMinute(map) / segment.beatsPerMinute;
+
+    return GetSamplesPerMinute(map) / segment.slope * log1p(segment.slope * beats / segment.beatsPerMinute);
+}
+
+static double GetSegmentBeats(const TempoMap* map, const TempoSegment& segment, double sample)
+{
+    const double samples = sample - segment.sample;
+    if (fabs(segment.slope) < TEMPO_FLAT_SLOPE)
+        return samples * segment.beatsPerMinute / GetSamplesPerMinute(map);
+
+    return segment.beatsPerMinute * expm1(segment.slope * samples / GetSamplesPerMinute(map)) / segment.slope;
+}
+
+static void UpdateTempoPositions(TempoMap* map)
+{
+    vector<TempoSegment>& segments = map->segments;
+    segments[0].sample = 0.0;
+    for (size_t s = 0; s < segments.size(); s++)
+    {
+        TempoSegment& segment = segments[s];
+        const bool last = s + 1 == segments.size();
+
+        /* the last segment has nothing to ramp towards and stays constant */
+        segment.slope = segment.ramp && !last ? (segments[s + 1].beatsPerMinute - segment.beatsPerMinute) / (segments[s + 1].beat - segment.beat) : 0.0;
+        if (!last)
+            segments[s + 1].sample = segment.sample + GetSegmentSamples(map, segment, segments[s + 1].beat);
+    }
+}
+
+bool InitializeTempoMap(TempoMap* map, double sampleRate, double beatsPerMinute)
+{
+    if (sampleRate <= 0.0 || beatsPerMinute <= 0.0)
+        return false;
+
+    TempoSegment segment;
+    segment.beat = 0.0;
+    segment.sample = 0.0;
+    segment.beatsPerMinute = beatsPerMinute;
+    segment.slope = 0.0;
+    segment.ramp = false;
+
+    TempoMeter meter;
+    meter.bar = 0;
+    meter.beat = 0.0;
+    meter.numerator = TEMPO_DEFAULT_NUMERATOR;
+    meter.denominator = TEMPO_DEFAULT_DENOMINATOR;
+
+    map->sampleRate = sampleRate;
+    map->segments.assign(1, segment);
+    map->meters.assign(1, meter);
+    return true;
+}
+
+bool SetTempoChange(TempoMap* map, double beat, double beatsPerMinute, bool ramp)
+{
+    if (beat < 0.0 || beatsPerMinute <= 0.0 || map->segments.empty())
+        return false;
+
+    vector<TempoSegment>& segments = map->segments;
+    vector<TempoSegment>::iterator place = lower_bound(
+        segments.begin(), segments.end(), beat,
+        [](const TempoSegment& segment, double value) { return segment.beat < value; }
+    );
+
+    if (place != segments.end() && place->beat == beat)
+    {
+
+        place->beatsPerMinute = beatsPerMinute;
+        place->ramp = ramp;
+    }
+    else {
+        TempoSegment segment;
+        segment.beat = beat;
+        segment.sample = 0.0;
+        segment.beatsPerMinute = beatsPerMinute;
+        segment.slope = 0.0;
+        segment.ramp = ramp;
+        segments.insert(place, segment);
+    }
+
+    UpdateTempoPositions(map);
+    return true;
+}
+
+static double GetMeterBarLength(const TempoMeter& meter)
+{
+    return meter.numerator * 4.0 / meter.denominator;
+}
+
+bool SetMeterChange(TempoMap* map, int bar, int numerator, int denominator)
+{
+    if (bar < 0 || numerator <= 0 || denominator <= 0 || map->meters.empty())
+        return false;
+
+    vector<TempoMeter>& meters = map->meters;
+    vector<TempoMeter>::iterator place = lower_bound(
+        meters.begin(), meters.end(), bar,
+        [](const TempoMeter& meter, int value) { return meter.bar < value; }
+    );
+
+    if (place != meters.end() && place->bar == bar)
+    {
+
+        place->numerator = numerator;
+        place->denominator = denominator;
+    }
+    else {
+        TempoMeter meter;
+        meter.bar = bar;
+        meter.beat = 0.0;
+        meter.numerator = numerator;
+        meter.denominator = denominator;
+        meters.insert(place, meter);
+    }
+
+    for (size_t m = 1; m < meters.size(); m++)
+        meters[m].beat = meters[m - 1].beat + (meters[m].bar - meters[m - 1].bar) * GetMeterBarLength(meters[m - 1]);
+
+    return true;
+}
+
+static size_t FindTempoSegmentByBeat(const TempoMap* map, double beat)
+{
+    const vector<TempoSegment>& segments = map->segments;
+    return upper_bound(
+        segments.begin() + 1, segments.end(), beat,
+        [](double value, const TempoSegment& segment) { return value < segment.beat; }
+    ) - segments.begin() - 1;
+}
+
+static size_t FindTempoSegmentBySample(const TempoMap* map, double sample)
+{
+    const vector<TempoSegment>& segments = map->segments;
+    return upper_bound(
+        segments.begin() + 1, segments.end(), sample,
+        [](double value, const TempoSegment& segment) { return value < segment.sample; }
+    ) - segments.begin() - 1;
+}
+
+double BeatToSample(const TempoMap* map, double beat)
+{
+    const TempoSegment& segment = map->segments[FindTempoSegmentByBeat(map, beat)];
+    return segment.sample + GetSegmentSamples(map, segment, beat);
+}
+
+double SampleToBeat(const TempoMap* map, double sample)
+{
+    const TempoSegment& segment = map->segments[FindTempoSegmentBySample(map, sample)];
+    return segment.beat + GetSegmentBeats(map, segment, sample);
+}
+
+double GetTempoAtBeat(const TempoMap* map, double beat)
+{
+    const TempoSegment& segment = map->segments[FindTempoSegmentByBeat(map, beat)];
+    return segment.beatsPerMinute + segment.slope * max(beat - segment.beat, 0.0);
+}
+
+bool BeatToBar(const TempoMap* map, double beat, int* bar, double* beatInBar)
+{
+    const vector<TempoMeter>& meters = map->meters;
+    if (meters.empty())
+        return false;
+
+    const TempoMeter& meter = *(upper_bound(
+        meters.begin() + 1, meters.end(), beat,
+        [](double value, const TempoMeter& other) { return value < other.beat; }
+    ) - 1);
+
+    const double length = GetMeterBarLength(meter);
+    const int bars = (int)floor((beat - meter.beat) / length);
+    *bar = meter.bar + bars;
+    *beatInBar = (beat - meter.beat - bars * length) * meter.denominator / 4.0;
+    return true;
+}
+
+double BarToBeat(const TempoMap* map, int bar, double beatInBar)
+{
+    const vector<TempoMeter>& meters = map->meters;
+    const TempoMeter& meter = *(upper_bound(
+        meters.begin() + 1, meters.end(), bar,
+        [](int value, const TempoMeter& other) { return value < other.bar; }
+    ) - 1);
+
+    return meter.beat + (bar - meter.bar) * GetMeterBarLength(meter) + beatInBar * 4.0 / meter.denominator;
+}
+
+bool InitializeTempoCursor(TempoCursor* cursor, const TempoMap* map)
+{
+    cursor->map = map;
+    cursor->segment = 0;
+    return map != NULL && !map->segments.empty();
+}
+
+double CursorBeatToSample(TempoCursor* cursor, double beat)
+{
+    const vector<TempoSegment>& segments = cursor->map->segments;
+    size_t segment = cursor->segment;
+
+    /* stay in the segment or step into the next one; anything else is a jump */
+    if (segment + 1 < segments.size() && beat >= segments[segment + 1].beat)
+        segment++;
+    if (beat < segments[segment].beat || (segment + 1 < segments.size() && beat >= segments[segment + 1].beat))
+        segment = FindTempoSegmentByBeat(cursor->map, beat);
+
+    cursor->segment = segment;
+    return segments[segment].sample + GetSegmentSamples(cursor->map, segments[segment], beat);
+}
+
+double CursorSampleToBeat(TempoCursor* cursor, double sample)
+{
+    const vector<TempoSegment>& segments = cursor->map->segments;
+    size_t segment = cursor->segment;
+
+    if (segment + 1 < segments.size() && sample >= segments[segment + 1].sample)
+        segment++;
+    if (sample < segments[segment].sample || (segment + 1 < segments.size() && sample >= segments[segment + 1].sample))
+        segment = FindTempoSegmentBySample(cursor->map, sample);
+
+    cursor->segment = segment;
+    return segments[segment].beat + GetSegmentBeats(cursor->map, segments[segment], sample);
+}
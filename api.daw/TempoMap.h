@@ -0,0 +1,58 @@
+#pragma once
+
+#include<cstddef>
+#include<vector>
+
+/*api.daw tempo map*/
+#define TEMPO_DEFAULT_BPM 120.0
+#define TEMPO_DEFAULT_NUMERATOR 4
+#define TEMPO_DEFAULT_DENOMINATOR 4
+
+/*
+    A tempo segment runs from its beat until the next one; sample holds the cumulative
+    position at its start so conversions are a binary search plus closed-form math.
+    A ramp changes tempo linearly per beat until the next segment's tempo.
+*/
+struct TempoSegment {
+    double beat;
+    double sample;
+    double beatsPerMinute;
+    double slope;
+    bool ramp;
+};
+
+/* Meters change on bar lines; beat holds the cumulative quarter-note position of the bar. */
+struct TempoMeter {
+    int bar;
+    double beat;
+    int numerator;
+    int denominator;
+};
+
+struct TempoMap {
+    double sampleRate;
+    std::vector<TempoSegment> segments;
+    std::vector<TempoMeter> meters;
+};
+
+/* Remembers the last segment so sequential lookups within a block stay O(1). */
+struct TempoCursor {
+    const TempoMap* map;
+    size_t segment;
+};
+
+bool InitializeTempoMap(TempoMap* map, double sampleRate, double beatsPerMinute = TEMPO_DEFAULT_BPM);
+bool SetTempoChange(TempoMap* map, double beat, double beatsPerMinute, bool ramp = false);
+bool SetMeterChange(TempoMap* map, int bar, int numerator, int denominator);
+
+double BeatToSample(const TempoMap* map, double beat);
+double SampleToBeat(const TempoMap* map, double sample);
+double GetTempoAtBeat(const TempoMap* map, double beat);
+
+/* bar counts from zero; beatInBar is in units of the meter's denominator */
+bool BeatToBar(const TempoMap* map, double beat, int* bar, double* beatInBar);
+double BarToBeat(const TempoMap* map, int bar, double beatInBar);
+
+bool InitializeTempoCursor(TempoCursor* cursor, const TempoMap* map);
+double CursorBeatToSample(TempoCursor* cursor, double beat);
+double CursorSampleToBeat(TempoCursor* cursor, double sample);
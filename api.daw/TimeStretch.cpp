@@ -0,0 +1,1021 @@
+#include"TimeStretch.h"
+#include"EngineThreads.h"
+#include"Trace.h"
+#include"Log.h"
+
+#include"sndfile.h"
+
+#include<algorithm>
+#include<cmath>
+#include<cstdio>
+#include<cstring>
+#include<thread>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+using namespace std;
+
+static double WrapPhase(double phase)
+{
+    return phase - 2.0 * M_PI * floor(phase / (2.0 * M_PI) + 0.5);
+}
+
+bool InitializeTimeStretch(TimeStretch* stretch, int mode, int channelCount)
+{
+    if ((mode != TIME_STRETCH_VOCODER && mode != TIME_STRETCH_WSOLA) || channelCount <= 0 || channelCount > ENGINE_MAX_CHANNELS)
+        return false;
+
+    const bool vocoder = mode == TIME_STRETCH_VOCODER;
+    stretch->mode = mode;
+    stretch->channelCount = channelCount;
+    stretch->frameSize = vocoder ? TIME_STRETCH_VOCODER_FRAMES : TIME_STRETCH_WSOLA_FRAMES;
+    stretch->hop = vocoder ? TIME_STRETCH_VOCODER_HOP : TIME_STRETCH_WSOLA_HOP;
+    stretch->search = vocoder ? 0 : TIME_STRETCH_WSOLA_SEARCH;
+    stretch->ratio = 1.0;
+    stretch->pitch = 1.0;
+    stretch->holdTransients = false;
+    if (vocoder && !InitializeFft(&stretch->fft, stretch->frameSize))
+        return false;
+
+    /* periodic Hann windows; overlap-added every hop they sum to a constant, windowed twice by the vocoder and once by WSOLA */
+    const int frameSize = stretch->frameSize;
+    const int bins = vocoder ? frameSize / 2 + 1 : 0;
+    stretch->window.resize(frameSize);
+    double sum = 0.0;
+    for (int n = 0; n < frameSize; n++)
+    {
+        const double window = 0.5 - 0.5 * cos(2.0 * M_PI * n / frameSize);
+        stretch->window[n] = (float)window;
+        sum += vocoder ? window * window : window;
+    }
+    stretch->normalization = (float)(stretch->hop / sum);
+
+    stretch->frame.assign(frameSize, 0.0f);
+    stretch->real.assign(bins, 0.0f);
+    stretch->imaginary.assign(bins, 0.0f);
+    stretch->peaks.assign(bins, 0);
+    stretch->mono.assign(vocoder ? 0 : TIME_STRETCH_FIFO_FRAMES, 0.0f);
+    for (int c = 0; c < channelCount; c++)
+    {
+        TimeStretchChannel* channel = &stretch->channels[c];
+        channel->input.assign(TIME_STRETCH_FIFO_FRAMES, 0.0f);
+        channel->stretched.assign(TIME_STRETCH_FIFO_FRAMES, 0.0f);
+        channel->output.assign(TIME_STRETCH_FIFO_FRAMES, 0.0f);
+        channel->accumulator.assign(frameSize, 0.0f);
+        channel->magnitudes.assign(bins, 0.0f);
+        channel->previousMagnitudes.assign(bins, 0.0f);
+        channel->phases.assign(bins, 0.0f);
+        channel->previousPhases.assign(bins, 0.0f);
+        channel->synthesisPhases.assign(bins, 0.0f);
+    }
+
+    return BeginTimeStretch(stretch, 0);
+}
+
+bool SetTimeStretchRatio(TimeStretch* stretch, double ratio, double semitones)
+{
+    stretch->ratio = min(max(ratio, TIME_STRETCH_MIN_RATIO), TIME_STRETCH_MAX_RATIO);
+    stretch->pitch = pow(2.0, min(max(semitones, -TIME_STRETCH_MAX_SEMITONES), TIME_STRETCH_MAX_SEMITONES) / 12.0);
+    return true;
+}
+
+bool BeginTimeStretch(TimeStretch* stretch, long long stretchedStart)
+{
+    if (stretchedStart < 0 || stretchedStart % stretch->hop != 0)
+        return false;
+
+    /* the first frame ends a hop past the start, so the stretched audio is fully overlapped from its first frame on */
+    const long long first = stretchedStart - (stretch->frameSize - stretch->hop);
+    stretch->analysisPosition = first / (stretch->ratio * stretch->pitch);
+    stretch->inputStart = (long long)floor(stretch->analysisPosition) - stretch->search - 1;
+    stretch->inputCount = 0;
+    stretch->idealPosition = stretch->analysisPosition;
+    stretch->transientFrames = 0;
+    stretch->previousAnalysis = 0;
+    stretch->started = false;
+    stretch->fluxAverage = 0.0f;
+    stretch->accumulatorPosition = first;
+    stretch->stretchedFirst = stretchedStart;
+
+    /* the stretched FIFO opens with the frame before stretchedStart, which the cubic reads around the first output */
+    stretch->stretchedCount = 1;
+    stretch->outputPosition = (long long)ceil(stretchedStart / stretch->pitch);
+    stretch->resamplePosition = stretch->outputPosition * stretch->pitch - (stretchedStart - 1);
+    stretch->outputCount = 0;
+    for (int c = 0; c < stretch->channelCount; c++)
+    {
+        TimeStretchChannel* channel = &stretch->channels[c];
+        channel->stretched[0] = 0.0f;
+        fill(channel->accumulator.begin(), channel->accumulator.end(), 0.0f);
+        fill(channel->magnitudes.begin(), channel->magnitudes.end(), 0.0f);
+        fill(channel->previousMagnitudes.begin(), channel->previousMagnitudes.end(), 0.0f);
+    }
+
+    return true;
+}
+
+long long GetTimeStretchInputPosition(const TimeStretch* stretch)
+{
+    return stretch->inputStart + stretch->inputCount;
+}
+
+long long GetTimeStretchOutputPosition(const TimeStretch* stretch)
+{
+    return stretch->outputPosition;
+}
+
+int GetTimeStretchLatency(int mode)
+{
+    if (mode == TIME_STRETCH_WSOLA)
+        return TIME_STRETCH_WSOLA_FRAMES + TIME_STRETCH_WSOLA_SEARCH + TIME_STRETCH_WSOLA_HOP / 4;
+
+    return TIME_STRETCH_VOCODER_FRAMES + TIME_STRETCH_VOCODER_HOP / 4;
+}
+
+/* identity phase locking: peaks advance at the frequency measured across the analysis hop, and the bins around a peak keep their phase offsets from it */
+static void LockVocoderPhases(TimeStretch* stretch, TimeStretchChannel* channel, int analysisHop)
+{
+    const int bins = stretch->frameSize / 2 + 1;
+    const float* magnitudes = channel->magnitudes.data();
+    const float* phases = channel->phases.data();
+    const float* previousPhases = channel->previousPhases.data();
+    float* synthesisPhases = channel->synthesisPhases.data();
+    int* peaks = stretch->peaks.data();
+
+    int peakCount = 0;
+    for (int k = 0; k < bins; k++)
+    {
+        const float magnitude = magnitudes[k];
+        if (magnitude <= 0.0f)
+            continue;
+        if ((k >= 1 && magnitude <= magnitudes[k - 1]) || (k >= 2 && magnitude <= magnitudes[k - 2]))
+            continue;
+        if ((k + 1 < bins && magnitude < magnitudes[k + 1]) || (k + 2 < bins && magnitude < magnitudes[k + 2]))
+            continue;
+        peaks[peakCount++] = k;
+    }
+    if (peakCount == 0)
+    {
+
+        memcpy(synthesisPhases, phases, bins * sizeof(float));
+        return;
+    }
+
+    const double advance = (double)stretch->hop / analysisHop;
+    for (int p = 0; p < peakCount; p++)
+    {
+        const int k = peaks[p];
+        const double expected = 2.0 * M_PI * k * analysisHop / stretch->frameSize;
+        const double deviation = WrapPhase(phases[k] - previousPhases[k] - expected);
+        synthesisPhases[k] = (float)WrapPhase(synthesisPhases[k] + (expected + deviation) * advance);
+    }
+
+    /* a peak's region reaches halfway to the next peak */
+    for (int p = 0; p < peakCount; p++)
+    {
+        const int peak = peaks[p];
+        const int first = p == 0 ? 0 : (peaks[p - 1] + peak) / 2 + 1;
+        const int last = p == peakCount - 1 ? bins - 1 : (peak + peaks[p + 1]) / 2;
+        for (int k = first; k <= last; k++)
+        {
+            if (k != peak)
+                synthesisPhases[k] = synthesisPhases[peak] + phases[k] - phases[peak];
+        }
+    }
+}
+
+/* transforms the frame at start into the magnitudes and phases of every channel; returns their spectral flux against the previous frame and whether their magnitudes rose */
+static float AnalyzeVocoderFrame(TimeStretch* stretch, long long start, bool* rising)
+{
+    const int frameSize = stretch->frameSize;
+    const int bins = frameSize / 2 + 1;
+    const int offset = (int)(start - stretch->inputStart);
+    float* frame = stretch->frame.data();
+    float* real = stretch->real.data();
+    float* imaginary = stretch->imaginary.data();
+
+    float flux = 0.0f;
+    float energy = 0.0f;
+    float previousEnergy = 0.0f;
+    for (int c = 0; c < stretch->channelCount; c++)
+    {
+        TimeStretchChannel* channel = &stretch->channels[c];
+        const float* input = channel->input.data() + offset;
+        for (int n = 0; n < frameSize; n++)
+            frame[n] = input[n] * stretch->window[n];
+        ForwardFft(&stretch->fft, frame, real, imaginary);
+
+        float* magnitudes = channel->magnitudes.data();
+        float* phases = channel->phases.data();
+        const float* previousMagnitudes = channel->previousMagnitudes.data();
+        for (int k = 0; k < bins; k++)
+        {
+            magnitudes[k] = sqrtf(real[k] * real[k] + imaginary[k] * imaginary[k]);
+            phases[k] = atan2f(imaginary[k], real[k]);
+            flux += max(magnitudes[k] - previousMagnitudes[k], 0.0f);
+            energy += magnitudes[k];
+            previousEnergy += previousMagnitudes[k];
+        }
+    }
+
+    *rising = energy > previousEnergy;
+    return energy > 1e-9f ? flux / energy : 0.0f;
+}
+
+/* where in the frame at start the input's energy jumps most against the blocks before it */
+static int FindTransientOnset(const TimeStretch* stretch, long long start)
+{
+    const int offset = (int)(start - stretch->inputStart);
+    double history = 0.0;
+    double bestRise = 0.0;
+    int onset = 0;
+    for (int b = 0; b < stretch->frameSize / TIME_STRETCH_ONSET_FRAMES; b++)
+    {
+        double energy = 0.0;
+        for (int c = 0; c < stretch->channelCount; c++)
+        {
+            const float* input = stretch->channels[c].input.data() + offset + b * TIME_STRETCH_ONSET_FRAMES;
+            for (int n = 0; n < TIME_STRETCH_ONSET_FRAMES; n++)
+                energy += input[n] * input[n];
+        }
+        const double rise = b == 0 ? 0.0 : energy / (history / b + 1e-12);
+        if (rise > bestRise)
+        {
+
+            bestRise = rise;
+            onset = b * TIME_STRETCH_ONSET_FRAMES;
+        }
+        history += energy;
+    }
+
+    return onset;
+}
+
+static bool ProduceVocoderFrame(TimeStretch* stretch)
+{
+    long long start = llround(stretch->analysisPosition);
+    if (start + stretch->frameSize > stretch->inputStart + stretch->inputCount)
+        return false;
+
+    const int frameSize = stretch->frameSize;
+    const int bins = frameSize / 2 + 1;
+    for (int c = 0; c < stretch->channelCount; c++)
+    {
+        stretch->channels[c].previousMagnitudes.swap(stretch->channels[c].magnitudes);
+        stretch->channels[c].previousPhases.swap(stretch->channels[c].phases);
+    }
+
+    /* a transient is a jump in the spectral flux of all channels together, relative to their magnitude, while the magnitude rises */
+    bool rising = false;
+    const float flux = AnalyzeVocoderFrame(stretch, start, &rising);
+    const bool transient = stretch->started && rising && flux > TIME_STRETCH_TRANSIENT_FLUX && flux > TIME_STRETCH_TRANSIENT_RATIO * stretch->fluxAverage;
+    if (stretch->started)
+        stretch->fluxAverage += 0.2f * (flux - stretch->fluxAverage);
+
+    /*
+        Held frames copy the input at the synthesis hop, so the attack comes out as far into
+        the output frame as it sits in the input frame. The frame is moved so that this puts
+        the attack at its stretched time, within the input still at hand.
+    */
+    if (transient && stretch->holdTransients)
+    {
+
+        const double scale = stretch->ratio * stretch->pitch;
+        const long long onset = start + FindTransientOnset(stretch, start);
+        const long long aligned = llround(onset - (onset * scale - stretch->accumulatorPosition));
+        const long long clamped = min(max(aligned, stretch->inputStart), stretch->inputStart + stretch->inputCount - frameSize);
+        if (clamped != start)
+        {
+
+            start = clamped;
+            stretch->analysisPosition = (double)start;
+            AnalyzeVocoderFrame(stretch, start, &rising);
+        }
+        stretch->transientFrames = frameSize / stretch->hop;
+    }
+
+    /* at a transient every bin restarts from its analysis phase, so the attack is rebuilt as it was recorded */
+    const int analysisHop = (int)(start - stretch->previousAnalysis);
+    float* frame = stretch->frame.data();
+    float* real = stretch->real.data();
+    float* imaginary = stretch->imaginary.data();
+    for (int c = 0; c < stretch->channelCount; c++)
+    {
+        TimeStretchChannel* channel = &stretch->channels[c];
+        if (!stretch->started || transient || analysisHop <= 0)
+            memcpy(channel->synthesisPhases.data(), channel->phases.data(), bins * sizeof(float));
+        else
+            LockVocoderPhases(stretch, channel, analysisHop);
+
+        const float* magnitudes = channel->magnitudes.data();
+        const float* synthesisPhases = channel->synthesisPhases.data();
+        for (int k = 0; k < bins; k++)
+        {
+            real[k] = magnitudes[k] * cosf(synthesisPhases[k]);
+            imaginary[k] = magnitudes[k] * sinf(synthesisPhases[k]);
+        }
+        InverseFft(&stretch->fft, real, imaginary, frame);
+
+        float* accumulator = channel->accumulator.data();
+        for (int n = 0; n < frameSize; n++)
+            accumulator[n] += frame[n] * stretch->window[n] * stretch->normalization;
+    }
+
+    stretch->previousAnalysis = start;
+    return true;
+}
+
+static float CorrelateWsola(const float* reference, const float* candidate, int length, int step)
+{
+    float product = 0.0f;
+    float energy = 0.0f;
+    for (int n = 0; n < length; n += step)
+    {
+        product += reference[n] * candidate[n];
+        energy += candidate[n] * candidate[n];
+    }
+
+    return product / sqrtf(energy + 1e-9f);
+}
+
+/* the frame within the search range that best matches the natural continuation of the previous frame over their overlap: a coarse pass on every fourth frame and offset, then a fine pass around its best */
+static long long FindWsolaStart(TimeStretch* stretch, long long nominal, long long target, long long first, long long end)
+{
+    float* mono = stretch->mono.data();
+    const int length = (int)(end - first);
+    const int offset = (int)(first - stretch->inputStart);
+    for (int n = 0; n < length; n++)
+    {
+        float sum = 0.0f;
+        for (int c = 0; c < stretch->channelCount; c++)
+            sum += stretch->channels[c].input[offset + n];
+        mono[n] = sum;
+    }
+
+    const int overlap = stretch->frameSize - stretch->hop;
+    const float* reference = mono + (target - first);
+    long long best = nominal;
+    float bestScore = CorrelateWsola(reference, mono + (nominal - first), overlap, 4);
+    for (long long candidate = nominal - stretch->search; candidate <= nominal + stretch->search; candidate += 4)
+    {
+        const float score = CorrelateWsola(reference, mono + (candidate - first), overlap, 4);
+        if (score > bestScore)
+        {
+
+            best = candidate;
+            bestScore = score;
+        }
+    }
+
+    const long long coarse = best;
+    bestScore = CorrelateWsola(reference, mono + (coarse - first), overlap, 1);
+    for (long long candidate = max(coarse - 3, nominal - stretch->search); candidate <= min(coarse + 3, nominal + (long long)stretch->search); candidate++)
+    {
+        const float score = CorrelateWsola(reference, mono + (candidate - first), overlap, 1);
+        if (candidate != coarse && score > bestScore)
+        {
+
+            best = candidate;
+            bestScore = score;
+        }
+    }
+
+    return best;
+}
+
+static bool ProduceWsolaFrame(TimeStretch* stretch)
+{
+    const long long nominal = llround(stretch->analysisPosition);
+    const long long target = stretch->started ? stretch->previousAnalysis + stretch->hop : nominal;
+    const long long first = min(nominal - stretch->search, target);
+    const long long end = max(nominal + stretch->search, target) + stretch->frameSize;
+    if (end > stretch->inputStart + stretch->inputCount)
+        return false;
+
+    const long long start = stretch->started ? FindWsolaStart(stretch, nominal, target, first, end) : nominal;
+    const int offset = (int)(start - stretch->inputStart);
+    for (int c = 0; c < stretch->channelCount; c++)
+    {
+        TimeStretchChannel* channel = &stretch->channels[c];
+        const float* input = channel->input.data() + offset;
+        float* accumulator = channel->accumulator.data();
+        for (int n = 0; n < stretch->frameSize; n++)
+            accumulator[n] += input[n] * stretch->window[n] * stretch->normalization;
+    }
+
+    stretch->previousAnalysis = start;
+    return true;
+}
+
+/* the first hop of the accumulator is complete once its frame is added; it moves to the stretched FIFO unless it lies before the start */
+static void EmitTimeStretchHop(TimeStretch* stretch)
+{
+    const int hop = stretch->hop;
+    const int skipped = (int)max(0LL, min((long long)hop, stretch->stretchedFirst - stretch->accumulatorPosition));
+    for (int c = 0; c < stretch->channelCount; c++)
+    {
+        TimeStretchChannel* channel = &stretch->channels[c];
+        float* accumulator = channel->accumulator.data();
+        memcpy(channel->stretched.data() + stretch->stretchedCount, accumulator + skipped, (hop - skipped) * sizeof(float));
+        memmove(accumulator, accumulator + hop, (stretch->frameSize - hop) * sizeof(float));
+        memset(accumulator + stretch->frameSize - hop, 0, hop * sizeof(float));
+    }
+
+    /* after the frames of an attack, the hops close the distance to where the ratio puts the analysis, but never less than half or more than twice the ratio's hop */
+    const double step = hop / (stretch->ratio * stretch->pitch);
+    stretch->idealPosition += step;
+    if (stretch->transientFrames > 0)
+    {
+
+        stretch->analysisPosition += hop;
+        stretch->transientFrames--;
+    } else {
+        const double distance = stretch->idealPosition - stretch->analysisPosition;
+        stretch->analysisPosition += min(max(step + (distance - step) * 0.25, step * 0.5), step * 2.0);
+    }
+
+    stretch->stretchedCount += hop - skipped;
+    stretch->accumulatorPosition += hop;
+    stretch->started = true;
+}
+
+/* reads the stretched audio pitch frames per output frame with a Catmull-Rom cubic, which needs a frame before the read point and two after */
+static bool ResampleTimeStretch(TimeStretch* stretch)
+{
+    double position = stretch->resamplePosition;
+    int count = stretch->outputCount;
+    const int previousCount = count;
+    while (count < TIME_STRETCH_FIFO_FRAMES)
+    {
+        const int index = (int)position;
+        if (index + 2 >= stretch->stretchedCount)
+            break;
+
+        const float fraction = (float)(position - index);
+        for (int c = 0; c < stretch->channelCount; c++)
+        {
+            TimeStretchChannel* channel = &stretch->channels[c];
+            const float* p = channel->stretched.data() + index - 1;
+            channel->output[count] = p[1] + 0.5f * fraction * (p[2] - p[0] + fraction * (2.0f * p[0] - 5.0f * p[1] + 4.0f * p[2] - p[3] + fraction * (3.0f * (p[1] - p[2]) + p[3] - p[0])));
+        }
+        count++;
+        position += stretch->pitch;
+    }
+
+    const int dropped = min((int)position - 1, stretch->stretchedCount);
+    if (dropped > 0)
+    {
+
+        for (int c = 0; c < stretch->channelCount; c++)
+        {
+            float* stretched = stretch->channels[c].stretched.data();
+            memmove(stretched, stretched + dropped, (stretch->stretchedCount - dropped) * sizeof(float));
+        }
+        stretch->stretchedCount -= dropped;
+        position -= dropped;
+    }
+
+    stretch->resamplePosition = position;
+    stretch->outputCount = count;
+    return count > previousCount;
+}
+
+/* input before the earliest frame a coming frame can read is dropped; holding transients keeps more, for frames moved back to their attack */
+static void CompactTimeStretchInput(TimeStretch* stretch)
+{
+    long long keep = llround(stretch->analysisPosition) - stretch->search;
+    if (stretch->holdTransients)
+        keep -= TIME_STRETCH_HOLD_HISTORY;
+    if (stretch->mode == TIME_STRETCH_WSOLA && stretch->started)
+        keep = min(keep, stretch->previousAnalysis + stretch->hop);
+
+    const int dropped = (int)min((long long)stretch->inputCount, keep - stretch->inputStart);
+    if (dropped <= 0)
+        return;
+
+    for (int c = 0; c < stretch->channelCount; c++)
+    {
+        float* input = stretch->channels[c].input.data();
+        memmove(input, input + dropped, (stretch->inputCount - dropped) * sizeof(float));
+    }
+    stretch->inputStart += dropped;
+    stretch->inputCount -= dropped;
+}
+
+static void RunTimeStretch(TimeStretch* stretch)
+{
+    bool progress = true;
+    while (progress)
+    {
+        progress = false;
+        while (stretch->stretchedCount + stretch->hop <= TIME_STRETCH_FIFO_FRAMES)
+        {
+            const bool produced = stretch->mode == TIME_STRETCH_VOCODER ? ProduceVocoderFrame(stretch) : ProduceWsolaFrame(stretch);
+            if (!produced)
+                break;
+
+            EmitTimeStretchHop(stretch);
+            progress = true;
+        }
+        if (ResampleTimeStretch(stretch))
+            progress = true;
+    }
+
+    CompactTimeStretchInput(stretch);
+}
+
+int WriteTimeStretch(TimeStretch* stretch, const float* const* input, int frameCount)
+{
+    int written = 0;
+    while (written < frameCount && stretch->inputCount < TIME_STRETCH_FIFO_FRAMES)
+    {
+        const int count = min(frameCount - written, TIME_STRETCH_FIFO_FRAMES - stretch->inputCount);
+        for (int c = 0; c < stretch->channelCount; c++)
+        {
+            float* destination = stretch->channels[c].input.data() + stretch->inputCount;
+            if (input == NULL)
+                memset(destination, 0, count * sizeof(float));
+            else
+                memcpy(destination, input[c] + written, count * sizeof(float));
+        }
+        stretch->inputCount += count;
+        written += count;
+        RunTimeStretch(stretch);
+    }
+
+    return written;
+}
+
+int ReadTimeStretch(TimeStretch* stretch, float* const* output, int frameCount)
+{
+    int read = 0;
+    while (read < frameCount && stretch->outputCount > 0)
+    {
+        const int count = min(frameCount - read, stretch->outputCount);
+        for (int c = 0; c < stretch->channelCount; c++)
+        {
+            float* source = stretch->channels[c].output.data();
+            memcpy(output[c] + read, source, count * sizeof(float));
+            memmove(source, source + count, (stretch->outputCount - count) * sizeof(float));
+        }
+        stretch->outputCount -= count;
+        stretch->outputPosition += count;
+        read += count;
+        RunTimeStretch(stretch);
+    }
+
+    return read;
+}
+
+static int ComputePitchShifterLatency(const PitchShifter* shifter)
+{
+    return shifter->bypassed.load(memory_order_relaxed) ? 0 : GetTimeStretchLatency(shifter->mode.load(memory_order_relaxed));
+}
+
+static bool UpdatePitchShifterLatency(PitchShifter* shifter)
+{
+    const int latency = ComputePitchShifterLatency(shifter);
+    shifter->latency.store(latency, memory_order_relaxed);
+    if (shifter->engine == NULL || shifter->node == ENGINE_NO_NODE)
+        return true;
+
+    return SetEngineNodeLatency(shifter->engine, shifter->node, latency);
+}
+
+bool InitializePitchShifter(PitchShifter* shifter, int channelCount)
+{
+    shifter->engine = NULL;
+    shifter->node = ENGINE_NO_NODE;
+    shifter->channelCount = channelCount;
+    shifter->bypassed.store(true);
+    shifter->mode.store(TIME_STRETCH_VOCODER);
+    shifter->semitones.store(0.0f);
+    shifter->latency.store(0);
+    shifter->underruns.store(0);
+    shifter->appliedBypassed = true;
+    shifter->appliedMode = TIME_STRETCH_VOCODER;
+    shifter->written = 0;
+
+    return InitializeTimeStretch(&shifter->stretches[TIME_STRETCH_VOCODER], TIME_STRETCH_VOCODER, channelCount) &&
+        InitializeTimeStretch(&shifter->stretches[TIME_STRETCH_WSOLA], TIME_STRETCH_WSOLA, channelCount);
+}
+
+bool ProcessPitchShifter(PitchShifter* shifter, float** channels, int channelCount, int frameCount)
+{
+    if (channelCount < shifter->channelCount)
+        return false;
+
+    const bool bypassed = shifter->bypassed.load(memory_order_relaxed);
+    const int mode = shifter->mode.load(memory_order_relaxed) == TIME_STRETCH_WSOLA ? TIME_STRETCH_WSOLA : TIME_STRETCH_VOCODER;
+    TimeStretch* stretch = &shifter->stretches[mode];
+    SetTimeStretchRatio(stretch, 1.0, shifter->semitones.load(memory_order_relaxed));
+
+    /* a fresh stream on every switch, so the output stays exactly the latency behind the input */
+    if (bypassed != shifter->appliedBypassed || mode != shifter->appliedMode)
+    {
+
+        shifter->appliedBypassed = bypassed;
+        shifter->appliedMode = mode;
+        shifter->written = 0;
+        BeginTimeStretch(stretch, 0);
+        WriteTimeStretch(stretch, NULL, (int)-GetTimeStretchInputPosition(stretch));
+    }
+    if (bypassed)
+        return true;
+
+    const int written = WriteTimeStretch(stretch, channels, frameCount);
+
+    /* the first latency frames of the stream are silence; the rest is read back into the block */
+    const int silent = (int)min((long long)frameCount, max(0LL, GetTimeStretchLatency(mode) - shifter->written));
+    shifter->written += frameCount;
+    float* output[ENGINE_MAX_CHANNELS];
+    for (int c = 0; c < shifter->channelCount; c++)
+    {
+        memset(channels[c], 0, silent * sizeof(float));
+        output[c] = channels[c] + silent;
+    }
+
+    const int read = ReadTimeStretch(stretch, output, frameCount - silent);
+    if (read < frameCount - silent || written < frameCount)
+    {
+
+        for (int c = 0; c < shifter->channelCount; c++)
+            memset(output[c] + read, 0, (frameCount - silent - read) * sizeof(float));
+        shifter->underruns.fetch_add(1, memory_order_relaxed);
+    }
+
+    return true;
+}
+
+bool SetPitchShifterBypassed(PitchShifter* shifter, bool bypassed)
+{
+    shifter->bypassed.store(bypassed, memory_order_relaxed);
+    return UpdatePitchShifterLatency(shifter);
+}
+
+bool SetPitchShifterMode(PitchShifter* shifter, int mode)
+{
+    if (mode != TIME_STRETCH_VOCODER && mode != TIME_STRETCH_WSOLA)
+        return false;
+
+    shifter->mode.store(mode, memory_order_relaxed);
+    return UpdatePitchShifterLatency(shifter);
+}
+
+static bool ProcessPitchShifterNode(void* state, EngineNodeContext* context)
+{
+    return ProcessPitchShifter((PitchShifter*)state, context->channels, context->channelCount, context->frameCount);
+}
+
+static unsigned long long HashPitchShifterNode(void* state, unsigned long long hash)
+{
+    PitchShifter* shifter = (PitchShifter*)state;
+    const int switches[2] = { shifter->bypassed.load(memory_order_relaxed), shifter->mode.load(memory_order_relaxed) };
+    const float semitones = shifter->semitones.load(memory_order_relaxed);
+    hash = HashEngineBytes(hash, switches, sizeof(switches));
+    return HashEngineBytes(hash, &semitones, sizeof(semitones));
+}
+
+static void* ClonePitchShifterNode(void* state, Engine*)
+{
+    PitchShifter* shifter = (PitchShifter*)state;
+    PitchShifter* clone = new PitchShifter();
+    if (!InitializePitchShifter(clone, shifter->channelCount))
+    {
+
+        delete clone;
+        return NULL;
+    }
+
+    clone->bypassed.store(shifter->bypassed.load());
+    clone->mode.store(shifter->mode.load());
+    clone->semitones.store(shifter->semitones.load());
+    UpdatePitchShifterLatency(clone);
+    return clone;
+}
+
+static void ReleasePitchShifterNode(void* state)
+{
+    delete (PitchShifter*)state;
+}
+
+/* the phases carry from frame to frame for as long as the stream runs */
+static long long GetPitchShifterTail(void* state)
+{
+    PitchShifter* shifter = (PitchShifter*)state;
+    return shifter->bypassed.load() ? 0 : ENGINE_UNBOUNDED_TAIL;
+}
+
+int AddPitchShifterNode(Engine* engine, PitchShifter* shifter, const char* name)
+{
+    shifter->engine = engine;
+    shifter->node = AddEngineNode(engine, name, shifter, ProcessPitchShifterNode);
+    SetEngineNodeHash(engine, shifter->node, HashPitchShifterNode);
+    SetEngineNodeClone(engine, shifter->node, ClonePitchShifterNode, ReleasePitchShifterNode);
+    SetEngineNodeTail(engine, shifter->node, GetPitchShifterTail);
+    UpdatePitchShifterLatency(shifter);
+    return shifter->node;
+}
+
+struct TimeStretchJob {
+    const float* const* input;
+    int channelCount;
+    long long frameCount;
+    int mode;
+    double ratio;
+    double semitones;
+    long long outputFrames;
+    long long segmentFrames;
+    int segmentCount;
+    std::atomic<int> next;
+    std::atomic<bool> failed;
+    std::vector<std::vector<float>>* segments;
+};
+
+/* segment s covers its share of the output plus half a crossfade and the seam search on each side */
+static long long GetTimeStretchSegmentStart(const TimeStretchJob* job, int segment)
+{
+    return segment == 0 ? 0 : segment * job->segmentFrames - TIME_STRETCH_CROSSFADE_FRAMES / 2 - TIME_STRETCH_SEAM_SEARCH;
+}
+
+static long long GetTimeStretchSegmentEnd(const TimeStretchJob* job, int segment)
+{
+    return (segment + 1) * job->segmentFrames + TIME_STRETCH_CROSSFADE_FRAMES / 2 + TIME_STRETCH_SEAM_SEARCH;
+}
+
+/* rendered from two frames before the segment, so the phases have settled where it starts */
+static bool RenderTimeStretchSegment(TimeStretchJob* job, TimeStretch* stretch, int segment)
+{
+    const long long keepStart = GetTimeStretchSegmentStart(job, segment);
+    const long long keepEnd = GetTimeStretchSegmentEnd(job, segment);
+    const long long keepFrames = keepEnd - keepStart;
+
+    const long long preroll = (long long)ceil(keepStart * stretch->pitch) - 2 * stretch->frameSize;
+    const long long stretchedStart = max(0LL, preroll / stretch->hop * stretch->hop);
+    if (!BeginTimeStretch(stretch, stretchedStart))
+        return false;
+
+    vector<float>* output = &(*job->segments)[segment * job->channelCount];
+    for (int c = 0; c < job->channelCount; c++)
+        output[c].assign((size_t)keepFrames, 0.0f);
+
+    vector<float> storage((size_t)TIME_STRETCH_CHUNK_FRAMES * job->channelCount);
+    float* chunk[ENGINE_MAX_CHANNELS];
+    for (int c = 0; c < job->channelCount; c++)
+        chunk[c] = storage.data() + (size_t)c * TIME_STRETCH_CHUNK_FRAMES;
+
+    /* input outside the buffer is silence, which also flushes the last frames */
+    while (GetTimeStretchOutputPosition(stretch) < keepEnd)
+    {
+        const long long position = GetTimeStretchInputPosition(stretch);
+        for (int c = 0; c < job->channelCount; c++)
+        {
+            for (int n = 0; n < TIME_STRETCH_CHUNK_FRAMES; n++)
+            {
+                const long long index = position + n;
+                chunk[c][n] = index >= 0 && index < job->frameCount ? job->input[c][index] : 0.0f;
+            }
+        }
+        const int written = WriteTimeStretch(stretch, chunk, TIME_STRETCH_CHUNK_FRAMES);
+
+        int read = 0;
+        do
+        {
+            const long long start = GetTimeStretchOutputPosition(stretch);
+            read = ReadTimeStretch(stretch, chunk, TIME_STRETCH_CHUNK_FRAMES);
+            for (int n = 0; n < read; n++)
+            {
+                const long long index = start + n - keepStart;
+                if (index < 0 || index >= keepFrames)
+                    continue;
+                for (int c = 0; c < job->channelCount; c++)
+                    output[c][(size_t)index] = chunk[c][n];
+            }
+        } while (read == TIME_STRETCH_CHUNK_FRAMES);
+
+        if (written == 0 && read == 0)
+            return false;
+    }
+
+    return true;
+}
+
+static void RunTimeStretchWorker(TimeStretchJob* job)
+{
+    SetTraceThreadName("Time stretch");
+    TimeStretch* stretch = new TimeStretch;
+    if (!InitializeTimeStretch(stretch, job->mode, job->channelCount))
+    {
+
+        job->failed.store(true);
+        delete stretch;
+        return;
+    }
+    SetTimeStretchRatio(stretch, job->ratio, job->semitones);
+    stretch->holdTransients = true;
+
+    for (int segment = job->next.fetch_add(1); segment < job->segmentCount && !job->failed.load(); segment = job->next.fetch_add(1))
+    {
+        TraceScope trace("Stretch segment");
+        if (!RenderTimeStretchSegment(job, stretch, segment))
+            job->failed.store(true);
+    }
+    delete stretch;
+}
+
+static float GetTimeStretchSegmentSample(const TimeStretchJob* job, int segment, long long index)
+{
+    const vector<float>* channels = &(*job->segments)[(size_t)segment * job->channelCount];
+    const size_t offset = (size_t)(index - GetTimeStretchSegmentStart(job, segment));
+    float sum = 0.0f;
+    for (int c = 0; c < job->channelCount; c++)
+        sum += channels[c][offset];
+    return sum;
+}
+
+/* how far the later segment is slid at a seam: the earlier one, already slid by previousShift, is matched over the crossfade against every shift in the search */
+static long long FindTimeStretchSeam(const TimeStretchJob* job, int segment, long long previousShift)
+{
+    const int length = TIME_STRETCH_CROSSFADE_FRAMES;
+    const long long first = segment * job->segmentFrames - length / 2;
+    vector<float> reference(length);
+    vector<float> candidates(length + 2 * TIME_STRETCH_SEAM_SEARCH);
+    for (int n = 0; n < length; n++)
+        reference[n] = GetTimeStretchSegmentSample(job, segment - 1, first + n + previousShift);
+    for (int n = 0; n < (int)candidates.size(); n++)
+        candidates[n] = GetTimeStretchSegmentSample(job, segment, first - TIME_STRETCH_SEAM_SEARCH + n);
+
+    long long best = 0;
+    float bestScore = CorrelateWsola(reference.data(), candidates.data() + TIME_STRETCH_SEAM_SEARCH, length, 1);
+    for (int shift = -TIME_STRETCH_SEAM_SEARCH; shift <= TIME_STRETCH_SEAM_SEARCH; shift++)
+    {
+        const float score = CorrelateWsola(reference.data(), candidates.data() + TIME_STRETCH_SEAM_SEARCH + shift, length, 1);
+        if (score > bestScore)
+        {
+
+            best = shift;
+            bestScore = score;
+        }
+    }
+
+    return best;
+}
+
+bool StretchAudio(
+    const float* const* input, int channelCount, long long frameCount, int sampleRate, int mode, double ratio, double semitones, int threadCount,
+    vector<float>* output, TimeStretchReport* report
+)
+{
+    if (channelCount <= 0 || channelCount > ENGINE_MAX_CHANNELS || frameCount <= 0 || sampleRate <= 0)
+        return false;
+    if (mode != TIME_STRETCH_VOCODER && mode != TIME_STRETCH_WSOLA)
+        return false;
+
+    const unsigned long long startTicks = ReadEngineTicks();
+    ratio = min(max(ratio, TIME_STRETCH_MIN_RATIO), TIME_STRETCH_MAX_RATIO);
+
+    /* segments have a fixed length, so how the output is cut does not depend on the threads */
+    TimeStretchJob job;
+    job.input = input;
+    job.channelCount = channelCount;
+    job.frameCount = frameCount;
+    job.mode = mode;
+    job.ratio = ratio;
+    job.semitones = semitones;
+    job.outputFrames = max(1LL, llround(frameCount * ratio));
+    job.segmentFrames = (long long)TIME_STRETCH_SEGMENT_SECONDS * sampleRate;
+    job.segmentCount = (int)((job.outputFrames + job.segmentFrames - 1) / job.segmentFrames);
+    job.next.store(0);
+    job.failed.store(false);
+    vector<vector<float>> segments((size_t)job.segmentCount * channelCount);
+    job.segments = &segments;
+
+    if (threadCount <= 0)
+        threadCount = max(1, (int)thread::hardware_concurrency());
+    threadCount = min(threadCount, job.segmentCount);
+    vector<thread> workers;
+    for (int t = 0; t < threadCount; t++)
+        workers.push_back(CreateEngineThread(RunTimeStretchWorker, &job));
+    for (thread& worker : workers)
+        worker.join();
+    if (job.failed.load())
+        return false;
+
+    /* each seam is slid into place and crossfaded with weights that sum to one */
+    vector<long long> shifts(job.segmentCount, 0);
+    for (int s = 1; s < job.segmentCount; s++)
+        shifts[s] = FindTimeStretchSeam(&job, s, shifts[s - 1]);
+
+    const int fade = TIME_STRETCH_CROSSFADE_FRAMES / 2;
+    for (int c = 0; c < channelCount; c++)
+        output[c].assign((size_t)job.outputFrames, 0.0f);
+    for (int s = 0; s < job.segmentCount; s++)
+    {
+        const long long boundary = s * job.segmentFrames;
+        const long long next = (s + 1) * job.segmentFrames;
+        const long long first = s == 0 ? 0 : boundary - fade;
+        const long long last = s == job.segmentCount - 1 ? job.outputFrames : next + fade;
+        const long long offset = shifts[s] - GetTimeStretchSegmentStart(&job, s);
+        for (int c = 0; c < channelCount; c++)
+        {
+            const vector<float>& segment = segments[(size_t)s * channelCount + c];
+            for (long long index = first; index < last; index++)
+            {
+                float weight = 1.0f;
+                if (s > 0 && index < boundary + fade)
+                    weight = (float)(0.5 - 0.5 * cos(M_PI * (index - (boundary - fade) + 0.5) / (2 * fade)));
+                else if (s < job.segmentCount - 1 && index >= next - fade)
+                    weight = (float)(0.5 + 0.5 * cos(M_PI * (index - (next - fade) + 0.5) / (2 * fade)));
+                output[c][(size_t)index] += segment[(size_t)(index + offset)] * weight;
+            }
+        }
+    }
+
+    const double seconds = (ReadEngineTicks() - startTicks) * GetEngineTickSeconds();
+    if (report != NULL)
+    {
+
+        report->threads = threadCount;
+        report->segments = job.segmentCount;
+        report->inputSeconds = (double)frameCount / sampleRate;
+        report->outputSeconds = (double)job.outputFrames / sampleRate;
+        report->milliseconds = seconds * 1000.0;
+        report->realtimeFactor = seconds > 0.0 ? report->inputSeconds / seconds : 0.0;
+    }
+
+    return true;
+}
+
+bool StretchAudioFile(const char* inputPath, const char* outputPath, int mode, double ratio, double semitones, int threadCount, TimeStretchReport* report)
+{
+    SF_INFO info;
+    memset(&info, 0, sizeof(info));
+    SNDFILE* file = sf_open(inputPath, SFM_READ, &info);
+    if (file == NULL)
+    {
+
+        LogMessage(LOG_ERROR, "The sound file %s could not be opened: %s", inputPath, sf_strerror(NULL));
+        return false;
+    }
+
+    vector<float> interleaved((size_t)info.frames * info.channels);
+    const long long read = info.frames > 0 ? sf_readf_float(file, interleaved.data(), info.frames) : 0;
+    sf_close(file);
+    if (read <= 0 || info.samplerate <= 0)
+    {
+
+        LogMessage(LOG_ERROR, "The sound file %s holds no audio.", inputPath);
+        return false;
+    }
+
+    const int channelCount = min(info.channels, ENGINE_MAX_CHANNELS);
+    if (info.channels > channelCount)
+        LogMessage(LOG_WARNING, "Only the first %d channels of %s are stretched.", channelCount, inputPath);
+
+    vector<float> channels[ENGINE_MAX_CHANNELS];
+    const float* input[ENGINE_MAX_CHANNELS];
+    for (int c = 0; c < channelCount; c++)
+    {
+        channels[c].resize((size_t)read);
+        for (long long n = 0; n < read; n++)
+            channels[c][(size_t)n] = interleaved[(size_t)n * info.channels + c];
+        input[c] = channels[c].data();
+    }
+
+    vector<float> output[ENGINE_MAX_CHANNELS];
+    if (!StretchAudio(input, channelCount, read, info.samplerate, mode, ratio, semitones, threadCount, output, report))
+    {
+
+        LogMessage(LOG_ERROR, "The sound file %s could not be stretched.", inputPath);
+        return false;
+    }
+
+    const long long frames = (long long)output[0].size();
+    interleaved.resize((size_t)frames * channelCount);
+    for (long long n = 0; n < frames; n++)
+    {
+        for (int c = 0; c < channelCount; c++)
+            interleaved[(size_t)n * channelCount + c] = output[c][(size_t)n];
+    }
+
+    SF_INFO outputInfo;
+    memset(&outputInfo, 0, sizeof(outputInfo));
+    outputInfo.samplerate = info.samplerate;
+    outputInfo.channels = channelCount;
+    outputInfo.format = SF_FORMAT_WAV | SF_FORMAT_FLOAT;
+    SNDFILE* outputFile = sf_open(outputPath, SFM_WRITE, &outputInfo);
+    if (outputFile == NULL)
+    {
+
+        LogMessage(LOG_ERROR, "The stretched audio could not be written to %s: %s", outputPath, sf_strerror(NULL));
+        return false;
+    }
+
+    const bool succeeded = sf_writef_float(outputFile, interleaved.data(), frames) == frames;
+    sf_close(outputFile);
+    if (!succeeded)
+        LogMessage(LOG_ERROR, "The stretched audio could not be written to %s.", outputPath);
+    return succeeded;
+}
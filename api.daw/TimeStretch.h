@@ -0,0 +1,177 @@
+#pragma once
+
+#include<atomic>
+#include<vector>
+
+#include"Engine.h"
+#include"Fft.h"
+
+/*api.daw time stretch*/
+#define TIME_STRETCH_VOCODER 0
+#define TIME_STRETCH_WSOLA 1
+
+#define TIME_STRETCH_VOCODER_FRAMES 2048
+#define TIME_STRETCH_VOCODER_HOP 512
+#define TIME_STRETCH_WSOLA_FRAMES 1024
+#define TIME_STRETCH_WSOLA_HOP 512
+#define TIME_STRETCH_WSOLA_SEARCH 256
+#define TIME_STRETCH_TRANSIENT_RATIO 2.0f
+#define TIME_STRETCH_TRANSIENT_FLUX 0.1f
+#define TIME_STRETCH_ONSET_FRAMES 64
+#define TIME_STRETCH_HOLD_HISTORY 8192
+#define TIME_STRETCH_FIFO_FRAMES 32768
+#define TIME_STRETCH_CHUNK_FRAMES 4096
+#define TIME_STRETCH_MIN_RATIO 0.25
+#define TIME_STRETCH_MAX_RATIO 4.0
+#define TIME_STRETCH_MAX_SEMITONES 12.0
+#define TIME_STRETCH_SEGMENT_SECONDS 4
+#define TIME_STRETCH_CROSSFADE_FRAMES 1024
+#define TIME_STRETCH_SEAM_SEARCH 256
+#define TIME_STRETCH_PATH_LENGTH 260
+
+/* The FIFOs of one channel and the spectra its phase vocoder carries from frame to frame. */
+struct TimeStretchChannel {
+    std::vector<float> input;
+    std::vector<float> stretched;
+    std::vector<float> output;
+    std::vector<float> accumulator;
+    std::vector<float> magnitudes;
+    std::vector<float> previousMagnitudes;
+    std::vector<float> phases;
+    std::vector<float> previousPhases;
+    std::vector<float> synthesisPhases;
+};
+
+/*
+    Streaming time stretch and pitch shift. Frames are taken from the input every
+    hop / (ratio * pitch) frames and overlap-added every hop frames, which stretches the
+    audio by ratio * pitch; a cubic resampler then reads the result pitch frames at a
+    time, which restores the length to ratio and moves the pitch. The phase vocoder
+    locks each bin's phase to its spectral peak and resets all phases on frames whose
+    spectral flux jumps, so attacks stay sharp; offline, the frames holding the attack
+    are also taken at the synthesis hop, so it is copied once instead of smeared, and
+    the hops after catch up with the ratio. WSOLA copies the input frame that best
+    continues the previous one; it costs a fraction of the vocoder and has less latency,
+    which suits previews.
+
+    Positions are absolute: output frame j comes from input frame j / ratio. Input and
+    output may be written and read in any amounts; a write stops early when the output
+    has not been read.
+*/
+struct TimeStretch {
+    int mode;
+    int channelCount;
+    int frameSize;
+    int hop;
+    int search;
+    double ratio;
+    double pitch;
+    bool holdTransients;
+
+    long long inputStart;
+    int inputCount;
+    double analysisPosition;
+    double idealPosition;
+    int transientFrames;
+    long long previousAnalysis;
+    bool started;
+    float fluxAverage;
+    long long accumulatorPosition;
+    long long stretchedFirst;
+    int stretchedCount;
+    double resamplePosition;
+    int outputCount;
+    long long outputPosition;
+
+    Fft fft;
+    float normalization;
+    std::vector<float> window;
+    std::vector<float> frame;
+    std::vector<float> real;
+    std::vector<float> imaginary;
+    std::vector<int> peaks;
+    std::vector<float> mono;
+    TimeStretchChannel channels[ENGINE_MAX_CHANNELS];
+};
+
+bool InitializeTimeStretch(TimeStretch* stretch, int mode, int channelCount);
+
+/* ratio is output length over input length; the pitch moves by semitones independently of it */
+bool SetTimeStretchRatio(TimeStretch* stretch, double ratio, double semitones);
+
+/* starts a stream whose stretched audio begins at stretchedStart, a multiple of the hop; 0 starts at the first input frame */
+bool BeginTimeStretch(TimeStretch* stretch, long long stretchedStart);
+
+/* the input frame the next write continues from, which is negative at the start; the output frame the next read returns */
+long long GetTimeStretchInputPosition(const TimeStretch* stretch);
+long long GetTimeStretchOutputPosition(const TimeStretch* stretch);
+
+/* a NULL input writes silence; returns the frames taken */
+int WriteTimeStretch(TimeStretch* stretch, const float* const* input, int frameCount);
+
+/* returns the frames read, which fall short while the stretch waits for input */
+int ReadTimeStretch(TimeStretch* stretch, float* const* output, int frameCount);
+
+/* what a stream of constant pitch needs written ahead of what it reads */
+int GetTimeStretchLatency(int mode);
+
+/*
+    A pitch shifter on the audio thread: the counterpart of the oscillator's frequency for
+    recorded audio. The stream is delayed by the latency, which delay compensation is told.
+*/
+struct PitchShifter {
+    Engine* engine;
+    int node;
+    int channelCount;
+
+    /* settings, written by the UI thread */
+    std::atomic<bool> bypassed;
+    std::atomic<int> mode;
+    std::atomic<float> semitones;
+    std::atomic<int> latency;
+
+    /* blocks that found the stretch short of output */
+    std::atomic<unsigned long long> underruns;
+
+    /* audio thread */
+    bool appliedBypassed;
+    int appliedMode;
+    long long written;
+    TimeStretch stretches[2];
+};
+
+/* bypassed at 0 semitones with the phase vocoder */
+bool InitializePitchShifter(PitchShifter* shifter, int channelCount);
+bool ProcessPitchShifter(PitchShifter* shifter, float** channels, int channelCount, int frameCount);
+
+/* the setters below update the node's latency in the engine; they belong to the UI thread */
+bool SetPitchShifterBypassed(PitchShifter* shifter, bool bypassed);
+bool SetPitchShifterMode(PitchShifter* shifter, int mode);
+
+int AddPitchShifterNode(Engine* engine, PitchShifter* shifter, const char* name);
+
+struct TimeStretchReport {
+    int threads;
+    int segments;
+    double inputSeconds;
+    double outputSeconds;
+    double milliseconds;
+    double realtimeFactor;
+};
+
+/*
+    Stretches a whole buffer offline. The output is cut into segments rendered on up to
+    threadCount threads; each segment starts its own stream a few frames early on the
+    same frame grid a single stream would use. Neighbours carry unrelated phases, so each
+    seam is slid by up to TIME_STRETCH_SEAM_SEARCH frames to where the two correlate best
+    and crossfaded over TIME_STRETCH_CROSSFADE_FRAMES; the segments do not depend on the
+    thread count, so neither does the result.
+    output receives channelCount channels of frameCount * ratio frames.
+*/
+bool StretchAudio(
+    const float* const* input, int channelCount, long long frameCount, int sampleRate, int mode, double ratio, double semitones, int threadCount,
+    std::vector<float>* output, TimeStretchReport* report
+);
+
+/* reads a sound file, stretches it and writes a 32-bit float WAV file */
+bool StretchAudioFile(const char* inputPath, const char* outputPath, int mode, double ratio, double semitones, int threadCount, TimeStretchReport* report);
@@ -0,0 +1,282 @@
+#include"Timeline.h"
+
+#include<algorithm>
+#include<cstdio>
+
+using namespace std;
+
+static long long UpdateTimelineMaxEnds(TimelineIndex* index, int low, int high)
+{
+    if (low >= high)
+        return -1;
+
+    const int middle = low + (high - low) / 2;
+    long long maxEnd = index->ends[middle];
+    maxEnd = max(maxEnd, UpdateTimelineMaxEnds(index, low, middle));
+    maxEnd = max(maxEnd, UpdateTimelineMaxEnds(index, middle + 1, high));
+
+    index->maxEnds[middle] = maxEnd;
+    return maxEnd;
+}
+
+static void RefreshTimelineIndex(TimelineIndex* index)
+{
+    index->maxEnds.resize(index->starts.size());
+    UpdateTimelineMaxEnds(index, 0, (int)index->starts.size());
+}
+
+static int FindTimelineIndexEntry(const TimelineIndex* index, unsigned clip, long long start)
+{
+    int entry = (int)(lower_bound(index->starts.begin(), index->starts.end(), start) - index->starts.begin());
+    while (entry < (int)index->starts.size() && index->starts[entry] == start)
+    {
+        if (index->clips[entry] == clip)
+            return entry;
+        entry++;
+    }
+
+    return -1;
+}
+
+static void InsertTimelineIndexEntry(TimelineIndex* index, unsigned clip, const TimelineClip& data)
+{
+    const int entry = (int)(upper_bound(index->starts.begin(), index->starts.end(), data.start) - index->starts.begin());
+    index->starts.insert(index->starts.begin() + entry, data.start);
+    index->ends.insert(index->ends.begin() + entry, data.start + data.length);
+    index->clips.insert(index->clips.begin() + entry, clip);
+}
+
+static void EraseTimelineIndexEntry(TimelineIndex* index, int entry)
+{
+    index->starts.erase(index->starts.begin() + entry);
+    index->ends.erase(index->ends.begin() + entry);
+    index->clips.erase(index->clips.begin() + entry);
+}
+
+int AddTimelineTrack(Timeline* timeline, const char* name)
+{
+    TimelineTrack track;
+    snprintf(track.name, TIMELINE_NAME_LENGTH, "%s", name);
+    track.gain = 1.0f;
+    track.mute = false;
+
+    timeline->tracks.push_back(track);
+    return (int)timeline->tracks.size() - 1;
+}
+
+int AddTimelineClip(Timeline* timeline, const TimelineClip& clip)
+{
+    if (clip.length <= 0 || clip.track >= timeline->tracks.size())
+        return -1;
+
+    const unsigned index = (unsigned)timeline->clips.size();
+    timeline->clips.push_back(clip);
+
+    /* one sorted insert and a linear refresh instead of a full sort */
+    InsertTimelineIndexEntry(&timeline->index, index, clip);
+    RefreshTimelineIndex(&timeline->index);
+
+    return (int)index;
+}
+
+int AddTimelineClips(Timeline* timeline, const TimelineClip* clips, int count)
+{
+    int added = 0;
+    timeline->clips.reserve(timeline->clips.size() + count);
+    for (int c = 0; c < count; c++)
+    {
+        if (clips[c].length <= 0 || clips[c].track >= timeline->tracks.size())
+            continue;
+
+        timeline->clips.push_back(clips[c]);
+        added++;
+    }
+
+    BuildTimelineIndex(timeline);
+    return added;
+}
+
+bool MoveTimelineClip(Timeline* timeline, int clip, long long start)
+{
+    if (clip < 0 || clip >= (int)timeline->clips.size())
+        return false;
+
+    TimelineClip& data = timeline->clips[clip];
+    const int entry = FindTimelineIndexEntry(&timeline->index, (unsigned)clip, data.start);
+    if (entry < 0)
+        return false;
+
+    EraseTimelineIndexEntry(&timeline->index, entry);
+    data.start = start;
+    InsertTimelineIndexEntry(&timeline->index, (unsigned)clip, data);
+    RefreshTimelineIndex(&timeline->index);
+
+    return true;
+}
+
+bool RemoveTimelineClip(Timeline* timeline, int clip)
+{
+    if (clip < 0 || clip >= (int)timeline->clips.size())
+        return false;
+
+    TimelineIndex* index = &timeline->index;
+    const int entry = FindTimelineIndexEntry(index, (unsigned)clip, timeline->clips[clip].start);
+    if (entry < 0)
+        return false;
+    EraseTimelineIndexEntry(index, entry);
+
+    /* the last clip takes the freed slot so clip storage stays dense */
+    const unsigned last = (unsigned)timeline->clips.size() - 1;
+    if ((unsigned)clip != last)
+    {
+
+        const int moved = FindTimelineIndexEntry(index, last, timeline->clips[last].start);
+        index->clips[moved] = (unsigned)clip;
+        timeline->clips[clip] = timeline->clips[last];
+    }
+    timeline->clips.pop_back();
+
+    RefreshTimelineIndex(index);
+    return true;
+}
+
+bool SetTimelineClip(Timeline* timeline, int clip, const TimelineClip& data)
+{
+    if (clip < 0 || clip > (int)timeline->clips.size())
+        return false;
+
+    TimelineIndex* index = &timeline->index;
+    if (clip == (int)timeline->clips.size())
+        timeline->clips.push_back(data);
+    else {
+        const int entry = FindTimelineIndexEntry(index, (unsigned)clip, timeline->clips[clip].start);
+        if (entry < 0)
+            return false;
+
+        EraseTimelineIndexEntry(index, entry);
+        timeline->clips[clip] = data;
+    }
+
+    InsertTimelineIndexEntry(index, (unsigned)clip, data);
+    RefreshTimelineIndex(index);
+    return true;
+}
+
+bool PopTimelineClip(Timeline* timeline)
+{
+    if (timeline->clips.empty())
+        return false;
+
+    return RemoveTimelineClip(timeline, (int)timeline->clips.size() - 1);
+}
+
+int AddTimelineRegion(Timeline* timeline, long long start, long long length, const char* name)
+{
+    TimelineRegion region;
+    region.start = start;
+    region.length = length;
+    snprintf(region.name, TIMELINE_NAME_LENGTH, "%s", name);
+
+    timeline->regions.push_back(region);
+    return (int)timeline->regions.size() - 1;
+}
+
+int AddTimelineMarker(Timeline* timeline, long long position, const char* name)
+{
+    TimelineMarker marker;
+    marker.position = position;
+    snprintf(marker.name, TIMELINE_NAME_LENGTH, "%s", name);
+
+    vector<TimelineMarker>::iterator place = upper_bound(
+        timeline->markers.begin(), timeline->markers.end(), position,
+        [](long long value, const TimelineMarker& other) { return value < other.position; }
+    );
+    return (int)(timeline->markers.insert(place, marker) - timeline->markers.begin());
+}
+
+bool BuildTimelineIndex(Timeline* timeline)
+{
+    TimelineIndex* index = &timeline->index;
+    const size_t count = timeline->clips.size();
+
+    vector<unsigned> order(count);
+    for (size_t c = 0; c < count; c++)
+        order[c] = (unsigned)c;
+
+    const vector<TimelineClip>& clips = timeline->clips;
+    stable_sort(order.begin(), order.end(), [&clips](unsigned a, unsigned b) { return clips[a].start < clips[b].start; });
+
+    index->starts.resize(count);
+    index->ends.resize(count);
+    index->clips.swap(order);
+    for (size_t e = 0; e < count; e++)
+    {
+        const TimelineClip& clip = clips[index->clips[e]];
+        index->starts[e] = clip.start;
+        index->ends[e] = clip.start + clip.length;
+    }
+
+    RefreshTimelineIndex(index);
+    return true;
+}
+
+static void QueryTimelineIndex(const TimelineIndex* index, int low, int high, long long start, long long end, unsigned* results, int capacity, int* found)
+{
+    while (low < high)
+    {
+        const int middle = low + (high - low) / 2;
+
+        /* nothing below this node reaches the query */
+        if (index->maxEnds[middle] <= start)
+            return;
+
+        QueryTimelineIndex(index, low, middle, start, end, results, capacity, found);
+
+        /* everything from here on starts at or after the end of the query */
+        if (index->starts[middle] >= end)
+            return;
+
+        if (index->ends[middle] > start)
+        {
+
+            if (*found < capacity)
+                results[*found] = index->clips[middle];
+            (*found)++;
+        }
+
+        low = middle + 1;
+    }
+}
+
+int QueryTimelineClips(const Timeline* timeline, long long start, long long end, unsigned* results, int capacity)
+{
+    int found = 0;
+    QueryTimelineIndex(&timeline->index, 0, (int)timeline->index.starts.size(), start, end, results, capacity, &found);
+    return found;
+}
+
+int FindTimelineMarkers(const Timeline* timeline, long long start, long long end, int* first)
+{
+    const vector<TimelineMarker>& markers = timeline->markers;
+    vector<TimelineMarker>::const_iterator low = lower_bound(
+        markers.begin(), markers.end(), start,
+        [](const TimelineMarker& marker, long long value) { return marker.position < value; }
+    );
+    vector<TimelineMarker>::const_iterator high = lower_bound(
+        low, markers.end(), end,
+        [](const TimelineMarker& marker, long long value) { return marker.position < value; }
+    );
+
+    *first = (int)(low - markers.begin());
+    return (int)(high - low);
+}
+
+long long GetTimelineLength(const Timeline* timeline)
+{
+    const TimelineIndex& index = timeline->index;
+    if (index.starts.empty())
+        return 0;
+
+    /* the root of the implicit tree holds the largest end */
+    return index.maxEnds[index.starts.size() / 2];
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include<vector>
+
+/*api.daw timeline*/
+#define TIMELINE_NAME_LENGTH 32
+#define TIMELINE_NO_ASSET 0xFFFFFFFFu
+
+/* Positions and lengths are in samples at the engine sample rate. */
+struct TimelineTrack {
+    char name[TIMELINE_NAME_LENGTH];
+    float gain;
+    bool mute;
+};
+
+struct TimelineClip {
+    long long start;
+    long long length;
+    long long sourceOffset;
+    unsigned track;
+    unsigned asset;
+    float gain;
+};
+
+struct TimelineRegion {
+    long long start;
+    long long length;
+    char name[TIMELINE_NAME_LENGTH];
+};
+
+struct TimelineMarker {
+    long long position;
+    char name[TIMELINE_NAME_LENGTH];
+};
+
+/*
+    Interval index over the clips: flat arrays sorted by start, with maxEnds laid
+    out as an implicit balanced tree (the node for [low, high) sits at the middle
+    index and stores the largest end below it). Range queries cost O(log n + k)
+    and never allocate; edits keep the arrays sorted with one insert and a
+    linear maxEnds refresh instead of a full re-sort.
+*/
+struct TimelineIndex {
+    std::vector<long long> starts;
+    std::vector<long long> ends;
+    std::vector<long long> maxEnds;
+    std::vector<unsigned> clips;
+};
+
+struct Timeline {
+    std::vector<TimelineTrack> tracks;
+    std::vector<TimelineClip> clips;
+    std::vector<TimelineRegion> regions;
+    std::vector<TimelineMarker> markers;
+    TimelineIndex index;
+};
+
+int AddTimelineTrack(Timeline* timeline, const char* name);
+int AddTimelineClip(Timeline* timeline, const TimelineClip& clip);
+int AddTimelineClips(Timeline* timeline, const TimelineClip* clips, int count);
+bool MoveTimelineClip(Timeline* timeline, int clip, long long start);
+bool RemoveTimelineClip(Timeline* timeline, int clip);
+
+/* replaces one clip in place (or appends when clip is the clip count) and re-indexes only it */
+bool SetTimelineClip(Timeline* timeline, int clip, const TimelineClip& data);
+bool PopTimelineClip(Timeline* timeline);
+
+int AddTimelineRegion(Timeline* timeline, long long start, long long length, const char* name);
+int AddTimelineMarker(Timeline* timeline, long long position, const char* name);
+
+bool BuildTimelineIndex(Timeline* timeline);
+
+/* clips overlapping [start, end); returns how many overlap, writing at most capacity of them */
+int QueryTimelineClips(const Timeline* timeline, long long start, long long end, unsigned* results, int capacity);
+
+/* markers inside [start, end); returns how many and the first one through first */
+int FindTimelineMarkers(const Timeline* timeline, long long start, long long end, int* first);
+
+long long GetTimelineLength(const Timeline* timeline);
@@ -0,0 +1,280 @@
+#include"Trace.h"
+#include"Log.h"
+
+#include<algorithm>
+#include<atomic>
+#include<climits>
+#include<cstdio>
+#include<ctime>
+#include<vector>
+
+using namespace std;
+
+/* single producer, the owning thread; readers copy and then drop whatever the producer lapped meanwhile */
+struct TraceRing {
+    atomic<bool> owned;
+    atomic<unsigned long long> head;
+    char name[TRACE_THREAD_NAME_LENGTH];
+    TraceEvent events[TRACE_RING_EVENTS];
+};
+
+struct Trace {
+    TraceRing rings[TRACE_MAX_THREADS];
+    atomic<bool> enabled{ true };
+    atomic<unsigned long long> unowned;
+
+    atomic<unsigned long long> xrunTicks;
+    atomic<bool> xrunSaving{ true };
+
+    /* UI thread */
+    unsigned long long lastXrunSave;
+};
+
+static Trace ApplicationTrace;
+static thread_local TraceRing* TraceThreadRing = NULL;
+static const unsigned long long TraceEpochTicks = ReadEngineTicks();
+
+void SetTraceEnabled(bool enabled)
+{
+    ApplicationTrace.enabled.store(enabled, memory_order_relaxed);
+}
+
+bool IsTraceEnabled()
+{
+    return ApplicationTrace.enabled.load(memory_order_relaxed);
+}
+
+/* claimed from a fixed pool on the first event, so even that event does not allocate */
+static TraceRing* GetTraceRing()
+{
+    TraceRing* ring = TraceThreadRing;
+    if (ring != NULL)
+        return ring;
+
+    for (int r = 0; r < TRACE_MAX_THREADS; r++)
+    {
+        TraceRing& candidate = ApplicationTrace.rings[r];
+        if (!candidate.owned.load(memory_order_relaxed) && !candidate.owned.exchange(true, memory_order_acquire))
+        {
+
+            snprintf(candidate.name, TRACE_THREAD_NAME_LENGTH, "Thread %d", r);
+            TraceThreadRing = &candidate;
+            return &candidate;
+        }
+    }
+
+    ApplicationTrace.unowned.fetch_add(1, memory_order_relaxed);
+    return NULL;
+}
+
+void SetTraceThreadName(const char* name)
+{
+    TraceRing* ring = GetTraceRing();
+    if (ring != NULL)
+        snprintf(ring->name, TRACE_THREAD_NAME_LENGTH, "%s", name);
+}
+
+void ReleaseTraceThread()
+{
+    TraceRing* ring = TraceThreadRing;
+    if (ring == NULL)
+        return;
+
+    TraceThreadRing = NULL;
+    ring->owned.store(false, memory_order_release);
+}
+
+static void RecordTraceEvent(const char* name, unsigned long long start, unsigned long long ticks, int argument, int type)
+{
+    if (!ApplicationTrace.enabled.load(memory_order_relaxed))
+        return;
+
+    TraceRing* ring = GetTraceRing();
+    if (ring == NULL)
+        return;
+
+    const unsigned long long head = ring->head.load(memory_order_relaxed);
+    TraceEvent& event = ring->events[head % TRACE_RING_EVENTS];
+    event.start = start;
+    event.ticks = ticks;
+    event.name = name;
+    event.argument = argument;
+    event.type = type;
+    ring->head.store(head + 1, memory_order_release);
+}
+
+void WriteTraceEvent(const char* name, unsigned long long start, unsigned long long ticks, int argument)
+{
+    RecordTraceEvent(name, start, ticks, argument, TRACE_EVENT_COMPLETE);
+}
+
+void MarkTraceXrun()
+{
+    if (!ApplicationTrace.enabled.load(memory_order_relaxed))
+        return;
+
+    const unsigned long long now = ReadEngineTicks();
+    RecordTraceEvent(TRACE_XRUN_NAME, now, 0, TRACE_NO_ARGUMENT, TRACE_EVENT_INSTANT);
+
+    /* the first underrun of a burst sets the window; the rest fall inside it */
+    unsigned long long expected = 0;
+    ApplicationTrace.xrunTicks.compare_exchange_strong(expected, now, memory_order_release, memory_order_relaxed);
+}
+
+/* copies the ring's events, oldest first, that the producer did not overwrite while they were copied */
+static int CopyTraceRing(TraceRing* ring, vector<TraceEvent>* events)
+{
+    const unsigned long long head = ring->head.load(memory_order_acquire);
+    const unsigned long long first = head > TRACE_RING_EVENTS ? head - TRACE_RING_EVENTS : 0;
+
+    const size_t offset = events->size();
+    for (unsigned long long position = first; position < head; position++)
+        events->push_back(ring->events[position % TRACE_RING_EVENTS]);
+
+    /* a slot the producer reached after the head was read belongs to an event TRACE_RING_EVENTS newer */
+    atomic_thread_fence(memory_order_acquire);
+    const unsigned long long lapped = ring->head.load(memory_order_relaxed);
+    const unsigned long long valid = lapped >= TRACE_RING_EVENTS ? lapped - TRACE_RING_EVENTS + 1 : 0;
+    if (valid > first)
+        events->erase(events->begin() + offset, events->begin() + offset + (size_t)min(valid - first, head - first));
+
+    return (int)(events->size() - offset);
+}
+
+static void WriteTraceString(FILE* file, const char* text)
+{
+    fputc('"', file);
+    for (const char* c = text; *c != '\0'; c++)
+    {
+        if (*c == '"' || *c == '\\')
+            fprintf(file, "\\%c", *c);
+        else if ((unsigned char)*c < 0x20)
+            fprintf(file, "\\u%04x", (unsigned char)*c);
+        else
+            fputc(*c, file);
+    }
+    fputc('"', file);
+}
+
+static bool SaveTraceWindow(const char* path, unsigned long long from, unsigned long long to)
+{
+    FILE* file = fopen(path, "w");
+    if (file == NULL)
+    {
+
+        LogMessage(LOG_ERROR, "The trace %s could not be written.", path);
+        return false;
+    }
+
+    const double microsecondsPerTick = GetEngineTickSeconds() * 1e6;
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"api.daw\"}}");
+
+    vector<TraceEvent> events;
+    events.reserve(TRACE_RING_EVENTS);
+    int written = 0;
+    for (int r = 0; r < TRACE_MAX_THREADS; r++)
+    {
+        TraceRing& ring = ApplicationTrace.rings[r];
+        events.clear();
+        if (CopyTraceRing(&ring, &events) == 0)
+            continue;
+
+        bool named = false;
+        for (const TraceEvent& event : events)
+        {
+            if (event.start + event.ticks < from || event.start > to)
+                continue;
+
+            if (!named)
+            {
+
+                fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":", r);
+                WriteTraceString(file, ring.name);
+                fprintf(file, "}}");
+                named = true;
+            }
+
+            const double timestamp = (double)(long long)(event.start - TraceEpochTicks) * microsecondsPerTick;
+            fprintf(file, ",\n{\"name\":");
+            WriteTraceString(file, event.name);
+            if (event.type == TRACE_EVENT_INSTANT)
+                fprintf(file, ",\"ph\":\"i\",\"s\":\"g\",\"ts\":%.3f,\"pid\":1,\"tid\":%d", timestamp, r);
+            else
+                fprintf(file, ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d", timestamp, event.ticks * microsecondsPerTick, r);
+            if (event.argument != TRACE_NO_ARGUMENT)
+                fprintf(file, ",\"args\":{\"argument\":%d}", event.argument);
+            fprintf(file, "}");
+            written++;
+        }
+    }
+
+    fprintf(file, "\n]}\n");
+    const bool failed = ferror(file) != 0;
+    fclose(file);
+    if (failed)
+    {
+
+        LogMessage(LOG_ERROR, "The trace %s could not be written.", path);
+        return false;
+    }
+
+    LogMessage(LOG_INFO, "Saved %d trace events to %s", written, path);
+    return true;
+}
+
+bool SaveTrace(const char* path, double seconds)
+{
+    const unsigned long long now = ReadEngineTicks();
+    const unsigned long long window = seconds > 0.0 ? (unsigned long long)(seconds / GetEngineTickSeconds()) : ULLONG_MAX;
+    return SaveTraceWindow(path, now > window ? now - window : 0, ULLONG_MAX);
+}
+
+void FormatTracePath(const char* prefix, char* path, size_t capacity)
+{
+    const time_t now = time(NULL);
+    char stamp[32];
+    strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", localtime(&now));
+    snprintf(path, capacity, "%s-%s.json", prefix, stamp);
+}
+
+bool PollTraceXrun(char* path, size_t capacity)
+{
+    Trace* trace = &ApplicationTrace;
+    const unsigned long long xrun = trace->xrunTicks.load(memory_order_acquire);
+    if (xrun == 0)
+        return false;
+
+    const double tickSeconds = GetEngineTickSeconds();
+    const unsigned long long now = ReadEngineTicks();
+    if ((now - xrun) * tickSeconds < TRACE_XRUN_AFTER_SECONDS)
+        return false;
+    trace->xrunTicks.store(0, memory_order_relaxed);
+
+    /* a device that keeps underrunning would otherwise fill the disk */
+    if (!trace->xrunSaving.load(memory_order_relaxed) || (trace->lastXrunSave != 0 && (xrun - trace->lastXrunSave) * tickSeconds < TRACE_XRUN_INTERVAL_SECONDS))
+        return false;
+    trace->lastXrunSave = xrun;
+
+    const unsigned long long before = (unsigned long long)(TRACE_XRUN_BEFORE_SECONDS / tickSeconds);
+    FormatTracePath("trace-xrun", path, capacity);
+    return SaveTraceWindow(path, xrun > before ? xrun - before : 0, ULLONG_MAX);
+}
+
+void SetTraceXrunSaving(bool saving)
+{
+    ApplicationTrace.xrunSaving.store(saving, memory_order_relaxed);
+}
+
+bool IsTraceXrunSaving()
+{
+    return ApplicationTrace.xrunSaving.load(memory_order_relaxed);
+}
+
+unsigned long long GetTraceEventCount()
+{
+    unsigned long long count = 0;
+    for (const TraceRing& ring : ApplicationTrace.rings)
+        count += ring.head.load(memory_order_relaxed);
+    return count;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include<cstddef>
+
+#include"EngineThreads.h"
+
+/*api.daw trace*/
+#define TRACE_MAX_THREADS 16
+#define TRACE_RING_EVENTS 8192
+#define TRACE_THREAD_NAME_LENGTH 32
+#define TRACE_PATH_LENGTH 260
+#define TRACE_NO_ARGUMENT -1
+#define TRACE_XRUN_BEFORE_SECONDS 2.0
+#define TRACE_XRUN_AFTER_SECONDS 0.5
+#define TRACE_XRUN_INTERVAL_SECONDS 10.0
+#define TRACE_XRUN_NAME "Underrun"
+
+#define TRACE_EVENT_COMPLETE 0
+#define TRACE_EVENT_INSTANT 1
+
+/*
+    A flight recorder for the timeline: every thread writes its own ring of timed events,
+    stamped with the time stamp counter and overwriting the oldest, so recording never waits
+    and never allocates. The name must outlive the trace, a literal or a node's name; the
+    argument is a frame count, a node index or TRACE_NO_ARGUMENT. Nothing is formatted until
+    the rings are saved as Chrome trace JSON, which Perfetto and chrome://tracing open.
+*/
+struct TraceEvent {
+    unsigned long long start;
+    unsigned long long ticks;
+    const char* name;
+    int argument;
+    int type;
+};
+
+void SetTraceEnabled(bool enabled);
+bool IsTraceEnabled();
+
+/* names the calling thread's track in the timeline */
+void SetTraceThreadName(const char* name);
+
+/* gives the calling thread's ring back; its events stay until the next owner overwrites them */
+void ReleaseTraceThread();
+
+void WriteTraceEvent(const char* name, unsigned long long start, unsigned long long ticks, int argument = TRACE_NO_ARGUMENT);
+
+/* audio thread: marks the underrun and asks the UI thread to save the seconds around it */
+void MarkTraceXrun();
+
+/* times its own scope; with the trace off it reads no ticks */
+struct TraceScope {
+    const char* name;
+    int argument;
+    unsigned long long start;
+
+    TraceScope(const char* name, int argument = TRACE_NO_ARGUMENT) : name(name), argument(argument), start(IsTraceEnabled() ? ReadEngineTicks() : 0) {}
+    ~TraceScope()
+    {
+        if (start != 0)
+            WriteTraceEvent(name, start, ReadEngineTicks() - start, argument);
+    }
+};
+
+/* prefix-YYYYmmdd-HHMMSS.json in the working directory */
+void FormatTracePath(const char* prefix, char* path, size_t capacity);
+
+/* writes the last seconds of every ring, or all of them when seconds is 0 */
+bool SaveTrace(const char* path, double seconds = 0.0);
+
+/* UI thread, once per frame: once TRACE_XRUN_AFTER_SECONDS have passed since an underrun, saves the window around it to a new file */
+bool PollTraceXrun(char* path, size_t capacity);
+void SetTraceXrunSaving(bool saving);
+bool IsTraceXrunSaving();
+
+unsigned long long GetTraceEventCount();
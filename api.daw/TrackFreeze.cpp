@@ -0,0 +1,446 @@
+#include"TrackFreeze.h"
+#include"EngineThreads.h"
+#include"Trace.h"
+#include"Log.h"
+
+#include<algorithm>
+#include<cstdio>
+#include<cstring>
+#include<vector>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include<windows.h>
+#else
+#include<sys/stat.h>
+#endif
+
+using namespace std;
+
+/* An offline render reads the cache file itself instead of going through the streamer. */
+struct TrackFreezeReader {
+    SNDFILE* file;
+    int channelCount;
+    long long frameCount;
+    long long position;
+    vector<float> interleaved;
+};
+
+static bool ReadTrackFreezeReader(TrackFreezeReader* reader, EngineNodeContext* context)
+{
+    const int read = (int)max(0ll, min((long long)context->frameCount, reader->frameCount - reader->position));
+    const int got = read > 0 ? (int)sf_readf_float(reader->file, reader->interleaved.data(), read) : 0;
+    for (int c = 0; c < context->channelCount; c++)
+    {
+        const int source = min(c, reader->channelCount - 1);
+        for (int n = 0; n < got; n++)
+            context->channels[c][n] = reader->interleaved[(size_t)n * reader->channelCount + source];
+        memset(context->channels[c] + got, 0, sizeof(float) * (context->frameCount - got));
+    }
+    reader->position += context->frameCount;
+
+    return got == read;
+}
+
+static bool ProcessTrackFreezeNode(void* state, EngineNodeContext* context)
+{
+    TrackFreeze* freeze = (TrackFreeze*)state;
+    if (freeze->reader != NULL)
+        return ReadTrackFreezeReader(freeze->reader, context);
+
+    DiskStream* stream = freeze->stream.load(memory_order_acquire);
+    if (stream == NULL)
+    {
+
+        for (int c = 0; c < context->channelCount; c++)
+            memset(context->channels[c], 0, sizeof(float) * context->frameCount);
+        return true;
+    }
+
+    return ReadDiskStream(stream, context->channels, context->channelCount, context->frameCount);
+}
+
+/* a copy with no stream and no thread, only the reader */
+static void* CloneTrackFreezeNode(void* state, Engine* destination)
+{
+    TrackFreeze* freeze = (TrackFreeze*)state;
+    if (freeze->state != TRACK_FREEZE_FROZEN)
+    {
+
+        LogMessage(LOG_ERROR, "The frozen track has not finished rendering.");
+        return NULL;
+    }
+
+    SF_INFO info;
+    memset(&info, 0, sizeof(info));
+    SNDFILE* file = sf_open(freeze->path, SFM_READ, &info);
+    if (file == NULL)
+    {
+
+        LogMessage(LOG_ERROR, "The freeze file %s could not be opened.", freeze->path);
+        return NULL;
+    }
+
+    TrackFreezeReader* reader = new TrackFreezeReader();
+    reader->file = file;
+    reader->channelCount = info.channels;
+    reader->frameCount = min((long long)info.frames, freeze->frameCount);
+    reader->position = 0;
+    reader->interleaved.assign((size_t)destination->blockSize * info.channels, 0.0f);
+
+    TrackFreeze* clone = new TrackFreeze();
+    clone->engine = destination;
+    clone->node = ENGINE_NO_NODE;
+    clone->state = TRACK_FREEZE_FROZEN;
+    clone->stream.store(NULL);
+    clone->reader = reader;
+    return clone;
+}
+
+static void ReleaseTrackFreezeClone(void* state)
+{
+    TrackFreeze* clone = (TrackFreeze*)state;
+    sf_close(clone->reader->file);
+    delete clone->reader;
+    delete clone;
+}
+
+static bool SeekTrackFreezeClone(void* state, long long frame)
+{
+    TrackFreezeReader* reader = ((TrackFreeze*)state)->reader;
+    reader->position = frame;
+    return frame >= reader->frameCount || sf_seek(reader->file, (sf_count_t)frame, SEEK_SET) >= 0;
+}
+
+static long long GetTrackFreezeTail(void*)
+{
+    return 0;
+}
+
+int AddTrackFreezeNode(Engine* engine, TrackFreeze* freeze, DiskStreamer* streamer, int sourceNode, const char* directory)
+{
+    freeze->engine = engine;
+    freeze->streamer = streamer;
+    freeze->sourceNode = sourceNode;
+    snprintf(freeze->directory, TRACK_FREEZE_PATH_LENGTH, "%s", directory);
+    freeze->path[0] = '\0';
+
+    freeze->state = TRACK_FREEZE_OFF;
+    freeze->renderEngine = NULL;
+    freeze->frameCount = 0;
+    freeze->hash = 0;
+    freeze->cached = false;
+    freeze->playing = false;
+    freeze->seekFrame = 0;
+    freeze->renderedFrames.store(0);
+    freeze->rendered.store(false);
+    freeze->cancelled.store(false);
+    freeze->renderSucceeded = false;
+    freeze->renderMilliseconds = 0.0;
+    freeze->stream.store(NULL);
+    freeze->reader = NULL;
+
+    freeze->node = AddEngineNode(engine, "Freeze", freeze, ProcessTrackFreezeNode, false);
+    SetEngineNodeClone(engine, freeze->node, CloneTrackFreezeNode, ReleaseTrackFreezeClone);
+    SetEngineNodeSeek(engine, freeze->node, SeekTrackFreezeClone);
+    SetEngineNodeTail(engine, freeze->node, GetTrackFreezeTail);
+    return freeze->node;
+}
+
+static void BeginTrackFreezeSettle(TrackFreeze* freeze)
+{
+    freeze->settleFrames = freeze->engine->renderedFrames.load(memory_order_relaxed);
+    freeze->settleStart = chrono::steady_clock::now();
+}
+
+/* true once the audio thread can no longer be running the schedule from before the rewiring */
+static bool IsTrackFreezeSettled(TrackFreeze* freeze)
+{
+    Engine* engine = freeze->engine;
+    if (engine->pendingSchedule.load(memory_order_acquire) == NULL)
+        return true;
+
+    /* an engine nobody processes never picks the schedule up, but it does not run the old one either */
+    const unsigned long long frames = engine->renderedFrames.load(memory_order_relaxed);
+    if (frames != freeze->settleFrames)
+    {
+
+        BeginTrackFreezeSettle(freeze);
+        return false;
+    }
+
+    return chrono::steady_clock::now() - freeze->settleStart >= chrono::milliseconds(TRACK_FREEZE_SETTLE_MILLISECONDS);
+}
+
+bool FreezeTrack(TrackFreeze* freeze, long long frameCount)
+{
+    if (freeze->state != TRACK_FREEZE_OFF || frameCount <= 0)
+        return false;
+
+    freeze->frameCount = frameCount;
+    freeze->state = TRACK_FREEZE_BYPASSING;
+    BeginTrackFreezeSettle(freeze);
+    return true;
+}
+
+bool UnfreezeTrack(TrackFreeze* freeze)
+{
+    if (freeze->state != TRACK_FREEZE_FROZEN)
+        return false;
+
+    freeze->state = TRACK_FREEZE_RELEASING;
+    BeginTrackFreezeSettle(freeze);
+    return true;
+}
+
+bool IsTrackFreezeBypassing(const TrackFreeze* freeze)
+{
+    return freeze->state == TRACK_FREEZE_BYPASSING || freeze->state == TRACK_FREEZE_RENDERING || freeze->state == TRACK_FREEZE_FROZEN;
+}
+
+static bool CreateTrackFreezeDirectory(const char* directory)
+{
+#if defined(_WIN32)
+    return CreateDirectoryA(directory, NULL) != 0 || GetLastError() == ERROR_ALREADY_EXISTS;
+#else
+    struct stat status;
+    return mkdir(directory, 0755) == 0 || (stat(directory, &status) == 0 && S_ISDIR(status.st_mode));
+#endif
+}
+
+static void DestroyTrackFreezeEngine(TrackFreeze* freeze)
+{
+    if (freeze->renderEngine == NULL)
+        return;
+
+    ReleaseEngineClones(freeze->renderEngine);
+    DestroyEngine(freeze->renderEngine);
+    freeze->renderEngine = NULL;
+}
+
+static void RenderTrackFreeze(TrackFreeze* freeze)
+{
+    SetTraceThreadName("Freeze render");
+    const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    Engine* engine = freeze->engine;
+    Engine* offline = freeze->renderEngine;
+    bool succeeded = false;
+
+    /* the chain runs in its own engine, so nothing here touches the live schedule */
+    char temporary[TRACK_FREEZE_FILE_LENGTH + 8];
+    snprintf(temporary, sizeof(temporary), "%s.tmp", freeze->path);
+
+    SF_INFO info;
+    memset(&info, 0, sizeof(info));
+    info.samplerate = engine->sampleRate;
+    info.channels = engine->channelCount;
+    info.format = SF_FORMAT_WAV | SF_FORMAT_FLOAT;
+    SNDFILE* file = sf_open(temporary, SFM_WRITE, &info);
+    if (file != NULL)
+    {
+
+        vector<float> storage((size_t)engine->blockSize * engine->channelCount);
+        vector<float> interleaved((size_t)engine->blockSize * engine->channelCount);
+        float* channels[ENGINE_MAX_CHANNELS];
+        for (int c = 0; c < engine->channelCount; c++)
+            channels[c] = storage.data() + (size_t)c * engine->blockSize;
+
+        /* the chain's latency is rendered and dropped so the frozen audio lines up with frame 0 */
+        const long long latency = GetEngineOutputLatency(offline);
+        const long long total = freeze->frameCount + latency;
+        long long position = 0;
+        succeeded = true;
+        while (position < total && succeeded && !freeze->cancelled.load(memory_order_relaxed))
+        {
+            const int frameCount = (int)min((long long)engine->blockSize, total - position);
+            ProcessEngineBlock(offline, channels, frameCount);
+
+            const int skipped = (int)max(0ll, min((long long)frameCount, latency - position));
+            const int written = frameCount - skipped;
+            for (int n = 0; n < written; n++)
+            {
+                for (int c = 0; c < engine->channelCount; c++)
+                    interleaved[(size_t)n * engine->channelCount + c] = channels[c][skipped + n];
+            }
+            succeeded = sf_writef_float(file, interleaved.data(), written) == written;
+
+            position += frameCount;
+            freeze->renderedFrames.store(max(0ll, position - latency), memory_order_relaxed);
+        }
+        sf_close(file);
+
+        succeeded = succeeded && position >= total;
+        if (succeeded)
+        {
+
+            remove(freeze->path);
+            succeeded = rename(temporary, freeze->path) == 0;
+        }
+        if (!succeeded)
+            remove(temporary);
+    }
+
+    if (!succeeded && !freeze->cancelled.load(memory_order_relaxed))
+        LogMessage(LOG_ERROR, "The track %s could not be frozen.", engine->nodes[freeze->sourceNode].name);
+
+    freeze->renderSucceeded = succeeded;
+    freeze->renderMilliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    freeze->rendered.store(true, memory_order_release);
+}
+
+/* a cache file is used when it holds at least the frames asked for */
+static bool OpenTrackFreezeStream(TrackFreeze* freeze)
+{
+    FILE* file = fopen(freeze->path, "rb");
+    if (file == NULL)
+        return false;
+    fclose(file);
+
+    DiskStream* stream = OpenDiskStream(freeze->streamer, freeze->path);
+    if (stream == NULL)
+        return false;
+    if (stream->frameCount < freeze->frameCount)
+    {
+
+        CloseDiskStream(freeze->streamer, stream);
+        return false;
+    }
+
+    SeekDiskStream(stream, freeze->seekFrame);
+    SetDiskStreamPlaying(stream, freeze->playing);
+    freeze->stream.store(stream, memory_order_release);
+    return true;
+}
+
+bool UpdateTrackFreeze(TrackFreeze* freeze)
+{
+    if (freeze->state == TRACK_FREEZE_BYPASSING)
+    {
+
+        if (!IsTrackFreezeSettled(freeze))
+            return false;
+
+        if (!HashEngineNodes(freeze->engine, freeze->sourceNode, &freeze->hash))
+        {
+
+            LogMessage(LOG_ERROR, "The track %s cannot be frozen: a node in its chain has no state hash.", freeze->engine->nodes[freeze->sourceNode].name);
+            freeze->state = TRACK_FREEZE_OFF;
+            return true;
+        }
+
+        /* the format of the render belongs in the key as much as the chain itself */
+        const int format[3] = {freeze->engine->sampleRate, freeze->engine->blockSize, freeze->engine->channelCount};
+        freeze->hash = HashEngineBytes(freeze->hash, format, sizeof(format));
+        snprintf(freeze->path, TRACK_FREEZE_FILE_LENGTH, "%s/freeze-%016llx.wav", freeze->directory, freeze->hash);
+
+        freeze->cached = OpenTrackFreezeStream(freeze);
+        if (freeze->cached)
+        {
+
+            freeze->renderedFrames.store(freeze->frameCount);
+            freeze->renderMilliseconds = 0.0;
+            freeze->state = TRACK_FREEZE_FROZEN;
+            return false;
+        }
+
+        if (!CreateTrackFreezeDirectory(freeze->directory))
+        {
+
+            LogMessage(LOG_ERROR, "The freeze directory %s could not be created.", freeze->directory);
+            freeze->state = TRACK_FREEZE_OFF;
+            return true;
+        }
+
+        /*
+            the chain is cloned here, where the graph cannot change underneath, into an engine of its
+            own and rendered from frame 0, so the bounce matches its key and the live states carry on
+        */
+        Engine* engine = freeze->engine;
+        freeze->renderEngine = CreateEngine(engine->sampleRate, engine->blockSize, engine->channelCount);
+        int copies[ENGINE_MAX_NODES];
+        for (int n = 0; n < ENGINE_MAX_NODES; n++)
+            copies[n] = ENGINE_NO_NODE;
+        const int output = freeze->renderEngine != NULL ? CloneEngineNodes(engine, freeze->sourceNode, freeze->renderEngine, copies) : ENGINE_NO_NODE;
+        const bool prepared = output != ENGINE_NO_NODE && SetEngineOutputNode(freeze->renderEngine, output) && CompileEngineGraph(freeze->renderEngine);
+        if (!prepared || !SeekEngineNodes(freeze->renderEngine, 0))
+        {
+
+            DestroyTrackFreezeEngine(freeze);
+            LogMessage(LOG_ERROR, "The track %s could not be copied for freezing.", engine->nodes[freeze->sourceNode].name);
+            freeze->state = TRACK_FREEZE_OFF;
+            return true;
+        }
+
+        freeze->renderedFrames.store(0);
+        freeze->rendered.store(false);
+        freeze->cancelled.store(false);
+        freeze->thread = CreateEngineThread(RenderTrackFreeze, freeze);
+        freeze->state = TRACK_FREEZE_RENDERING;
+        return false;
+    }
+
+    if (freeze->state == TRACK_FREEZE_RENDERING)
+    {
+
+        if (!freeze->rendered.load(memory_order_acquire))
+            return false;
+
+        freeze->thread.join();
+        DestroyTrackFreezeEngine(freeze);
+        if (freeze->renderSucceeded && OpenTrackFreezeStream(freeze))
+        {
+
+            freeze->state = TRACK_FREEZE_FROZEN;
+            return false;
+        }
+
+        freeze->state = TRACK_FREEZE_OFF;
+        return true;
+    }
+
+    if (freeze->state == TRACK_FREEZE_RELEASING)
+    {
+
+        if (!IsTrackFreezeSettled(freeze))
+            return false;
+
+        CloseDiskStream(freeze->streamer, freeze->stream.exchange(NULL));
+        freeze->state = TRACK_FREEZE_OFF;
+        return false;
+    }
+
+    return false;
+}
+
+bool SetTrackFreezePlaying(TrackFreeze* freeze, bool playing)
+{
+    freeze->playing = playing;
+
+    DiskStream* stream = freeze->stream.load(memory_order_relaxed);
+    return stream == NULL || SetDiskStreamPlaying(stream, playing);
+}
+
+bool SeekTrackFreeze(TrackFreeze* freeze, long long frame)
+{
+    if (frame < 0)
+        return false;
+    freeze->seekFrame = frame;
+
+    DiskStream* stream = freeze->stream.load(memory_order_relaxed);
+    return stream == NULL || SeekDiskStream(stream, frame);
+}
+
+bool ReleaseTrackFreeze(TrackFreeze* freeze)
+{
+    if (freeze->thread.joinable())
+    {
+
+        freeze->cancelled.store(true);
+        freeze->thread.join();
+    }
+    DestroyTrackFreezeEngine(freeze);
+
+    CloseDiskStream(freeze->streamer, freeze->stream.exchange(NULL));
+    freeze->state = TRACK_FREEZE_OFF;
+    return true;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include<atomic>
+#include<chrono>
+#include<thread>
+
+#include"DiskStreamer.h"
+#include"Engine.h"
+
+/*api.daw track freeze*/
+#define TRACK_FREEZE_PATH_LENGTH 260
+#define TRACK_FREEZE_FILE_LENGTH (TRACK_FREEZE_PATH_LENGTH + 32)
+#define TRACK_FREEZE_DEFAULT_DIRECTORY "freeze"
+#define TRACK_FREEZE_SETTLE_MILLISECONDS 250
+
+#define TRACK_FREEZE_OFF 0
+#define TRACK_FREEZE_BYPASSING 1
+#define TRACK_FREEZE_RENDERING 2
+#define TRACK_FREEZE_FROZEN 3
+#define TRACK_FREEZE_RELEASING 4
+
+struct TrackFreezeReader;
+
+/*
+    Freezing renders sourceNode and everything upstream of it into a cache file and plays
+    that file through node instead. The caller owns the wiring: while the freeze bypasses
+    the chain, connect node where sourceNode used to go and recompile, so the chain drops
+    out of the live schedule. Once the audio thread has picked that schedule up, the chain
+    is hashed and, unless freeze-<hash>.wav already holds enough frames, copied into a
+    private engine and rendered faster than realtime on a worker thread.
+*/
+struct TrackFreeze {
+    Engine* engine;
+    DiskStreamer* streamer;
+    int sourceNode;
+    int node;
+    char directory[TRACK_FREEZE_PATH_LENGTH];
+    /* the directory, then /freeze-<hash>.wav */
+    char path[TRACK_FREEZE_FILE_LENGTH];
+
+    /* owned by the UI thread */
+    int state;
+    long long frameCount;
+    unsigned long long hash;
+    bool cached;
+    bool playing;
+    long long seekFrame;
+    unsigned long long settleFrames;
+    std::chrono::steady_clock::time_point settleStart;
+
+    Engine* renderEngine;
+    std::thread thread;
+    std::atomic<long long> renderedFrames;
+    std::atomic<bool> rendered;
+    std::atomic<bool> cancelled;
+    bool renderSucceeded;
+    double renderMilliseconds;
+
+    /* read by the audio thread */
+    std::atomic<DiskStream*> stream;
+
+    /* set only on the private copy an offline render makes, which reads the cache file directly */
+    TrackFreezeReader* reader;
+};
+
+int AddTrackFreezeNode(Engine* engine, TrackFreeze* freeze, DiskStreamer* streamer, int sourceNode, const char* directory = TRACK_FREEZE_DEFAULT_DIRECTORY);
+
+/* both return true when the chain must be rewired: recompile with IsTrackFreezeBypassing deciding the route */
+bool FreezeTrack(TrackFreeze* freeze, long long frameCount);
+bool UnfreezeTrack(TrackFreeze* freeze);
+
+/* UI thread, once per frame: advances the freeze; true when the wiring must change */
+bool UpdateTrackFreeze(TrackFreeze* freeze);
+bool IsTrackFreezeBypassing(const TrackFreeze* freeze);
+
+bool SetTrackFreezePlaying(TrackFreeze* freeze, bool playing);
+bool SeekTrackFreeze(TrackFreeze* freeze, long long frame);
+
+/* stops a render in progress and closes the stream; the node must be out of the schedule */
+bool ReleaseTrackFreeze(TrackFreeze* freeze);
@@ -1,4 +1,9 @@
 #include<iostream>
+#include<cfloat>
+#include<chrono>
+#include<cstring>
+#include<string>
+#include<vector>
 
 #include"imgui/imgui.h"
 #include"imgui/imgui_impl_glfw.h"
@@ -7,6 +12,34 @@
 #include"AL/al.h"
 #include"AL/alc.h"
 
+#include"Engine.h"
+#include"AudioStream.h"
+#include"PluginHost.h"
+#include"PluginSandbox.h"
+#include"Mixer.h"
+#include"MixerKernels.h"
+#include"MidiFile.h"
+#include"MidiPlayer.h"
+#include"TempoMap.h"
+#include"Project.h"
+#include"ProjectFile.h"
+#include"ProjectHistory.h"
+#include"Autosave.h"
+#include"DiskStreamer.h"
+#include"TrackFreeze.h"
+#include"EngineThreads.h"
+#include"RealtimeSafety.h"
+#include"Log.h"
+#include"PerformanceMonitor.h"
+#include"Trace.h"
+#include"Convolution.h"
+#include"Dynamics.h"
+#include"DelayLine.h"
+#include"TimeStretch.h"
+#include"Batch.h"
+#include"Export.h"
+#include"Import.h"
+
 #include<glad/glad.h>
 #include<GLFW/glfw3.h>
 
@@ -14,6 +47,7 @@
 #include <corecrt_math_defines.h>
 
 #define APPLICATION_NAME "DAW Application"
+#define APPLICATION_LOG_PATH "api.daw.log"
 
 using namespace std;
 
@@ -29,7 +63,7 @@ bool OpenApplicationWindow(GLFWwindow* window)
         return true;
     }
     else {
-        printf("The application window generated an error.");
+        LogMessage(LOG_ERROR, "The application window generated an error.");
         glfwTerminate();
         return false;
     }
@@ -144,13 +178,10 @@ bool DrawApplicationWindowBackground()
     return true;
 }
 
-#define APPLICATION_GLOBAL_SAMPLERATE 100
-#define SAMPLE_RATE 44100
-#define BUFFER_SECONDS 1
+#define APPLICATION_SAMPLE_RATE 44100
 #define WAVE_FREQUENCY 50
-#define CHANNEL_COUNT 1
-#define BUFFER_LENGTH (SAMPLE_RATE * BUFFER_SECONDS)
-#define BUFFER_SIZE 1
+#define CHANNEL_COUNT 2
+#define BLOCK_SIZE 512
 
 bool DrawPluginOscilloscope(const char* label, float* yPoints, float* xPoints, const int nyquistLimit)
 {
@@ -182,6 +213,1180 @@ bool SetPluginOptions()
     return true;
 }
 
+Engine* AudioEngine;
+AudioStream ApplicationAudioStream;
+EngineOscillator ApplicationOscillator;
+int OscillatorNode = ENGINE_NO_NODE;
+int TrackNode = ENGINE_NO_NODE;
+Mixer* ApplicationMixer;
+MidiSynth ApplicationSynth;
+Project ApplicationProject;
+ProjectHistory ApplicationHistory;
+int SynthNode = ENGINE_NO_NODE;
+DiskStreamer ApplicationStreamer;
+TrackFreeze TrackOneFreeze;
+int FreezeSeconds = 30;
+PerformanceMonitor ApplicationPerformance;
+ConvolutionPool ApplicationConvolutionPool;
+ConvolutionReverb ApplicationReverb;
+int ReverbNode = ENGINE_NO_NODE;
+Dynamics MasterDynamics;
+DelayEffect ApplicationDelay;
+PitchShifter ApplicationPitch;
+
+PluginLibrary PluginLibraries[PLUGIN_MAX_LIBRARIES];
+int PluginLibraryCount = 0;
+vector<PluginInstance*> PluginChain;
+PluginSandboxReport PluginSandboxReports[PLUGIN_MAX_LIBRARIES];
+#define PLUGIN_SANDBOX_MEASUREMENT_BLOCKS 2000
+
+bool ConfigureEngineGraph()
+{
+    /* oscillator -> plugin chain -> reverb -> delay -> pitch shift -> track -> mixer -> master dynamics, or the frozen chain -> reverb -> track while it is bypassed */
+    int previous = OscillatorNode;
+    for (PluginInstance* plugin : PluginChain)
+    {
+        ClearEngineNodeInputs(AudioEngine, plugin->node);
+        ConnectEngineNodes(AudioEngine, previous, plugin->node);
+        previous = plugin->node;
+    }
+
+    ClearEngineNodeInputs(AudioEngine, ReverbNode);
+    if (IsTrackFreezeBypassing(&TrackOneFreeze))
+        ConnectEngineNodes(AudioEngine, TrackOneFreeze.node, ReverbNode);
+    else {
+        TrackOneFreeze.sourceNode = previous;
+        ConnectEngineNodes(AudioEngine, previous, ReverbNode);
+    }
+    ClearEngineNodeInputs(AudioEngine, ApplicationDelay.node);
+    ConnectEngineNodes(AudioEngine, ReverbNode, ApplicationDelay.node);
+    ClearEngineNodeInputs(AudioEngine, ApplicationPitch.node);
+    ConnectEngineNodes(AudioEngine, ApplicationDelay.node, ApplicationPitch.node);
+    ClearEngineNodeInputs(AudioEngine, TrackNode);
+    ConnectEngineNodes(AudioEngine, ApplicationPitch.node, TrackNode);
+
+    return CompileEngineGraph(AudioEngine);
+}
+
+bool InsertPlugin(PluginLibrary* library, bool sandboxed)
+{
+    PluginInstance* plugin = CreatePluginInstance(library, AudioEngine->sampleRate, AudioEngine->blockSize, sandboxed);
+    if (plugin == NULL)
+        return false;
+
+    if (AddPluginNode(AudioEngine, plugin) == ENGINE_NO_NODE)
+    {
+
+        DestroyPluginInstance(plugin);
+        return false;
+    }
+
+    PluginChain.push_back(plugin);
+    return ConfigureEngineGraph();
+}
+
+bool DrawTrackFreeze()
+{
+    TrackFreeze* freeze = &TrackOneFreeze;
+    if (freeze->state == TRACK_FREEZE_OFF)
+    {
+
+        ImGui::SliderInt("Freeze length (s)", &FreezeSeconds, 1, 600);
+        if (ImGui::Button("Freeze track") && FreezeTrack(freeze, (long long)FreezeSeconds * AudioEngine->sampleRate))
+        {
+
+            MidiScheduler* scheduler = &ApplicationSynth.scheduler;
+            SeekTrackFreeze(freeze, scheduler->position.load());
+            SetTrackFreezePlaying(freeze, scheduler->playing.load());
+            ConfigureEngineGraph();
+        }
+        return true;
+    }
+
+    if (freeze->state == TRACK_FREEZE_FROZEN)
+    {
+
+        if (ImGui::Button("Unfreeze track") && UnfreezeTrack(freeze))
+            ConfigureEngineGraph();
+        ImGui::SameLine();
+
+        const double seconds = (double)freeze->frameCount / AudioEngine->sampleRate;
+        if (freeze->cached)
+            ImGui::Text("Frozen from cache, %.1f s", seconds);
+        else
+            ImGui::Text("Frozen %.1f s in %.2f ms (%.1fx realtime)", seconds, freeze->renderMilliseconds, seconds * 1000.0 / freeze->renderMilliseconds);
+
+        DiskStream* stream = freeze->stream.load();
+        ImGui::Text("%s, %u starved blocks", freeze->path, stream != NULL ? stream->starvedBlocks.load() : 0);
+        return true;
+    }
+
+    if (freeze->state == TRACK_FREEZE_RENDERING)
+        ImGui::ProgressBar((float)freeze->renderedFrames.load() / freeze->frameCount, ImVec2(-1.0f, 0.0f), "Rendering");
+    else
+        ImGui::Text(freeze->state == TRACK_FREEZE_BYPASSING ? "Bypassing chain..." : "Releasing freeze...");
+
+    return true;
+}
+
+bool DrawPluginBrowser()
+{
+    if (ImGui::CollapsingHeader("Plugins"))
+    {
+
+        ImGui::Text("Output latency %d samples", GetEngineOutputLatency(AudioEngine));
+        DrawTrackFreeze();
+
+        if (PluginLibraryCount == 0)
+            ImGui::Text("No plugins found in %s or %s.", PLUGIN_DEFAULT_DIRECTORY, PLUGIN_PATH_VARIABLE);
+
+        for (int l = 0; l < PluginLibraryCount; l++)
+        {
+            ImGui::PushID(l);
+            if (ImGui::Button("Insert"))
+                InsertPlugin(&PluginLibraries[l], false);
+            ImGui::SameLine();
+            if (ImGui::Button("Insert sandboxed"))
+                InsertPlugin(&PluginLibraries[l], true);
+            ImGui::SameLine();
+            if (ImGui::Button("Measure sandbox"))
+            {
+
+                MeasurePluginSandboxOverhead(
+                    PluginLibraries[l].path, PluginLibraries[l].descriptor, AudioEngine->sampleRate, AudioEngine->blockSize,
+                    PLUGIN_SANDBOX_MEASUREMENT_BLOCKS, &PluginSandboxReports[l]
+                );
+            }
+            ImGui::SameLine();
+            ImGui::Text("%s (%s)", PluginLibraries[l].descriptor->name, PluginLibraries[l].descriptor->vendor);
+
+            const PluginSandboxReport& report = PluginSandboxReports[l];
+            if (report.blockCount > 0)
+            {
+
+                ImGui::Text(
+                    "In-process %.2f us, sandboxed %.2f us (worst %.2f us), overhead %.2f us per %d-sample block",
+                    report.inProcessMicroseconds, report.sandboxMicroseconds, report.sandboxWorstMicroseconds, report.overheadMicroseconds, report.blockSize
+                );
+            }
+            ImGui::PopID();
+        }
+
+        for (size_t i = 0; i < PluginChain.size(); i++)
+        {
+            PluginInstance* plugin = PluginChain[i];
+            ImGui::PushID((int)(PLUGIN_MAX_LIBRARIES + i));
+            ImGui::Separator();
+
+            bool bypassed = plugin->bypassed.load();
+            if (ImGui::Checkbox("Bypass", &bypassed))
+                SetPluginBypassed(plugin, bypassed);
+            ImGui::SameLine();
+            ImGui::Text("%s, latency %d samples", plugin->descriptor->name, plugin->latency.load());
+            if (plugin->sandbox != NULL)
+            {
+
+                ImGui::SameLine();
+                ImGui::Text(plugin->sandbox->crashed.load() ? "[sandbox exited]" : "[sandboxed, %u missed blocks]", plugin->sandbox->timeouts.load());
+            }
+
+            for (int p = 0; p < plugin->parameterCount; p++)
+            {
+                const DawPluginParameter& parameter = plugin->descriptor->parameters[p];
+                float value = GetPluginParameter(plugin, p);
+                if (ImGui::SliderFloat(parameter.name, &value, parameter.minimum, parameter.maximum))
+                    SetPluginParameter(plugin, p, value);
+            }
+            ImGui::PopID();
+        }
+    }
+
+    return true;
+}
+
+#define MIXER_BENCHMARK_BLOCKS 2000
+const int MixerBenchmarkTrackCounts[] = { 16, 64, 128, 256, 511 };
+#define MIXER_BENCHMARK_SIZES (int)(sizeof(MixerBenchmarkTrackCounts) / sizeof(int))
+MixerBenchmarkResult MixerBenchmarkResults[2 * MIXER_BENCHMARK_SIZES];
+int MixerBenchmarkResultCount = 0;
+EngineDenormalReport DenormalReport;
+bool DenormalChecked = false;
+
+/* the size the bank is built for: a 32-band EQ on 64 stereo tracks */
+#define EQ_BENCHMARK_TRACKS 64
+const char* EqTypeNames[FILTER_TYPE_COUNT] = { "Off", "Lowpass", "Highpass", "Bandpass", "Notch", "Bell", "Low shelf", "High shelf", "Allpass" };
+const char* EqKernelNames[] = { "scalar", "SSE   ", "AVX2  " };
+int EqBands[MIXER_MAX_TRACKS] = {};
+FilterBankBenchmarkResult EqBenchmarkResults[6];
+int EqBenchmarkResultCount = 0;
+
+bool DrawMixerStrip(MixerStrip* strip)
+{
+    ImGui::PushID(strip);
+    float gain = strip->gain.load();
+    float pan = strip->pan.load();
+    bool mute = strip->mute.load();
+    bool solo = strip->solo.load();
+
+    ImGui::Text("%s", strip->name);
+    if (ImGui::SliderFloat("Gain", &gain, 0.0f, 2.0f))
+        SetMixerStripGain(strip, gain);
+    if (ImGui::SliderFloat("Pan", &pan, -1.0f, 1.0f))
+        SetMixerStripPan(strip, pan);
+    if (ImGui::Checkbox("Mute", &mute))
+        SetMixerStripMute(strip, mute);
+    ImGui::SameLine();
+    if (ImGui::Checkbox("Solo", &solo))
+        SetMixerStripSolo(strip, solo);
+    ImGui::PopID();
+
+    return true;
+}
+
+bool DrawMixerTrackEq(int track)
+{
+    ImGui::PushID(track);
+    if (ImGui::TreeNode("EQ"))
+    {
+
+        int& band = EqBands[track];
+        ImGui::SliderInt("Band", &band, 0, MIXER_EQ_BANDS - 1);
+
+        FilterSettings settings;
+        GetMixerTrackEq(ApplicationMixer, track, band, &settings);
+        bool changed = ImGui::Combo("Type", &settings.type, EqTypeNames, FILTER_TYPE_COUNT);
+        changed |= ImGui::SliderFloat("Frequency", &settings.frequency, MIXER_EQ_MIN_FREQUENCY, MIXER_EQ_MAX_FREQUENCY, "%.0f Hz", ImGuiSliderFlags_Logarithmic);
+        changed |= ImGui::SliderFloat("Q", &settings.q, 0.1f, 18.0f, "%.2f", ImGuiSliderFlags_Logarithmic);
+        changed |= ImGui::SliderFloat("Gain dB", &settings.gain, -24.0f, 24.0f);
+        if (changed)
+            SetMixerTrackEq(ApplicationMixer, track, band, &settings);
+        ImGui::TreePop();
+    }
+    ImGui::PopID();
+
+    return true;
+}
+
+bool DrawMixer()
+{
+    if (ImGui::CollapsingHeader("Mixer"))
+    {
+
+        for (int t = 0; t < ApplicationMixer->trackCount.load(); t++)
+        {
+
+            DrawMixerStrip(&ApplicationMixer->tracks[t].strip);
+            DrawMixerTrackEq(t);
+        }
+        DrawMixerStrip(&ApplicationMixer->master);
+
+        ImGui::Separator();
+        if (ImGui::Button("Benchmark mix time"))
+        {
+
+            MixerBenchmarkResultCount = BenchmarkMixer(
+                AudioEngine->sampleRate, AudioEngine->blockSize, MixerBenchmarkTrackCounts, MIXER_BENCHMARK_SIZES, MIXER_BENCHMARK_BLOCKS, MixerBenchmarkResults
+            );
+        }
+        ImGui::SameLine();
+        ImGui::Text("AVX2 kernels %s", IsMixKernelAVX2() ? "active" : "unavailable");
+
+        for (int r = 0; r < MixerBenchmarkResultCount; r++)
+        {
+            const MixerBenchmarkResult& result = MixerBenchmarkResults[r];
+            ImGui::Text(
+                "%s %3d tracks: %8.2f us/block, %.3f ns/track-frame, %.2f GB/s",
+                result.avx2 ? "AVX2  " : "scalar", result.trackCount, result.microsecondsPerBlock, result.nanosecondsPerTrackFrame, result.gigabytesPerSecond
+            );
+        }
+
+        ImGui::Separator();
+        if (ImGui::Button("Benchmark EQ"))
+        {
+
+            EqBenchmarkResultCount = BenchmarkFilterBank(
+                AudioEngine->sampleRate, AudioEngine->blockSize, 2 * EQ_BENCHMARK_TRACKS, MIXER_EQ_BANDS, EqBenchmarkResults
+            );
+        }
+        ImGui::SameLine();
+        ImGui::Text("%d bands on %d stereo tracks", MIXER_EQ_BANDS, EQ_BENCHMARK_TRACKS);
+
+        for (int r = 0; r < EqBenchmarkResultCount; r++)
+        {
+            const FilterBankBenchmarkResult& result = EqBenchmarkResults[r];
+            ImGui::Text(
+                "%s %s: %8.2f us/block, %.3f ns/filter-sample, %5.1f%% of a core", EqKernelNames[result.kernel], result.modulated ? "modulated" : "static   ",
+                result.microsecondsPerBlock, result.nanosecondsPerFilterSample, result.corePercent
+            );
+        }
+
+        ImGui::Separator();
+        if (ImGui::Button("Check denormals"))
+        {
+
+            MeasureEngineDenormals(&DenormalReport);
+            DenormalChecked = true;
+        }
+        if (DenormalChecked)
+        {
+
+            ImGui::SameLine();
+            ImGui::Text("%s", DenormalReport.passed ? "PASS" : "FAIL");
+            ImGui::Text("Signal %.2f ns/frame, tail %.2f ns/frame (%.2fx)", DenormalReport.signalNanoseconds, DenormalReport.tailNanoseconds, DenormalReport.ratio);
+            ImGui::Text("Tail without flushing %.2f ns/frame (%.2fx)", DenormalReport.unprotectedTailNanoseconds, DenormalReport.unprotectedRatio);
+        }
+    }
+
+    return true;
+}
+
+#define MIDI_PATH_LENGTH 260
+char MidiPath[MIDI_PATH_LENGTH] = "";
+int MidiEventCount = 0;
+double MidiLoadMilliseconds = 0.0;
+
+bool LoadApplicationMidi(const char* path)
+{
+    const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    MidiPlayback* playback = new MidiPlayback();
+    if (!LoadMidiFile(path, &playback->sequence) || !BuildMidiTempoMap(&playback->sequence, AudioEngine->sampleRate, &playback->tempoMap))
+    {
+
+        delete playback;
+        return false;
+    }
+
+    MidiEventCount = (int)playback->sequence.events.size();
+    SetProjectTempoMap(&ApplicationHistory, &ApplicationProject, playback->tempoMap, "Import MIDI tempo");
+    MidiLoadMilliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    SetMidiSchedulerPlayback(&ApplicationSynth.scheduler, playback);
+    return SeekMidiScheduler(&ApplicationSynth.scheduler, 0);
+}
+
+bool DrawMidiTransport()
+{
+    if (ImGui::CollapsingHeader("MIDI"))
+    {
+
+        ImGui::InputText("File", MidiPath, MIDI_PATH_LENGTH);
+        ImGui::SameLine();
+        if (ImGui::Button("Load"))
+            LoadApplicationMidi(MidiPath);
+
+        MidiScheduler* scheduler = &ApplicationSynth.scheduler;
+        bool playing = scheduler->playing.load();
+        if (ImGui::Button(playing ? "Stop" : "Play"))
+        {
+
+            SetMidiSchedulerPlaying(scheduler, !playing);
+            SetTrackFreezePlaying(&TrackOneFreeze, !playing);
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Rewind"))
+        {
+
+            SeekMidiScheduler(scheduler, 0);
+            SeekTrackFreeze(&TrackOneFreeze, 0);
+        }
+
+        /* musical position comes from the tempo map rather than a fixed samples-per-second timebase */
+        int bar;
+        double beatInBar;
+        const double beat = SampleToBeat(&ApplicationProject.tempoMap, (double)scheduler->position.load());
+        BeatToBar(&ApplicationProject.tempoMap, beat, &bar, &beatInBar);
+        ImGui::SameLine();
+        ImGui::Text("%d.%d  %.1f BPM", bar + 1, (int)beatInBar + 1, GetTempoAtBeat(&ApplicationProject.tempoMap, beat));
+
+        if (MidiEventCount > 0)
+            ImGui::Text("%d events loaded in %.2f ms", MidiEventCount, MidiLoadMilliseconds);
+    }
+
+    return true;
+}
+
+const double ReverbBenchmarkSeconds[] = { 1.0, 2.0, 5.0, 10.0 };
+#define REVERB_BENCHMARK_SIZES (int)(sizeof(ReverbBenchmarkSeconds) / sizeof(double))
+ConvolutionBenchmarkResult ReverbBenchmarkResults[REVERB_BENCHMARK_SIZES];
+int ReverbBenchmarkResultCount = 0;
+char ReverbPath[CONVOLUTION_PATH_LENGTH] = "";
+
+bool DrawReverb()
+{
+    if (ImGui::CollapsingHeader("Reverb"))
+    {
+
+        ImGui::InputText("Impulse", ReverbPath, CONVOLUTION_PATH_LENGTH);
+        ImGui::SameLine();
+        if (ImGui::Button("Load impulse"))
+            SetConvolutionReverbImpulse(&ApplicationReverb, LoadConvolution(ReverbPath, AudioEngine->sampleRate, AudioEngine->channelCount));
+
+        float dry = ApplicationReverb.dry.load();
+        float wet = ApplicationReverb.wet.load();
+        if (ImGui::SliderFloat("Dry", &dry, 0.0f, 1.0f))
+            ApplicationReverb.dry.store(dry);
+        if (ImGui::SliderFloat("Wet", &wet, 0.0f, 1.0f))
+            ApplicationReverb.wet.store(wet);
+
+        const Convolution* impulse = ApplicationReverb.impulse;
+        if (impulse != NULL)
+        {
+
+            ImGui::Text(
+                "%.2f s, %d levels, %.1f MB, %llu partitions late", (double)impulse->impulseFrames / AudioEngine->sampleRate, impulse->channels[0].levelCount,
+                impulse->bytes / 1048576.0, impulse->lateJobs.load()
+            );
+        }
+
+        if (ImGui::Button("Benchmark reverb"))
+            ReverbBenchmarkResultCount = BenchmarkConvolution(AudioEngine->sampleRate, AudioEngine->blockSize, ReverbBenchmarkSeconds, REVERB_BENCHMARK_SIZES, ReverbBenchmarkResults);
+        for (int r = 0; r < ReverbBenchmarkResultCount; r++)
+        {
+            const ConvolutionBenchmarkResult& result = ReverbBenchmarkResults[r];
+            ImGui::Text(
+                "%4.1f s impulse: %.1f us/block on the audio thread, %.2f%% + %.2f%% pool = %.2f%% of a core, %.1f MB",
+                result.impulseSeconds, result.foregroundMicrosecondsPerBlock, result.foregroundPercent, result.backgroundPercent, result.totalPercent, result.megabytes
+            );
+        }
+    }
+
+    return true;
+}
+
+const char* DelayTypeNames[] = { "Echo", "Chorus", "Flanger" };
+const char* DelayInterpolationNames[DELAY_INTERPOLATION_COUNT] = { "Linear", "Cubic", "Allpass", "Windowed sinc" };
+const int DelayBenchmarkVoices[] = { 1, 4, 8, 16 };
+#define DELAY_BENCHMARK_SIZES (int)(sizeof(DelayBenchmarkVoices) / sizeof(int))
+DelayBenchmarkResult DelayBenchmarkResults[2 * DELAY_INTERPOLATION_COUNT * DELAY_BENCHMARK_SIZES];
+int DelayBenchmarkResultCount = 0;
+
+bool DrawDelay()
+{
+    if (ImGui::CollapsingHeader("Delay"))
+    {
+
+        ImGui::PushID(&ApplicationDelay);
+        bool bypassed = ApplicationDelay.bypassed.load();
+        if (ImGui::Checkbox("Bypass", &bypassed))
+            ApplicationDelay.bypassed.store(bypassed);
+
+        int type = ApplicationDelay.type.load();
+        for (int t = DELAY_EFFECT_ECHO; t <= DELAY_EFFECT_FLANGER; t++)
+        {
+            ImGui::SameLine();
+            if (ImGui::RadioButton(DelayTypeNames[t], &type, t))
+                SetDelayEffectType(&ApplicationDelay, t);
+        }
+
+        int interpolation = ApplicationDelay.interpolation.load();
+        if (ImGui::Combo("Interpolation", &interpolation, DelayInterpolationNames, DELAY_INTERPOLATION_COUNT))
+            ApplicationDelay.interpolation.store(interpolation);
+
+        int voices = ApplicationDelay.voices.load();
+        float time = ApplicationDelay.time.load();
+        float depth = ApplicationDelay.depth.load();
+        float rate = ApplicationDelay.rate.load();
+        float feedback = ApplicationDelay.feedback.load();
+        float damping = ApplicationDelay.damping.load();
+        float mix = ApplicationDelay.mix.load();
+        if (ImGui::SliderInt("Voices", &voices, 1, DELAY_MAX_VOICES))
+            ApplicationDelay.voices.store(voices);
+        if (ImGui::SliderFloat("Time ms", &time, 0.0f, DELAY_MAX_MILLISECONDS, "%.1f", ImGuiSliderFlags_Logarithmic))
+            ApplicationDelay.time.store(time);
+        if (ImGui::SliderFloat("Depth ms", &depth, 0.0f, DELAY_MAX_DEPTH_MILLISECONDS))
+            ApplicationDelay.depth.store(depth);
+        if (ImGui::SliderFloat("Rate Hz", &rate, 0.0f, 10.0f))
+            ApplicationDelay.rate.store(rate);
+        if (ImGui::SliderFloat("Feedback", &feedback, -0.95f, 0.95f))
+            ApplicationDelay.feedback.store(feedback);
+        if (ImGui::SliderFloat("Damping", &damping, 0.0f, 0.95f))
+            ApplicationDelay.damping.store(damping);
+        if (ImGui::SliderFloat("Mix", &mix, 0.0f, 1.0f))
+            ApplicationDelay.mix.store(mix);
+
+        if (ImGui::Button("Benchmark voices"))
+            DelayBenchmarkResultCount = BenchmarkDelay(AudioEngine->sampleRate, AudioEngine->blockSize, DelayBenchmarkVoices, DELAY_BENCHMARK_SIZES, DelayBenchmarkResults);
+        ImGui::SameLine();
+        ImGui::Text("AVX2 kernel %s", IsDelayKernelAVX2() ? "active" : "unavailable");
+        for (int r = 0; r < DelayBenchmarkResultCount; r++)
+        {
+            const DelayBenchmarkResult& result = DelayBenchmarkResults[r];
+            ImGui::Text(
+                "%s %-13s %2d voices: %6.1f ns/frame, %.2fx one scalar voice", result.avx2 ? "AVX2  " : "scalar", DelayInterpolationNames[result.interpolation],
+                result.voices, result.nanosecondsPerFrame, result.singleVoiceRatio
+            );
+        }
+        ImGui::PopID();
+    }
+
+    return true;
+}
+
+const char* TimeStretchModeNames[] = { "Phase vocoder", "WSOLA preview" };
+char StretchPath[TIME_STRETCH_PATH_LENGTH] = "";
+float StretchRatio = 1.0f;
+float StretchSemitones = 0.0f;
+int StretchMode = TIME_STRETCH_VOCODER;
+int StretchThreads = 0;
+TimeStretchReport StretchReport;
+bool StretchReported = false;
+
+bool DrawTimeStretch()
+{
+    if (ImGui::CollapsingHeader("Pitch and time stretch"))
+    {
+
+        ImGui::PushID(&ApplicationPitch);
+        bool bypassed = ApplicationPitch.bypassed.load();
+        if (ImGui::Checkbox("Bypass", &bypassed))
+            SetPitchShifterBypassed(&ApplicationPitch, bypassed);
+
+        int mode = ApplicationPitch.mode.load();
+        for (int m = TIME_STRETCH_VOCODER; m <= TIME_STRETCH_WSOLA; m++)
+        {
+            ImGui::SameLine();
+            if (ImGui::RadioButton(TimeStretchModeNames[m], &mode, m))
+                SetPitchShifterMode(&ApplicationPitch, m);
+        }
+
+        float semitones = ApplicationPitch.semitones.load();
+        if (ImGui::SliderFloat("Pitch semitones", &semitones, (float)-TIME_STRETCH_MAX_SEMITONES, (float)TIME_STRETCH_MAX_SEMITONES))
+            ApplicationPitch.semitones.store(semitones);
+        ImGui::Text("Latency %d frames, %llu underruns", ApplicationPitch.latency.load(), ApplicationPitch.underruns.load());
+
+        /* the file is written beside the original, so a clip can be pointed at it */
+        ImGui::Separator();
+        ImGui::InputText("Sound file", StretchPath, TIME_STRETCH_PATH_LENGTH);
+        ImGui::SliderFloat("Length ratio", &StretchRatio, (float)TIME_STRETCH_MIN_RATIO, (float)TIME_STRETCH_MAX_RATIO, "%.3f", ImGuiSliderFlags_Logarithmic);
+        ImGui::SliderFloat("Semitones", &StretchSemitones, (float)-TIME_STRETCH_MAX_SEMITONES, (float)TIME_STRETCH_MAX_SEMITONES);
+        ImGui::Combo("Method", &StretchMode, TimeStretchModeNames, 2);
+        ImGui::SliderInt("Threads (0 = all)", &StretchThreads, 0, max(1, (int)thread::hardware_concurrency()));
+        if (ImGui::Button("Stretch file"))
+        {
+
+            char output[TIME_STRETCH_PATH_LENGTH + 16];
+            snprintf(output, sizeof(output), "%s.stretched.wav", StretchPath);
+            StretchReported = StretchAudioFile(StretchPath, output, StretchMode, StretchRatio, StretchSemitones, StretchThreads, &StretchReport);
+        }
+        if (StretchReported)
+        {
+
+            ImGui::Text(
+                "%.1f s to %.1f s in %.0f ms on %d threads, %d segments: %.1fx realtime", StretchReport.inputSeconds, StretchReport.outputSeconds,
+                StretchReport.milliseconds, StretchReport.threads, StretchReport.segments, StretchReport.realtimeFactor
+            );
+        }
+        ImGui::PopID();
+    }
+
+    return true;
+}
+
+const float DynamicsBenchmarkLookahead[] = { 0.5f, 2.0f, 5.0f, 20.0f };
+#define DYNAMICS_BENCHMARK_SIZES (int)(sizeof(DynamicsBenchmarkLookahead) / sizeof(float))
+DynamicsBenchmarkResult DynamicsBenchmarkResults[2 * DYNAMICS_BENCHMARK_SIZES];
+int DynamicsBenchmarkResultCount = 0;
+
+bool DrawDynamics()
+{
+    if (ImGui::CollapsingHeader("Master dynamics"))
+    {
+
+        ImGui::PushID(&MasterDynamics);
+        bool bypassed = MasterDynamics.bypassed.load();
+        if (ImGui::Checkbox("Bypass", &bypassed))
+            MasterDynamics.bypassed.store(bypassed);
+
+        int mode = MasterDynamics.mode.load();
+        ImGui::SameLine();
+        if (ImGui::RadioButton("Compressor", &mode, DYNAMICS_COMPRESSOR))
+            SetDynamicsMode(&MasterDynamics, mode);
+        ImGui::SameLine();
+        if (ImGui::RadioButton("Limiter", &mode, DYNAMICS_LIMITER))
+            SetDynamicsMode(&MasterDynamics, mode);
+
+        float threshold = MasterDynamics.threshold.load();
+        if (ImGui::SliderFloat(mode == DYNAMICS_LIMITER ? "Ceiling dB" : "Threshold dB", &threshold, -40.0f, 0.0f))
+            MasterDynamics.threshold.store(threshold);
+
+        float lookahead = GetDynamicsLookahead(&MasterDynamics);
+        if (ImGui::SliderFloat("Lookahead ms", &lookahead, 0.0f, DYNAMICS_MAX_LOOKAHEAD_MILLISECONDS))
+            SetDynamicsLookahead(&MasterDynamics, lookahead);
+
+        float release = MasterDynamics.release.load();
+        if (ImGui::SliderFloat("Release ms", &release, 1.0f, 1000.0f, "%.0f", ImGuiSliderFlags_Logarithmic))
+            MasterDynamics.release.store(release);
+
+        if (mode == DYNAMICS_LIMITER)
+        {
+
+            bool truePeak = MasterDynamics.truePeak.load();
+            if (ImGui::Checkbox("True peak", &truePeak))
+                SetDynamicsTruePeak(&MasterDynamics, truePeak);
+        } else {
+            bool rms = MasterDynamics.detector.load() == DYNAMICS_DETECT_RMS;
+            if (ImGui::Checkbox("RMS detection", &rms))
+                MasterDynamics.detector.store(rms ? DYNAMICS_DETECT_RMS : DYNAMICS_DETECT_PEAK);
+
+            float ratio = MasterDynamics.ratio.load();
+            float knee = MasterDynamics.knee.load();
+            float attack = MasterDynamics.attack.load();
+            float makeup = MasterDynamics.makeup.load();
+            if (ImGui::SliderFloat("Ratio", &ratio, 1.0f, 20.0f))
+                MasterDynamics.ratio.store(ratio);
+            if (ImGui::SliderFloat("Knee dB", &knee, 0.0f, 24.0f))
+                MasterDynamics.knee.store(knee);
+            if (ImGui::SliderFloat("Attack ms", &attack, 0.0f, 100.0f))
+                MasterDynamics.attack.store(attack);
+            if (ImGui::SliderFloat("Makeup dB", &makeup, 0.0f, 24.0f))
+                MasterDynamics.makeup.store(makeup);
+        }
+
+        ImGui::Text("Reduction %.1f dB, latency %d frames", MasterDynamics.reduction.load(), MasterDynamics.latency.load());
+
+        if (ImGui::Button("Benchmark dynamics"))
+        {
+
+            DynamicsBenchmarkResultCount = BenchmarkDynamics(
+                AudioEngine->sampleRate, AudioEngine->blockSize, DynamicsBenchmarkLookahead, DYNAMICS_BENCHMARK_SIZES, DynamicsBenchmarkResults
+            );
+        }
+        for (int r = 0; r < DynamicsBenchmarkResultCount; r++)
+        {
+            const DynamicsBenchmarkResult& result = DynamicsBenchmarkResults[r];
+            ImGui::Text(
+                "%s %4.1f ms lookahead: %.2f ns/frame, %.3f%% of a core", result.avx2 ? "AVX2  " : "scalar", result.lookaheadMilliseconds,
+                result.nanosecondsPerFrame, result.corePercent
+            );
+        }
+        ImGui::PopID();
+    }
+
+    return true;
+}
+
+struct ExportFormatOption {
+    const char* label;
+    const char* suffix;
+    int format;
+    bool enabled;
+};
+
+/* every format shares one render; the 16 and 24 bit ones share one dithered conversion each */
+ExportFormatOption ExportFormatOptions[] = {
+    { "WAV float", ".wav", SF_FORMAT_WAV | SF_FORMAT_FLOAT, true },
+    { "WAV 24-bit", "-24.wav", SF_FORMAT_WAV | SF_FORMAT_PCM_24, false },
+    { "WAV 16-bit", "-16.wav", SF_FORMAT_WAV | SF_FORMAT_PCM_16, false },
+    { "AIFF 24-bit", ".aiff", SF_FORMAT_AIFF | SF_FORMAT_PCM_24, false },
+    { "FLAC 24-bit", ".flac", SF_FORMAT_FLAC | SF_FORMAT_PCM_24, false },
+    { "Ogg Vorbis", ".ogg", SF_FORMAT_OGG | SF_FORMAT_VORBIS, false },
+    { "MP3", ".mp3", SF_FORMAT_MPEG | SF_FORMAT_MPEG_LAYER_III, false },
+};
+#define EXPORT_FORMAT_OPTIONS (int)(sizeof(ExportFormatOptions) / sizeof(ExportFormatOption))
+
+char ExportPath[EXPORT_PATH_LENGTH] = "export";
+int ExportSeconds = 60;
+int ExportThreads = 0;
+ExportTarget ExportTargets[EXPORT_FORMAT_OPTIONS];
+int ExportTargetCount = 0;
+ExportFormatsReport ExportMixReport;
+bool ExportReported = false;
+const int ExportBenchmarkThreads[] = { 1, 2, 4, 8, 16, 32 };
+#define EXPORT_BENCHMARK_SIZES (int)(sizeof(ExportBenchmarkThreads) / sizeof(int))
+ExportBenchmarkResult ExportBenchmarkResults[EXPORT_BENCHMARK_SIZES];
+int ExportBenchmarkResultCount = 0;
+double ExportSerialMilliseconds = 0.0;
+
+/* the audio thread stops while the graph is copied, so no node state is cloned in the middle of a block */
+Engine* CreateApplicationExportTemplate(int* mixNode)
+{
+    const bool streaming = StopAudioStream(&ApplicationAudioStream);
+    Engine* engine = CreateExportTemplate(AudioEngine, ApplicationMixer->node, mixNode);
+    if (streaming)
+        StartAudioStream(&ApplicationAudioStream, AudioEngine);
+    return engine;
+}
+
+bool DrawExport()
+{
+    if (ImGui::CollapsingHeader("Mix export"))
+    {
+
+        const int cores = max(1, (int)thread::hardware_concurrency());
+        const long long frameCount = (long long)ExportSeconds * AudioEngine->sampleRate;
+        ImGui::InputText("Export file (no extension)", ExportPath, EXPORT_PATH_LENGTH);
+        for (int f = 0; f < EXPORT_FORMAT_OPTIONS; f++)
+        {
+            if (f % 4 != 0)
+                ImGui::SameLine();
+            ImGui::Checkbox(ExportFormatOptions[f].label, &ExportFormatOptions[f].enabled);
+        }
+        ImGui::SliderInt("Export length (s)", &ExportSeconds, 1, 3600);
+        ImGui::SliderInt("Export threads (0 = all)", &ExportThreads, 0, cores);
+        if (ImGui::Button("Export mix"))
+        {
+
+            ExportTargetCount = 0;
+            for (int f = 0; f < EXPORT_FORMAT_OPTIONS; f++)
+            {
+                if (!ExportFormatOptions[f].enabled)
+                    continue;
+
+                ExportTarget& target = ExportTargets[ExportTargetCount++];
+                snprintf(target.path, EXPORT_PATH_LENGTH, "%s%s", ExportPath, ExportFormatOptions[f].suffix);
+                target.format = ExportFormatOptions[f].format;
+            }
+            int mixNode;
+            Engine* exportTemplate = CreateApplicationExportTemplate(&mixNode);
+            ExportReported = exportTemplate != NULL && ExportMixFormats(exportTemplate, mixNode, frameCount, ExportThreads, ExportTargets, ExportTargetCount, &ExportMixReport);
+            DestroyExportTemplate(exportTemplate);
+        }
+        if (ExportReported)
+        {
+
+            const ExportReport& render = ExportMixReport.render;
+            ImGui::Text("%.1f s in %.0f ms on %d threads: %.1fx realtime", render.seconds, render.milliseconds, render.threads, render.realtimeFactor);
+            ImGui::Text(
+                "%d of %d stems in segments, %d stem jobs; mix in %d %s", render.segmentedStems, render.stems, render.stemJobs, render.mixJobs,
+                render.segmentedMix ? "segments" : "job"
+            );
+            ImGui::Text(
+                "%d files from one render and %d conversions in %.0f ms, %.0f ms after the render", ExportMixReport.targets, ExportMixReport.conversions,
+                ExportMixReport.milliseconds, ExportMixReport.drainMilliseconds
+            );
+            for (int t = 0; t < ExportTargetCount; t++)
+                ImGui::Text("%s: encoded in %.0f ms", ExportTargets[t].path, ExportTargets[t].milliseconds);
+        }
+
+        /* every thread count the machine has cores for, against one engine rendering the whole graph on one thread */
+        if (ImGui::Button("Measure export speedup"))
+        {
+
+            int threadCounts[EXPORT_BENCHMARK_SIZES];
+            int count = 0;
+            for (int i = 0; i < EXPORT_BENCHMARK_SIZES; i++)
+            {
+                if (ExportBenchmarkThreads[i] <= cores)
+                    threadCounts[count++] = ExportBenchmarkThreads[i];
+            }
+            int mixNode;
+            Engine* exportTemplate = CreateApplicationExportTemplate(&mixNode);
+            ExportBenchmarkResultCount = exportTemplate != NULL ?
+                BenchmarkExport(exportTemplate, mixNode, frameCount, threadCounts, count, ExportBenchmarkResults, &ExportSerialMilliseconds) : 0;
+            DestroyExportTemplate(exportTemplate);
+        }
+        if (ExportBenchmarkResultCount > 0)
+            ImGui::Text("Single-threaded export: %.0f ms", ExportSerialMilliseconds);
+        for (int r = 0; r < ExportBenchmarkResultCount; r++)
+        {
+            const ExportBenchmarkResult& result = ExportBenchmarkResults[r];
+            ImGui::Text("%2d threads: %.0f ms, %.2fx speedup, peak difference %.1e", result.threads, result.milliseconds, result.speedup, result.peakDifference);
+        }
+    }
+
+    return true;
+}
+
+char ProjectPath[PROJECT_PATH_LENGTH] = "project.dawp";
+char ProjectStatus[128] = "";
+
+bool DrawProjectFile()
+{
+    if (ImGui::CollapsingHeader("Project"))
+    {
+
+        ImGui::InputText("Path", ProjectPath, PROJECT_PATH_LENGTH);
+        if (ImGui::Button("Save"))
+        {
+
+            ProjectSaveReport report;
+            RecordProjectMixer(&ApplicationHistory, &ApplicationProject, ApplicationMixer);
+            if (SaveProject(ProjectPath, &ApplicationProject, &report))
+            {
+
+                snprintf(
+                    ProjectStatus, sizeof(ProjectStatus), "Saved %d of %d chunks, %llu bytes%s in %.2f ms",
+                    report.writtenChunks, report.chunkCount, report.writtenBytes, report.compacted ? " (full rewrite)" : "", report.milliseconds
+                );
+            }
+            else
+                snprintf(ProjectStatus, sizeof(ProjectStatus), "Save failed");
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Open"))
+        {
+
+            const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            Project project;
+            if (LoadProject(ProjectPath, &project))
+            {
+
+                ApplicationProject = project;
+                ResetProjectHistory(&ApplicationHistory, &ApplicationProject, ApplicationHistory.memoryCap);
+                ApplyProjectMixer(&ApplicationProject, ApplicationMixer);
+                snprintf(
+                    ProjectStatus, sizeof(ProjectStatus), "Opened %d clips in %.2f ms", (int)ApplicationProject.timeline.clips.size(),
+                    chrono::duration<double, milli>(chrono::steady_clock::now() - start).count()
+                );
+            }
+            else
+                snprintf(ProjectStatus, sizeof(ProjectStatus), "Open failed");
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Export JSON"))
+        {
+
+            char path[PROJECT_PATH_LENGTH + 8];
+            snprintf(path, sizeof(path), "%s.json", ProjectPath);
+            RecordProjectMixer(&ApplicationHistory, &ApplicationProject, ApplicationMixer);
+            snprintf(ProjectStatus, sizeof(ProjectStatus), ExportProjectJson(&ApplicationProject, path) ? "Exported %s" : "Export to %s failed", path);
+        }
+
+        ImGui::Text("%s: %d tracks, %d clips", ApplicationProject.name, (int)ApplicationProject.timeline.tracks.size(), (int)ApplicationProject.timeline.clips.size());
+        ImGui::Text("%s", ProjectStatus);
+    }
+
+    return true;
+}
+
+int HistoryMemoryCapMegabytes = (int)(PROJECT_HISTORY_DEFAULT_MEMORY >> 20);
+
+bool DrawProjectHistory()
+{
+    /* a step can restore mixer settings, so the live mixer follows the project after every one */
+    ImGuiIO& io = ImGui::GetIO();
+    bool stepped = false;
+    if (io.KeyCtrl && ImGui::IsKeyPressed(ImGuiKey_Z))
+        stepped |= UndoProjectEdit(&ApplicationHistory, &ApplicationProject);
+    if (io.KeyCtrl && ImGui::IsKeyPressed(ImGuiKey_Y))
+        stepped |= RedoProjectEdit(&ApplicationHistory, &ApplicationProject);
+
+    if (ImGui::CollapsingHeader("Edit"))
+    {
+
+        if (ImGui::Button("Undo") && CanUndoProjectEdit(&ApplicationHistory))
+            stepped |= UndoProjectEdit(&ApplicationHistory, &ApplicationProject);
+        ImGui::SameLine();
+        if (ImGui::Button("Redo") && CanRedoProjectEdit(&ApplicationHistory))
+            stepped |= RedoProjectEdit(&ApplicationHistory, &ApplicationProject);
+        ImGui::SameLine();
+        if (ImGui::Button("Add track"))
+        {
+
+            char name[TIMELINE_NAME_LENGTH];
+            snprintf(name, sizeof(name), "Track %d", (int)ApplicationProject.timeline.tracks.size() + 1);
+            AddProjectTrack(&ApplicationHistory, &ApplicationProject, name);
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Add marker"))
+            AddProjectMarker(&ApplicationHistory, &ApplicationProject, ApplicationSynth.scheduler.position.load(), "Marker");
+
+        if (ImGui::SliderInt("History memory (MB)", &HistoryMemoryCapMegabytes, 16, 4096))
+            SetProjectHistoryMemoryCap(&ApplicationHistory, (unsigned long long)HistoryMemoryCapMegabytes << 20);
+
+        ImGui::Text(
+            "%d undo, %d redo steps, %.2f MB held", ApplicationHistory.current, (int)ApplicationHistory.versions.size() - ApplicationHistory.current - 1,
+            GetProjectHistoryMemory(&ApplicationHistory) / 1048576.0
+        );
+        ImGui::Text("Current: %s", ApplicationHistory.versions[ApplicationHistory.current].label);
+    }
+
+    if (stepped)
+        ApplyProjectMixer(&ApplicationProject, ApplicationMixer);
+    return true;
+}
+
+Autosave ApplicationAutosave;
+
+bool DrawAutosave()
+{
+    if (ImGui::CollapsingHeader("Autosave"))
+    {
+
+        ImGui::SliderInt("Interval (s)", &ApplicationAutosave.intervalSeconds, 0, 600, ApplicationAutosave.intervalSeconds == 0 ? "Off" : "%d");
+        ImGui::SliderInt("Keep", &ApplicationAutosave.retention, 1, AUTOSAVE_MAX_RETENTION);
+        if (ImGui::Button("Autosave now"))
+        {
+
+            RecordProjectMixer(&ApplicationHistory, &ApplicationProject, ApplicationMixer);
+            RequestAutosave(&ApplicationAutosave, &ApplicationHistory, ProjectPath);
+        }
+
+        AutosaveReport report;
+        if (GetAutosaveReport(&ApplicationAutosave, &report))
+        {
+
+            char path[AUTOSAVE_PATH_LENGTH];
+            GetAutosavePath(ProjectPath, report.slot, path, sizeof(path));
+            ImGui::Text("%s %s", report.saved ? "Saved" : "Failed to save", path);
+            ImGui::Text(
+                "Snapshot %.2f us, build %.2f ms, write %.2f ms, %llu bytes", report.snapshotMicroseconds, report.buildMilliseconds,
+                report.writeMilliseconds, report.writtenBytes
+            );
+        }
+        ImGui::Text("Audio underruns: %u", ApplicationAudioStream.underruns.load());
+    }
+
+    return true;
+}
+
+AssetImport ApplicationImport;
+char ImportDirectory[IMPORT_PATH_LENGTH] = "samples";
+int ImportThreads = 0;
+int ImportSelected = -1;
+
+/* called every frame: finished files join the project at once, while the rest still import */
+bool PollApplicationImport()
+{
+    ImportedAsset* assets[IMPORT_MAX_FILES];
+    const int count = CollectImportedAssets(&ApplicationImport, assets, IMPORT_MAX_FILES);
+    if (count == 0)
+        return false;
+
+    const char* paths[IMPORT_MAX_FILES];
+    for (int a = 0; a < count; a++)
+        paths[a] = assets[a]->path;
+    ImportProjectAssets(&ApplicationHistory, &ApplicationProject, paths, count);
+    return true;
+}
+
+bool DrawImport()
+{
+    if (ImGui::CollapsingHeader("Import"))
+    {
+
+        const int cores = max(1, (int)thread::hardware_concurrency());
+        ImGui::InputText("Folder", ImportDirectory, IMPORT_PATH_LENGTH);
+        ImGui::SliderInt("Import threads (0 = all but one)", &ImportThreads, 0, cores);
+        if (ImGui::Button("Import folder"))
+        {
+
+            ImportSelected = -1;
+            StartAssetImport(&ApplicationImport, ImportDirectory, AudioEngine->sampleRate, ImportThreads);
+        }
+
+        AssetImportReport report;
+        if (!GetAssetImportReport(&ApplicationImport, &report))
+            return true;
+
+        char progress[64];
+        snprintf(progress, sizeof(progress), "%d / %d files", report.finished, report.files);
+        ImGui::ProgressBar((float)report.finished / report.files, ImVec2(-1.0f, 0.0f), progress);
+        ImGui::Text(
+            "%.1f files/s, %.1f MB/s on %d threads, %.1f MB in %.2f s, %d failed", report.filesPerSecond, report.megabytesPerSecond, report.threads,
+            report.megabytes, report.seconds, report.failed
+        );
+
+        /* only the stage is read until a file is done, so a decode never holds up a frame */
+        ImGui::BeginChild("Imported files", ImVec2(0.0f, 160.0f), true);
+        for (int a = 0; a < (int)ApplicationImport.assets.size(); a++)
+        {
+            const ImportedAsset* asset = ApplicationImport.assets[a];
+            const int stage = asset->stage.load(std::memory_order_acquire);
+            char label[IMPORT_PATH_LENGTH + 32];
+            snprintf(label, sizeof(label), "%s (%s)##%d", asset->path, GetImportStageName(stage), a);
+            if (ImGui::Selectable(label, ImportSelected == a) && stage == IMPORT_DONE)
+                ImportSelected = a;
+        }
+        ImGui::EndChild();
+
+        if (ImportSelected >= 0)
+        {
+
+            const ImportedAsset* asset = ApplicationImport.assets[ImportSelected];
+            ImGui::Text(
+                "%d Hz, %d channels, %.2f s, imported in %.1f ms", asset->sourceRate, asset->channelCount,
+                (double)asset->frameCount / ApplicationImport.sampleRate, asset->milliseconds
+            );
+            ImGui::PlotHistogram("##Peaks", asset->peaks.data() + 1, (int)asset->peaks.size() / 2, 0, NULL, 0.0f, 1.0f, ImVec2(-1.0f, 60.0f), sizeof(float) * 2);
+        }
+    }
+
+    return true;
+}
+
+vector<string> RealtimeViolationText;
+
+bool DrawRealtimeSafety()
+{
+    if (!IsRealtimeSafetyInstalled())
+        return false;
+
+    if (ImGui::CollapsingHeader("Real-time safety"))
+    {
+
+        /* symbolized once per violation; the stacks do not change after they are recorded */
+        const int violationCount = GetRealtimeViolationCount();
+        for (int v = (int)RealtimeViolationText.size(); v < violationCount; v++)
+        {
+            RealtimeViolation violation;
+            char text[REALTIME_SAFETY_DESCRIPTION_LENGTH];
+            if (!GetRealtimeViolation(v, &violation) || !DescribeRealtimeViolation(&violation, text, sizeof(text)))
+                break;
+            RealtimeViolationText.push_back(text);
+        }
+
+        ImGui::Text("%d violations, %llu calls on real-time threads", violationCount, GetRealtimeViolationTotal());
+        ImGui::SameLine();
+        if (ImGui::Button("Clear"))
+        {
+
+            ClearRealtimeViolations();
+            RealtimeViolationText.clear();
+        }
+        for (const string& text : RealtimeViolationText)
+            ImGui::TextUnformatted(text.c_str());
+    }
+
+    return true;
+}
+
+LogBenchmarkReport LogBenchmark;
+bool LogBenchmarked = false;
+
+bool DrawLog()
+{
+    if (ImGui::CollapsingHeader("Log"))
+    {
+
+        ImGui::Text("%llu records written, %llu dropped", GetLogWrittenCount(), GetLogDroppedCount());
+        if (ImGui::Button("Benchmark log calls"))
+            LogBenchmarked = MeasureLogOverhead(&LogBenchmark);
+        if (LogBenchmarked)
+        {
+
+            ImGui::Text(
+                "%d calls: %.2f ns/call, worst burst %.2f ns/call, %llu dropped", LogBenchmark.calls, LogBenchmark.nanosecondsPerCall,
+                LogBenchmark.worstNanoseconds, LogBenchmark.dropped
+            );
+            if (LogBenchmark.checked)
+                ImGui::Text("%llu real-time violations while logging", LogBenchmark.violations);
+        }
+    }
+
+    return true;
+}
+
+#define TRACE_SAVE_SECONDS 10.0
+
+char TracePath[TRACE_PATH_LENGTH] = "";
+
+/* the timeline of every thread, saved for Perfetto or chrome://tracing */
+bool DrawTrace()
+{
+    if (ImGui::CollapsingHeader("Trace"))
+    {
+
+        bool enabled = IsTraceEnabled();
+        if (ImGui::Checkbox("Record trace", &enabled))
+            SetTraceEnabled(enabled);
+        bool xrunSaving = IsTraceXrunSaving();
+        if (ImGui::Checkbox("Save trace on underrun", &xrunSaving))
+            SetTraceXrunSaving(xrunSaving);
+
+        ImGui::Text("%llu events recorded", GetTraceEventCount());
+        if (ImGui::Button("Save trace"))
+        {
+
+            FormatTracePath("trace", TracePath, sizeof(TracePath));
+            if (!SaveTrace(TracePath, TRACE_SAVE_SECONDS))
+                TracePath[0] = '\0';
+        }
+        if (TracePath[0] != '\0')
+            ImGui::Text("Last trace: %s", TracePath);
+    }
+
+    return true;
+}
+
+bool DrawPerformanceRow(const char* name, const PerformanceStats* stats, double period)
+{
+    if (stats->blocks == 0)
+        return false;
+
+    const double average = stats->totalSeconds / stats->blocks;
+    ImGui::PushID(stats);
+    ImGui::TableNextRow();
+    ImGui::TableNextColumn();
+    ImGui::TextUnformatted(name);
+    ImGui::TableNextColumn();
+    ImGui::Text("%.1f", average * 1e6);
+    ImGui::TableNextColumn();
+    ImGui::Text("%.1f", stats->worstSeconds * 1e6);
+    ImGui::TableNextColumn();
+    ImGui::Text("%.2f%%", average / period * 100.0);
+    ImGui::TableNextColumn();
+    ImGui::PlotHistogram("##histogram", stats->histogram, PERFORMANCE_HISTOGRAM_BINS, 0, NULL, 0.0f, FLT_MAX, ImVec2(160, 18));
+    ImGui::PopID();
+
+    return true;
+}
+
+bool DrawPerformanceTable(const char* label)
+{
+    if (!ImGui::BeginTable(label, 5, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit))
+        return false;
+
+    ImGui::TableSetupColumn("Name");
+    ImGui::TableSetupColumn("Avg us");
+    ImGui::TableSetupColumn("Worst us");
+    ImGui::TableSetupColumn("Load");
+    ImGui::TableSetupColumn("Histogram");
+    ImGui::TableHeadersRow();
+    return true;
+}
+
+/* the DSP window: load against the period, worst block, underruns, and where the time goes by track and by node */
+bool DrawPerformance()
+{
+    const int trackCount = ApplicationMixer->trackCount.load();
+    int trackNodes[PERFORMANCE_MAX_TRACKS];
+    const char* trackNames[PERFORMANCE_MAX_TRACKS];
+    for (int t = 0; t < trackCount && t < PERFORMANCE_MAX_TRACKS; t++)
+    {
+        trackNodes[t] = ApplicationMixer->tracks[t].sourceNode;
+        trackNames[t] = ApplicationMixer->tracks[t].strip.name;
+    }
+    SetPerformanceMonitorTracks(&ApplicationPerformance, trackNodes, trackNames, trackCount);
+    UpdatePerformanceMonitor(&ApplicationPerformance);
+
+    const double period = (double)AudioEngine->blockSize / AudioEngine->sampleRate;
+    ImGui::Begin("DSP performance");
+    ImGui::Text("DSP load %.1f%% (peak %.1f%%)", ApplicationPerformance.load * 100.0, ApplicationPerformance.peakLoad * 100.0);
+    ImGui::PlotLines(
+        "##load", ApplicationPerformance.loadHistory, PERFORMANCE_HISTORY_BLOCKS, ApplicationPerformance.historyPosition, "Load %", 0.0f, 100.0f, ImVec2(0, 60)
+    );
+    ImGui::Text("Worst block %.1f us of a %.1f us period", GetPerformanceWorstSeconds(&ApplicationPerformance) * 1e6, period * 1e6);
+    ImGui::Text(
+        "Underruns %u, blocks not profiled %llu", ApplicationAudioStream.underruns.load(), GetPerformanceDroppedBlocks(&ApplicationPerformance)
+    );
+    if (ImGui::Button("Reset"))
+        ResetPerformanceMonitor(&ApplicationPerformance);
+    ImGui::SameLine();
+    ImGui::TextDisabled("histogram bins double from %.0f ns", PERFORMANCE_HISTOGRAM_FIRST_NANOSECONDS);
+
+    if (DrawPerformanceTable("Blocks"))
+    {
+
+        DrawPerformanceRow("Block", &ApplicationPerformance.blocks, period);
+        for (int t = 0; t < ApplicationPerformance.trackCount; t++)
+            DrawPerformanceRow(ApplicationPerformance.tracks[t].name, &ApplicationPerformance.tracks[t].stats, period);
+        ImGui::EndTable();
+    }
+
+    if (ImGui::CollapsingHeader("Nodes") && DrawPerformanceTable("Nodes"))
+    {
+
+        for (int n = 0; n < AudioEngine->nodeCount; n++)
+            DrawPerformanceRow(AudioEngine->nodes[n].name, &ApplicationPerformance.nodes[n], period);
+        ImGui::EndTable();
+    }
+    ImGui::End();
+
+    return true;
+}
+
 bool ApplicationShouldDrawBackground = false;
 #define APPLICATION_SHOULD_DRAW_BACKGROUND ApplicationShouldDrawBackground
 bool PluginShouldDrawBackground = true;
@@ -189,6 +1394,7 @@ bool PluginShouldDrawBackground = true;
 
 bool ConfigureApplicationWindowFrame()
 {
+    TraceScope trace("UI frame");
     SetApplicationWindowColor();
 
     ImGui_ImplOpenGL3_NewFrame();
@@ -219,7 +1425,25 @@ bool ConfigureApplicationWindowFrame()
         DrawPluginOscilloscope(oscilloscopeLabel, amplitudes, samples, nyquistLimit);
     }
 
+    ApplicationOscillator.frequency.store(Frequency);
+    DrawPluginBrowser();
+    DrawMixer();
+    DrawMidiTransport();
+    DrawReverb();
+    DrawDelay();
+    DrawTimeStretch();
+    DrawDynamics();
+    DrawExport();
+    DrawProjectFile();
+    DrawImport();
+    DrawProjectHistory();
+    DrawAutosave();
+    DrawRealtimeSafety();
+    DrawLog();
+    DrawTrace();
+
     ImGui::End();
+    DrawPerformance();
     glUseProgram(APPLICATION_WINDOW_GL_PROGRAM);
     SetPluginOptions();
 
@@ -237,6 +1461,7 @@ bool ConfigureApplicationWindowFrame()
 
 bool ReframeApplicationWindow(GLFWwindow* window)
 {
+    TraceScope trace("Swap buffers");
     glfwSwapBuffers(window);
     return true;
 }
@@ -255,72 +1480,151 @@ bool ExitGLFW(GLFWwindow* window, int numberOfObjects = 1)
     return true;
 }
 
-ALshort monoSamples[BUFFER_LENGTH];
-ALshort stereoSamples[BUFFER_LENGTH * 2];
-
-ALuint alBuffer[BUFFER_SIZE], alSource;
-
 ALCdevice* alDevice;
 ALCcontext* alContext;
 
-void GenerateWaveData()
+bool ConfigureAudioEngine()
 {
-    if (CHANNEL_COUNT == 1)
-    {
+    AudioEngine = CreateEngine(APPLICATION_SAMPLE_RATE, BLOCK_SIZE, CHANNEL_COUNT);
+    if (AudioEngine == NULL)
+        return false;
 
-        for (int i = 0; i < BUFFER_LENGTH; ++i) {
-            monoSamples[i * CHANNEL_COUNT] = sin(2 * M_PI * (short)Frequency * i / BUFFER_LENGTH) * SHRT_MAX;
-        }
+    InitializeProject(&ApplicationProject, "Untitled", AudioEngine->sampleRate);
+    ResetProjectHistory(&ApplicationHistory, &ApplicationProject);
 
-        for (int b = 0; b < BUFFER_SIZE; b++)
-        {
-            alBufferData(alBuffer[b], AL_FORMAT_MONO16, monoSamples, sizeof(monoSamples), BUFFER_LENGTH * CHANNEL_COUNT);
-            alSourceQueueBuffers(alSource, 1, &alBuffer[b]);
-        }
-    }
+    OscillatorNode = AddOscillatorNode(AudioEngine, &ApplicationOscillator, Frequency);
+    TrackNode = AddEngineNode(AudioEngine, "Track 1", NULL, NULL);
 
-    if (CHANNEL_COUNT == 2)
-    {
+    ApplicationMixer = CreateMixer(AudioEngine);
+    if (ApplicationMixer == NULL)
+        return false;
 
-        for (int i = 0; i < BUFFER_LENGTH; ++i) {
-            stereoSamples[i * CHANNEL_COUNT] = sin(2 * M_PI * (short)Frequency * i / BUFFER_LENGTH / CHANNEL_COUNT) * SHRT_MAX;
-            stereoSamples[i * CHANNEL_COUNT + 1] = -1 * sin(2 * M_PI * Frequency * i / BUFFER_LENGTH / CHANNEL_COUNT) * SHRT_MAX;
-        }
+    AddMixerTrack(ApplicationMixer, "Track 1", TrackNode);
 
-        for (int b = 0; b < BUFFER_SIZE; b++)
-        {
-            alBufferData(alBuffer[b], AL_FORMAT_STEREO16, stereoSamples, sizeof(stereoSamples), BUFFER_LENGTH * CHANNEL_COUNT);
-            alSourceQueueBuffers(alSource, 1, &alBuffer[b]);
-        }
-    }
+    StartConvolutionPool(&ApplicationConvolutionPool);
+    ReverbNode = AddConvolutionReverbNode(AudioEngine, &ApplicationReverb, &ApplicationConvolutionPool);
+    InitializeDelayEffect(&ApplicationDelay, AudioEngine->sampleRate, AudioEngine->channelCount, AudioEngine->blockSize);
+    AddDelayEffectNode(AudioEngine, &ApplicationDelay, "Delay");
+    InitializePitchShifter(&ApplicationPitch, AudioEngine->channelCount);
+    AddPitchShifterNode(AudioEngine, &ApplicationPitch, "Pitch shift");
+
+    StartDiskStreamer(&ApplicationStreamer);
+    AddTrackFreezeNode(AudioEngine, &TrackOneFreeze, &ApplicationStreamer, OscillatorNode);
+
+    SynthNode = AddMidiSynthNode(AudioEngine, &ApplicationSynth);
+    AddMixerTrack(ApplicationMixer, "MIDI", SynthNode);
+
+    /* the master dynamics sit after the mixer, so everything heard or exported passes through them */
+    InitializeDynamics(&MasterDynamics, AudioEngine->sampleRate, AudioEngine->channelCount, AudioEngine->blockSize);
+    AddDynamicsNode(AudioEngine, &MasterDynamics, "Master dynamics");
+    ConnectEngineNodes(AudioEngine, ApplicationMixer->node, MasterDynamics.node);
+    SetEngineOutputNode(AudioEngine, MasterDynamics.node);
+
+    PluginLibraryCount = ScanPluginDirectories(PluginLibraries, PLUGIN_MAX_LIBRARIES);
+    StartPerformanceMonitor(&ApplicationPerformance, AudioEngine);
+
+    return ConfigureEngineGraph();
 }
 
 void ExitAL()
 {
-    alSourceStop(alSource);
-    alDeleteSources(1, &alSource);
-    alDeleteBuffers(1, alBuffer);
+    StopAudioStream(&ApplicationAudioStream);
+    StopPerformanceMonitor(&ApplicationPerformance);
+    ReleaseConvolutionReverb(&ApplicationReverb);
+    StopConvolutionPool(&ApplicationConvolutionPool);
+    ReleaseTrackFreeze(&TrackOneFreeze);
+    StopDiskStreamer(&ApplicationStreamer);
+
+    for (PluginInstance* plugin : PluginChain)
+        DestroyPluginInstance(plugin);
+    PluginChain.clear();
+    DestroyEngine(AudioEngine);
+    DestroyMixer(ApplicationMixer);
+    ReleaseMidiScheduler(&ApplicationSynth.scheduler);
+
+    for (int l = 0; l < PluginLibraryCount; l++)
+        UnloadPluginLibrary(&PluginLibraries[l]);
+
     alcMakeContextCurrent(NULL);
     alcDestroyContext(alContext);
     alcCloseDevice(alDevice);
 }
 
-ALint iBuffersProcessed = 0;
-ALint iTotalBuffersProcessed = 0;
+bool HasCommandLineArgument(int argc, char** argv, const char* argument)
+{
+    for (int a = 1; a < argc; a++)
+    {
+        if (strcmp(argv[a], argument) == 0)
+            return true;
+    }
+
+    return false;
+}
+
+/* renders the configured graph with the real-time checks on and fails on any violation */
+int RunRealtimeSafetyTest(int argc, char** argv)
+{
+    const int seconds = argc >= 3 ? atoi(argv[2]) : REALTIME_SAFETY_TEST_SECONDS;
+    RealtimeSafetyReport report;
+    CheckEngineRealtimeSafety(AudioEngine, (long long)(seconds > 0 ? seconds : REALTIME_SAFETY_TEST_SECONDS) * AudioEngine->sampleRate, &report);
+
+    for (int v = 0; v < report.violationCount; v++)
+    {
+        RealtimeViolation violation;
+        char text[REALTIME_SAFETY_DESCRIPTION_LENGTH];
+        if (GetRealtimeViolation(v, &violation) && DescribeRealtimeViolation(&violation, text, sizeof(text)))
+            printf("%s", text);
+    }
+    printf(
+        "Real-time safety %s: %lld frames in %.2f ms, %d violations, %llu calls%s\n", report.passed ? "passed" : "failed", report.renderedFrames,
+        report.renderMilliseconds, report.violationCount, report.violationTotal, report.checkerActive ? "" : ", checks not active"
+    );
+
+    return report.passed ? 0 : 1;
+}
 
-int main()
+int main(int argc, char** argv)
 {
+    if (IsPluginSandboxCommandLine(argc, argv))
+        return RunPluginSandbox(argc, argv);
+
+    StartLog(APPLICATION_LOG_PATH);
+    SetTraceThreadName("UI");
+
+    /* headless: the batch opens no audio device and no window */
+    if (IsBatchRenderCommandLine(argc, argv))
+    {
+
+        const int result = RunBatchRender(argc, argv);
+        StopLog();
+        return result;
+    }
 
     alDevice = alcOpenDevice(NULL);
     alContext = alcCreateContext(alDevice, NULL);
     alcMakeContextCurrent(alContext);
-    
-    alGenSources(1, &alSource);
-    alGenBuffers(BUFFER_SIZE, alBuffer);
 
-    GenerateWaveData();
+    ConfigureAudioEngine();
+
+    /* installed after the plugin scan so the plugin libraries are patched too */
+    const bool realtimeTest = argc >= 2 && strcmp(argv[1], REALTIME_SAFETY_TEST_ARGUMENT) == 0;
+#if defined(_DEBUG)
+    const bool realtimeSafety = true;
+#else
+    const bool realtimeSafety = realtimeTest || HasCommandLineArgument(argc, argv, REALTIME_SAFETY_ARGUMENT);
+#endif
+    if (realtimeSafety)
+        InstallRealtimeSafety();
+    if (realtimeTest)
+    {
 
-    printf("End of OpenAL configuration");
+        const int result = RunRealtimeSafetyTest(argc, argv);
+        ExitAL();
+        StopLog();
+        return result;
+    }
+
+    LogMessage(LOG_INFO, "End of OpenAL configuration");
 
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
@@ -353,8 +1657,9 @@ int main()
             SetPluginOptions();
 
             /* al */
-            alSourcePlay(alSource);
+            StartAudioStream(&ApplicationAudioStream, AudioEngine);
             /* al */
+            StartAutosave(&ApplicationAutosave);
 
             while (!glfwWindowShouldClose(window))
             {
@@ -363,38 +1668,40 @@ int main()
                 glfwPollEvents();
 
                 /* al */
-                alGetSourcei(alSource, AL_BUFFERS_PROCESSED, &iBuffersProcessed);
-
-                iTotalBuffersProcessed += iBuffersProcessed;
-
-                ALuint uiBufferRemoved = 0;
-                alGenBuffers(BUFFER_SIZE, &uiBufferRemoved);
-                alSourceUnqueueBuffers(alSource, 1, &uiBufferRemoved);
-
-                alBufferData(uiBufferRemoved, AL_FORMAT_MONO16, monoSamples, sizeof(monoSamples), BUFFER_LENGTH * CHANNEL_COUNT);
-
-                iBuffersProcessed--;
-
-                if (iTotalBuffersProcessed == BUFFER_SIZE)
+                CollectEngineGarbage(AudioEngine);
+                CollectMidiSchedulerGarbage(&ApplicationSynth.scheduler);
+                CollectConvolutionGarbage(&ApplicationReverb);
+                if (UpdateTrackFreeze(&TrackOneFreeze))
+                    ConfigureEngineGraph();
+                if (IsAutosaveDue(&ApplicationAutosave))
                 {
 
-                    GenerateWaveData();
-
-                    alSourcePlay(alSource);
-
-                    iBuffersProcessed = 0;
-                    iTotalBuffersProcessed = 0;
+                    /* the mixer is snapshotted into the history only when an autosave is due, so fader moves do not flood the undo steps */
+                    RecordProjectMixer(&ApplicationHistory, &ApplicationProject, ApplicationMixer);
+                    PollAutosave(&ApplicationAutosave, &ApplicationHistory, ProjectPath);
+                }
+                PollApplicationImport();
+                if (PollTraceXrun(TracePath, sizeof(TracePath)))
+                    LogMessage(LOG_WARNING, "The audio stream underran; the trace around it is in %s", TracePath);
+                for (PluginInstance* plugin : PluginChain)
+                {
+                    PollPluginInstance(plugin);
+                    UpdatePluginLatency(AudioEngine, plugin);
                 }
                 /* al */
             }
         }
 
+        StopAutosave(&ApplicationAutosave);
+        StopAssetImport(&ApplicationImport);
         ExitAL();
         ExitGLFW(window);
+        StopLog();
 
         return 0;
     }
     else {
+        StopLog();
         return -1;
     }
 }
\ No newline at end of file